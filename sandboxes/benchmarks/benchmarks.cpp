@@ -0,0 +1,104 @@
+// Timings of the performance critical parts of libslic3r on the test models and on generated input.
+// The unit tests only check the behavior, the timings are collected here.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+#include <libslic3r/Format/OBJ.hpp>
+
+#include "benchmarks.hpp"
+
+const std::string USAGE_STR = {
+    "Usage: benchmarks [benchmark_name ...]\n"
+    "Runs all the benchmarks if no name is given."
+};
+
+using namespace Slic3r;
+
+static const struct {
+    const char *name;
+    void      (*run)();
+} benchmarks[] = {
+    { "mesh_slicing_threads",        Benchmark::mesh_slicing_threads },
+    { "mesh_slicing_sweep",          Benchmark::mesh_slicing_sweep },
+    { "gcode_time_estimator",        Benchmark::gcode_time_estimator },
+    { "gcode_reader",                Benchmark::gcode_reader },
+    { "clipper_offset_ladder",       Benchmark::clipper_offset_ladder },
+    { "edge_grid",                   Benchmark::edge_grid },
+    { "gcode_writer",                Benchmark::gcode_writer },
+    { "cooling_buffer",              Benchmark::cooling_buffer },
+    { "infill",                      Benchmark::infill },
+    { "gyroid_wave_cache",           Benchmark::gyroid_wave_cache },
+    { "stl_load",                    Benchmark::stl_load },
+    { "gyroid_wave",                 Benchmark::gyroid_wave },
+    { "mesh_slicing_transformed",    Benchmark::mesh_slicing_transformed },
+};
+
+TriangleMesh Slic3r::Benchmark::load_test_mesh(const char *obj_filename)
+{
+    TriangleMesh mesh;
+    if (! load_obj((std::string(TEST_DATA_DIR) + "/" + obj_filename).c_str(), &mesh))
+        throw std::runtime_error(std::string("Failed to load ") + obj_filename);
+    mesh.repair();
+    return mesh;
+}
+
+void Slic3r::Benchmark::load_test_print(std::initializer_list<const char*> obj_filenames, const DynamicPrintConfig &config, Model &model, Print &print)
+{
+    for (const char *obj_filename : obj_filenames) {
+        ModelObject *object = model.add_object();
+        object->name = obj_filename;
+        object->add_volume(load_test_mesh(obj_filename));
+        object->add_instance();
+    }
+    model.arrange_objects(PrintConfig::min_object_distance(&config));
+    model.center_instances_around_point(Vec2d(100, 100));
+    for (ModelObject *object : model.objects) {
+        object->ensure_on_bed();
+        // Only the instances checked in the object list are printed.
+        for (ModelInstance *instance : object->instances)
+            instance->checked = true;
+        print.auto_assign_extruders(object);
+    }
+    print.apply(model, config);
+    print.validate();
+    print.set_status_silent();
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; ++ i) {
+        bool known = false;
+        for (const auto &benchmark : benchmarks)
+            known |= strcmp(argv[i], benchmark.name) == 0;
+        if (! known) {
+            std::cerr << "Unknown benchmark " << argv[i] << std::endl << USAGE_STR << std::endl << "Benchmarks:" << std::endl;
+            for (const auto &benchmark : benchmarks)
+                std::cerr << "  " << benchmark.name << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    int result = EXIT_SUCCESS;
+    for (const auto &benchmark : benchmarks) {
+        bool selected = argc == 1;
+        for (int i = 1; i < argc; ++ i)
+            selected |= strcmp(argv[i], benchmark.name) == 0;
+        if (! selected)
+            continue;
+        std::cout << "== " << benchmark.name << std::endl;
+        try {
+            benchmark.run();
+        } catch (const std::exception &ex) {
+            std::cerr << benchmark.name << " failed: " << ex.what() << std::endl;
+            result = EXIT_FAILURE;
+        }
+    }
+    return result;
+}
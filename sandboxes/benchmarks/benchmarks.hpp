@@ -0,0 +1,58 @@
+#ifndef slic3r_benchmarks_hpp_
+#define slic3r_benchmarks_hpp_
+
+#include <chrono>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+
+namespace Slic3r {
+
+class DynamicPrintConfig;
+class Model;
+class Print;
+class TriangleMesh;
+
+namespace Benchmark {
+
+// Wall clock time of fn() in seconds.
+template<typename Fn> double time_it(Fn &&fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The benchmarks check their results, so that the timings of a broken build are not reported.
+inline void check(bool condition, const char *expression, const char *file, int line)
+{
+    if (! condition)
+        throw std::runtime_error(std::string(file) + ":" + std::to_string(line) + ": Check failed: " + expression);
+}
+
+#define BENCHMARK_CHECK(condition) Slic3r::Benchmark::check((condition), #condition, __FILE__, __LINE__)
+
+// Load an OBJ file of the test data and repair it.
+TriangleMesh load_test_mesh(const char *obj_filename);
+// Load OBJ files of the test data as objects of a model, arrange them on the bed and apply them to the print.
+void load_test_print(std::initializer_list<const char*> obj_filenames, const DynamicPrintConfig &config, Model &model, Print &print);
+
+// The benchmarks, printing their timings to the standard output.
+void mesh_slicing_threads();
+void mesh_slicing_sweep();
+void gcode_time_estimator();
+void gcode_reader();
+void clipper_offset_ladder();
+void edge_grid();
+void gcode_writer();
+void cooling_buffer();
+void infill();
+void gyroid_wave_cache();
+void stl_load();
+void gyroid_wave();
+void mesh_slicing_transformed();
+
+} // namespace Benchmark
+} // namespace Slic3r
+
+#endif /* slic3r_benchmarks_hpp_ */
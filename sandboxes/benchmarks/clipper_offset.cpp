@@ -0,0 +1,66 @@
+#include <iostream>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/ClipperUtils.hpp>
+#include <libslic3r/ExPolygon.hpp>
+
+#include "benchmarks.hpp"
+
+namespace Slic3r {
+namespace Benchmark {
+
+// Insets and gaps of 40 combs and boxes with a hole, calculated one by one and by the OffsetLadder.
+void clipper_offset_ladder()
+{
+    coord_t s = 1000000;
+    ExPolygons islands;
+    for (int i = 0; i < 40; ++ i) {
+        ExPolygon comb;
+        comb.contour.points = { { 0, 0 }, { 30 * s, 0 }, { 30 * s, 15 * s } };
+        for (coord_t x = 29 * s; x > 0; x -= 3 * s) {
+            comb.contour.points.emplace_back(x, 15 * s);
+            comb.contour.points.emplace_back(x, 5 * s);
+            comb.contour.points.emplace_back(x - 2 * s, 5 * s);
+            comb.contour.points.emplace_back(x - 2 * s, 15 * s);
+        }
+        comb.contour.points.emplace_back(0, 15 * s);
+        ExPolygon box;
+        box.contour.points = { { 40 * s, 0 }, { 60 * s, 0 }, { 60 * s, 20 * s }, { 40 * s, 20 * s } };
+        box.holes.emplace_back(Points{ { 47 * s, 7 * s }, { 47 * s, 13 * s }, { 53 * s, 13 * s }, { 53 * s, 7 * s } });
+        for (ExPolygon *expoly : { &comb, &box }) {
+            expoly->translate(0, i * 25 * s);
+            islands.emplace_back(std::move(*expoly));
+        }
+    }
+    float delta    = 0.45f * s;
+    float collapse = 0.2f * s;
+    size_t num_levels_ref = 0;
+    double t_ref = time_it([&islands, delta, collapse, &num_levels_ref]() {
+        for (const ExPolygon &island : islands) {
+            ExPolygons last { island };
+            for (int i = 0; i < 10; ++ i, ++ num_levels_ref) {
+                ExPolygons level = offset2_ex(last, - delta - collapse, collapse);
+                if (level.empty())
+                    break;
+                diff_ex(offset(last, - 0.5f * delta), offset(level, 0.5f * delta + 10.f));
+                last = std::move(level);
+            }
+        }
+    });
+    size_t num_levels = 0;
+    double t = time_it([&islands, delta, collapse, &num_levels]() {
+        for (const ExPolygon &island : islands) {
+            OffsetLadder ladder(ExPolygons { island });
+            for (int i = 0; i < 10; ++ i, ++ num_levels) {
+                if (ladder.inset(delta, collapse).empty())
+                    break;
+                ladder.gaps(0.5f * delta, 0.5f * delta + 10.f);
+            }
+        }
+    });
+    std::cout << "Offsets one by one: " << t_ref << "s, offset ladder: " << t << "s" << std::endl;
+    BENCHMARK_CHECK(num_levels == num_levels_ref);
+}
+
+} // namespace Benchmark
+} // namespace Slic3r
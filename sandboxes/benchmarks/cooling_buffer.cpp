@@ -0,0 +1,48 @@
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/GCode.hpp>
+#include <libslic3r/GCode/CoolingBuffer.hpp>
+
+#include "benchmarks.hpp"
+
+namespace Slic3r {
+namespace Benchmark {
+
+// CoolingBuffer::process_layer() of a layer of 100 thousand extrusion moves, split into paths of 50 moves as GCode::_extrude() emits them.
+void cooling_buffer()
+{
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    config.set_deserialize({ { "cooling", "1" }, { "slowdown_below_layer_time", "1000" }, { "gcode_comments", "1" } });
+    PrintConfig print_config;
+    print_config.apply(config, true);
+    GCode gcodegen;
+    gcodegen.apply_print_config(print_config);
+    gcodegen.set_layer_count(10);
+    GCodeWriter &writer = gcodegen.writer();
+    writer.set_extruders({ 0 });
+    writer.set_extruder(0);
+    std::unique_ptr<CoolingBuffer> buffer = std::make_unique<CoolingBuffer>(gcodegen);
+
+    std::string gcode;
+    for (size_t i = 0; i < 2000; ++ i) {
+        gcode += writer.set_speed(2400, "", (i % 4 == 0) ? ";_EXTRUDE_SET_SPEED;_EXTERNAL_PERIMETER" : ";_EXTRUDE_SET_SPEED");
+        for (size_t j = 0; j < 50; ++ j)
+            gcode += writer.extrude_to_xy(Vec2d(double(j % 2) * 10. + 50., double(i) * 0.01 + double(j) * 0.1), 0.05, "perimeter");
+        gcode += ";_EXTRUDE_END\n";
+        gcode += writer.travel_to_xy(Vec2d(50., double(i) * 0.01));
+    }
+    const size_t num_runs = 10;
+    std::string out;
+    double t = time_it([&buffer, &gcode, &out, num_runs]() {
+        for (size_t i = 0; i < num_runs; ++ i)
+            out = buffer->process_layer(gcode, 1);
+    }) / double(num_runs);
+    std::cout << "CoolingBuffer::process_layer() of " << gcode.size() / 1024 << " kB: " << t * 1000. << "ms" << std::endl;
+    BENCHMARK_CHECK(out.find(";_EXTRUDE_SET_SPEED") == std::string::npos);
+}
+
+} // namespace Benchmark
+} // namespace Slic3r
@@ -0,0 +1,77 @@
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/EdgeGrid.hpp>
+
+#include "benchmarks.hpp"
+
+namespace Slic3r {
+namespace Benchmark {
+
+// Gear like contour with a circular hole, sampled finely enough to place many edges into each grid cell.
+static ExPolygon gear(double radius, int num_teeth, int segments_per_tooth)
+{
+    ExPolygon out;
+    int n = num_teeth * segments_per_tooth;
+    for (int i = 0; i < n; ++ i) {
+        double a = 2. * PI * double(i) / double(n);
+        double r = radius * (1. + 0.1 * std::sin(a * num_teeth));
+        out.contour.points.emplace_back(Point::new_scale(r * std::cos(a), r * std::sin(a)));
+    }
+    Polygon hole;
+    for (int i = n - 1; i >= 0; -- i) {
+        double a = 2. * PI * double(i) / double(n);
+        hole.points.emplace_back(Point::new_scale(0.3 * radius * std::cos(a), 0.3 * radius * std::sin(a)));
+    }
+    out.holes.emplace_back(std::move(hole));
+    return out;
+}
+
+// Creation of the grid of 16 gears, its signed distance field, and the signed distance of a million points
+// queried one by one and in batches.
+void edge_grid()
+{
+    ExPolygons shapes;
+    for (int i = 0; i < 16; ++ i) {
+        shapes.emplace_back(gear(20., 30, 200));
+        shapes.back().translate(scale_(50. * (i % 4)), scale_(50. * (i / 4)));
+    }
+    EdgeGrid::Grid grid;
+    double t_create = time_it([&grid, &shapes]() { grid.create(shapes, coord_t(scale_(1.))); });
+    double t_sdf    = time_it([&grid]() { grid.calculate_sdf(); });
+    // Points close to the contours, as the points of the perimeters queried by the seam placement.
+    coord_t search_radius = coord_t(scale_(0.6));
+    Points  pts;
+    {
+        Points         contour_points = to_points(to_polygons(shapes));
+        std::mt19937   rng(0);
+        std::uniform_int_distribution<size_t>  ipt(0, contour_points.size() - 1);
+        std::uniform_int_distribution<coord_t> jitter(- search_radius, search_radius);
+        pts.reserve(1000000);
+        for (size_t i = 0; i < 1000000; ++ i)
+            pts.emplace_back(contour_points[ipt(rng)] + Point(jitter(rng), jitter(rng)));
+    }
+    std::vector<coordf_t> dist_one_by_one(pts.size());
+    std::vector<bool>     found_one_by_one(pts.size());
+    double t_one_by_one = time_it([&]() {
+        for (size_t i = 0; i < pts.size(); ++ i)
+            found_one_by_one[i] = grid.signed_distance(pts[i], search_radius, dist_one_by_one[i]);
+    });
+    std::vector<coordf_t> dist_batch;
+    // The first batch query prepares the edge data for the vectorized evaluation.
+    double t_batch_first = time_it([&]() { dist_batch = grid.signed_distance(pts, search_radius); });
+    double t_batch       = time_it([&]() { dist_batch = grid.signed_distance(pts, search_radius); });
+    std::cout << "create: " << t_create << "s, calculate_sdf: " << t_sdf << "s" << std::endl;
+    std::cout << "signed distance of " << pts.size() << " points one by one: " << t_one_by_one << "s, first batch: " << t_batch_first << "s, next batch: " << t_batch << "s" << std::endl;
+    BENCHMARK_CHECK(dist_batch.size() == pts.size());
+    size_t num_mismatches = 0;
+    for (size_t i = 0; i < pts.size(); ++ i)
+        if (found_one_by_one[i] ? std::abs(dist_batch[i] - dist_one_by_one[i]) > 1. : ! std::isnan(dist_batch[i]))
+            ++ num_mismatches;
+    BENCHMARK_CHECK(num_mismatches == 0);
+}
+
+} // namespace Benchmark
+} // namespace Slic3r
@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Fill/Fill.hpp>
+#include <libslic3r/Fill/FillGyroid.hpp>
+#include <libslic3r/Geometry.hpp>
+#include <libslic3r/Layer.hpp>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+
+#include "benchmarks.hpp"
+
+namespace Slic3r {
+namespace Benchmark {
+
+// Filling the sparse infill surfaces of all the layers of two test models with the patterns having a shared pattern cache.
+// Layer::make_fills() picks the pattern by the "method" option, therefore the surfaces are filled here directly.
+void infill()
+{
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    config.set_deserialize({
+        { "fill_density",   "35%" },
+        { "layer_height",   "0.1" }
+    });
+    Model model;
+    Print print;
+    load_test_print({ "ipadstand.obj", "extruder_idler.obj" }, config, model, print);
+    print.process();
+    for (const char *pattern : { "gyroid", "rectilinear", "honeycomb" }) {
+        size_t num_surfaces = 0;
+        size_t num_polylines = 0;
+        double t = time_it([&print, pattern, &num_surfaces, &num_polylines]() {
+            for (const PrintObject *object : print.objects())
+                for (const Layer *layer : object->layers())
+                    for (const LayerRegion *layerm : layer->regions())
+                        for (const Surface &surface : layerm->fill_surfaces.surfaces)
+                            if (surface.surface_type == stInternal) {
+                                std::unique_ptr<Fill> filler(Fill::new_from_type(pattern));
+                                filler->layer_id = layer->id();
+                                filler->z        = layer->print_z;
+                                filler->angle    = float(Geometry::deg2rad(layerm->region()->config().fill_angle.value));
+                                filler->spacing  = layerm->flow(frInfill).spacing();
+                                FillParams params;
+                                params.density = 0.35f;
+                                Surface surface_fill(surface);
+                                num_polylines += filler->fill_surface(&surface_fill, params).size();
+                                ++ num_surfaces;
+                            }
+        });
+        std::cout << pattern << ": fill_surface() of " << num_surfaces << " surfaces: " << t << "s, " << num_polylines << " polylines" << std::endl;
+        BENCHMARK_CHECK(num_polylines > 0);
+    }
+}
+
+// Gyroid fill_surface() of 500 layers of a 100x100mm square, 0.2mm apart, covering about 80 periods of the pattern.
+void gyroid_wave_cache()
+{
+    Surface surface(stInternal, ExPolygon(Polygon::new_scale({ {0, 0}, {100, 0}, {100, 100}, {0, 100} })));
+    std::unique_ptr<Fill> filler(Fill::new_from_type("gyroid"));
+    filler->angle   = 0.f;
+    filler->spacing = 0.45;
+    FillParams fill_params;
+    fill_params.density = 0.2f;
+    size_t num_points = 0;
+    double t = time_it([&surface, &filler, &fill_params, &num_points]() {
+        for (size_t i = 0; i < 500; ++ i) {
+            filler->z = 0.2 * double(i + 1);
+            for (const Polyline &polyline : filler->fill_surface(&surface, fill_params))
+                num_points += polyline.points.size();
+        }
+    });
+    std::cout << "gyroid: fill_surface() of 500 layers: " << t << "s, " << num_points << " points" << std::endl;
+    BENCHMARK_CHECK(num_points > 0);
+}
+
+// The gyroid wave evaluated by libm sample by sample, as FillGyroid did before, and by the batch evaluation of FillGyroid::wave().
+// The waves take a few percent of fill_surface() of a simple square, the rest is clipping, chaining and connecting the lines.
+void gyroid_wave()
+{
+    const size_t        num_samples = 1000000;
+    std::vector<double> xs(num_samples);
+    for (size_t i = 0; i < num_samples; ++ i)
+        xs[i] = 2. * PI * double(i) / double(num_samples);
+    std::vector<double> ys_libm(num_samples), ys_batch(num_samples);
+    const size_t        num_phases = 20;
+    double t_libm = time_it([&xs, &ys_libm, num_phases]() {
+        for (size_t k = 0; k < num_phases; ++ k) {
+            double z_sin = sin(0.3 * double(k)), z_cos = cos(0.3 * double(k));
+            bool   vertical = std::abs(z_sin) <= std::abs(z_cos);
+            for (size_t i = 0; i < xs.size(); ++ i) {
+                double x = xs[i], a, b, res;
+                if (vertical) {
+                    double phase_offset = (z_cos < 0 ? PI : 0) + PI;
+                    a   = sin(x + phase_offset);
+                    b   = - z_cos;
+                    res = z_sin * cos(x + phase_offset);
+                } else {
+                    double phase_offset = z_sin < 0 ? PI : 0.;
+                    a   = cos(x + phase_offset);
+                    b   = - z_sin;
+                    res = z_cos * sin(x + phase_offset + PI);
+                }
+                double r = sqrt(a * a + b * b);
+                ys_libm[i] = asin(a / r) + asin(res / r) + (vertical ? PI : 0.5 * PI);
+            }
+        }
+    });
+    double t_batch = time_it([&xs, &ys_batch, num_phases]() {
+        for (size_t k = 0; k < num_phases; ++ k) {
+            double z_sin = sin(0.3 * double(k)), z_cos = cos(0.3 * double(k));
+            FillGyroid::wave(z_sin, z_cos, std::abs(z_sin) <= std::abs(z_cos), false, xs.data(), ys_batch.data(), xs.size());
+        }
+    });
+    double max_error = 0.;
+    for (size_t i = 0; i < num_samples; ++ i)
+        max_error = std::max(max_error, std::abs(ys_batch[i] - ys_libm[i]));
+    std::cout << "gyroid wave of " << num_phases * num_samples << " samples: libm " << t_libm << "s, FillGyroid::wave() " << t_batch <<
+        "s, max difference " << max_error << std::endl;
+    BENCHMARK_CHECK(max_error < 1e-12);
+}
+
+} // namespace Benchmark
+} // namespace Slic3r
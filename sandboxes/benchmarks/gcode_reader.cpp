@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/GCodeReader.hpp>
+
+#include "benchmarks.hpp"
+
+namespace Slic3r {
+namespace Benchmark {
+
+// Parsing a large G-code file line by line read by std::getline() and memory mapped by GCodeReader::parse_file().
+void gcode_reader()
+{
+    boost::filesystem::path temp = boost::filesystem::unique_path();
+    {
+        std::ostringstream out;
+        out << "; synthetic G-code\nG21\nG90\nM83\n";
+        char buf[128];
+        for (size_t layer = 0; layer < 2000; ++ layer) {
+            sprintf(buf, "G1 Z%.3f F7800 ; layer %d\n", 0.2 + 0.2 * layer, int(layer));
+            out << buf;
+            for (size_t i = 0; i < 3000; ++ i) {
+                sprintf(buf, "G1 X%.3f Y%.3f E%.5f\n", 100. + (i % 37), 100. + (i % 91) * 0.5, 0.01 + (i % 7) * 0.001);
+                out << buf;
+            }
+            out << "G92 E0\n\n";
+        }
+        std::string gcode = out.str();
+        std::ofstream f(temp.string(), std::ios::binary);
+        f << gcode;
+        std::cout << "G-code: " << gcode.size() / 1048576 << " MB" << std::endl;
+    }
+    size_t num_extrusions_getline = 0;
+    double t_getline = time_it([&temp, &num_extrusions_getline]() {
+        GCodeReader reader;
+        std::ifstream f(temp.string());
+        std::string line;
+        while (std::getline(f, line))
+            reader.parse_line(line, [&num_extrusions_getline](GCodeReader &reader, const GCodeReader::GCodeLine &line)
+                { num_extrusions_getline += line.extruding(reader); });
+    });
+    size_t num_extrusions = 0;
+    double t_parse_file = time_it([&temp, &num_extrusions]() {
+        GCodeReader reader;
+        reader.parse_file(temp.string(), [&num_extrusions](GCodeReader &reader, const GCodeReader::GCodeLine &line)
+            { num_extrusions += line.extruding(reader); });
+    });
+    boost::nowide::remove(temp.string().c_str());
+    std::cout << "std::getline() and parse_line(): " << num_extrusions_getline << " extrusions in " << t_getline << "s" << std::endl;
+    std::cout << "parse_file(): " << num_extrusions << " extrusions in " << t_parse_file << "s" << std::endl;
+    BENCHMARK_CHECK(num_extrusions > 0);
+    BENCHMARK_CHECK(num_extrusions_getline == num_extrusions);
+}
+
+} // namespace Benchmark
+} // namespace Slic3r
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/GCodeTimeEstimator.hpp>
+
+#include "benchmarks.hpp"
+
+namespace Slic3r {
+namespace Benchmark {
+
+// Time estimate of a multi-million line G-code, fed to the estimator in line aligned blocks the way GCode::_write() does.
+void gcode_time_estimator()
+{
+    // Layers of short circular extrusions, similar to perimeters of a finely tessellated model.
+    std::string gcode;
+    {
+        std::ostringstream out;
+        out << "M83\nG21\nG90\nM204 S1000 T1250\n";
+        char buf[128];
+        for (int layer = 0; layer < 500; ++ layer) {
+            sprintf(buf, "G1 Z%.3f F7800\n", 0.2 + 0.2 * layer);
+            out << buf;
+            for (int loop = 0; loop < 20; ++ loop) {
+                double r = 5. + 2. * loop;
+                out << ((loop & 1) ? "G1 F1800\n" : "G1 F2400\n");
+                for (int i = 0; i <= 400; ++ i) {
+                    double a = 2. * M_PI * i / 400.;
+                    sprintf(buf, "G1 X%.3f Y%.3f E%.5f\n", 100. + r * cos(a), 100. + r * sin(a), 0.01);
+                    out << buf;
+                }
+            }
+        }
+        gcode = out.str();
+    }
+    std::cout << "G-code: " << std::count(gcode.begin(), gcode.end(), '\n') << " lines, " << gcode.size() / 1048576 << " MB" << std::endl;
+    GCodeTimeEstimator estimator(GCodeTimeEstimator::Normal);
+    size_t memory_used = 0;
+    double t = time_it([&gcode, &estimator, &memory_used]() {
+        for (size_t pos = 0; pos < gcode.size();) {
+            size_t end = gcode.find('\n', std::min(gcode.size() - 1, pos + 4096));
+            if (end == std::string::npos)
+                end = gcode.size() - 1;
+            estimator.add_gcode_block(gcode.substr(pos, end + 1 - pos));
+            pos = end + 1;
+        }
+        memory_used = estimator.memory_used();
+        estimator.calculate_time();
+    });
+    std::cout << "Estimated " << estimator.get_time_dhms() << " in " << t << "s, estimator memory " <<
+        memory_used / 1048576 << " MB before / " << estimator.memory_used() / 1048576 << " MB after calculate_time()" << std::endl;
+    BENCHMARK_CHECK(estimator.get_time() > 0.f);
+}
+
+} // namespace Benchmark
+} // namespace Slic3r
@@ -0,0 +1,73 @@
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/GCodeWriter.hpp>
+
+#include "benchmarks.hpp"
+
+namespace Slic3r {
+namespace Benchmark {
+
+// The extrusion move as GCodeWriter::extrude_to_xy() formatted it with a std::ostringstream per move.
+static std::string extrude_to_xy_iostream(const Vec2d &point, double E, const std::string &extrusion_axis, const std::string &object_color)
+{
+    std::ostringstream gcode;
+    gcode << "C " << object_color << " ; for custom object color\n";
+    gcode << "G1 X" << std::fixed << std::setprecision(3) << point(0)
+          <<   " Y" << std::fixed << std::setprecision(3) << point(1)
+          <<    " " << extrusion_axis << std::fixed << std::setprecision(5) << E;
+    gcode << "\n";
+    return gcode.str();
+}
+
+// Emitting extrusion moves with the std::ostringstream formatting, the string returning GCodeWriter::extrude_to_xy()
+// and the variant appending to a G-code buffer.
+void gcode_writer()
+{
+    const size_t        num_moves = 2000000;
+    const double        dE        = 0.05;
+    std::vector<Vec2d>  pts;
+    pts.reserve(num_moves);
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> coord(0., 250.);
+    for (size_t i = 0; i < num_moves; ++ i)
+        pts.emplace_back(coord(rng), coord(rng));
+
+    std::string iostream;
+    double t_iostream = time_it([&pts, &iostream, dE]() {
+        double E = 0.;
+        for (const Vec2d &pt : pts) {
+            E += dE;
+            iostream += extrude_to_xy_iostream(pt, E, "E", "#FFFFFF");
+        }
+    });
+    std::string returned;
+    double t_returned = time_it([&pts, &returned, dE]() {
+        GCodeWriter writer;
+        writer.set_extruders({ 0 });
+        writer.set_extruder(0);
+        for (const Vec2d &pt : pts)
+            returned += writer.extrude_to_xy(pt, dE);
+    });
+    std::string appended;
+    double t_appended = time_it([&pts, &appended, dE]() {
+        GCodeWriter writer;
+        writer.set_extruders({ 0 });
+        writer.set_extruder(0);
+        for (const Vec2d &pt : pts)
+            writer.extrude_to_xy(appended, pt, dE);
+    });
+    std::cout << "std::ostringstream: " << num_moves / t_iostream << " moves/s" << std::endl;
+    std::cout << "extrude_to_xy() returning strings: " << num_moves / t_returned << " moves/s" << std::endl;
+    std::cout << "extrude_to_xy() appending: " << num_moves / t_appended << " moves/s" << std::endl;
+    BENCHMARK_CHECK(returned == appended);
+    BENCHMARK_CHECK(iostream == appended);
+}
+
+} // namespace Benchmark
+} // namespace Slic3r
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <tbb/task_arena.h>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/TriangleMesh.hpp>
+#include <admesh/stl.h>
+
+#include "benchmarks.hpp"
+
+namespace Slic3r {
+namespace Benchmark {
+
+static std::vector<float> slicing_heights(const TriangleMesh &mesh, float layer_height)
+{
+    std::vector<float> z;
+    BoundingBoxf3 bbox = mesh.bounding_box();
+    for (double h = bbox.min.z() + 0.5 * layer_height; h < bbox.max.z(); h += layer_height)
+        z.emplace_back(float(h));
+    return z;
+}
+
+// Slicing of a large mesh with the TBB scheduler limited to 1, 2, 4 ... threads.
+void mesh_slicing_threads()
+{
+    // About 2M facets sliced at 0.05mm layers.
+    TriangleMesh mesh = make_sphere(50., 2. * PI / 1440.);
+    std::vector<float> z = slicing_heights(mesh, 0.05f);
+    std::cout << "Slicing " << mesh.facets_count() << " facets into " << z.size() << " layers" << std::endl;
+    double t1 = 0.;
+    for (int num_threads = 1; num_threads <= std::max(1, int(std::thread::hardware_concurrency())); num_threads *= 2) {
+        std::vector<Polygons> layers;
+        double t = time_it([&mesh, &z, &layers, num_threads]() {
+            tbb::task_arena arena(num_threads);
+            arena.execute([&mesh, &z, &layers]() {
+                TriangleMeshSlicer slicer(&mesh);
+                slicer.slice(z, &layers, [](){});
+            });
+        });
+        if (num_threads == 1)
+            t1 = t;
+        std::cout << "  threads: " << num_threads << ", time: " << t << "s, speedup: " << t1 / t << std::endl;
+        BENCHMARK_CHECK(layers.size() == z.size());
+    }
+}
+
+// Repeated slicing with varying layer heights, as if the user was editing the layer height,
+// by intersecting each facet with the slicing planes and by sweeping the planes over the facets sorted by z.
+void mesh_slicing_sweep()
+{
+    auto report = [](const std::string &name, const TriangleMesh &mesh) {
+        std::vector<std::vector<float>> zs;
+        for (float layer_height : { 0.2f, 0.15f, 0.1f, 0.07f, 0.05f })
+            zs.emplace_back(slicing_heights(mesh, layer_height));
+        auto slice = [&zs](const TriangleMeshSlicer &slicer) {
+            for (const std::vector<float> &z : zs) {
+                std::vector<Polygons> layers;
+                slicer.slice(z, &layers, [](){});
+                BENCHMARK_CHECK(layers.size() == z.size());
+            }
+        };
+        TriangleMeshSlicer slicer(&mesh);
+        double t_facets = time_it([&slicer, &slice]() { slice(slicer); });
+        TriangleMeshSlicer slicer_sweep(&mesh);
+        double t_index  = time_it([&slicer_sweep]() { slicer_sweep.build_z_index(); });
+        double t_sweep  = time_it([&slicer_sweep, &slice]() { slice(slicer_sweep); });
+        std::cout << name << " (" << mesh.facets_count() << " facets, " << zs.size() << " slicing runs): per facet " << t_facets <<
+            "s, sweep " << t_sweep << "s + index " << t_index << "s" << std::endl;
+    };
+    for (const char *obj_filename : { "20mm_cube.obj", "frog_legs.obj", "extruder_idler.obj", "ipadstand.obj", "bridge.obj" })
+        report(obj_filename, load_test_mesh(obj_filename));
+    report("sphere 500k", make_sphere(50., 2. * PI / 720.));
+    report("sphere 2M", make_sphere(50., 2. * PI / 1440.));
+}
+
+// Repeated slicing of a rotated and scaled volume: a transformed copy of the mesh indexed for each slicing run,
+// as PrintObject did before, against the mesh indexed once by the ModelVolume and transformed by the slicer on the fly.
+void mesh_slicing_transformed()
+{
+    auto report = [](const std::string &name, TriangleMesh &&mesh) {
+        Model       model;
+        ModelVolume &volume = *model.add_object()->add_volume(std::move(mesh));
+        volume.set_rotation(Vec3d(0.3, 0.2, 0.1));
+        volume.set_scaling_factor(Vec3d(1.1, 0.9, 1.2));
+        const Transform3d &trafo = volume.get_matrix();
+        TriangleMesh transformed(volume.mesh());
+        transformed.transform(trafo, true);
+        std::vector<float> z = slicing_heights(transformed, 0.1f);
+        const int runs = 5;
+        std::vector<Polygons> layers_copy;
+        double t_copy = time_it([&volume, &trafo, &z, &layers_copy]() {
+            for (int i = 0; i < runs; ++ i) {
+                TriangleMesh copy(volume.mesh());
+                copy.transform(trafo, true);
+                if (copy.repaired)
+                    stl_check_facets_exact(&copy.stl);
+                copy.require_shared_vertices();
+                TriangleMeshSlicer slicer(&copy);
+                layers_copy.clear();
+                slicer.slice(z, &layers_copy, [](){});
+            }
+        });
+        std::vector<Polygons> layers_trafo;
+        double t_cache = time_it([&volume]() { volume.slicing_mesh(); });
+        double t_trafo = time_it([&volume, &trafo, &z, &layers_trafo]() {
+            for (int i = 0; i < runs; ++ i) {
+                ModelVolume::SlicingMesh slicing_mesh = volume.slicing_mesh();
+                TriangleMeshSlicer slicer;
+                slicer.init(slicing_mesh.mesh.get(), trafo, slicing_mesh.facets_edges, [](){});
+                layers_trafo.clear();
+                slicer.slice(z, &layers_trafo, [](){});
+            }
+        });
+        BENCHMARK_CHECK(layers_copy.size() == z.size() && layers_trafo.size() == z.size());
+        size_t points_copy = 0, points_trafo = 0;
+        for (size_t i = 0; i < z.size(); ++ i) {
+            for (const Polygon &p : layers_copy[i])  points_copy  += p.points.size();
+            for (const Polygon &p : layers_trafo[i]) points_trafo += p.points.size();
+        }
+        BENCHMARK_CHECK(points_copy == points_trafo);
+        std::cout << name << " (" << transformed.facets_count() << " facets, " << runs << " slicing runs): transformed copy " << t_copy <<
+            "s, init with transformation " << t_trafo << "s + cached mesh " << t_cache << "s" << std::endl;
+    };
+    for (const char *obj_filename : { "extruder_idler.obj", "ipadstand.obj" })
+        report(obj_filename, load_test_mesh(obj_filename));
+    report("sphere 500k", make_sphere(50., 2. * PI / 720.));
+}
+
+} // namespace Benchmark
+} // namespace Slic3r
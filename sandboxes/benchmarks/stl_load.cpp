@@ -0,0 +1,58 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include <boost/filesystem.hpp>
+
+#include <libslic3r/libslic3r.h>
+#include <admesh/stl.h>
+
+#include "benchmarks.hpp"
+
+namespace Slic3r {
+namespace Benchmark {
+
+// Loading an ASCII and a binary STL file of a million random facets by stl_open().
+void stl_load()
+{
+    const size_t num_facets = 1000000;
+    stl_file stl;
+    {
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> coordinate(-100.f, 100.f);
+        std::uniform_real_distribution<float> unit(-1.f, 1.f);
+        stl.stats.type = inmemory;
+        stl.stats.number_of_facets = uint32_t(num_facets);
+        stl.stats.original_num_facets = int(num_facets);
+        stl_allocate(&stl);
+        for (stl_facet &facet : stl.facet_start) {
+            facet.normal = stl_normal(unit(rng), unit(rng), unit(rng));
+            for (stl_vertex &v : facet.vertex)
+                v = stl_vertex(coordinate(rng), coordinate(rng), coordinate(rng));
+        }
+    }
+    boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("stl_load_%%%%-%%%%");
+    boost::filesystem::create_directories(dir);
+    for (bool binary_format : { false, true }) {
+        std::string path = (dir / (binary_format ? "random-binary.stl" : "random-ascii.stl")).string();
+        if (binary_format)
+            stl_write_binary(&stl, path.c_str(), "random");
+        else
+            stl_write_ascii(&stl, path.c_str(), "random");
+        stl_file loaded;
+        bool     success = false;
+        double   t       = time_it([&loaded, &path, &success]() { success = stl_open(&loaded, path.c_str()); });
+        std::cout << (binary_format ? "binary" : "ASCII") << " STL of " << num_facets << " facets, " <<
+            boost::filesystem::file_size(path) / (1024 * 1024) << " MB: loaded in " << t << "s" << std::endl;
+        BENCHMARK_CHECK(success);
+        // The normal and the vertices are compared, the ASCII format does not store the extra bytes.
+        BENCHMARK_CHECK(loaded.facet_start.size() == stl.facet_start.size());
+        BENCHMARK_CHECK(std::equal(loaded.facet_start.begin(), loaded.facet_start.end(), stl.facet_start.begin(),
+            [](const stl_facet &f1, const stl_facet &f2) { return memcmp(&f1, &f2, 48) == 0; }));
+    }
+    boost::filesystem::remove_all(dir);
+}
+
+} // namespace Benchmark
+} // namespace Slic3r
@@ -0,0 +1,128 @@
+// Benchmark of the tessellation of the print object toolpaths into the preview volumes.
+// Runs without an OpenGL context: the volumes are only compacted, never uploaded to the graphics card.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include <libslic3r/libslic3r.h>
+#include <libslic3r/ExtrusionEntityCollection.hpp>
+#include <libslic3r/Model.hpp>
+#include <libslic3r/Print.hpp>
+#include <libslic3r/PrintConfig.hpp>
+#include <slic3r/GUI/3DScene.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/spin_mutex.h>
+
+const std::string USAGE_STR = {
+    "Usage: toolpathstessellation stlfilename.stl [layer_height]"
+};
+
+using namespace Slic3r;
+
+// Call visitor(extrusion_entity, copy, feature) for all the extrusions of a layer, colored by a feature
+// the same way GLCanvas3D::_load_print_object_toolpaths() does.
+template<typename Visitor> static void for_each_extrusion(const PrintObject &object, const Layer &layer, Visitor &&visitor)
+{
+    for (const Point &copy : object.copies()) {
+        for (const LayerRegion *layerm : layer.regions()) {
+            visitor(&layerm->perimeters, copy, 0);
+            for (const ExtrusionEntity *ee : layerm->fills.entities)
+                visitor(ee, copy, 1);
+        }
+        if (const SupportLayer *support_layer = dynamic_cast<const SupportLayer*>(&layer))
+            for (const ExtrusionEntity *ee : support_layer->support_fills.entities)
+                visitor(ee, copy, 2);
+    }
+}
+
+// Tessellate the layers into one volume per feature and per range of layers.
+// With preallocate set, the volumes are sized by _3DScene::extrusionentity_to_verts_size() first.
+static size_t tessellate(const PrintObject &object, bool preallocate, GLVolumePtrs &volumes)
+{
+    std::vector<const Layer*> layers(object.layers().begin(), object.layers().end());
+    layers.insert(layers.end(), object.support_layers().begin(), object.support_layers().end());
+    std::sort(layers.begin(), layers.end(), [](const Layer *l1, const Layer *l2) { return l1->print_z < l2->print_z; });
+
+    tbb::spin_mutex mutex;
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, layers.size(), std::max(layers.size() / 16, size_t(1))),
+        [&layers, &object, &mutex, &volumes, preallocate](const tbb::blocked_range<size_t> &range) {
+        GLIndexedVertexArray::Size sizes[3];
+        if (preallocate)
+            for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer)
+                for_each_extrusion(object, *layers[idx_layer], [&sizes](const ExtrusionEntity *ee, const Point &, size_t feature) {
+                    _3DScene::extrusionentity_to_verts_size(ee, sizes[feature]);
+                });
+        GLVolume *vols[3];
+        for (size_t i = 0; i < 3; ++ i) {
+            vols[i] = new GLVolume();
+            vols[i]->indexed_vertex_array.compact_on_finalize = true;
+            vols[i]->indexed_vertex_array.reserve_more(sizes[i]);
+        }
+        for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer) {
+            const Layer *layer = layers[idx_layer];
+            for_each_extrusion(object, *layer, [&vols, layer](const ExtrusionEntity *ee, const Point &copy, size_t feature) {
+                _3DScene::extrusionentity_to_verts(ee, float(layer->print_z), copy, *vols[feature]);
+            });
+        }
+        for (size_t i = 0; i < 3; ++ i) {
+            if (preallocate && vols[i]->indexed_vertex_array.vertices_and_normals_interleaved.size() > sizes[i].vertices * 6)
+                std::cerr << "Vertex count over the preallocated bound" << std::endl;
+            vols[i]->indexed_vertex_array.finalize_geometry(false);
+        }
+        tbb::spin_mutex::scoped_lock lock(mutex);
+        volumes.insert(volumes.end(), vols, vols + 3);
+    });
+    return layers.size();
+}
+
+int main(const int argc, const char *argv[])
+{
+    using std::cout; using std::endl;
+
+    if (argc < 2) {
+        cout << USAGE_STR << endl;
+        return EXIT_SUCCESS;
+    }
+
+    DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+    if (argc > 2)
+        config.set_deserialize("layer_height", argv[2]);
+
+    Model model = Model::read_from_file(argv[1], &config);
+    model.add_default_instances();
+    // Only the instances checked in the object list are printed.
+    for (ModelObject *object : model.objects)
+        for (ModelInstance *instance : object->instances)
+            instance->checked = true;
+    model.center_instances_around_point(Vec2d(100., 100.));
+
+    Print print;
+    print.apply(model, config);
+    if (print.objects().empty()) {
+        std::cerr << "No printable object in " << argv[1] << endl;
+        return EXIT_FAILURE;
+    }
+    print.process();
+
+    for (bool preallocate : { false, true }) {
+        GLVolumePtrs volumes;
+        size_t       num_layers = 0;
+        auto         start      = std::chrono::steady_clock::now();
+        for (const PrintObject *object : print.objects())
+            num_layers += tessellate(*object, preallocate, volumes);
+        double       elapsed    = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t       memory     = 0;
+        for (const GLVolume *volume : volumes)
+            memory += volume->indexed_vertex_array.cpu_memory_used();
+        cout << (preallocate ? "preallocated" : "growing     ") << ": " << num_layers << " layers tessellated in " << elapsed << "s, "
+             << memory / (1024 * 1024) << "MB" << endl;
+        for (GLVolume *volume : volumes)
+            delete volume;
+    }
+
+    return EXIT_SUCCESS;
+}
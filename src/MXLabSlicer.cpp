@@ -36,6 +36,7 @@
 #include "libslic3r/Model.hpp"
 #include "libslic3r/Print.hpp"
 #include "libslic3r/SLAPrint.hpp"
+#include "libslic3r/SliceCache.hpp"
 #include "libslic3r/TriangleMesh.hpp"
 #include "libslic3r/Format/AMF.hpp"
 #include "libslic3r/Format/3mf.hpp"
@@ -378,6 +379,9 @@ int CLI::run(int argc, char **argv)
                 boost::nowide::cerr << "error: cannot export SLA slices for a SLA configuration" << std::endl;
                 return 1;
             }
+            std::shared_ptr<SliceCache> slice_cache;
+            if (! m_config.opt_string("slice_cache").empty())
+                slice_cache = std::make_shared<SliceCache>(m_config.opt_string("slice_cache"));
             // Make a copy of the model if the current action is not the last action, as the model may be
             // modified by the centering and such.
             Model model_copy;
@@ -394,6 +398,8 @@ int CLI::run(int argc, char **argv)
                 Print       fff_print;
                 SLAPrint    sla_print;
 
+                fff_print.set_slice_cache(slice_cache);
+
                 sla_print.set_status_callback(
                             [](const PrintBase::SlicingStatus& s)
                 {
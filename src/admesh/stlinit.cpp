@@ -25,49 +25,156 @@
 #include <string.h>
 #include <math.h>
 #include <assert.h>
+#include <float.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
 
 #include <boost/log/trivial.hpp>
-#include <boost/nowide/cstdio.hpp>
+#include <boost/nowide/convert.hpp>
 #include <boost/detail/endian.hpp>
 
-#include "stl.h"
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 
-#ifndef SEEK_SET
-#error "SEEK_SET not defined"
-#endif
+#include "stl.h"
 
 #ifndef BOOST_LITTLE_ENDIAN
 extern void stl_internal_reverse_quads(char *buf, size_t cnt);
 #endif /* BOOST_LITTLE_ENDIAN */
 
-static FILE* stl_open_count_facets(stl_file *stl, const char *file) 
+// An ASCII STL is split into blocks of about this size to be counted and parsed in parallel.
+#define ASCII_BLOCK_SIZE       (4 * 1024 * 1024)
+
+// Read only memory mapping of the whole STL file, the path is UTF-8 encoded.
+class stl_mapped_file
+{
+public:
+	explicit stl_mapped_file(const char *file)
+	{
+#ifdef _WIN32
+		HANDLE handle = ::CreateFileW(boost::nowide::widen(file).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (handle == INVALID_HANDLE_VALUE)
+			return;
+		LARGE_INTEGER size;
+		if (::GetFileSizeEx(handle, &size)) {
+			if (size.QuadPart == 0)
+				m_data = "";
+			else if (HANDLE mapping = ::CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr); mapping != nullptr) {
+				// The view keeps the file mapping object alive.
+				m_data = (const char*)::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				if (m_data != nullptr)
+					m_size = size_t(size.QuadPart);
+				::CloseHandle(mapping);
+			}
+		}
+		::CloseHandle(handle);
+#else
+		int fd = ::open(file, O_RDONLY);
+		if (fd == -1)
+			return;
+		struct stat st;
+		if (::fstat(fd, &st) == 0) {
+			if (st.st_size == 0)
+				m_data = "";
+			else if (void *ptr = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0); ptr != MAP_FAILED) {
+				m_data = (const char*)ptr;
+				m_size = size_t(st.st_size);
+			}
+		}
+		// The mapping stays valid after the file descriptor is closed.
+		::close(fd);
+#endif
+	}
+	stl_mapped_file(const stl_mapped_file&) = delete;
+	stl_mapped_file& operator=(const stl_mapped_file&) = delete;
+	~stl_mapped_file()
+	{
+		if (m_size > 0) {
+#ifdef _WIN32
+			::UnmapViewOfFile(m_data);
+#else
+			::munmap(const_cast<char*>(m_data), m_size);
+#endif
+		}
+	}
+
+	bool        is_open() const { return m_data != nullptr; }
+	const char* begin()   const { return m_data; }
+	const char* end()     const { return m_data + m_size; }
+	size_t      size()    const { return m_size; }
+
+private:
+	const char *m_data = nullptr;
+	size_t      m_size = 0;
+};
+
+// Split [begin, end) into blocks of approximately ASCII_BLOCK_SIZE, each block but the last one ending with a new line.
+static std::vector<const char*> ascii_blocks(const char *begin, const char *end)
+{
+	std::vector<const char*> blocks { begin };
+	while (size_t(end - blocks.back()) > ASCII_BLOCK_SIZE) {
+		const char *eol = (const char*)memchr(blocks.back() + ASCII_BLOCK_SIZE, '\n', end - blocks.back() - ASCII_BLOCK_SIZE);
+		if (eol == nullptr || eol + 1 == end)
+			break;
+		blocks.emplace_back(eol + 1);
+	}
+	blocks.emplace_back(end);
+	return blocks;
+}
+
+// Count the lines in [begin, end) the way the former fgets(linebuf, 100, fp) loop did: A line longer than 98 characters
+// is read in pieces of 99 characters, and a piece is counted unless it is shorter than 5 characters or it starts a solid / endsolid line.
+static size_t ascii_count_lines(const char *begin, const char *end)
+{
+	size_t num_lines = 0;
+	for (const char *p = begin; p < end;) {
+		const char *piece_end = std::min(p + 99, end);
+		if (const char *eol = (const char*)memchr(p, '\n', piece_end - p); eol != nullptr)
+			piece_end = eol + 1;
+		size_t len = piece_end - p;
+#ifdef _WIN32
+		// The file used to be read in text mode, which converted "\r\n" to "\n".
+		if (len > 1 && piece_end[-1] == '\n' && piece_end[-2] == '\r')
+			-- len;
+#endif /* _WIN32 */
+		// strlen() stops at a zero character.
+		if (const char *zero = (const char*)memchr(p, 0, len); zero != nullptr)
+			len = zero - p;
+		if (len > 4 && ! (len >= 5 && strncmp(p, "solid", 5) == 0) && ! (len >= 8 && strncmp(p, "endsolid", 8) == 0))
+			++ num_lines;
+		p = piece_end;
+	}
+	return num_lines;
+}
+
+static bool stl_open_count_facets(stl_file *stl, const stl_mapped_file &mapped, const char *file)
 {
-  	// Open the file in binary mode first.
-  	FILE *fp = boost::nowide::fopen(file, "rb");
-  	if (fp == nullptr) {
-		BOOST_LOG_TRIVIAL(error) << "stl_open_count_facets: Couldn't open " << file << " for reading";
-    	return nullptr;
-  	}
   	// Find size of file.
-  	fseek(fp, 0, SEEK_END);
-  	long file_size = ftell(fp);
+  	size_t file_size = mapped.size();
 
   	// Check for binary or ASCII file.
-  	fseek(fp, HEADER_SIZE, SEEK_SET);
-	unsigned char chtest[128];
-  	if (! fread(chtest, sizeof(chtest), 1, fp)) {
+  	if (file_size < HEADER_SIZE + 128) {
 		BOOST_LOG_TRIVIAL(error) << "stl_open_count_facets: The input is an empty file: " << file;
-    	fclose(fp);
-    	return nullptr;
+    	return false;
   	}
+	const unsigned char *chtest = (const unsigned char*)mapped.begin() + HEADER_SIZE;
   	stl->stats.type = ascii;
-  	for (size_t s = 0; s < sizeof(chtest); s++) {
+  	for (size_t s = 0; s < 128; s++) {
     	if (chtest[s] > 127) {
       		stl->stats.type = binary;
       		break;
     	}
   	}
-  	rewind(fp);
 
   	uint32_t num_facets = 0;
 
@@ -77,134 +184,331 @@ static FILE* stl_open_count_facets(stl_file *stl, const char *file)
     	// Test if the STL file has the right size.
     	if (((file_size - HEADER_SIZE) % SIZEOF_STL_FACET != 0) || (file_size < STL_MIN_FILE_SIZE)) {
 			BOOST_LOG_TRIVIAL(error) << "stl_open_count_facets: The file " << file << " has the wrong size.";
-      		fclose(fp);
-      		return nullptr;
+      		return false;
     	}
-    	num_facets = (file_size - HEADER_SIZE) / SIZEOF_STL_FACET;
+    	num_facets = uint32_t((file_size - HEADER_SIZE) / SIZEOF_STL_FACET);
 
     	// Read the header.
-    	if (fread(stl->stats.header, LABEL_SIZE, 1, fp) > 79)
-      		stl->stats.header[80] = '\0';
+    	memcpy(stl->stats.header, mapped.begin(), LABEL_SIZE);
 
     	// Read the int following the header.  This should contain # of facets.
 	  	uint32_t header_num_facets;
-    	bool header_num_faces_read = fread(&header_num_facets, sizeof(uint32_t), 1, fp) != 0;
+	  	memcpy(&header_num_facets, mapped.begin() + LABEL_SIZE, sizeof(uint32_t));
 #ifndef BOOST_LITTLE_ENDIAN
     	// Convert from little endian to big endian.
     	stl_internal_reverse_quads((char*)&header_num_facets, 4);
 #endif /* BOOST_LITTLE_ENDIAN */
-    	if (! header_num_faces_read || num_facets != header_num_facets)
+    	if (num_facets != header_num_facets)
 			BOOST_LOG_TRIVIAL(info) << "stl_open_count_facets: Warning: File size doesn't match number of facets in the header: " << file;
   	}
   	// Otherwise, if the .STL file is ASCII, then do the following:
   	else
   	{
-    	// Reopen the file in text mode (for getting correct newlines on Windows)
-    	// fix to silence a warning about unused return value.
-    	// obviously if it fails we have problems....
-    	fp = boost::nowide::freopen(file, "r", fp);
-
-		// do another null check to be safe
-    	if (fp == nullptr) {
-			BOOST_LOG_TRIVIAL(error) << "stl_open_count_facets: Couldn't open " << file << " for reading";
-      		fclose(fp);
-      		return nullptr;
-    	}
-    
-    	// Find the number of facets.
-		char linebuf[100];
-		int num_lines = 1;
-		while (fgets(linebuf, 100, fp) != nullptr) {
-		    // Don't count short lines.
-		    if (strlen(linebuf) <= 4)
-		    	continue;
-		    // Skip solid/endsolid lines as broken STL file generators may put several of them.
-		    if (strncmp(linebuf, "solid", 5) == 0 || strncmp(linebuf, "endsolid", 8) == 0)
-		    	continue;
-		    ++ num_lines;
-		}
+    	// Find the number of facets. The blocks end with a new line, thus they are counted independently.
+    	std::vector<const char*> blocks = ascii_blocks(mapped.begin(), mapped.end());
+    	size_t num_lines = 1 + tbb::parallel_reduce(tbb::blocked_range<size_t>(0, blocks.size() - 1), size_t(0),
+    		[&blocks](const tbb::blocked_range<size_t> &range, size_t num_lines) {
+    			for (size_t i = range.begin(); i < range.end(); ++ i)
+    				num_lines += ascii_count_lines(blocks[i], blocks[i + 1]);
+    			return num_lines;
+    		},
+    		[](size_t a, size_t b) { return a + b; });
 
-    	rewind(fp);
-    
     	// Get the header.
 		int i = 0;
-    	for (; i < 80 && (stl->stats.header[i] = getc(fp)) != '\n'; ++ i) ;
+    	for (const char *p = mapped.begin(); i < 80 && p < mapped.end() && *p != '\n'; ++ i, ++ p)
+    		stl->stats.header[i] = *p;
+#ifdef _WIN32
+    	// The file used to be read in text mode, which converted "\r\n" to "\n".
+    	if (i > 0 && i < 80 && stl->stats.header[i - 1] == '\r' && mapped.begin()[i] == '\n')
+    		-- i;
+#endif /* _WIN32 */
     	stl->stats.header[i] = '\0'; // Lose the '\n'
     	stl->stats.header[80] = '\0';
 
-    	num_facets = num_lines / ASCII_LINES_PER_FACET;
+    	num_facets = uint32_t(num_lines / ASCII_LINES_PER_FACET);
   	}
 
   	stl->stats.number_of_facets += num_facets;
   	stl->stats.original_num_facets = stl->stats.number_of_facets;
-  	return fp;
+  	return true;
 }
 
-/* Reads the contents of the file pointed to by fp into the stl structure,
-   starting at facet first_facet.  The second argument says if it's our first
-   time running this for the stl and therefore we should reset our max and min stats. */
-static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
+static inline bool ascii_is_space(char c)
 {
-	if (stl->stats.type == binary)
-    	fseek(fp, HEADER_SIZE, SEEK_SET);
-  	else
-    	rewind(fp);
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
 
-  	char normal_buf[3][32];
-  	for (uint32_t i = first_facet; i < stl->stats.number_of_facets; ++ i) {
-  	  	stl_facet facet;
+static inline const char* ascii_skip_space(const char *p, const char *end)
+{
+	while (p < end && ascii_is_space(*p))
+		++ p;
+	return p;
+}
 
-    	if (stl->stats.type == binary) {
-      		// Read a single facet from a binary .STL file. We assume little-endian architecture!
-      		if (fread(&facet, 1, SIZEOF_STL_FACET, fp) != SIZEOF_STL_FACET)
-      			return false;
-#ifndef BOOST_LITTLE_ENDIAN
-      		// Convert the loaded little endian data to big endian.
-      		stl_internal_reverse_quads((char*)&facet, 48);
-#endif /* BOOST_LITTLE_ENDIAN */
-    	} else {
-			// Read a single facet from an ASCII .STL file
-			// skip solid/endsolid
-			// (in this order, otherwise it won't work when they are paired in the middle of a file)
-			fscanf(fp, " endsolid%*[^\n]\n");
-			fscanf(fp, " solid%*[^\n]\n");  // name might contain spaces so %*s doesn't work and it also can be empty (just "solid")
-			// Leading space in the fscanf format skips all leading white spaces including numerous new lines and tabs.
-			int res_normal     = fscanf(fp, " facet normal %31s %31s %31s", normal_buf[0], normal_buf[1], normal_buf[2]);
-			assert(res_normal == 3);
-			int res_outer_loop = fscanf(fp, " outer loop");
-			assert(res_outer_loop == 0);
-			int res_vertex1    = fscanf(fp, " vertex %f %f %f", &facet.vertex[0](0), &facet.vertex[0](1), &facet.vertex[0](2));
-			assert(res_vertex1 == 3);
-			int res_vertex2    = fscanf(fp, " vertex %f %f %f", &facet.vertex[1](0), &facet.vertex[1](1), &facet.vertex[1](2));
-			assert(res_vertex2 == 3);
-			// Trailing whitespace is there to eat all whitespaces and empty lines up to the next non-whitespace.
-			int res_vertex3    = fscanf(fp, " vertex %f %f %f ", &facet.vertex[2](0), &facet.vertex[2](1), &facet.vertex[2](2));
-			assert(res_vertex3 == 3);
-			// Some G-code generators tend to produce text after "endloop" and "endfacet". Just ignore it.
-			char buf[2048];
-			fgets(buf, 2047, fp);
-			bool endloop_ok = strncmp(buf, "endloop", 7) == 0 && (buf[7] == '\r' || buf[7] == '\n' || buf[7] == ' ' || buf[7] == '\t');
-			assert(endloop_ok);
-			// Skip the trailing whitespaces and empty lines.
-			fscanf(fp, " ");
-			fgets(buf, 2047, fp);
-			bool endfacet_ok = strncmp(buf, "endfacet", 8) == 0 && (buf[8] == '\r' || buf[8] == '\n' || buf[8] == ' ' || buf[8] == '\t');
-			assert(endfacet_ok);
-			if (res_normal != 3 || res_outer_loop != 0 || res_vertex1 != 3 || res_vertex2 != 3 || res_vertex3 != 3 || ! endloop_ok || ! endfacet_ok) {
-				BOOST_LOG_TRIVIAL(error) << "Something is syntactically very wrong with this ASCII STL! ";
-				return false;
+// Match a fscanf() format consisting of literals and white spaces, where a white space matches any number of white spaces.
+// As with fscanf(), the input is consumed up to the first mismatching character.
+static inline bool ascii_scan_literal(const char *&p, const char *end, const char *format)
+{
+	for (; *format != 0; ++ format) {
+		if (*format == ' ')
+			p = ascii_skip_space(p, end);
+		else if (p < end && *p == *format)
+			++ p;
+		else
+			return false;
+	}
+	return true;
+}
+
+// Skip the " endsolid%*[^\n]\n" and " solid%*[^\n]\n" lines preceding a facet, then the white spaces before the "facet" keyword.
+static const char* ascii_skip_solid(const char *p, const char *end)
+{
+	for (const char *keyword : { " endsolid", " solid" })
+		if (ascii_scan_literal(p, end, keyword) && p < end && *p != '\n') {
+			p = (const char*)memchr(p, '\n', end - p);
+			p = (p == nullptr) ? end : ascii_skip_space(p, end);
+		}
+	return ascii_skip_space(p, end);
+}
+
+// Read up to max_len non white space characters, as fscanf(" %31s") does.
+static inline bool ascii_scan_token(const char *&p, const char *end, size_t max_len, const char *&token_begin, const char *&token_end)
+{
+	p = ascii_skip_space(p, end);
+	token_begin = p;
+	for (const char *p_max = p + std::min(max_len, size_t(end - p)); p < p_max && ! ascii_is_space(*p); ++ p) ;
+	token_end = p;
+	return token_end > token_begin;
+}
+
+// Parse [+-]digits[.digits][(e|E)[+-]digits] at the start of [p, end) into a float rounded the same way as by strtof().
+// Only the numbers, which may be converted exactly with double precision arithmetic are accepted, otherwise nullptr is returned.
+static const char* ascii_parse_float_fast(const char *p, const char *end, float &out)
+{
+	static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p ++ == '-';
+	uint64_t mantissa   = 0;
+	int      num_digits = 0;
+	int      exponent   = 0;
+	bool     has_digits = false;
+	for (; p < end && *p >= '0' && *p <= '9'; ++ p, has_digits = true)
+		if (mantissa > 0 || *p != '0') {
+			if (++ num_digits > 19)
+				return nullptr;
+			mantissa = mantissa * 10 + (*p - '0');
+		}
+	if (p < end && *p == '.')
+		for (++ p; p < end && *p >= '0' && *p <= '9'; ++ p, has_digits = true) {
+			-- exponent;
+			if (mantissa > 0 || *p != '0') {
+				if (++ num_digits > 19)
+					return nullptr;
+				mantissa = mantissa * 10 + (*p - '0');
+			}
+		}
+	if (! has_digits)
+		return nullptr;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		++ p;
+		bool negative_exponent = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negative_exponent = *p ++ == '-';
+		if (p == end || *p < '0' || *p > '9')
+			return nullptr;
+		int e = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; ++ p)
+			if (e < 10000)
+				e = e * 10 + (*p - '0');
+		exponent += negative_exponent ? - e : e;
+	}
+	if (mantissa == 0) {
+		out = negative ? -0.f : 0.f;
+		return p;
+	}
+	// Both the mantissa and the power of ten are exact, therefore the product / quotient is rounded once.
+	if (mantissa > (uint64_t(1) << 53) || exponent < -22 || exponent > 22)
+		return nullptr;
+	double d = (exponent < 0) ? double(mantissa) / pow10[- exponent] : double(mantissa) * pow10[exponent];
+	if (d < FLT_MIN || d > FLT_MAX)
+		return nullptr;
+	// Rounding the double to float is exact unless the double lies exactly halfway between two floats.
+	uint64_t bits;
+	memcpy(&bits, &d, sizeof(d));
+	if ((bits & 0x1FFFFFFF) == 0x10000000)
+		return nullptr;
+	out = negative ? - float(d) : float(d);
+	return p;
+}
+
+// Parse a vertex coordinate, as fscanf(" %f") does. The number has to be followed by a white space.
+static inline bool ascii_scan_float(const char *&p, const char *end, float &out)
+{
+	const char *token_begin, *token_end;
+	if (! ascii_scan_token(p, end, size_t(-1), token_begin, token_end))
+		return false;
+	const char *num_end = ascii_parse_float_fast(token_begin, token_end, out);
+	if (num_end != token_end) {
+		// Not a plain decimal number, let the C library parse it.
+		std::string token(token_begin, token_end);
+		int         n = 0;
+		if (sscanf(token.c_str(), "%f%n", &out, &n) != 1 || n != int(token.size()))
+			return false;
+	}
+	return true;
+}
+
+// Read a line as fgets(buf, 2047, fp) does and test whether it starts with the keyword followed by a white space.
+static inline bool ascii_scan_end_line(const char *&p, const char *end, const char *keyword)
+{
+	const char *line_end = std::min(p + 2046, end);
+	if (const char *eol = (const char*)memchr(p, '\n', line_end - p); eol != nullptr)
+		line_end = eol + 1;
+	size_t len = strlen(keyword);
+	bool   ok  = size_t(line_end - p) > len && strncmp(p, keyword, len) == 0 && (p[len] == '\r' || p[len] == '\n' || p[len] == ' ' || p[len] == '\t');
+	p = line_end;
+	return ok;
+}
+
+// Parse a single facet of an ASCII STL starting at the "facet" keyword in the same way the former sequence of fscanf() / fgets() calls did.
+// Returns the position after the facet or nullptr on a syntax error.
+static const char* ascii_parse_facet(const char *p, const char *end, stl_facet &facet)
+{
+	// The facet normal is parsed as a single string as to workaround for not a numbers in the normal definition.
+	const char *normal[3][2];
+	if (! ascii_scan_literal(p, end, " facet normal ") ||
+		! ascii_scan_token(p, end, 31, normal[0][0], normal[0][1]) ||
+		! ascii_scan_token(p, end, 31, normal[1][0], normal[1][1]) ||
+		! ascii_scan_token(p, end, 31, normal[2][0], normal[2][1]))
+		return nullptr;
+	// A missing "outer loop" used to be tolerated, as fscanf() returns zero both on success and on a mismatch.
+	ascii_scan_literal(p, end, " outer loop");
+	for (size_t i = 0; i < 3; ++ i)
+		if (! ascii_scan_literal(p, end, " vertex ") ||
+			! ascii_scan_float(p, end, facet.vertex[i](0)) || ! ascii_scan_float(p, end, facet.vertex[i](1)) || ! ascii_scan_float(p, end, facet.vertex[i](2)))
+			return nullptr;
+	// Trailing whitespace is there to eat all whitespaces and empty lines up to the next non-whitespace.
+	p = ascii_skip_space(p, end);
+	// Some G-code generators tend to produce text after "endloop" and "endfacet". Just ignore it.
+	if (! ascii_scan_end_line(p, end, "endloop"))
+		return nullptr;
+	// Skip the trailing whitespaces and empty lines.
+	p = ascii_skip_space(p, end);
+	if (! ascii_scan_end_line(p, end, "endfacet"))
+		return nullptr;
+	for (size_t i = 0; i < 3; ++ i) {
+		const char *num_end = ascii_parse_float_fast(normal[i][0], normal[i][1], facet.normal(i));
+		if (num_end != normal[i][1] && sscanf(std::string(normal[i][0], normal[i][1]).c_str(), "%f", &facet.normal(i)) != 1) {
+		    // Normal was mangled. Maybe denormals or "not a number" were stored?
+		  	// Just reset the normal and silently ignore it.
+		  	memset(&facet.normal, 0, sizeof(facet.normal));
+		  	break;
+		}
+	}
+	return p;
+}
+
+// Parse up to max_facets facets starting at p. Parsing stops before the first facet starting at or after stop.
+// Returns true if parsing stopped exactly at stop or after max_facets facets, false on a syntax error or if the facet boundary was missed.
+static bool ascii_parse_facets(const char *p, const char *end, const char *stop, size_t max_facets, std::vector<stl_facet> &facets)
+{
+	while (facets.size() < max_facets) {
+		p = ascii_skip_solid(p, end);
+		if (p >= stop)
+			return p == stop && stop < end;
+		stl_facet facet;
+		memset(&facet, 0, sizeof(facet));
+		if ((p = ascii_parse_facet(p, end, facet)) == nullptr)
+			return false;
+		facets.emplace_back(facet);
+	}
+	return true;
+}
+
+// Read the facets of an ASCII STL. The file is split into blocks at the lines starting with the "facet" keyword, which are parsed in parallel.
+// A facet boundary is verified against the position, where the parser of the preceding block stopped. If the parser did not stop there
+// (malformed file) or if it failed, the rest of the file is parsed sequentially to reproduce the result of the sequential parser exactly.
+static bool stl_read_ascii(stl_file *stl, const char *begin, const char *end)
+{
+	std::vector<const char*> blocks = ascii_blocks(begin, end);
+	for (size_t i = 1; i + 1 < blocks.size(); ++ i) {
+		// Move the block boundary to the next line starting with the "facet" keyword.
+		const char *p = blocks[i];
+		for (;;) {
+			const char *q = p;
+			while (q < end && (*q == ' ' || *q == '\t' || *q == '\r'))
+				++ q;
+			if (size_t(end - q) >= 5 && strncmp(q, "facet", 5) == 0) {
+				p = q;
+				break;
 			}
+			p = (const char*)memchr(q, '\n', end - q);
+			p = (p == nullptr) ? end : p + 1;
+			if (p == end)
+				break;
+		}
+		blocks[i] = std::max(p, blocks[i - 1]);
+	}
+	blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
 
-			// The facet normal has been parsed as a single string as to workaround for not a numbers in the normal definition.
-			if (sscanf(normal_buf[0], "%f", &facet.normal(0)) != 1 ||
-			    sscanf(normal_buf[1], "%f", &facet.normal(1)) != 1 ||
-			    sscanf(normal_buf[2], "%f", &facet.normal(2)) != 1) {
-			    // Normal was mangled. Maybe denormals or "not a number" were stored?
-			  	// Just reset the normal and silently ignore it.
-			  	memset(&facet.normal, 0, sizeof(facet.normal));
+	size_t                              num_facets = stl->stats.number_of_facets;
+	std::vector<std::vector<stl_facet>> facets(blocks.size() - 1);
+	std::vector<char>                   block_ok(blocks.size() - 1, false);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, blocks.size() - 1, 1),
+		[&blocks, &facets, &block_ok, end, num_facets](const tbb::blocked_range<size_t> &range) {
+			for (size_t i = range.begin(); i < range.end(); ++ i) {
+				// An ASCII facet takes about 250 bytes.
+				facets[i].reserve((blocks[i + 1] - blocks[i]) / 200);
+				block_ok[i] = ascii_parse_facets(blocks[i], end, blocks[i + 1], num_facets, facets[i]);
+			}
+		});
+
+	size_t i_facet = 0;
+	for (size_t i = 0; i + 1 < blocks.size() && i_facet < num_facets; ++ i) {
+		if (! block_ok[i] && i_facet + facets[i].size() < num_facets) {
+			// Fall back to the sequential parser for the rest of the file.
+			facets[i].clear();
+			if (! ascii_parse_facets(blocks[i], end, end, num_facets - i_facet, facets[i]) || i_facet + facets[i].size() < num_facets) {
+				BOOST_LOG_TRIVIAL(error) << "Something is syntactically very wrong with this ASCII STL! ";
+				return false;
 			}
 		}
+		size_t n = std::min(facets[i].size(), num_facets - i_facet);
+		std::copy(facets[i].begin(), facets[i].begin() + n, stl->facet_start.begin() + i_facet);
+		i_facet += n;
+	}
+	if (i_facet < num_facets) {
+		BOOST_LOG_TRIVIAL(error) << "Something is syntactically very wrong with this ASCII STL! ";
+		return false;
+	}
+	return true;
+}
 
+/* Reads the contents of the mapped file into the stl structure. The binary facets are copied straight
+   from the mapping, the ASCII facets are parsed in parallel. */
+static bool stl_read(stl_file *stl, const stl_mapped_file &mapped)
+{
+	if (stl->stats.type == binary) {
+		const char *data = mapped.begin() + HEADER_SIZE;
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, stl->stats.number_of_facets),
+			[stl, data](const tbb::blocked_range<size_t> &range) {
+				for (size_t i = range.begin(); i < range.end(); ++ i) {
+					stl_facet &facet = stl->facet_start[i];
+					// Read a single facet from a binary .STL file. We assume little-endian architecture!
+					memcpy(&facet, data + i * SIZEOF_STL_FACET, SIZEOF_STL_FACET);
+#ifndef BOOST_LITTLE_ENDIAN
+					// Convert the loaded little endian data to big endian.
+					stl_internal_reverse_quads((char*)&facet, 48);
+#endif /* BOOST_LITTLE_ENDIAN */
+				}
+			});
+	} else if (! stl_read_ascii(stl, mapped.begin(), mapped.end()))
+		return false;
+
+	bool first = true;
+	for (const stl_facet &facet : stl->facet_start) {
 #if 0
 		// Report close to zero vertex coordinates. Due to the nature of the floating point numbers,
 		// close to zero values may be represented with singificantly higher precision than the rest of the vertices.
@@ -219,12 +523,9 @@ static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
 		    printf("stl_read: facet %d(2) = %e\r\n", j, facet.vertex[j](2));
 		}
 #endif
-
-		// Write the facet into memory.
-		stl->facet_start[i] = facet;
 		stl_facet_stats(stl, facet, first);
-  	}
-  
+	}
+
   	stl->stats.size = stl->stats.max - stl->stats.min;
   	stl->stats.bounding_diameter = stl->stats.size.norm();
   	return true;
@@ -233,13 +534,15 @@ static bool stl_read(stl_file *stl, FILE *fp, int first_facet, bool first)
 bool stl_open(stl_file *stl, const char *file)
 {
 	stl->clear();
-	FILE *fp = stl_open_count_facets(stl, file);
-	if (fp == nullptr)
+	stl_mapped_file mapped(file);
+	if (! mapped.is_open()) {
+		BOOST_LOG_TRIVIAL(error) << "stl_open_count_facets: Couldn't open " << file << " for reading";
+		return false;
+	}
+	if (! stl_open_count_facets(stl, mapped, file))
 		return false;
 	stl_allocate(stl);
-	bool result = stl_read(stl, fp, 0, true);
-  	fclose(fp);
-  	return result;
+	return stl_read(stl, mapped);
 }
 
 void stl_allocate(stl_file *stl) 
@@ -300,6 +300,67 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygon &expolygon, const float delta,
     return output;
 }
 
+// Offset a single ExPolygon given by its scaled contour and its scaled reversed holes, append the scaled result to out.
+// Each contour and hole is offsetted separately. For a negative offset the offsetted holes are subtracted from the offsetted contour,
+// for a positive offset the offsetted holes are just collected. Returns false if nothing remained after the offset.
+static bool _offset_scaled(ClipperLib::ClipperOffset &co, const ClipperLib::Path &contour, const ClipperLib::Paths &holes_reversed,
+    const float delta_scaled, ClipperLib::JoinType joinType, ClipperLib::Paths &out)
+{
+    // 1) Offset the outer contour.
+    ClipperLib::Paths contours;
+    co.Clear();
+    co.AddPath(contour, joinType, ClipperLib::etClosedPolygon);
+    co.Execute(contours, delta_scaled);
+    if (contours.empty())
+        // No need to try to offset the holes.
+        return false;
+
+    if (holes_reversed.empty()) {
+        // No need to subtract holes from the offsetted expolygon, we are done.
+        append(out, std::move(contours));
+        return true;
+    }
+
+    // 2) Offset the holes one by one, collect the offsetted holes.
+    ClipperLib::Paths holes;
+    for (const ClipperLib::Path &hole : holes_reversed) {
+        co.Clear();
+        co.AddPath(hole, joinType, ClipperLib::etClosedPolygon);
+        ClipperLib::Paths out_hole;
+        co.Execute(out_hole, - delta_scaled);
+        append(holes, std::move(out_hole));
+    }
+
+    // 3) Subtract holes from the contours.
+    if (holes.empty()) {
+        // No hole remaining after an offset. Just copy the outer contour.
+        append(out, std::move(contours));
+    } else if (delta_scaled < 0) {
+        // Negative offset. There is a chance, that the offsetted hole intersects the outer contour. 
+        // Subtract the offsetted holes from the offsetted contours.
+        ClipperLib::Clipper clipper;
+        clipper.Clear();
+        clipper.AddPaths(contours, ClipperLib::ptSubject, true);
+        clipper.AddPaths(holes, ClipperLib::ptClip, true);
+        ClipperLib::Paths output;
+        clipper.Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+        if (output.empty())
+            // The offsetted holes have eaten up the offsetted outer contour.
+            return false;
+        append(out, std::move(output));
+    } else {
+        // Positive offset. As long as the Clipper offset does what one expects it to do, the offsetted hole will have a smaller
+        // area than the original hole or even disappear, therefore there will be no new intersections.
+        // Just collect the reversed holes.
+        append(out, std::move(contours));
+        // Reverse the holes in place.
+        for (size_t i = 0; i < holes.size(); ++ i)
+            std::reverse(holes[i].begin(), holes[i].end());
+        append(out, std::move(holes));
+    }
+    return true;
+}
+
 // This is a safe variant of the polygons offset, tailored for multiple ExPolygons.
 // It is required, that the input expolygons do not overlap and that the holes of each ExPolygon don't intersect with their respective outer contours.
 // Each ExPolygon is offsetted separately, then the offsetted ExPolygons are united.
@@ -307,88 +368,29 @@ ClipperLib::Paths _offset(const Slic3r::ExPolygons &expolygons, const float delt
     ClipperLib::JoinType joinType, double miterLimit)
 {
     const float delta_scaled = delta * float(CLIPPER_OFFSET_SCALE);
+    ClipperLib::ClipperOffset co;
+    if (joinType == jtRound)
+        co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
+    else
+        co.MiterLimit = miterLimit;
+    co.ShortestEdgeLength = double(std::abs(delta_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR));
     // Offsetted ExPolygons before they are united.
     ClipperLib::Paths contours_cummulative;
     contours_cummulative.reserve(expolygons.size());
     // How many non-empty offsetted expolygons were actually collected into contours_cummulative?
     // If only one, then there is no need to do a final union.
     size_t expolygons_collected = 0;
-    for (Slic3r::ExPolygons::const_iterator it_expoly = expolygons.begin(); it_expoly != expolygons.end(); ++ it_expoly) {
-        // 1) Offset the outer contour.
-        ClipperLib::Paths contours;
-        {
-            ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath(it_expoly->contour);
-            scaleClipperPolygon(input);
-            ClipperLib::ClipperOffset co;
-            if (joinType == jtRound)
-                co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
-            else
-                co.MiterLimit = miterLimit;
-            co.ShortestEdgeLength = double(std::abs(delta_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR));
-            co.AddPath(input, joinType, ClipperLib::etClosedPolygon);
-            co.Execute(contours, delta_scaled);
+    for (const ExPolygon &expoly : expolygons) {
+        ClipperLib::Path contour = Slic3rMultiPoint_to_ClipperPath(expoly.contour);
+        scaleClipperPolygon(contour);
+        ClipperLib::Paths holes;
+        holes.reserve(expoly.holes.size());
+        for (const Polygon &hole : expoly.holes) {
+            holes.emplace_back(Slic3rMultiPoint_to_ClipperPath_reversed(hole));
+            scaleClipperPolygon(holes.back());
         }
-        if (contours.empty())
-            // No need to try to offset the holes.
-            continue;
-
-        if (it_expoly->holes.empty()) {
-            // No need to subtract holes from the offsetted expolygon, we are done.
-            contours_cummulative.insert(contours_cummulative.end(), contours.begin(), contours.end());
+        if (_offset_scaled(co, contour, holes, delta_scaled, joinType, contours_cummulative))
             ++ expolygons_collected;
-        } else {
-            // 2) Offset the holes one by one, collect the offsetted holes.
-            ClipperLib::Paths holes;
-            {
-                for (Polygons::const_iterator it_hole = it_expoly->holes.begin(); it_hole != it_expoly->holes.end(); ++ it_hole) {
-                    ClipperLib::Path input = Slic3rMultiPoint_to_ClipperPath_reversed(*it_hole);
-                    scaleClipperPolygon(input);
-                    ClipperLib::ClipperOffset co;
-                    if (joinType == jtRound)
-                        co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
-                    else
-                        co.MiterLimit = miterLimit;
-                    co.ShortestEdgeLength = double(std::abs(delta_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR));
-                    co.AddPath(input, joinType, ClipperLib::etClosedPolygon);
-                    ClipperLib::Paths out;
-                    co.Execute(out, - delta_scaled);
-                    holes.insert(holes.end(), out.begin(), out.end());
-                }
-            }
-
-            // 3) Subtract holes from the contours.
-            if (holes.empty()) {
-                // No hole remaining after an offset. Just copy the outer contour.
-                contours_cummulative.insert(contours_cummulative.end(), contours.begin(), contours.end());
-                ++ expolygons_collected;
-            } else if (delta < 0) {
-                // Negative offset. There is a chance, that the offsetted hole intersects the outer contour. 
-                // Subtract the offsetted holes from the offsetted contours.
-                ClipperLib::Clipper clipper;
-                clipper.Clear();
-                clipper.AddPaths(contours, ClipperLib::ptSubject, true);
-                clipper.AddPaths(holes, ClipperLib::ptClip, true);
-                ClipperLib::Paths output;
-                clipper.Execute(ClipperLib::ctDifference, output, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
-                if (! output.empty()) {
-                    contours_cummulative.insert(contours_cummulative.end(), output.begin(), output.end());
-                    ++ expolygons_collected;
-                } else {
-                    // The offsetted holes have eaten up the offsetted outer contour.
-                }
-            } else {
-                // Positive offset. As long as the Clipper offset does what one expects it to do, the offsetted hole will have a smaller
-                // area than the original hole or even disappear, therefore there will be no new intersections.
-                // Just collect the reversed holes.
-                contours_cummulative.reserve(contours.size() + holes.size());
-                contours_cummulative.insert(contours_cummulative.end(), contours.begin(), contours.end());
-                // Reverse the holes in place.
-                for (size_t i = 0; i < holes.size(); ++ i)
-                    std::reverse(holes[i].begin(), holes[i].end());
-                contours_cummulative.insert(contours_cummulative.end(), holes.begin(), holes.end());
-                ++ expolygons_collected;
-            }
-        }
     }
 
     // 4) Unite the offsetted expolygons.
@@ -481,6 +483,107 @@ ExPolygons offset2_ex(const ExPolygons &expolygons, const float delta1,
     return union_ex(polys);
 }
 
+OffsetLadder::OffsetLadder(const ExPolygons &level, ClipperLib::JoinType joinType, double miterLimit) :
+    m_join_type(joinType), m_current(scaled(level))
+{
+    if (joinType == jtRound)
+        m_co.ArcTolerance = miterLimit * double(CLIPPER_OFFSET_SCALE);
+    else
+        m_co.MiterLimit = miterLimit;
+}
+
+OffsetLadder::ScaledExPolygons OffsetLadder::scaled(const ExPolygons &expolygons)
+{
+    ScaledExPolygons out;
+    out.reserve(expolygons.size());
+    for (const ExPolygon &expoly : expolygons) {
+        out.emplace_back();
+        ScaledExPolygon &dst = out.back();
+        dst.contour = Slic3rMultiPoint_to_ClipperPath(expoly.contour);
+        scaleClipperPolygon(dst.contour);
+        dst.holes.reserve(expoly.holes.size());
+        for (const Polygon &hole : expoly.holes) {
+            dst.holes.emplace_back(Slic3rMultiPoint_to_ClipperPath_reversed(hole));
+            scaleClipperPolygon(dst.holes.back());
+        }
+    }
+    return out;
+}
+
+ClipperLib::Paths OffsetLadder::offset(const ScaledExPolygons &level, float delta)
+{
+    const float delta_scaled = delta * float(CLIPPER_OFFSET_SCALE);
+    m_co.ShortestEdgeLength = double(std::abs(delta_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR));
+    ClipperLib::Paths out;
+    size_t expolygons_collected = 0;
+    for (const ScaledExPolygon &expoly : level)
+        if (_offset_scaled(m_co, expoly.contour, expoly.holes, delta_scaled, m_join_type, out))
+            ++ expolygons_collected;
+    if (expolygons_collected > 1 && delta > 0) {
+        // The outwards offsetted expolygons may intersect.
+        ClipperLib::Clipper clipper;
+        clipper.AddPaths(out, ClipperLib::ptSubject, true);
+        clipper.Execute(ClipperLib::ctUnion, out, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    }
+    return out;
+}
+
+void OffsetLadder::push(const ExPolygons &level)
+{
+    m_previous = std::move(m_current);
+    m_current  = scaled(level);
+}
+
+ExPolygons OffsetLadder::inset(float delta, float collapse)
+{
+    ClipperLib::Paths out = this->offset(m_current, - delta - collapse);
+    if (collapse > 0.f && ! out.empty()) {
+        // Grow the inset back. The shrunk expolygons do not overlap, therefore they are offsetted at once
+        // without converting them back to ExPolygons.
+        const float collapse_scaled = collapse * float(CLIPPER_OFFSET_SCALE);
+        m_co.Clear();
+        m_co.ShortestEdgeLength = double(collapse_scaled * CLIPPER_OFFSET_SHORTEST_EDGE_FACTOR);
+        m_co.AddPaths(out, m_join_type, ClipperLib::etClosedPolygon);
+        m_co.Execute(out, collapse_scaled);
+    }
+    unscaleClipperPolygons(out);
+    ExPolygons level = ClipperPaths_to_Slic3rExPolygons(out);
+    this->push(level);
+    return level;
+}
+
+ExPolygons OffsetLadder::gaps(float inset_previous, float outset_current)
+{
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(this->offset(m_previous, - inset_previous), ClipperLib::ptSubject, true);
+    clipper.AddPaths(this->offset(m_current, outset_current), ClipperLib::ptClip, true);
+    ClipperLib::Paths out;
+    clipper.Execute(ClipperLib::ctDifference, out, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    unscaleClipperPolygons(out);
+    return ClipperPaths_to_Slic3rExPolygons(out);
+}
+
+ExPolygons OffsetLadder::thin_walls(float outset_current, float collapse)
+{
+    // The previous level in its original orientation and scale.
+    ClipperLib::Paths subject;
+    for (const ScaledExPolygon &expoly : m_previous) {
+        subject.emplace_back(expoly.contour);
+        for (const ClipperLib::Path &hole : expoly.holes)
+            subject.emplace_back(hole.rbegin(), hole.rend());
+    }
+    unscaleClipperPolygons(subject);
+    ClipperLib::Paths clip = this->offset(m_current, outset_current);
+    unscaleClipperPolygons(clip);
+    safety_offset(&clip);
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(subject, ClipperLib::ptSubject, true);
+    clipper.AddPaths(clip, ClipperLib::ptClip, true);
+    ClipperLib::Paths out;
+    clipper.Execute(ClipperLib::ctDifference, out, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    return offset2_ex(ClipperPaths_to_Slic3rExPolygons(out), - collapse, collapse);
+}
+
 template<class T, class TSubj, class TClip>
 T _clipper_do(const ClipperLib::ClipType     clipType,
               TSubj &&                        subject,
@@ -85,6 +85,46 @@ Slic3r::ExPolygons offset2_ex(const Slic3r::ExPolygons &expolygons, const float
     const float delta2, ClipperLib::JoinType joinType = ClipperLib::jtMiter, 
     double miterLimit = 3);
 
+// Successive insets of non-overlapping ExPolygons, as calculated by the perimeter generator for its loops.
+// The levels are kept as scaled Clipper paths, therefore each level is converted from the Slic3r representation just once,
+// and it is shared by the inset producing the next level and by the gap and thin wall detection between the neighbor levels.
+// A single ClipperOffset setup is reused for all the offsets of the ladder.
+class OffsetLadder
+{
+public:
+    OffsetLadder(const Slic3r::ExPolygons &level, ClipperLib::JoinType joinType = ClipperLib::jtMiter, double miterLimit = 3);
+
+    // Push a level calculated by the caller, which becomes the current level.
+    void               push(const Slic3r::ExPolygons &level);
+    // Push the current level shrunk by delta, the same as offset_ex(current, - delta).
+    // With a positive collapse, the parts narrower than 2 * collapse are removed,
+    // the same as offset2_ex(current, - delta - collapse, collapse). Returns the new current level.
+    Slic3r::ExPolygons inset(float delta, float collapse = 0.f);
+    // Area of the previous level shrunk by inset_previous, which is not covered by the current level grown by outset_current,
+    // the same as diff_ex(offset(previous, - inset_previous), offset(current, outset_current)).
+    Slic3r::ExPolygons gaps(float inset_previous, float outset_current);
+    // Area of the previous level not covered by the current level grown by outset_current, with the parts narrower than 2 * collapse removed,
+    // the same as offset2_ex(diff_ex(to_polygons(previous), offset(current, outset_current), true), - collapse, collapse).
+    Slic3r::ExPolygons thin_walls(float outset_current, float collapse);
+
+private:
+    // Scaled contour and scaled reversed holes of an ExPolygon.
+    struct ScaledExPolygon {
+        ClipperLib::Path  contour;
+        ClipperLib::Paths holes;
+    };
+    typedef std::vector<ScaledExPolygon> ScaledExPolygons;
+
+    static ScaledExPolygons scaled(const Slic3r::ExPolygons &expolygons);
+    // Safe offset of a level, see _offset(const Slic3r::ExPolygons&). Returns scaled paths.
+    ClipperLib::Paths       offset(const ScaledExPolygons &level, float delta);
+
+    ClipperLib::JoinType        m_join_type;
+    ClipperLib::ClipperOffset   m_co;
+    ScaledExPolygons            m_previous;
+    ScaledExPolygons            m_current;
+};
+
 Slic3r::Polygons _clipper(ClipperLib::ClipType clipType,
     const Slic3r::Polygons &subject, const Slic3r::Polygons &clip, bool safety_offset_ = false);
 Slic3r::ExPolygons _clipper_ex(ClipperLib::ClipType clipType,
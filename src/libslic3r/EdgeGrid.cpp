@@ -3,6 +3,15 @@
 #include <float.h>
 #include <unordered_map>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#endif
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #if 0
 // #ifdef SLIC3R_GUI
 #include <wx/image.h>
@@ -150,138 +159,45 @@ void EdgeGrid::Grid::create_from_m_contours(coord_t resolution)
 	m_rows = (m_bbox.max(1) - m_bbox.min(1) + m_resolution - 1) / m_resolution;
 	m_cells.assign(m_rows * m_cols, Cell());
 
-	// 3) First round of contour rasterization, count the edges per grid cell.
-	for (size_t i = 0; i < m_contours.size(); ++ i) {
-		const Slic3r::Points &pts = *m_contours[i];
-		for (size_t j = 0; j < pts.size(); ++ j) {
-			// End points of the line segment.
-			Slic3r::Point p1(pts[j]);
-			Slic3r::Point p2 = pts[(j + 1 == pts.size()) ? 0 : j + 1];
-			p1(0) -= m_bbox.min(0);
-			p1(1) -= m_bbox.min(1);
-			p2(0) -= m_bbox.min(0);
-			p2(1) -= m_bbox.min(1);
-		   	// Get the cells of the end points.
-		    coord_t ix    = p1(0) / m_resolution;
-		    coord_t iy    = p1(1) / m_resolution;
-		    coord_t ixb   = p2(0) / m_resolution;
-		    coord_t iyb   = p2(1) / m_resolution;
-			assert(ix >= 0 && size_t(ix) < m_cols);
-			assert(iy >= 0 && size_t(iy) < m_rows);
-			assert(ixb >= 0 && size_t(ixb) < m_cols);
-			assert(iyb >= 0 && size_t(iyb) < m_rows);
-			// Account for the end points.
-			++ m_cells[iy*m_cols+ix].end;
-			if (ix == ixb && iy == iyb)
-				// Both ends fall into the same cell.
-				continue;
-		    // Raster the centeral part of the line.
-			coord_t dx = std::abs(p2(0) - p1(0));
-			coord_t dy = std::abs(p2(1) - p1(1));
-			if (p1(0) < p2(0)) {
-				int64_t ex = int64_t((ix + 1)*m_resolution - p1(0)) * int64_t(dy);
-				if (p1(1) < p2(1)) {
-					// x positive, y positive
-					int64_t ey = int64_t((iy + 1)*m_resolution - p1(1)) * int64_t(dx);
-					do {
-						assert(ix <= ixb && iy <= iyb);
-						if (ex < ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix += 1;
-						}
-						else if (ex == ey) {
-							ex = int64_t(dy) * m_resolution;
-							ey = int64_t(dx) * m_resolution;
-							ix += 1;
-							iy += 1;
-						}
-						else {
-							assert(ex > ey);
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy += 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
-				else {
-					// x positive, y non positive
-					int64_t ey = int64_t(p1(1) - iy*m_resolution) * int64_t(dx);
-					do {
-						assert(ix <= ixb && iy >= iyb);
-						if (ex <= ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix += 1;
-						}
-						else {
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy -= 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
-			}
-			else {
-				int64_t ex = int64_t(p1(0) - ix*m_resolution) * int64_t(dy);
-				if (p1(1) < p2(1)) {
-					// x non positive, y positive
-					int64_t ey = int64_t((iy + 1)*m_resolution - p1(1)) * int64_t(dx);
-					do {
-						assert(ix >= ixb && iy <= iyb);
-						if (ex < ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix -= 1;
-						}
-						else {
-							assert(ex >= ey);
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy += 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
-				else {
-					// x non positive, y non positive
-					int64_t ey = int64_t(p1(1) - iy*m_resolution) * int64_t(dx);
-					do {
-						assert(ix >= ixb && iy >= iyb);
-						if (ex < ey) {
-							ey -= ex;
-							ex = int64_t(dy) * m_resolution;
-							ix -= 1;
-						}
-						else if (ex == ey) {
-							// The lower edge of a grid cell belongs to the cell.
-							// Handle the case where the ray may cross the lower left corner of a cell in a general case,
-							// or a left or lower edge in a degenerate case (horizontal or vertical line).
-							if (dx > 0) {
-								ex = int64_t(dy) * m_resolution;
-								ix -= 1;
-							}
-							if (dy > 0) {
-								ey = int64_t(dx) * m_resolution;
-								iy -= 1;
-							}
-						}
-						else {
-							assert(ex > ey);
-							ex -= ey;
-							ey = int64_t(dx) * m_resolution;
-							iy -= 1;
-						}
-						++m_cells[iy*m_cols + ix].end;
-					} while (ix != ixb || iy != iyb);
-				}
+	// 3) Rasterize the contours, in parallel over chunks of contour segments.
+	// Each chunk collects its own list of (cell index, segment index) hits, so that the hits may be scattered into m_cell_data
+	// in the order of contours and segments, the same as if the contours were rasterized one by one.
+	struct Chunk {
+		size_t 									contour;
+		size_t 									begin;
+		size_t 									end;
+		std::vector<std::pair<size_t, size_t>> 	hits;
+	};
+	static constexpr size_t CHUNK_SEGMENTS = 1024;
+	std::vector<Chunk> chunks;
+	for (size_t i = 0; i < m_contours.size(); ++ i)
+		for (size_t j = 0; j < m_contours[i]->size(); j += CHUNK_SEGMENTS)
+			chunks.push_back({ i, j, std::min(j + CHUNK_SEGMENTS, m_contours[i]->size()), {} });
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, chunks.size()), [this, &chunks](const tbb::blocked_range<size_t> &range) {
+		struct Visitor {
+			inline bool operator()(coord_t iy, coord_t ix) {
+				hits->emplace_back(iy * cols + ix, j);
+				// Continue traversing the grid along the edge.
+				return true;
 			}
+			std::vector<std::pair<size_t, size_t>> *hits;
+			size_t 									cols;
+			size_t 									j;
+		} visitor { nullptr, m_cols, 0 };
+		for (size_t ichunk = range.begin(); ichunk != range.end(); ++ ichunk) {
+			Chunk 				  &chunk = chunks[ichunk];
+			const Slic3r::Points  &pts   = *m_contours[chunk.contour];
+			chunk.hits.reserve(2 * (chunk.end - chunk.begin));
+			visitor.hits = &chunk.hits;
+			for (visitor.j = chunk.begin; visitor.j < chunk.end; ++ visitor.j)
+				this->visit_cells_intersecting_line(pts[visitor.j], pts[(visitor.j + 1 == pts.size()) ? 0 : visitor.j + 1], visitor);
 		}
-	}
+	});
 
-	// 4) Prefix sum the numbers of hits per cells to get an index into m_cell_data.
+	// 4) Count the edges per grid cell, prefix sum the numbers of hits per cells to get an index into m_cell_data.
+	for (const Chunk &chunk : chunks)
+		for (const std::pair<size_t, size_t> &hit : chunk.hits)
+			++ m_cells[hit.first].end;
 	size_t cnt = m_cells.front().end;
 	for (size_t i = 1; i < m_cells.size(); ++ i) {
 		m_cells[i].begin = cnt;
@@ -292,33 +208,52 @@ void EdgeGrid::Grid::create_from_m_contours(coord_t resolution)
 	// 5) Allocate the cell data.
 	m_cell_data.assign(cnt, std::pair<size_t, size_t>(size_t(-1), size_t(-1)));
 
-	// 6) Finally fill in m_cell_data by rasterizing the lines once again.
+	// 6) Finally fill in m_cell_data from the collected hits.
 	for (size_t i = 0; i < m_cells.size(); ++i)
 		m_cells[i].end = m_cells[i].begin;
+	for (const Chunk &chunk : chunks)
+		for (const std::pair<size_t, size_t> &hit : chunk.hits)
+			m_cell_data[m_cells[hit.first].end ++] = std::make_pair(chunk.contour, hit.second);
 
-	struct Visitor {
-		Visitor(std::vector<std::pair<size_t, size_t>> &cell_data, std::vector<Cell> &cells, size_t cols) :
-			cell_data(cell_data), cells(cells), cols(cols), i(0), j(0) {}
+	// 7) The edges for the vectorized distance queries are only stored by the first batch query.
+	m_cell_edges = CellEdges();
+	m_cell_edges_valid = false;
+}
 
-		inline bool operator()(coord_t iy, coord_t ix) {
-			cell_data[cells[iy*cols + ix].end++] = std::pair<size_t, size_t>(i, j);
-			// Continue traversing the grid along the edge.
-			return true;
+void EdgeGrid::Grid::update_cell_edges() const
+{
+	if (m_cell_edges_valid.load(std::memory_order_acquire))
+		return;
+	std::lock_guard<std::mutex> lock(m_cell_edges_mutex);
+	if (m_cell_edges_valid.load(std::memory_order_relaxed))
+		return;
+	// Store the edges of m_cell_data relative to the origin of their cells,
+	// so that single precision floats are accurate enough to select the closest edge.
+	size_t cnt = m_cell_data.size();
+	for (std::vector<float> *v : { &m_cell_edges.x1, &m_cell_edges.y1, &m_cell_edges.vx, &m_cell_edges.vy, &m_cell_edges.vx_prev, &m_cell_edges.vy_prev, &m_cell_edges.len_inv })
+		v->assign(cnt, 0.f);
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, m_cells.size(), 256), [this](const tbb::blocked_range<size_t> &range) {
+		for (size_t icell = range.begin(); icell != range.end(); ++ icell) {
+			const Cell &cell = m_cells[icell];
+			coord_t x0 = m_bbox.min(0) + coord_t(icell % m_cols) * m_resolution;
+			coord_t y0 = m_bbox.min(1) + coord_t(icell / m_cols) * m_resolution;
+			for (size_t i = cell.begin; i != cell.end; ++ i) {
+				const Slic3r::Points &pts = *m_contours[m_cell_data[i].first];
+				size_t 				  ipt = m_cell_data[i].second;
+				const Slic3r::Point  &p0  = pts[(ipt == 0) ? (pts.size() - 1) : ipt - 1];
+				const Slic3r::Point  &p1  = pts[ipt];
+				const Slic3r::Point  &p2  = pts[(ipt + 1 == pts.size()) ? 0 : ipt + 1];
+				m_cell_edges.x1[i]      = float(p1.x() - x0);
+				m_cell_edges.y1[i]      = float(p1.y() - y0);
+				m_cell_edges.vx[i]      = float(p2.x() - p1.x());
+				m_cell_edges.vy[i]      = float(p2.y() - p1.y());
+				m_cell_edges.vx_prev[i] = float(p1.x() - p0.x());
+				m_cell_edges.vy_prev[i] = float(p1.y() - p0.y());
+				m_cell_edges.len_inv[i] = float(1. / (p2 - p1).cast<double>().norm());
+			}
 		}
-
-		std::vector<std::pair<size_t, size_t>> &cell_data;
-		std::vector<Cell> 					   &cells;
-		size_t									cols;
-		size_t 									i;
-		size_t 									j;
-	} visitor(m_cell_data, m_cells, m_cols);
-
-	assert(visitor.i == 0);
-	for (; visitor.i < m_contours.size(); ++ visitor.i) {
-		const Slic3r::Points &pts = *m_contours[visitor.i];
-		for (visitor.j = 0; visitor.j < pts.size(); ++ visitor.j)
-			this->visit_cells_intersecting_line(pts[visitor.j], pts[(visitor.j + 1 == pts.size()) ? 0 : visitor.j + 1], visitor);
-	}
+	});
+	m_cell_edges_valid.store(true, std::memory_order_release);
 }
 
 #if 0
@@ -1171,9 +1106,8 @@ EdgeGrid::Grid::ClosestPointResult EdgeGrid::Grid::closest_point(const Point &pt
 	return result;
 }
 
-bool EdgeGrid::Grid::signed_distance_edges(const Point &pt, coord_t search_radius, coordf_t &result_min_dist, bool *pon_segment) const 
+bool EdgeGrid::Grid::cells_in_radius(const Point &pt, coord_t search_radius, BoundingBox &bbox) const
 {
-	BoundingBox bbox;
 	bbox.min = bbox.max = Point(pt(0) - m_bbox.min(0), pt(1) - m_bbox.min(1));
 	bbox.defined = true;
 	// Upper boundary, round to grid and test validity.
@@ -1197,8 +1131,13 @@ bool EdgeGrid::Grid::signed_distance_edges(const Point &pt, coord_t search_radiu
 	bbox.min(0) /= m_resolution;
 	bbox.min(1) /= m_resolution;
 	// Is the interval empty?
-	if (bbox.min(0) > bbox.max(0) ||
-		bbox.min(1) > bbox.max(1))
+	return bbox.min(0) <= bbox.max(0) && bbox.min(1) <= bbox.max(1);
+}
+
+bool EdgeGrid::Grid::signed_distance_edges(const Point &pt, coord_t search_radius, coordf_t &result_min_dist, bool *pon_segment) const 
+{
+	BoundingBox bbox;
+	if (! this->cells_in_radius(pt, search_radius, bbox))
 		return false;
 	// Traverse all cells in the bounding box.
 	double d_min = double(search_radius);
@@ -1275,6 +1214,178 @@ bool EdgeGrid::Grid::signed_distance(const Point &pt, coord_t search_radius, coo
 	return true;
 }
 
+// Reduce the per lane minima of EdgeGrid::Grid::cell_edges_closest().
+static inline void cell_edges_closest_reduce(const float *mins, const float *idxs, size_t num_lanes, size_t begin, float &d2_min, size_t &i_min)
+{
+	// The lanes are visited in the order of their first edge. Among the equally distant edges the first one wins,
+	// the same as in the serial loop.
+	float  d2  = d2_min;
+	size_t idx = size_t(-1);
+	for (size_t lane = 0; lane < num_lanes; ++ lane) {
+		size_t i = begin + size_t(idxs[lane]);
+		if (mins[lane] < d2 || (mins[lane] == d2 && idx != size_t(-1) && i < idx)) {
+			d2  = mins[lane];
+			idx = i;
+		}
+	}
+	if (idx != size_t(-1)) {
+		d2_min = d2;
+		i_min  = idx;
+	}
+}
+
+void EdgeGrid::Grid::cell_edges_closest(size_t begin, size_t end, float px, float py, float &d2_min, size_t &i_min) const
+{
+	const CellEdges &c = m_cell_edges;
+	size_t i = begin;
+#if defined(__AVX__)
+	if (i + 8 <= end) {
+		const __m256 ppx  = _mm256_set1_ps(px);
+		const __m256 ppy  = _mm256_set1_ps(py);
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 inf  = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+		// Minimum per lane and its edge index relative to begin, stored as a float, which is exact for any sensible cell.
+		__m256 lane_min = inf;
+		__m256 lane_idx = zero;
+		__m256 idx 		= _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f);
+		const __m256 step = _mm256_set1_ps(8.f);
+		for (; i + 8 <= end; i += 8, idx = _mm256_add_ps(idx, step)) {
+			__m256 vx     = _mm256_loadu_ps(c.vx.data() + i);
+			__m256 vy     = _mm256_loadu_ps(c.vy.data() + i);
+			__m256 vptx   = _mm256_sub_ps(ppx, _mm256_loadu_ps(c.x1.data() + i));
+			__m256 vpty   = _mm256_sub_ps(ppy, _mm256_loadu_ps(c.y1.data() + i));
+			__m256 t      = _mm256_add_ps(_mm256_mul_ps(vx, vptx), _mm256_mul_ps(vy, vpty));
+			__m256 l2     = _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy));
+			__m256 t_prev = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(c.vx_prev.data() + i), vptx), _mm256_mul_ps(_mm256_loadu_ps(c.vy_prev.data() + i), vpty));
+			__m256 d_seg  = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(vy, vptx), _mm256_mul_ps(vx, vpty)), _mm256_loadu_ps(c.len_inv.data() + i));
+			__m256 d2_pt  = _mm256_add_ps(_mm256_mul_ps(vptx, vptx), _mm256_mul_ps(vpty, vpty));
+			__m256 pt_valid  = _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_LT_OQ), _mm256_cmp_ps(t_prev, zero, _CMP_GT_OQ));
+			__m256 seg_valid = _mm256_and_ps(_mm256_cmp_ps(t, zero, _CMP_GE_OQ), _mm256_cmp_ps(t, l2, _CMP_LE_OQ));
+			__m256 d2 	  = _mm256_blendv_ps(_mm256_blendv_ps(inf, d2_pt, pt_valid), _mm256_mul_ps(d_seg, d_seg), seg_valid);
+			__m256 closer = _mm256_cmp_ps(d2, lane_min, _CMP_LT_OQ);
+			lane_min = _mm256_blendv_ps(lane_min, d2, closer);
+			lane_idx = _mm256_blendv_ps(lane_idx, idx, closer);
+		}
+		alignas(32) float mins[8];
+		alignas(32) float idxs[8];
+		_mm256_store_ps(mins, lane_min);
+		_mm256_store_ps(idxs, lane_idx);
+		cell_edges_closest_reduce(mins, idxs, 8, begin, d2_min, i_min);
+	}
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	if (i + 4 <= end) {
+		const __m128 ppx  = _mm_set1_ps(px);
+		const __m128 ppy  = _mm_set1_ps(py);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 inf  = _mm_set1_ps(std::numeric_limits<float>::infinity());
+		// Minimum per lane and its edge index relative to begin, stored as a float, which is exact for any sensible cell.
+		__m128 lane_min = inf;
+		__m128 lane_idx = zero;
+		__m128 idx 		= _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+		const __m128 step = _mm_set1_ps(4.f);
+		for (; i + 4 <= end; i += 4, idx = _mm_add_ps(idx, step)) {
+			__m128 vx     = _mm_loadu_ps(c.vx.data() + i);
+			__m128 vy     = _mm_loadu_ps(c.vy.data() + i);
+			__m128 vptx   = _mm_sub_ps(ppx, _mm_loadu_ps(c.x1.data() + i));
+			__m128 vpty   = _mm_sub_ps(ppy, _mm_loadu_ps(c.y1.data() + i));
+			__m128 t      = _mm_add_ps(_mm_mul_ps(vx, vptx), _mm_mul_ps(vy, vpty));
+			__m128 l2     = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy));
+			__m128 t_prev = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c.vx_prev.data() + i), vptx), _mm_mul_ps(_mm_loadu_ps(c.vy_prev.data() + i), vpty));
+			__m128 d_seg  = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(vy, vptx), _mm_mul_ps(vx, vpty)), _mm_loadu_ps(c.len_inv.data() + i));
+			__m128 d2_pt  = _mm_add_ps(_mm_mul_ps(vptx, vptx), _mm_mul_ps(vpty, vpty));
+			__m128 pt_valid  = _mm_and_ps(_mm_cmplt_ps(t, zero), _mm_cmpgt_ps(t_prev, zero));
+			__m128 seg_valid = _mm_and_ps(_mm_cmpge_ps(t, zero), _mm_cmple_ps(t, l2));
+			// The two masks are exclusive.
+			__m128 d2 	  = _mm_or_ps(_mm_or_ps(_mm_and_ps(pt_valid, d2_pt), _mm_and_ps(seg_valid, _mm_mul_ps(d_seg, d_seg))), 
+								_mm_andnot_ps(_mm_or_ps(pt_valid, seg_valid), inf));
+			__m128 closer = _mm_cmplt_ps(d2, lane_min);
+			lane_min = _mm_or_ps(_mm_and_ps(closer, d2),  _mm_andnot_ps(closer, lane_min));
+			lane_idx = _mm_or_ps(_mm_and_ps(closer, idx), _mm_andnot_ps(closer, lane_idx));
+		}
+		alignas(16) float mins[4];
+		alignas(16) float idxs[4];
+		_mm_store_ps(mins, lane_min);
+		_mm_store_ps(idxs, lane_idx);
+		cell_edges_closest_reduce(mins, idxs, 4, begin, d2_min, i_min);
+	}
+#endif
+	// Scalar fallback and the remaining edges.
+	for (; i < end; ++ i) {
+		float vptx = px - c.x1[i];
+		float vpty = py - c.y1[i];
+		float t    = c.vx[i] * vptx + c.vy[i] * vpty;
+		float d2;
+		if (t < 0.f) {
+			if (c.vx_prev[i] * vptx + c.vy_prev[i] * vpty <= 0.f)
+				continue;
+			d2 = vptx * vptx + vpty * vpty;
+		} else if (t <= c.vx[i] * c.vx[i] + c.vy[i] * c.vy[i]) {
+			float d_seg = (c.vy[i] * vptx - c.vx[i] * vpty) * c.len_inv[i];
+			d2 = d_seg * d_seg;
+		} else
+			continue;
+		if (d2 < d2_min) {
+			d2_min = d2;
+			i_min  = i;
+		}
+	}
+}
+
+std::vector<coordf_t> EdgeGrid::Grid::signed_distance(const Points &pts, coord_t search_radius) const
+{
+	std::vector<coordf_t> out(pts.size(), std::numeric_limits<coordf_t>::quiet_NaN());
+	this->update_cell_edges();
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, pts.size(), 1024), [this, &pts, search_radius, &out](const tbb::blocked_range<size_t> &range) {
+		for (size_t idx = range.begin(); idx != range.end(); ++ idx) {
+			const Point &pt = pts[idx];
+			// Select the closest edge in single precision.
+			float  d2_min = float(search_radius) * float(search_radius);
+			size_t i_min  = size_t(-1);
+			BoundingBox cells;
+			if (this->cells_in_radius(pt, search_radius, cells))
+				for (int r = cells.min(1); r <= cells.max(1); ++ r)
+					for (int c = cells.min(0); c <= cells.max(0); ++ c) {
+						const Cell &cell = m_cells[r * m_cols + c];
+						if (cell.begin < cell.end)
+							this->cell_edges_closest(cell.begin, cell.end, 
+								float(pt.x() - m_bbox.min(0) - c * m_resolution), float(pt.y() - m_bbox.min(1) - r * m_resolution), d2_min, i_min);
+					}
+			if (i_min != size_t(-1)) {
+				// Distance and its signum calculated exactly for the closest edge, the same way as signed_distance_edges() does.
+				const Slic3r::Points &contour = *m_contours[m_cell_data[i_min].first];
+				size_t 				  ipt 	  = m_cell_data[i_min].second;
+				const Slic3r::Point  &p1 	  = contour[ipt];
+				const Slic3r::Point  &p2 	  = contour[(ipt + 1 == contour.size()) ? 0 : ipt + 1];
+				Slic3r::Point v_seg  = p2 - p1;
+				Slic3r::Point v_pt   = pt - p1;
+				int64_t 	  t_pt   = int64_t(v_seg(0)) * int64_t(v_pt(0)) + int64_t(v_seg(1)) * int64_t(v_pt(1));
+				int64_t 	  l2_seg = int64_t(v_seg(0)) * int64_t(v_seg(0)) + int64_t(v_seg(1)) * int64_t(v_seg(1));
+				double 		  d;
+				int 		  sign;
+				if (t_pt < 0) {
+					const Slic3r::Point &p0 = contour[(ipt == 0) ? (contour.size() - 1) : ipt - 1];
+					Slic3r::Point v_seg_prev = p1 - p0;
+					int64_t det = int64_t(v_seg_prev(0)) * int64_t(v_seg(1)) - int64_t(v_seg_prev(1)) * int64_t(v_seg(0));
+					d    = sqrt(double(int64_t(v_pt(0)) * int64_t(v_pt(0)) + int64_t(v_pt(1)) * int64_t(v_pt(1))));
+					sign = (det > 0) ? 1 : -1;
+				} else {
+					// Clamp to the end point if the single precision test admitted a point slightly behind it.
+					int64_t d_seg = int64_t(v_seg(1)) * int64_t(v_pt(0)) - int64_t(v_seg(0)) * int64_t(v_pt(1));
+					d    = (t_pt > l2_seg) ? (pt - p2).cast<double>().norm() : std::abs(double(d_seg) / sqrt(double(l2_seg)));
+					sign = (d_seg < 0) ? -1 : ((d_seg == 0) ? 0 : 1);
+				}
+				if (d < double(search_radius)) {
+					out[idx] = d * sign;
+					continue;
+				}
+			}
+			if (! m_signed_distance_field.empty())
+				out[idx] = signed_distance_bilinear(pt);
+		}
+	});
+	return out;
+}
+
 Polygons EdgeGrid::Grid::contours_simplified(coord_t offset, bool fill_holes) const
 {
 	assert(std::abs(2 * offset) < m_resolution);
@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <math.h>
 
+#include <atomic>
+#include <mutex>
+
 #include "Point.hpp"
 #include "BoundingBox.hpp"
 #include "ExPolygon.hpp"
@@ -66,6 +69,11 @@ public:
 	// Calculate a signed distance to the contours in search_radius from the point. If no edge is found in search_radius,
 	// return an interpolated value from m_signed_distance_field, if it exists.
 	bool signed_distance(const Point &pt, coord_t search_radius, coordf_t &result_min_dist) const;
+	// Batch variant of signed_distance() for many points. The distances to the edges near each point are evaluated
+	// several edges at once with SSE2 or AVX instructions if available, with a scalar fallback.
+	// Large batches are split over threads. Returns the signed distance for each point, or NaN if the distance is not known.
+	// The edge data for the vectorized evaluation is prepared by the first batch query.
+	std::vector<coordf_t> signed_distance(const Points &pts, coord_t search_radius) const;
 
 	const BoundingBox& 	bbox() const { return m_bbox; }
 	const coord_t 		resolution() const { return m_resolution; }
@@ -249,6 +257,15 @@ protected:
 	};
 
 	void create_from_m_contours(coord_t resolution);
+	// Fill in m_cell_edges if not done yet, thread safe.
+	void update_cell_edges() const;
+	// Range of the cells closer than search_radius to pt, returns false if the range is empty.
+	bool cells_in_radius(const Point &pt, coord_t search_radius, BoundingBox &cells) const;
+	// Update the squared distance d2_min and the index i_min of the edge closest to (px, py) with the edges [begin, end) of a cell,
+	// with (px, py) relative to the cell origin. Evaluated with SIMD instructions if available.
+	// Only the edges closest to (px, py) in their interior or at their start point inside the wedge with the preceding edge are considered,
+	// the same as in signed_distance_edges().
+	void cell_edges_closest(size_t begin, size_t end, float px, float py, float &d2_min, size_t &i_min) const;
 #if 0
 	bool line_cell_intersect(const Point &p1, const Point &p2, const Cell &cell);
 #endif
@@ -280,6 +297,16 @@ protected:
 	// Referencing a contour and a line segment of m_contours.
 	std::vector<std::pair<size_t, size_t> >		m_cell_data;
 
+	// Start points relative to their cell origin, directions, directions of the preceding contour edges and inverse lengths
+	// of the edges referenced by m_cell_data, in a structure of arrays layout for the vectorized distance queries.
+	// Only filled in by the first batch query, see update_cell_edges().
+	struct CellEdges {
+		std::vector<float> x1, y1, vx, vy, vx_prev, vy_prev, len_inv;
+	};
+	mutable CellEdges 							m_cell_edges;
+	mutable std::atomic<bool> 					m_cell_edges_valid { false };
+	mutable std::mutex 							m_cell_edges_mutex;
+
 	// Full grid of cells.
 	std::vector<Cell> 							m_cells;
 
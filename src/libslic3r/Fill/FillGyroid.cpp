@@ -4,49 +4,244 @@
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include <tbb/mutex.h>
+#include <tbb/parallel_for.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define GYROID_SIMD
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GYROID_SIMD
+#endif
 
 #include "FillGyroid.hpp"
 
 namespace Slic3r {
 
-static inline double f(double x, double z_sin, double z_cos, bool vertical, bool flip)
+// Lanes of the batch evaluation of the gyroid waves. All the lane types execute the same sequence of IEEE double
+// operations, thus a sample gets the same value whether it is evaluated by a SIMD batch or by the scalar tail.
+struct ScalarLanes
 {
-    if (vertical) {
-        double phase_offset = (z_cos < 0 ? M_PI : 0) + M_PI;
-        double a   = sin(x + phase_offset);
-        double b   = - z_cos;
-        double res = z_sin * cos(x + phase_offset + (flip ? M_PI : 0.));
-        double r   = sqrt(sqr(a) + sqr(b));
-        return asin(a/r) + asin(res/r) + M_PI;
+    typedef double V;
+    typedef bool   M;
+    static constexpr size_t size = 1;
+    static V    load(const double *p)       { return *p; }
+    static void store(double *p, V v)       { *p = v; }
+    static V    set1(double v)              { return v; }
+    static V    add(V a, V b)               { return a + b; }
+    static V    sub(V a, V b)               { return a - b; }
+    static V    mul(V a, V b)               { return a * b; }
+    static V    div(V a, V b)               { return a / b; }
+    static V    sqrt(V a)                   { return std::sqrt(a); }
+    static V    max(V a, V b)               { return b > a ? b : a; }
+    static V    abs(V a)                    { return std::abs(a); }
+    static V    neg(V a)                    { return - a; }
+    static M    lt(V a, V b)                { return a < b; }
+    static M    gt(V a, V b)                { return a > b; }
+    static M    eq(V a, V b)                { return a == b; }
+    static M    or_(M a, M b)               { return a || b; }
+    static V    select(M m, V a, V b)       { return m ? a : b; }
+};
+
+#if defined(__AVX__)
+struct SIMDLanes
+{
+    typedef __m256d V;
+    typedef __m256d M;
+    static constexpr size_t size = 4;
+    static V    load(const double *p)       { return _mm256_loadu_pd(p); }
+    static void store(double *p, V v)       { _mm256_storeu_pd(p, v); }
+    static V    set1(double v)              { return _mm256_set1_pd(v); }
+    static V    add(V a, V b)               { return _mm256_add_pd(a, b); }
+    static V    sub(V a, V b)               { return _mm256_sub_pd(a, b); }
+    static V    mul(V a, V b)               { return _mm256_mul_pd(a, b); }
+    static V    div(V a, V b)               { return _mm256_div_pd(a, b); }
+    static V    sqrt(V a)                   { return _mm256_sqrt_pd(a); }
+    static V    max(V a, V b)               { return _mm256_max_pd(b, a); }
+    static V    abs(V a)                    { return _mm256_andnot_pd(_mm256_set1_pd(-0.), a); }
+    static V    neg(V a)                    { return _mm256_xor_pd(_mm256_set1_pd(-0.), a); }
+    static M    lt(V a, V b)                { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static M    gt(V a, V b)                { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static M    eq(V a, V b)                { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static M    or_(M a, M b)               { return _mm256_or_pd(a, b); }
+    static V    select(M m, V a, V b)       { return _mm256_blendv_pd(b, a, m); }
+};
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+struct SIMDLanes
+{
+    typedef __m128d V;
+    typedef __m128d M;
+    static constexpr size_t size = 2;
+    static V    load(const double *p)       { return _mm_loadu_pd(p); }
+    static void store(double *p, V v)       { _mm_storeu_pd(p, v); }
+    static V    set1(double v)              { return _mm_set1_pd(v); }
+    static V    add(V a, V b)               { return _mm_add_pd(a, b); }
+    static V    sub(V a, V b)               { return _mm_sub_pd(a, b); }
+    static V    mul(V a, V b)               { return _mm_mul_pd(a, b); }
+    static V    div(V a, V b)               { return _mm_div_pd(a, b); }
+    static V    sqrt(V a)                   { return _mm_sqrt_pd(a); }
+    static V    max(V a, V b)               { return _mm_max_pd(b, a); }
+    static V    abs(V a)                    { return _mm_andnot_pd(_mm_set1_pd(-0.), a); }
+    static V    neg(V a)                    { return _mm_xor_pd(_mm_set1_pd(-0.), a); }
+    static M    lt(V a, V b)                { return _mm_cmplt_pd(a, b); }
+    static M    gt(V a, V b)                { return _mm_cmpgt_pd(a, b); }
+    static M    eq(V a, V b)                { return _mm_cmpeq_pd(a, b); }
+    static M    or_(M a, M b)               { return _mm_or_pd(a, b); }
+    static V    select(M m, V a, V b)       { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+};
+#endif
+
+// Polynomial evaluation by the Horner scheme.
+template<typename L, size_t N>
+static inline typename L::V horner(typename L::V x, const double (&coef)[N])
+{
+    typename L::V p = L::set1(coef[N - 1]);
+    for (size_t i = N - 1; i > 0; -- i)
+        p = L::add(L::mul(p, x), L::set1(coef[i - 1]));
+    return p;
+}
+
+// sin(x) and cos(x). The polynomials are fitted on <-pi/4, pi/4>, the absolute error is below 2e-14.
+template<typename L>
+static inline typename L::V gyroid_sin_cos(typename L::V x, typename L::V &cos_x)
+{
+    typedef typename L::V V;
+    typedef typename L::M M;
+    static constexpr double sin_coef[] = { -0.16666666666663907, 0.008333333331083924, -0.00019841266920300632, 2.755599174750086e-06, -2.4805701462923124e-08 };
+    static constexpr double cos_coef[] = { 0.04166666666666471, -0.001388888888728186, 2.4801585214487e-05, -2.7556370572543497e-07, 2.070066946316962e-09 };
+    // Adding and subtracting 1.5 * 2^52 rounds a double of a magnitude below 2^51 to the nearest integer.
+    const V round_magic = L::set1(6755399441055744.);
+    // Quadrant k = round(x / (pi/2)), r = x - k pi/2 with pi/2 split into 33 high bits and a remainder (Cody-Waite).
+    V k = L::sub(L::add(L::mul(x, L::set1(2. / M_PI)), round_magic), round_magic);
+    V r = L::sub(L::sub(x, L::mul(k, L::set1(1.57079632673412561417e+00))), L::mul(k, L::set1(6.07710050650619224932e-11)));
+    // k modulo 4, in <-2, 2>.
+    V q = L::sub(k, L::mul(L::set1(4.), L::sub(L::add(L::mul(k, L::set1(0.25)), round_magic), round_magic)));
+    V r2    = L::mul(r, r);
+    V sin_r = L::add(r, L::mul(L::mul(r, r2), horner<L>(r2, sin_coef)));
+    V cos_r = L::add(L::sub(L::set1(1.), L::mul(L::set1(0.5), r2)), L::mul(L::mul(r2, r2), horner<L>(r2, cos_coef)));
+    // Odd quadrants swap sine and cosine, sin(x) is negative for q in {-2, -1, 2}, cos(x) for q in {-2, 1, 2}.
+    M swap = L::eq(L::abs(q), L::set1(1.));
+    V s    = L::select(swap, cos_r, sin_r);
+    V c    = L::select(swap, sin_r, cos_r);
+    cos_x  = L::select(L::or_(L::gt(q, L::set1(0.5)), L::lt(q, L::set1(-1.5))), L::neg(c), c);
+    return L::select(L::or_(L::lt(q, L::set1(-0.5)), L::gt(q, L::set1(1.5))), L::neg(s), s);
+}
+
+// atan(t) for any t including infinities. The polynomial is fitted on <0, tan(pi/8)>, the absolute error is below 1e-13.
+template<typename L>
+static inline typename L::V gyroid_atan(typename L::V t)
+{
+    typedef typename L::V V;
+    typedef typename L::M M;
+    static constexpr double atan_coef[] = { -0.3333333333326854, 0.19999999951167788, -0.14285708231918848, 0.11110823943035666, -0.09084171942045463, 0.07605396498691808, -0.06029827497217355, 0.032998644657170284 };
+    M negative = L::lt(t, L::set1(0.));
+    V a        = L::abs(t);
+    // atan(a) = pi/2 - atan(1/a)
+    M inverse  = L::gt(a, L::set1(1.));
+    a          = L::select(inverse, L::div(L::set1(1.), a), a);
+    // atan(a) = pi/4 + atan((a - 1) / (a + 1))
+    M shift    = L::gt(a, L::set1(0.41421356237309503));
+    a          = L::select(shift, L::div(L::sub(a, L::set1(1.)), L::add(a, L::set1(1.))), a);
+    V a2       = L::mul(a, a);
+    V res      = L::add(L::select(shift, L::set1(0.25 * M_PI), L::set1(0.)), L::add(a, L::mul(L::mul(a, a2), horner<L>(a2, atan_coef))));
+    res        = L::select(inverse, L::sub(L::set1(0.5 * M_PI), res), res);
+    return L::select(negative, L::neg(res), res);
+}
+
+// The gyroid wave as a function of x for a given z phase. The phase shifts of the sine and cosine of x are multiples of pi,
+// thus they are folded into the signs of the terms. asin(a / r) + asin(res / r) is evaluated as atan(a / |b|) + atan(res / sqrt(r^2 - res^2)),
+// which is equal for r = sqrt(a^2 + b^2) as long as |res| <= |b|. That holds, as make_gyroid_waves() picks the vertical waves
+// for |z_sin| <= |z_cos| only.
+struct GyroidWave
+{
+    GyroidWave(double z_sin, double z_cos, bool vertical, bool flip) : vertical(vertical)
+    {
+        if (vertical) {
+            // a = sin(x + phase_offset), res = z_sin * cos(x + phase_offset + (flip ? pi : 0)), phase_offset = (z_cos < 0 ? pi : 0) + pi
+            a_sign  = z_cos < 0 ? 1. : -1.;
+            res_mul = ((z_cos < 0) == flip) ? - z_sin : z_sin;
+            b_abs   = std::abs(z_cos);
+            offset  = M_PI;
+        } else {
+            // a = cos(x + phase_offset), res = z_cos * sin(x + phase_offset + (flip ? 0 : pi)), phase_offset = z_sin < 0 ? pi : 0
+            a_sign  = z_sin < 0 ? -1. : 1.;
+            res_mul = ((z_sin < 0) == flip) ? - z_cos : z_cos;
+            b_abs   = std::abs(z_sin);
+            offset  = 0.5 * M_PI;
+        }
     }
-    else {
-        double phase_offset = z_sin < 0 ? M_PI : 0.;
-        double a   = cos(x + phase_offset);
-        double b   = - z_sin;
-        double res = z_cos * sin(x + phase_offset + (flip ? 0 : M_PI));
-        double r   = sqrt(sqr(a) + sqr(b));
-        return (asin(a/r) + asin(res/r) + 0.5 * M_PI);
+
+    template<typename L>
+    typename L::V eval(typename L::V x) const
+    {
+        typedef typename L::V V;
+        V cos_x;
+        V sin_x = gyroid_sin_cos<L>(x, cos_x);
+        V a     = L::mul(L::set1(a_sign),  vertical ? sin_x : cos_x);
+        V res   = L::mul(L::set1(res_mul), vertical ? cos_x : sin_x);
+        V b     = L::set1(b_abs);
+        // r^2 - res^2, clamped against rounding below zero for a == 0 and |res| == |b|, where asin(res / r) = +-pi/2.
+        V d2    = L::max(L::sub(L::add(L::mul(a, a), L::mul(b, b)), L::mul(res, res)), L::set1(0.));
+        return L::add(L::add(gyroid_atan<L>(L::div(a, b)), gyroid_atan<L>(L::div(res, L::sqrt(d2)))), L::set1(offset));
     }
+
+    double operator()(double x) const { return this->eval<ScalarLanes>(x); }
+
+    // Evaluate y[i] = f(x[i]) for i < n, in batches of the SIMD width where available.
+    void operator()(const double *x, double *y, size_t n) const
+    {
+        size_t i = 0;
+#ifdef GYROID_SIMD
+        for (; i + SIMDLanes::size <= n; i += SIMDLanes::size)
+            SIMDLanes::store(y + i, this->eval<SIMDLanes>(SIMDLanes::load(x + i)));
+#endif /* GYROID_SIMD */
+        for (; i < n; ++ i)
+            y[i] = this->eval<ScalarLanes>(x[i]);
+    }
+
+    bool    vertical;
+    double  a_sign;
+    double  res_mul;
+    double  b_abs;
+    double  offset;
+};
+
+void FillGyroid::wave(double z_sin, double z_cos, bool vertical, bool flip, const double *x, double *y, size_t n)
+{
+    GyroidWave(z_sin, z_cos, vertical, flip)(x, y, n);
 }
 
+// The waves sampled for one z phase. They do not depend on the surface being filled.
+struct GyroidRow
+{
+    // One period of the wave, or less if the surface is narrower.
+    std::vector<Vec2d>  one_period;
+    // The period replicated along x, without the point closing the first period.
+    std::vector<Vec2d>  points;
+};
+
 static inline Polyline make_wave(
-    const std::vector<Vec2d>& one_period, double width, double height, double offset, double scaleFactor,
+    const GyroidRow &row, double width, double height, double offset, double scaleFactor,
     double z_cos, double z_sin, bool vertical, bool flip)
 {
-    std::vector<Vec2d> points = one_period;
-    double period = points.back()(0);
+    std::vector<Vec2d> points;
+    double period = row.one_period.back()(0);
     if (width != period) // do not extend if already truncated
     {
-        points.reserve(one_period.size() * floor(width / period));
-        points.pop_back();
-
-        int n = points.size();
-        do {
-            points.emplace_back(Vec2d(points[points.size()-n](0) + period, points[points.size()-n](1)));
-        } while (points.back()(0) < width - EPSILON);
-
-        points.emplace_back(Vec2d(width, f(width, z_sin, z_cos, vertical, flip)));
-    }
+        // The replicated points up to the first one reaching the width, then the end point at the width.
+        auto it_last = std::find_if(row.points.begin() + (row.one_period.size() - 1), row.points.end(),
+            [width](const Vec2d &pt) { return pt(0) >= width - EPSILON; });
+        assert(it_last != row.points.end());
+        points.reserve((it_last - row.points.begin()) + 2);
+        points.assign(row.points.begin(), it_last + 1);
+        points.emplace_back(Vec2d(width, GyroidWave(z_sin, z_cos, vertical, flip)(width)));
+    } else
+        points = row.one_period;
 
     // and construct the final polyline to return:
     Polyline polyline;
@@ -64,26 +259,35 @@ static inline Polyline make_wave(
 
 static std::vector<Vec2d> make_one_period(double width, double scaleFactor, double z_cos, double z_sin, bool vertical, bool flip, double tolerance)
 {
+    const GyroidWave f(z_sin, z_cos, vertical, flip);
     std::vector<Vec2d> points;
     double dx = M_PI_2; // exact coordinates on main inflexion lobes
     double limit = std::min(2*M_PI, width);
     points.reserve(ceil(limit / tolerance / 3));
 
-    for (double x = 0.; x < limit - EPSILON; x += dx) {
-        points.emplace_back(Vec2d(x, f(x, z_sin, z_cos, vertical, flip)));
-    }
-    points.emplace_back(Vec2d(limit, f(limit, z_sin, z_cos, vertical, flip)));
+    // The samples of each refinement pass are evaluated in a single batch.
+    std::vector<double> xs, ys;
+    for (double x = 0.; x < limit - EPSILON; x += dx)
+        xs.emplace_back(x);
+    xs.emplace_back(limit);
+    ys.assign(xs.size(), 0.);
+    f(xs.data(), ys.data(), xs.size());
+    for (size_t i = 0; i < xs.size(); ++ i)
+        points.emplace_back(Vec2d(xs[i], ys[i]));
 
     // piecewise increase in resolution up to requested tolerance
     for(;;)
     {
         size_t size = points.size();
+        xs.clear();
+        for (size_t i = 1; i < size; ++ i)
+            xs.emplace_back(points[i-1](0) + (points[i](0) - points[i-1](0)) / 2);
+        ys.assign(xs.size(), 0.);
+        f(xs.data(), ys.data(), xs.size());
         for (unsigned int i = 1;i < size; ++i) {
             auto& lp = points[i-1]; // left point
             auto& rp = points[i];   // right point
-            double x = lp(0) + (rp(0) - lp(0)) / 2;
-            double y = f(x, z_sin, z_cos, vertical, flip);
-            Vec2d ip = {x, y};
+            Vec2d ip = {xs[i-1], ys[i-1]};
             if (std::abs(cross2(Vec2d(ip - lp), Vec2d(ip - rp))) > sqr(tolerance)) {
                 points.emplace_back(std::move(ip));
             }
@@ -102,6 +306,69 @@ static std::vector<Vec2d> make_one_period(double width, double scaleFactor, doub
     return points;
 }
 
+// The waves only depend on z and on the sampling parameters, not on the surface being filled.
+// They are therefore shared by all the surfaces, regions and objects filled at the same z with the same spacing,
+// which would otherwise resample the trigonometric functions and replicate the period for each of them.
+struct GyroidRowKey
+{
+    // Width of the sampled period, 2 PI unless the surface is narrower.
+    double  width;
+    // z in the units of the pattern, see make_gyroid_waves().
+    double  z;
+    bool    flip;
+    double  tolerance;
+
+    bool operator<(const GyroidRowKey &rhs) const
+        { return std::tie(width, z, flip, tolerance) < std::tie(rhs.width, rhs.z, rhs.flip, rhs.tolerance); }
+};
+
+static std::shared_ptr<const GyroidRow> make_row_cached(const GyroidRowKey &key, double width, double scaleFactor, double z_cos, double z_sin, bool vertical)
+{
+    static tbb::mutex                                                   cache_mutex;
+    static std::map<GyroidRowKey, std::shared_ptr<const GyroidRow>>    cache;
+    std::shared_ptr<const GyroidRow> row;
+    {
+        tbb::mutex::scoped_lock lock(cache_mutex);
+        auto it = cache.find(key);
+        if (it != cache.end())
+            row = it->second;
+    }
+    if (row && (row->one_period.back()(0) == width || row->points.back()(0) >= width - EPSILON))
+        return row;
+    // Sample and replicate outside of the lock. If two threads produce the same row, both produce the same points.
+    auto new_row = std::make_shared<GyroidRow>();
+    if (row) {
+        // The cached row is too short for this surface, extend a copy of it.
+        *new_row = *row;
+    } else {
+        new_row->one_period = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, key.flip, key.tolerance);
+        new_row->points     = new_row->one_period;
+        new_row->points.pop_back();
+    }
+    double period = new_row->one_period.back()(0);
+    if (width != period) {
+        // Extend to twice the length cached so far at least, so that a few wider surfaces do not extend the row each.
+        double length = std::max(width, 2. * new_row->points.back()(0));
+        std::vector<Vec2d> &points = new_row->points;
+        size_t n = new_row->one_period.size() - 1;
+        points.reserve(n * size_t(ceil(length / period) + 1));
+        do {
+            points.emplace_back(Vec2d(points[points.size()-n](0) + period, points[points.size()-n](1)));
+        } while (points.back()(0) < length - EPSILON);
+    }
+    {
+        tbb::mutex::scoped_lock lock(cache_mutex);
+        // The cache is bounded, it is cleared once full.
+        if (cache.size() >= FillGyroid::WaveCacheSize)
+            cache.clear();
+        std::shared_ptr<const GyroidRow> &slot = cache[key];
+        // Another thread may have stored a longer row in the meantime.
+        if (! slot || slot->points.back()(0) < new_row->points.back()(0))
+            slot = new_row;
+    }
+    return new_row;
+}
+
 static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double line_spacing, double width, double height)
 {
     const double scaleFactor = scale_(line_spacing) / density_adjusted;
@@ -127,18 +394,21 @@ static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double
         std::swap(width,height);
     }
 
-    std::vector<Vec2d> one_period_odd = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance); // creates one period of the waves, so it doesn't have to be recalculated all the time
+    // Only the part of width up to one period is sampled.
+    GyroidRowKey key { std::min(2*M_PI, width), z, flip, tolerance };
+    std::shared_ptr<const GyroidRow> row_odd = make_row_cached(key, width, scaleFactor, z_cos, z_sin, vertical); // creates one period of the waves, so it doesn't have to be recalculated all the time
     flip = !flip;                                                                   // even polylines are a bit shifted
-    std::vector<Vec2d> one_period_even = make_one_period(width, scaleFactor, z_cos, z_sin, vertical, flip, tolerance);
+    key.flip = flip;
+    std::shared_ptr<const GyroidRow> row_even = make_row_cached(key, width, scaleFactor, z_cos, z_sin, vertical);
     Polylines result;
 
     for (double y0 = lower_bound; y0 < upper_bound + EPSILON; y0 += M_PI) {
         // creates odd polylines
-        result.emplace_back(make_wave(one_period_odd, width, height, y0, scaleFactor, z_cos, z_sin, vertical, flip));
+        result.emplace_back(make_wave(*row_odd, width, height, y0, scaleFactor, z_cos, z_sin, vertical, flip));
         // creates even polylines
         y0 += M_PI;
         if (y0 < upper_bound + EPSILON) {
-            result.emplace_back(make_wave(one_period_even, width, height, y0, scaleFactor, z_cos, z_sin, vertical, flip));
+            result.emplace_back(make_wave(*row_even, width, height, y0, scaleFactor, z_cos, z_sin, vertical, flip));
         }
     }
 
@@ -147,6 +417,27 @@ static Polylines make_gyroid_waves(double gridZ, double density_adjusted, double
 
 // FIXME: needed to fix build on Mac on buildserver
 constexpr double FillGyroid::PatternTolerance;
+constexpr size_t FillGyroid::WaveCacheSize;
+
+Polylines FillGyroid::fill_surface(const Surface *surface, const FillParams &params)
+{
+    // Perform offset.
+    Slic3r::ExPolygons expp = offset_ex(surface->expolygon, float(scale_(this->overlap - 0.5 * this->spacing)));
+    if (expp.size() < 2)
+        return Fill::fill_surface(surface, params);
+    // Create the infills for each of the regions in parallel, then concatenate them in the order of the regions.
+    std::pair<float, Point> direction = _infill_direction(surface);
+    std::vector<Polylines>  polylines_per_island(expp.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, expp.size()),
+        [this, surface, &params, &direction, &expp, &polylines_per_island](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i < range.end(); ++ i)
+                this->_fill_surface_single(params, surface->thickness_layers, direction, expp[i], polylines_per_island[i]);
+        });
+    Polylines polylines_out;
+    for (Polylines &polylines : polylines_per_island)
+        append(polylines_out, std::move(polylines));
+    return polylines_out;
+}
 
 void FillGyroid::_fill_surface_single(
     const FillParams                &params, 
@@ -26,6 +26,16 @@ public:
     // Gyroid upper resolution tolerance (mm^-2)
     static constexpr double PatternTolerance = 0.2;
 
+    // Maximum number of the cached wave rows, shared by all the FillGyroid instances.
+    // There are two rows for each z and infill spacing, the layers filled in parallel use a few of them at a time.
+    static constexpr size_t WaveCacheSize = 1024;
+
+    // Evaluate the gyroid wave y[i] = f(x[i]) for i < n at the z phase given by z_sin, z_cos.
+    // Vectorized with SSE2 / AVX where available, the samples are within 1e-12 of the libm evaluation.
+    static void wave(double z_sin, double z_cos, bool vertical, bool flip, const double *x, double *y, size_t n);
+
+    // The islands of the surface are filled in parallel.
+    virtual Polylines fill_surface(const Surface *surface, const FillParams &params);
 
 protected:
     virtual void _fill_surface_single(
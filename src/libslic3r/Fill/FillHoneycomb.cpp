@@ -2,25 +2,27 @@
 #include "../ShortestPath.hpp"
 #include "../Surface.hpp"
 
+#include <tbb/mutex.h>
+
 #include "FillHoneycomb.hpp"
 
 namespace Slic3r {
 
-void FillHoneycomb::_fill_surface_single(
-    const FillParams                &params, 
-    unsigned int                     thickness_layers,
-    const std::pair<float, Point>   &direction, 
-    ExPolygon                       &expolygon, 
-    Polylines                       &polylines_out)
+// cache hexagons math
+const FillHoneycomb::CacheData& FillHoneycomb::cache_data(float density, coordf_t spacing)
 {
-    // cache hexagons math
-    CacheID cache_id(params.density, this->spacing);
-    Cache::iterator it_m = this->cache.find(cache_id);
-    if (it_m == this->cache.end()) {
-        it_m = this->cache.insert(it_m, std::pair<CacheID, CacheData>(cache_id, CacheData()));
+    // The Fill instances are created per layer and filled in parallel, thus the cache is static and guarded.
+    // std::map does not invalidate references to its elements on insertion, so the returned reference stays valid.
+    static tbb::mutex cache_mutex;
+    static Cache      cache;
+    tbb::mutex::scoped_lock lock(cache_mutex);
+    CacheID cache_id(density, spacing);
+    Cache::iterator it_m = cache.find(cache_id);
+    if (it_m == cache.end()) {
+        it_m = cache.insert(it_m, std::pair<CacheID, CacheData>(cache_id, CacheData()));
         CacheData &m = it_m->second;
-        coord_t min_spacing = scale_(this->spacing);
-        m.distance = min_spacing / params.density;
+        coord_t min_spacing = scale_(spacing);
+        m.distance = min_spacing / density;
         m.hex_side = m.distance / (sqrt(3)/2);
         m.hex_width = m.distance * 2; // $m->{hex_width} == $m->{hex_side} * sqrt(3);
         coord_t hex_height = m.hex_side * 2;
@@ -30,7 +32,17 @@ void FillHoneycomb::_fill_surface_single(
         m.y_offset = m.x_offset * sqrt(3)/3;
         m.hex_center = Point(m.hex_width/2, m.hex_side);
     }
-    CacheData &m = it_m->second;
+    return it_m->second;
+}
+
+void FillHoneycomb::_fill_surface_single(
+    const FillParams                &params, 
+    unsigned int                     thickness_layers,
+    const std::pair<float, Point>   &direction, 
+    ExPolygon                       &expolygon, 
+    Polylines                       &polylines_out)
+{
+    const CacheData &m = cache_data(params.density, this->spacing);
 
     Polygons polygons;
     {
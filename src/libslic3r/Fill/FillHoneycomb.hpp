@@ -23,7 +23,7 @@ protected:
 	    ExPolygon                       &expolygon, 
 	    Polylines                       &polylines_out);
 
-	// Caching the 
+	// Caching the hexagon dimensions, shared by all the FillHoneycomb instances.
 	struct CacheID 
 	{
 		CacheID(float adensity, coordf_t aspacing) : 
@@ -47,7 +47,7 @@ protected:
         Point	hex_center;
     };
     typedef std::map<CacheID, CacheData> Cache;
-	Cache cache;
+    static const CacheData& cache_data(float density, coordf_t spacing);
 
     virtual float _layer_angle(size_t idx) const { return float(M_PI/3.) * (idx % 3); }
 };
@@ -10,8 +10,10 @@
 #include "Utils.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <math.h>
+#include <thread>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/find.hpp>
@@ -29,6 +31,7 @@
 #include "SVG.hpp"
 
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
 
 #include <Shiny/Shiny.h>
 
@@ -258,8 +261,9 @@ std::string Wipe::wipe(GCode &gcodegen, bool toolchange)
                 double dE = length * (segment_length / wipe_dist) * 0.95;
                 //FIXME one shall not generate the unnecessary G1 Fxxx commands, here wipe_speed is a constant inside this cycle.
                 // Is it here for the cooling markers? Or should it be outside of the cycle?
-                gcode += gcodegen.writer().set_speed(wipe_speed*60, "", gcodegen.enable_cooling_markers() ? ";_WIPE" : "");
-                gcode += gcodegen.writer().extrude_to_xy(
+                gcodegen.writer().set_speed(gcode, wipe_speed*60, "", gcodegen.enable_cooling_markers() ? ";_WIPE" : "");
+                gcodegen.writer().extrude_to_xy(
+                    gcode,
                     gcodegen.point_to_gcode(line.b),
                     -dE,
                     "wipe and retract"
@@ -722,13 +726,20 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
 
     m_enable_analyzer = preview_data != nullptr;
 
+    bool remaining_times_enabled = print->config().remaining_times.value;
+
     try {
         m_placeholder_parser_failed_templates.clear();
+        // The output stream inserts the M73 lines of the silent mode time estimator, thus it has to be known upfront if it is enabled.
+        m_silent_time_estimator_enabled = (print->config().gcode_flavor == gcfMarlin) && print->config().silent_mode;
+        GCodeOutputStream gcode(file, remaining_times_enabled ? &m_normal_time_estimator : nullptr, (remaining_times_enabled && m_silent_time_estimator_enabled) ? &m_silent_time_estimator : nullptr);
 #if ENABLE_THUMBNAIL_GENERATOR
-        this->_do_export(*print, file, thumbnail_cb);
+        this->_do_export(*print, gcode, thumbnail_cb);
 #else
-        this->_do_export(*print, file);
+        this->_do_export(*print, gcode);
 #endif // ENABLE_THUMBNAIL_GENERATOR
+        gcode.finalize();
+
         fflush(file);
         if (ferror(file)) {
             fclose(file);
@@ -757,14 +768,6 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
         throw std::runtime_error(msg);
     }
 
-    GCodeTimeEstimator::PostProcessData normal_data = m_normal_time_estimator.get_post_process_data();
-    GCodeTimeEstimator::PostProcessData silent_data = m_silent_time_estimator.get_post_process_data();
-
-    bool remaining_times_enabled = print->config().remaining_times.value;
-
-    BOOST_LOG_TRIVIAL(debug) << "Time estimator post processing" << log_memory_info();
-    GCodeTimeEstimator::post_process(path_tmp, 60.0f, remaining_times_enabled ? &normal_data : nullptr, (remaining_times_enabled && m_silent_time_estimator_enabled) ? &silent_data : nullptr);
-
     if (remaining_times_enabled)
     {
         m_normal_time_estimator.reset();
@@ -793,9 +796,9 @@ void GCode::do_export(Print *print, const char *path, GCodePreviewData *preview_
 }
 
 #if ENABLE_THUMBNAIL_GENERATOR
-void GCode::_do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thumbnail_cb)
+void GCode::_do_export(Print& print, GCodeOutputStream &file, ThumbnailsGeneratorCallback thumbnail_cb)
 #else
-void GCode::_do_export(Print& print, FILE* file)
+void GCode::_do_export(Print& print, GCodeOutputStream &file)
 #endif // ENABLE_THUMBNAIL_GENERATOR
 {
     PROFILE_FUNC();
@@ -804,7 +807,6 @@ void GCode::_do_export(Print& print, FILE* file)
     m_normal_time_estimator.reset();
     m_normal_time_estimator.set_dialect(print.config().gcode_flavor);
     m_normal_time_estimator.set_extrusion_axis(print.config().get_extrusion_axis()[0]);
-    m_silent_time_estimator_enabled = (print.config().gcode_flavor == gcfMarlin) && print.config().silent_mode;
 
     // Until we have a UI support for the other firmwares than the Marlin, use the hardcoded default values
     // and let the user to enter the G-code limits into the start G-code.
@@ -1312,13 +1314,10 @@ void GCode::_do_export(Print& print, FILE* file)
                 m_cooling_buffer->reset();
                 m_cooling_buffer->set_current_extruder(initial_extruder_id);
                 // Pair the object layers with the support layers by z, extrude them.
-                std::vector<LayerToPrint> layers_to_print = collect_layers_to_print(object);
-                for (const LayerToPrint &ltp : layers_to_print) {
-                    std::vector<LayerToPrint> lrs;
-                    lrs.emplace_back(std::move(ltp));
-                    this->process_layer(file, print, lrs, tool_ordering.tools_for_layer(ltp.print_z()), nullptr, &copy - object.copies().data());
-                    print.throw_if_canceled();
-                }
+                std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> layers_to_print;
+                for (const LayerToPrint &ltp : collect_layers_to_print(object))
+                    layers_to_print.emplace_back(ltp.print_z(), std::vector<LayerToPrint>(1, ltp));
+                this->process_layers(file, print, tool_ordering, layers_to_print, nullptr, &copy - object.copies().data());
 #ifdef HAS_PRESSURE_EQUALIZER
                 if (m_pressure_equalizer)
                     _write(file, m_pressure_equalizer->process("", true));
@@ -1366,13 +1365,7 @@ void GCode::_do_export(Print& print, FILE* file)
             print.throw_if_canceled();
         }
         // Extrude the layers.
-        for (auto &layer : layers_to_print) {
-            const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer.first);
-            if (m_wipe_tower && layer_tools.has_wipe_tower)
-                m_wipe_tower->next_layer();
-            this->process_layer(file, print, layer.second, layer_tools, &print_object_instances_ordering, size_t(-1));
-            print.throw_if_canceled();
-        }
+        this->process_layers(file, print, tool_ordering, layers_to_print, &print_object_instances_ordering, size_t(-1));
 #ifdef HAS_PRESSURE_EQUALIZER
         if (m_pressure_equalizer)
             _write(file, m_pressure_equalizer->process("", true));
@@ -1427,9 +1420,9 @@ void GCode::_do_export(Print& print, FILE* file)
     print.throw_if_canceled();
 
     // calculates estimated printing time
-    m_normal_time_estimator.calculate_time(false);
+    m_normal_time_estimator.calculate_time();
     if (m_silent_time_estimator_enabled)
-        m_silent_time_estimator.calculate_time(false);
+        m_silent_time_estimator.calculate_time();
 
     // Get filament stats.
     print.m_print_statistics.clear();
@@ -1576,29 +1569,29 @@ static bool custom_gcode_sets_temperature(const std::string &gcode, const int mc
 
 // Print the machine envelope G-code for the Marlin firmware based on the "machine_max_xxx" parameters.
 // Do not process this piece of G-code by the time estimator, it already knows the values through another sources.
-void GCode::print_machine_envelope(FILE *file, Print &print)
+void GCode::print_machine_envelope(GCodeOutputStream &file, Print &print)
 {
     if (print.config().gcode_flavor.value == gcfMarlin) {
-        fprintf(file, "M201 X%d Y%d Z%d E%d ; sets maximum accelerations, mm/sec^2\n",
+        file.write_format("M201 X%d Y%d Z%d E%d ; sets maximum accelerations, mm/sec^2\n",
             int(print.config().machine_max_acceleration_x.values.front() + 0.5),
             int(print.config().machine_max_acceleration_y.values.front() + 0.5),
             int(print.config().machine_max_acceleration_z.values.front() + 0.5),
             int(print.config().machine_max_acceleration_e.values.front() + 0.5));
-        fprintf(file, "M203 X%d Y%d Z%d E%d ; sets maximum feedrates, mm/sec\n",
+        file.write_format("M203 X%d Y%d Z%d E%d ; sets maximum feedrates, mm/sec\n",
             int(print.config().machine_max_feedrate_x.values.front() + 0.5),
             int(print.config().machine_max_feedrate_y.values.front() + 0.5),
             int(print.config().machine_max_feedrate_z.values.front() + 0.5),
             int(print.config().machine_max_feedrate_e.values.front() + 0.5));
-        fprintf(file, "M204 P%d R%d T%d ; sets acceleration (P, T) and retract acceleration (R), mm/sec^2\n",
+        file.write_format("M204 P%d R%d T%d ; sets acceleration (P, T) and retract acceleration (R), mm/sec^2\n",
             int(print.config().machine_max_acceleration_extruding.values.front() + 0.5),
             int(print.config().machine_max_acceleration_retracting.values.front() + 0.5),
             int(print.config().machine_max_acceleration_extruding.values.front() + 0.5));
-        fprintf(file, "M205 X%.2lf Y%.2lf Z%.2lf E%.2lf ; sets the jerk limits, mm/sec\n",
+        file.write_format("M205 X%.2lf Y%.2lf Z%.2lf E%.2lf ; sets the jerk limits, mm/sec\n",
             print.config().machine_max_jerk_x.values.front(),
             print.config().machine_max_jerk_y.values.front(),
             print.config().machine_max_jerk_z.values.front(),
             print.config().machine_max_jerk_e.values.front());
-        fprintf(file, "M205 S%d T%d ; sets the minimum extruding and travel feed rate, mm/sec\n",
+        file.write_format("M205 S%d T%d ; sets the minimum extruding and travel feed rate, mm/sec\n",
             int(print.config().machine_min_extruding_rate.values.front() + 0.5),
             int(print.config().machine_min_travel_rate.values.front() + 0.5));
     }
@@ -1608,7 +1601,7 @@ void GCode::print_machine_envelope(FILE *file, Print &print)
 // Only do that if the start G-code does not already contain any M-code controlling an extruder temperature.
 // M140 - Set Extruder Temperature
 // M190 - Set Extruder Temperature and Wait
-void GCode::_print_first_layer_bed_temperature(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
+void GCode::_print_first_layer_bed_temperature(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
 {
     // Initial bed temperature based on the first extruder.
     int  temp = print.config().first_layer_bed_temperature.get_at(first_printing_extruder_id);
@@ -1628,7 +1621,7 @@ void GCode::_print_first_layer_bed_temperature(FILE *file, Print &print, const s
 // Only do that if the start G-code does not already contain any M-code controlling an extruder temperature.
 // M104 - Set Extruder Temperature
 // M109 - Set Extruder Temperature and Wait
-void GCode::_print_first_layer_extruder_temperatures(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
+void GCode::_print_first_layer_extruder_temperatures(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait)
 {
     // Is the bed temperature set by the provided custom G-code?
     int  temp_by_gcode     = -1;
@@ -1729,14 +1722,170 @@ std::vector<GCode::InstanceToPrint> GCode::sort_print_object_instances(
 	return out;
 }
 
+// Group the extrusions of a set of object & support layers with the same print_z by an extruder, then by an object, an island and a region.
+// Only the print, the sliced layers and the tool ordering are read, therefore process_layers() collects the extrusions of several layers
+// ahead in parallel. The extruder overrides are cached by the WipingExtrusions of the layer_tools, their update is guarded by wiping_extrusions_mutex.
+std::map<unsigned int, std::vector<GCode::ObjectByExtruder>> GCode::collect_layer_extrusions(
+    const Print                     &print,
+    const std::vector<LayerToPrint> &layers,
+    const LayerTools                &layer_tools,
+    std::mutex                      &wiping_extrusions_mutex)
+{
+    assert(! layer_tools.extruders.empty());
+    unsigned int first_extruder_id = layer_tools.extruders.front();
+    std::map<unsigned int, std::vector<ObjectByExtruder>> by_extruder;
+    for (const LayerToPrint &layer_to_print : layers) {
+        if (layer_to_print.support_layer != nullptr) {
+            const SupportLayer &support_layer = *layer_to_print.support_layer;
+            const PrintObject  &object = *support_layer.object();
+            if (! support_layer.support_fills.entities.empty()) {
+                ExtrusionRole   role               = support_layer.support_fills.role();
+                bool            has_support        = role == erMixed || role == erSupportMaterial;
+                bool            has_interface      = role == erMixed || role == erSupportMaterialInterface;
+                // Extruder ID of the support base. -1 if "don't care".
+                unsigned int    support_extruder   = object.config().support_material_extruder.value - 1;
+                // Shall the support be printed with the active extruder, preferably with non-soluble, to avoid tool changes?
+                bool            support_dontcare   = object.config().support_material_extruder.value == 0;
+                // Extruder ID of the support interface. -1 if "don't care".
+                unsigned int    interface_extruder = object.config().support_material_interface_extruder.value - 1;
+                // Shall the support interface be printed with the active extruder, preferably with non-soluble, to avoid tool changes?
+                bool            interface_dontcare = object.config().support_material_interface_extruder.value == 0;
+                if (support_dontcare || interface_dontcare) {
+                    // Some support will be printed with "don't care" material, preferably non-soluble.
+                    // Is the current extruder assigned a soluble filament?
+                    unsigned int dontcare_extruder = first_extruder_id;
+                    if (print.config().filament_soluble.get_at(dontcare_extruder)) {
+                        // The last extruder printed on the previous layer extrudes soluble filament.
+                        // Try to find a non-soluble extruder on the same layer.
+                        for (unsigned int extruder_id : layer_tools.extruders)
+                            if (! print.config().filament_soluble.get_at(extruder_id)) {
+                                dontcare_extruder = extruder_id;
+                                break;
+                            }
+                    }
+                    if (support_dontcare)
+                        support_extruder = dontcare_extruder;
+                    if (interface_dontcare)
+                        interface_extruder = dontcare_extruder;
+                }
+                // Both the support and the support interface are printed with the same extruder, therefore
+                // the interface may be interleaved with the support base.
+                bool single_extruder = ! has_support || support_extruder == interface_extruder;
+                // Assign an extruder to the base.
+                ObjectByExtruder &obj = object_by_extruder(by_extruder, has_support ? support_extruder : interface_extruder, &layer_to_print - layers.data(), layers.size());
+                obj.support = &support_layer.support_fills;
+                obj.support_extrusion_role = single_extruder ? erMixed : erSupportMaterial;
+                if (! single_extruder && has_interface) {
+                    ObjectByExtruder &obj_interface = object_by_extruder(by_extruder, interface_extruder, &layer_to_print - layers.data(), layers.size());
+                    obj_interface.support = &support_layer.support_fills;
+                    obj_interface.support_extrusion_role = erSupportMaterialInterface;
+                }
+            }
+        }
+        if (layer_to_print.object_layer != nullptr) {
+            const Layer &layer = *layer_to_print.object_layer;
+            // We now define a strategy for building perimeters and fills. The separation 
+            // between regions doesn't matter in terms of printing order, as we follow 
+            // another logic instead:
+            // - we group all extrusions by extruder so that we minimize toolchanges
+            // - we start from the last used extruder
+            // - for each extruder, we group extrusions by island
+            // - for each island, we extrude perimeters first, unless user set the infill_first
+            //   option
+            // (Still, we have to keep track of regions because we need to apply their config)
+            size_t n_slices = layer.slices.size();
+            const std::vector<BoundingBox> &layer_surface_bboxes = layer.slices_bboxes;
+            // Traverse the slices in an increasing order of bounding box size, so that the islands inside another islands are tested first,
+            // so we can just test a point inside ExPolygon::contour and we may skip testing the holes.
+            std::vector<size_t> slices_test_order;
+            slices_test_order.reserve(n_slices);
+            for (size_t i = 0; i < n_slices; ++ i)
+            	slices_test_order.emplace_back(i);
+            std::sort(slices_test_order.begin(), slices_test_order.end(), [&layer_surface_bboxes](int i, int j) {
+            	const Vec2d s1 = layer_surface_bboxes[i].size().cast<double>();
+            	const Vec2d s2 = layer_surface_bboxes[j].size().cast<double>();
+            	return s1.x() * s1.y() < s2.x() * s2.y();
+            });
+            auto point_inside_surface = [&layer, &layer_surface_bboxes](const size_t i, const Point &point) { 
+                const BoundingBox &bbox = layer_surface_bboxes[i];
+                return point(0) >= bbox.min(0) && point(0) < bbox.max(0) &&
+                       point(1) >= bbox.min(1) && point(1) < bbox.max(1) &&
+                       layer.slices[i].contour.contains(point);
+            };
+
+            for (size_t region_id = 0; region_id < print.regions().size(); ++ region_id) {
+                const LayerRegion *layerm = (region_id < layer.regions().size()) ? layer.regions()[region_id] : nullptr;
+                if (layerm == nullptr)
+                    continue;
+                const PrintRegion &region = *print.regions()[region_id];
+
+
+                // Now we must process perimeters and infills and create islands of extrusions in by_region std::map.
+                // It is also necessary to save which extrusions are part of MM wiping and which are not.
+                // The process is almost the same for perimeters and infills - we will do it in a cycle that repeats twice:
+                for (std::string entity_type("infills") ; entity_type != "done" ; entity_type = entity_type=="infills" ? "perimeters" : "done") {
+
+                    const ExtrusionEntitiesPtr& source_entities = entity_type=="infills" ? layerm->fills.entities : layerm->perimeters.entities;
+
+                    for (const ExtrusionEntity *ee : source_entities) {
+                        // fill represents infill extrusions of a single island.
+                        const auto *fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
+                        if (fill->entities.empty()) // This shouldn't happen but first_point() would fail.
+                            continue;
+
+                        // This extrusion is part of certain Region, which tells us which extruder should be used for it:
+                        int correct_extruder_id = Print::get_extruder(*fill, region);
+
+                        // Let's recover vector of extruder overrides:
+                        const ExtruderPerCopy* entity_overrides;
+                        {
+                            std::lock_guard<std::mutex> lock(wiping_extrusions_mutex);
+                            entity_overrides = const_cast<LayerTools&>(layer_tools).wiping_extrusions().get_extruder_overrides(fill, correct_extruder_id, layer_to_print.object()->copies().size());
+                        }
+
+                        // Now we must add this extrusion into the by_extruder map, once for each extruder that will print it:
+                        for (unsigned int extruder : layer_tools.extruders)
+                        {
+                            // Init by_extruder item only if we actually use the extruder:
+                            if (std::find(entity_overrides->begin(), entity_overrides->end(), extruder) != entity_overrides->end() ||      // at least one copy is overridden to use this extruder
+                                std::find(entity_overrides->begin(), entity_overrides->end(), -extruder-1) != entity_overrides->end() ||   // at least one copy would normally be printed with this extruder (see get_extruder_overrides function for explanation)
+                                (std::find(layer_tools.extruders.begin(), layer_tools.extruders.end(), correct_extruder_id) == layer_tools.extruders.end() && extruder == layer_tools.extruders.back())) // this entity is not overridden, but its extruder is not in layer_tools - we'll print it
+                                                                                                                                            //by last extruder on this layer (could happen e.g. when a wiping object is taller than others - dontcare extruders are eradicated from layer_tools)
+                            {
+                                std::vector<ObjectByExtruder::Island> &islands = object_islands_by_extruder(
+                                    by_extruder,
+                                    extruder,
+                                    &layer_to_print - layers.data(),
+                                    layers.size(), n_slices+1);
+                                for (size_t i = 0; i <= n_slices; ++ i) {
+									bool   last = i == n_slices;
+                                	size_t island_idx = last ? n_slices : slices_test_order[i];
+                                    if (// fill->first_point does not fit inside any slice
+										last ||
+                                        // fill->first_point fits inside ith slice
+                                        point_inside_surface(island_idx, fill->first_point())) {
+                                        if (islands[island_idx].by_region.empty())
+                                            islands[island_idx].by_region.assign(print.regions().size(), ObjectByExtruder::Island::Region());
+                                        islands[island_idx].by_region[region_id].append(entity_type, fill, entity_overrides, layer_to_print.object()->copies().size());
+                                        break;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            } // for regions
+        }
+    } // for objects
+    return by_extruder;
+}
+
 // In sequential mode, process_layer is called once per each object and its copy, 
 // therefore layers will contain a single entry and single_object_instance_idx will point to the copy of the object.
 // In non-sequential mode, process_layer is called per each print_z height with all object and support layers accumulated.
 // For multi-material prints, this routine minimizes extruder switches by gathering extruder specific extrusion paths
 // and performing the extruder specific extrusions together.
-void GCode::process_layer(
-    // Write into the output file.
-    FILE                            *file,
+GCode::LayerResult GCode::process_layer(
     const Print                     &print,
     // Set of object & print layers of the same PrintObject and with the same print_z.
     const std::vector<LayerToPrint> &layers,
@@ -1745,16 +1894,22 @@ void GCode::process_layer(
 	const std::vector<std::pair<size_t, size_t>> *ordering,
     // If set to size_t(-1), then print all copies of all objects.
     // Otherwise print a single copy of a single object.
-    const size_t                     single_object_instance_idx)
+    const size_t                     single_object_instance_idx,
+    // Extrusions of the layers grouped by collect_layer_extrusions().
+    std::map<unsigned int, std::vector<ObjectByExtruder>> &by_extruder,
+    // Distance fields of the layers below the object layers, one per LayerToPrint.
+    std::vector<std::unique_ptr<EdgeGrid::Grid>> &lower_layer_edge_grids)
 {
     assert(! layers.empty());
+    assert(lower_layer_edge_grids.size() == layers.size());
 //    assert(! layer_tools.extruders.empty());
     // Either printing all copies of all objects, or just a single copy of a single object.
     assert(single_object_instance_idx == size_t(-1) || layers.size() == 1);
 
+    LayerResult result;
     if (layer_tools.extruders.empty())
         // Nothing to extrude.
-        return;
+        return result;
 
     // Extract 1st object_layer and support_layer of this set of layers with an equal print_z.
     const Layer         *object_layer  = nullptr;
@@ -1945,147 +2100,6 @@ void GCode::process_layer(
             skirt_loops_per_extruder[first_extruder_id] = std::pair<size_t, size_t>(0, print.config().skirts.value);
     }
 
-    // Group extrusions by an extruder, then by an object, an island and a region.
-    std::map<unsigned int, std::vector<ObjectByExtruder>> by_extruder;
-    for (const LayerToPrint &layer_to_print : layers) {
-        if (layer_to_print.support_layer != nullptr) {
-            const SupportLayer &support_layer = *layer_to_print.support_layer;
-            const PrintObject  &object = *support_layer.object();
-            if (! support_layer.support_fills.entities.empty()) {
-                ExtrusionRole   role               = support_layer.support_fills.role();
-                bool            has_support        = role == erMixed || role == erSupportMaterial;
-                bool            has_interface      = role == erMixed || role == erSupportMaterialInterface;
-                // Extruder ID of the support base. -1 if "don't care".
-                unsigned int    support_extruder   = object.config().support_material_extruder.value - 1;
-                // Shall the support be printed with the active extruder, preferably with non-soluble, to avoid tool changes?
-                bool            support_dontcare   = object.config().support_material_extruder.value == 0;
-                // Extruder ID of the support interface. -1 if "don't care".
-                unsigned int    interface_extruder = object.config().support_material_interface_extruder.value - 1;
-                // Shall the support interface be printed with the active extruder, preferably with non-soluble, to avoid tool changes?
-                bool            interface_dontcare = object.config().support_material_interface_extruder.value == 0;
-                if (support_dontcare || interface_dontcare) {
-                    // Some support will be printed with "don't care" material, preferably non-soluble.
-                    // Is the current extruder assigned a soluble filament?
-                    unsigned int dontcare_extruder = first_extruder_id;
-                    if (print.config().filament_soluble.get_at(dontcare_extruder)) {
-                        // The last extruder printed on the previous layer extrudes soluble filament.
-                        // Try to find a non-soluble extruder on the same layer.
-                        for (unsigned int extruder_id : layer_tools.extruders)
-                            if (! print.config().filament_soluble.get_at(extruder_id)) {
-                                dontcare_extruder = extruder_id;
-                                break;
-                            }
-                    }
-                    if (support_dontcare)
-                        support_extruder = dontcare_extruder;
-                    if (interface_dontcare)
-                        interface_extruder = dontcare_extruder;
-                }
-                // Both the support and the support interface are printed with the same extruder, therefore
-                // the interface may be interleaved with the support base.
-                bool single_extruder = ! has_support || support_extruder == interface_extruder;
-                // Assign an extruder to the base.
-                ObjectByExtruder &obj = object_by_extruder(by_extruder, has_support ? support_extruder : interface_extruder, &layer_to_print - layers.data(), layers.size());
-                obj.support = &support_layer.support_fills;
-                obj.support_extrusion_role = single_extruder ? erMixed : erSupportMaterial;
-                if (! single_extruder && has_interface) {
-                    ObjectByExtruder &obj_interface = object_by_extruder(by_extruder, interface_extruder, &layer_to_print - layers.data(), layers.size());
-                    obj_interface.support = &support_layer.support_fills;
-                    obj_interface.support_extrusion_role = erSupportMaterialInterface;
-                }
-            }
-        }
-        if (layer_to_print.object_layer != nullptr) {
-            const Layer &layer = *layer_to_print.object_layer;
-            // We now define a strategy for building perimeters and fills. The separation 
-            // between regions doesn't matter in terms of printing order, as we follow 
-            // another logic instead:
-            // - we group all extrusions by extruder so that we minimize toolchanges
-            // - we start from the last used extruder
-            // - for each extruder, we group extrusions by island
-            // - for each island, we extrude perimeters first, unless user set the infill_first
-            //   option
-            // (Still, we have to keep track of regions because we need to apply their config)
-            size_t n_slices = layer.slices.size();
-            const std::vector<BoundingBox> &layer_surface_bboxes = layer.slices_bboxes;
-            // Traverse the slices in an increasing order of bounding box size, so that the islands inside another islands are tested first,
-            // so we can just test a point inside ExPolygon::contour and we may skip testing the holes.
-            std::vector<size_t> slices_test_order;
-            slices_test_order.reserve(n_slices);
-            for (size_t i = 0; i < n_slices; ++ i)
-            	slices_test_order.emplace_back(i);
-            std::sort(slices_test_order.begin(), slices_test_order.end(), [&layer_surface_bboxes](int i, int j) {
-            	const Vec2d s1 = layer_surface_bboxes[i].size().cast<double>();
-            	const Vec2d s2 = layer_surface_bboxes[j].size().cast<double>();
-            	return s1.x() * s1.y() < s2.x() * s2.y();
-            });
-            auto point_inside_surface = [&layer, &layer_surface_bboxes](const size_t i, const Point &point) { 
-                const BoundingBox &bbox = layer_surface_bboxes[i];
-                return point(0) >= bbox.min(0) && point(0) < bbox.max(0) &&
-                       point(1) >= bbox.min(1) && point(1) < bbox.max(1) &&
-                       layer.slices[i].contour.contains(point);
-            };
-
-            for (size_t region_id = 0; region_id < print.regions().size(); ++ region_id) {
-                const LayerRegion *layerm = (region_id < layer.regions().size()) ? layer.regions()[region_id] : nullptr;
-                if (layerm == nullptr)
-                    continue;
-                const PrintRegion &region = *print.regions()[region_id];
-
-
-                // Now we must process perimeters and infills and create islands of extrusions in by_region std::map.
-                // It is also necessary to save which extrusions are part of MM wiping and which are not.
-                // The process is almost the same for perimeters and infills - we will do it in a cycle that repeats twice:
-                for (std::string entity_type("infills") ; entity_type != "done" ; entity_type = entity_type=="infills" ? "perimeters" : "done") {
-
-                    const ExtrusionEntitiesPtr& source_entities = entity_type=="infills" ? layerm->fills.entities : layerm->perimeters.entities;
-
-                    for (const ExtrusionEntity *ee : source_entities) {
-                        // fill represents infill extrusions of a single island.
-                        const auto *fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
-                        if (fill->entities.empty()) // This shouldn't happen but first_point() would fail.
-                            continue;
-
-                        // This extrusion is part of certain Region, which tells us which extruder should be used for it:
-                        int correct_extruder_id = Print::get_extruder(*fill, region);
-
-                        // Let's recover vector of extruder overrides:
-                        const ExtruderPerCopy* entity_overrides = const_cast<LayerTools&>(layer_tools).wiping_extrusions().get_extruder_overrides(fill, correct_extruder_id, layer_to_print.object()->copies().size());
-
-                        // Now we must add this extrusion into the by_extruder map, once for each extruder that will print it:
-                        for (unsigned int extruder : layer_tools.extruders)
-                        {
-                            // Init by_extruder item only if we actually use the extruder:
-                            if (std::find(entity_overrides->begin(), entity_overrides->end(), extruder) != entity_overrides->end() ||      // at least one copy is overridden to use this extruder
-                                std::find(entity_overrides->begin(), entity_overrides->end(), -extruder-1) != entity_overrides->end() ||   // at least one copy would normally be printed with this extruder (see get_extruder_overrides function for explanation)
-                                (std::find(layer_tools.extruders.begin(), layer_tools.extruders.end(), correct_extruder_id) == layer_tools.extruders.end() && extruder == layer_tools.extruders.back())) // this entity is not overridden, but its extruder is not in layer_tools - we'll print it
-                                                                                                                                            //by last extruder on this layer (could happen e.g. when a wiping object is taller than others - dontcare extruders are eradicated from layer_tools)
-                            {
-                                std::vector<ObjectByExtruder::Island> &islands = object_islands_by_extruder(
-                                    by_extruder,
-                                    extruder,
-                                    &layer_to_print - layers.data(),
-                                    layers.size(), n_slices+1);
-                                for (size_t i = 0; i <= n_slices; ++ i) {
-									bool   last = i == n_slices;
-                                	size_t island_idx = last ? n_slices : slices_test_order[i];
-                                    if (// fill->first_point does not fit inside any slice
-										last ||
-                                        // fill->first_point fits inside ith slice
-                                        point_inside_surface(island_idx, fill->first_point())) {
-                                        if (islands[island_idx].by_region.empty())
-                                            islands[island_idx].by_region.assign(print.regions().size(), ObjectByExtruder::Island::Region());
-                                        islands[island_idx].by_region[region_id].append(entity_type, fill, entity_overrides, layer_to_print.object()->copies().size());
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            } // for regions
-        }
-    } // for objects
 
     std::string contour_filling_full;
     if (this->config().fixed_for_all_layers == ffalUserEdit) {
@@ -2112,7 +2126,6 @@ void GCode::process_layer(
     contour_fillings.push_back(contour_filling_full);
 
     // Extrude the skirt, brim, support, perimeters, infill ordered by the extruders.
-    std::vector<std::unique_ptr<EdgeGrid::Grid>> lower_layer_edge_grids(layers.size());
     for (unsigned int extruder_id : layer_tools.extruders)
     {
         gcode += (layer_tools.has_wipe_tower && m_wipe_tower) ?
@@ -2140,7 +2153,7 @@ void GCode::process_layer(
                         path.height     = (float)layer.height;
                         path.mm3_per_mm = mm3_per_mm;
                     }
-                    gcode += this->extrude_loop(loop, "skirt", m_config.support_material_speed.value);
+                    this->extrude_loop(gcode, loop, "skirt", m_config.support_material_speed.value);
                 }
                 m_avoid_crossing_perimeters.use_external_mp = false;
                 // Allow a straight travel move to the first object point if this is the first layer (but don't in next layers).
@@ -2154,7 +2167,7 @@ void GCode::process_layer(
             this->set_origin(0., 0.);
             m_avoid_crossing_perimeters.use_external_mp = true;
             for (const ExtrusionEntity *ee : print.brim().entities) {
-                gcode += this->extrude_entity(*ee, "brim", m_config.support_material_speed.value);
+                this->extrude_entity(gcode, *ee, "brim", m_config.support_material_speed.value);
             }
             m_brim_done = true;
             m_avoid_crossing_perimeters.use_external_mp = false;
@@ -2192,7 +2205,7 @@ void GCode::process_layer(
                 this->set_origin(unscale(offset));
                 if (instance_to_print.object_by_extruder.support != nullptr && !print_wipe_extrusions) {
                     m_layer = layers[instance_to_print.layer_id].support_layer;
-                    gcode += this->extrude_support(
+                    this->extrude_support(gcode,
                         // support_extrusion_role is erSupportMaterial, erSupportMaterialInterface or erMixed for all extrusion paths.
                         instance_to_print.object_by_extruder.support->chained_path_from(m_last_pos, instance_to_print.object_by_extruder.support_extrusion_role));
                     m_layer = layers[instance_to_print.layer_id].layer();
@@ -2209,9 +2222,9 @@ void GCode::process_layer(
                     for (ObjectByExtruder::Island &island : instance_to_print.object_by_extruder.islands) {
                         const auto& by_region_specific = is_anything_overridden ? island.by_region_per_copy(instance_to_print.instance_id, extruder_id, print_wipe_extrusions) : island.by_region;
                         if (cf_pattern[i] == 'C'){
-                            gcode += this->extrude_perimeters(print, by_region_specific, lower_layer_edge_grids[instance_to_print.layer_id], instance_to_print.print_object.model_object()->instances[0]->object_color, m_layer->id(), instance_to_print.print_object.layers().size());
+                            this->extrude_perimeters(gcode, print, by_region_specific, lower_layer_edge_grids[instance_to_print.layer_id], instance_to_print.print_object.model_object()->instances[0]->object_color, m_layer->id(), instance_to_print.print_object.layers().size());
                         } else if (cf_pattern[i] == 'F') {
-                            gcode += this->extrude_infill(print, by_region_specific, instance_to_print.print_object.model_object()->instances[0]->object_color, instance_to_print.print_object.layers().size());
+                            this->extrude_infill(gcode, print, by_region_specific, instance_to_print.print_object.model_object()->instances[0]->object_color, instance_to_print.print_object.layers().size());
                         }
                     }
                 }
@@ -2230,31 +2243,138 @@ void GCode::process_layer(
     if (m_spiral_vase)
         gcode = m_spiral_vase->process_layer(gcode);
 
-    // Apply cooling logic; this may alter speeds.
-    if (m_cooling_buffer)
-        gcode = m_cooling_buffer->process_layer(gcode, layer.id());
+    result.gcode    = std::move(gcode);
+    result.layer_id = layer.id();
+    result.print_z  = print_z;
+    return result;
+}
 
-    // add tag for analyzer
-    if (gcode.find(GCodeAnalyzer::Pause_Print_Tag) != gcode.npos)
-        gcode += "\n; " + GCodeAnalyzer::End_Pause_Print_Or_Custom_Code_Tag + "\n";
-    else if (gcode.find(GCodeAnalyzer::Custom_Code_Tag) != gcode.npos)
-        gcode += "\n; " + GCodeAnalyzer::End_Pause_Print_Or_Custom_Code_Tag + "\n";
+// Calculate the distance field of the layer below, used for the seam placement by extrude_loop().
+static std::unique_ptr<EdgeGrid::Grid> calculate_lower_layer_edge_grid(const Layer &layer)
+{
+    const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
+    auto grid = make_unique<EdgeGrid::Grid>();
+    grid->create(layer.lower_layer->slices, distance_field_resolution);
+    grid->calculate_sdf();
+    return grid;
+}
 
+// The layers are processed by a pipeline of the following stages:
+// 1) The extrusions are grouped by extruder, object, island and region by collect_layer_extrusions() and the distance fields
+//    for the seam placement are calculated in parallel for several layers ahead, as they only depend on the sliced layers.
+// 2) The layer G-code is generated by process_layer() including the spiral vase post-processing,
+//    these depend on the state of the G-code generator (position, retraction, extruder), thus the layers are processed in order.
+// 3) The cooling buffer adjusts the layer G-code. It reads its own snapshot of the print wide configuration
+//    and it only modifies the fan state of the GCodeWriter, which is not touched by stage 2).
+// 4) The pressure equalizer (if enabled) post-processes the layer G-code, which is then written
+//    into the output file, fed to the analyzer and to the time estimators.
+// Stages 2) to 4) are sequential and each of them keeps its own state, however they work on different layers
+// at the same time. As each stage sees the layers in the same order as if the layers were processed one by one,
+// the output is identical to the serial processing.
+void GCode::process_layers(
+    GCodeOutputStream                                                  &file,
+    const Print                                                        &print,
+    const ToolOrdering                                                 &tool_ordering,
+    const std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>>  &layers_to_print,
+    const std::vector<std::pair<size_t, size_t>>                       *ordering,
+    const size_t                                                        single_object_instance_idx)
+{
+    // Extrusions grouped by extruder and distance fields of the layers below, indexed by layers_to_print.
+    // Both are released once their layer is generated.
+    std::vector<std::map<unsigned int, std::vector<ObjectByExtruder>>> layer_extrusions(layers_to_print.size());
+    std::vector<std::vector<std::unique_ptr<EdgeGrid::Grid>>>         lower_layer_edge_grids(layers_to_print.size());
+    std::mutex                                                         wiping_extrusions_mutex;
+    size_t layer_to_print_idx = 0;
+    const auto input = tbb::make_filter<void, size_t>(tbb::filter::serial_in_order,
+        [&layer_to_print_idx, &layers_to_print](tbb::flow_control &fc) -> size_t {
+            if (layer_to_print_idx == layers_to_print.size()) {
+                fc.stop();
+                return 0;
+            }
+            return layer_to_print_idx ++;
+        });
+    const auto prepare = tbb::make_filter<size_t, size_t>(tbb::filter::parallel,
+        [&print, &tool_ordering, &layers_to_print, &layer_extrusions, &lower_layer_edge_grids, &wiping_extrusions_mutex](size_t idx) -> size_t {
+            const std::vector<LayerToPrint>              &layers = layers_to_print[idx].second;
+            const LayerTools                             &layer_tools = tool_ordering.tools_for_layer(layers_to_print[idx].first);
+            if (! layer_tools.extruders.empty())
+                layer_extrusions[idx] = collect_layer_extrusions(print, layers, layer_tools, wiping_extrusions_mutex);
+            std::vector<std::unique_ptr<EdgeGrid::Grid>> &grids  = lower_layer_edge_grids[idx];
+            grids.resize(layers.size());
+            for (size_t i = 0; i < layers.size(); ++ i) {
+                const Layer *layer = layers[i].object_layer;
+                if (layer != nullptr && layer->lower_layer != nullptr &&
+                    std::any_of(layer->regions().begin(), layer->regions().end(), [](const LayerRegion *layerm) { return ! layerm->perimeters.entities.empty(); }))
+                    grids[i] = calculate_lower_layer_edge_grid(*layer);
+            }
+            return idx;
+        });
+    const auto generate = tbb::make_filter<size_t, LayerResult>(tbb::filter::serial_in_order,
+        [this, &print, &tool_ordering, &layers_to_print, &layer_extrusions, &lower_layer_edge_grids, ordering, single_object_instance_idx](size_t idx) -> LayerResult {
+            const std::pair<coordf_t, std::vector<LayerToPrint>> &layer = layers_to_print[idx];
+            const LayerTools &layer_tools = tool_ordering.tools_for_layer(layer.first);
+            if (m_wipe_tower && layer_tools.has_wipe_tower)
+                m_wipe_tower->next_layer();
+            LayerResult result = this->process_layer(print, layer.second, layer_tools, ordering, single_object_instance_idx, layer_extrusions[idx], lower_layer_edge_grids[idx]);
+            layer_extrusions[idx].clear();
+            lower_layer_edge_grids[idx].clear();
+            print.throw_if_canceled();
+            return result;
+        });
+    const auto cooling = tbb::make_filter<LayerResult, LayerResult>(tbb::filter::serial_in_order,
+        [this](LayerResult in) -> LayerResult {
+            if (in.empty())
+                return in;
+            // Apply cooling logic; this may alter speeds.
+            if (m_cooling_buffer)
+                in.gcode = m_cooling_buffer->process_layer(in.gcode, in.layer_id);
+            // add tag for analyzer
+            if (in.gcode.find(GCodeAnalyzer::Pause_Print_Tag) != in.gcode.npos)
+                in.gcode += "\n; " + GCodeAnalyzer::End_Pause_Print_Or_Custom_Code_Tag + "\n";
+            else if (in.gcode.find(GCodeAnalyzer::Custom_Code_Tag) != in.gcode.npos)
+                in.gcode += "\n; " + GCodeAnalyzer::End_Pause_Print_Or_Custom_Code_Tag + "\n";
+            return in;
+        });
+    // The extrusions already written are sent to the preview in batches, so that the user interface is not flooded by tiny layers.
+    const Print::gcode_preview_layers_callback_type &preview_layers_callback = print.gcode_preview_layers_callback();
+    auto publish_preview_layers = [this, &preview_layers_callback]() {
+        GCodePreviewData preview_data;
+        m_analyzer.calc_gcode_preview_layers(preview_data);
+        if (! preview_data.extrusion.layers.empty())
+            preview_layers_callback(std::move(preview_data));
+    };
+    std::chrono::steady_clock::time_point last_preview_layers_published = std::chrono::steady_clock::now();
+    const auto output = tbb::make_filter<LayerResult, void>(tbb::filter::serial_in_order,
+        [this, &file, &preview_layers_callback, &publish_preview_layers, &last_preview_layers_published](LayerResult in) {
+            if (in.empty())
+                return;
 #ifdef HAS_PRESSURE_EQUALIZER
-    // Apply pressure equalization if enabled;
-    // printf("G-code before filter:\n%s\n", gcode.c_str());
-    if (m_pressure_equalizer)
-        gcode = m_pressure_equalizer->process(gcode.c_str(), false);
-    // printf("G-code after filter:\n%s\n", out.c_str());
+            // Apply pressure equalization if enabled;
+            // printf("G-code before filter:\n%s\n", in.gcode.c_str());
+            if (m_pressure_equalizer)
+                in.gcode = m_pressure_equalizer->process(in.gcode.c_str(), false);
+            // printf("G-code after filter:\n%s\n", in.gcode.c_str());
 #endif /* HAS_PRESSURE_EQUALIZER */
-    
-    _write(file, gcode);
-    BOOST_LOG_TRIVIAL(trace) << "Exported layer " << layer.id() << " print_z " << print_z << 
-        ", time estimator memory: " <<
-            format_memsize_MB(m_normal_time_estimator.memory_used() + (m_silent_time_estimator_enabled ? m_silent_time_estimator.memory_used() : 0)) <<
-        ", analyzer memory: " <<
-            format_memsize_MB(m_analyzer.memory_used()) <<
-        log_memory_info();
+            _write(file, in.gcode);
+            if (m_enable_analyzer && preview_layers_callback) {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now - last_preview_layers_published > std::chrono::milliseconds(250)) {
+                    publish_preview_layers();
+                    last_preview_layers_published = now;
+                }
+            }
+            BOOST_LOG_TRIVIAL(trace) << "Exported layer " << in.layer_id << " print_z " << in.print_z << 
+                ", time estimator memory: " <<
+                    format_memsize_MB(m_normal_time_estimator.memory_used() + (m_silent_time_estimator_enabled ? m_silent_time_estimator.memory_used() : 0)) <<
+                ", analyzer memory: " <<
+                    format_memsize_MB(m_analyzer.memory_used()) <<
+                log_memory_info();
+        });
+    // Limit the number of layers in flight to bound the memory held by the pipeline.
+    const size_t max_tokens = std::max<size_t>(4, 2 * std::thread::hardware_concurrency());
+    tbb::parallel_pipeline(max_tokens, input & prepare & generate & cooling & output);
+    if (m_enable_analyzer && preview_layers_callback)
+        publish_preview_layers();
 }
 
 void GCode::apply_print_config(const PrintConfig &print_config)
@@ -2499,6 +2619,13 @@ std::vector<float> polygon_angles_at_vertices(const Polygon &polygon, const std:
 }
 
 std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid, std::string object_color, int layer_id, int layer_cnt)
+{
+    std::string gcode;
+    this->extrude_loop(gcode, std::move(loop), std::move(description), speed, lower_layer_edge_grid, std::move(object_color), layer_id, layer_cnt);
+    return gcode;
+}
+
+void GCode::extrude_loop(std::string &gcode, ExtrusionLoop loop, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid, std::string object_color, int layer_id, int layer_cnt)
 {
     // printf("%d/%d\n", layer_id, layer_cnt);
     bool want_cw = (this->config().orientation == oeClockwise) || (this->config().orientation == oeAlternating && layer_id % 2 == 0);
@@ -2507,11 +2634,8 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
 
     if (m_layer->lower_layer != nullptr && lower_layer_edge_grid != nullptr) {
         if (! *lower_layer_edge_grid) {
-            // Create the distance field for a layer below.
-            const coord_t distance_field_resolution = coord_t(scale_(1.) + 0.5);
-            *lower_layer_edge_grid = make_unique<EdgeGrid::Grid>();
-            (*lower_layer_edge_grid)->create(m_layer->lower_layer->slices, distance_field_resolution);
-            (*lower_layer_edge_grid)->calculate_sdf();
+            // Create the distance field for a layer below, if it was not prepared by process_layers() in advance.
+            *lower_layer_edge_grid = calculate_lower_layer_edge_grid(*m_layer);
             #if 0
             {
                 static int iRun = 0;
@@ -2707,14 +2831,13 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
     // get paths
     ExtrusionPaths paths;
     loop.clip_end(clip_length, &paths);
-    if (paths.empty()) return "";
+    if (paths.empty()) return;
     
     // apply the small perimeter speed
     if (is_perimeter(paths.front().role()) && loop.length() <= SMALL_PERIMETER_LENGTH && speed == -1)
         speed = m_config.small_perimeter_speed.get_abs_value(m_config.perimeter_speed);
     
     // extrude along the path
-    std::string gcode;
     for (ExtrusionPaths::iterator path = paths.begin(); path != paths.end(); ++path) {
 //    description += ExtrusionLoop::role_to_string(loop.loop_role());
 //    description += ExtrusionEntity::role_to_string(path->role);
@@ -2744,7 +2867,7 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
 
         if (want_cw)
             path->polyline.reverse();
-        gcode += this->_extrude(*path, description, speed);
+        this->_extrude(gcode, *path, description, speed);
     }
     
  //    // reset acceleration
@@ -2786,20 +2909,24 @@ std::string GCode::extrude_loop(ExtrusionLoop loop, std::string description, dou
  //        // generate the travel move
  //        gcode += m_writer.travel_to_xy(this->point_to_gcode(pt), "move inwards before travel");
  //    }
-    
-    return gcode;
 }
 
 std::string GCode::extrude_multi_path(ExtrusionMultiPath multipath, std::string description, double speed, std::string object_color)
 {
-    // extrude along the path
     std::string gcode;
+    this->extrude_multi_path(gcode, std::move(multipath), std::move(description), speed, std::move(object_color));
+    return gcode;
+}
+
+void GCode::extrude_multi_path(std::string &gcode, ExtrusionMultiPath multipath, std::string description, double speed, std::string object_color)
+{
+    // extrude along the path
     for (ExtrusionPath path : multipath.paths) {
 //    description += ExtrusionLoop::role_to_string(loop.loop_role());
 //    description += ExtrusionEntity::role_to_string(path->role);
         path.object_color = object_color;
         path.simplify(SCALED_RESOLUTION);
-        gcode += this->_extrude(path, description, speed);
+        this->_extrude(gcode, path, description, speed);
     }
     if (m_wipe.enable) {
         m_wipe.path = std::move(multipath.paths.back().polyline);  // TODO: don't limit wipe to last path
@@ -2807,70 +2934,76 @@ std::string GCode::extrude_multi_path(ExtrusionMultiPath multipath, std::string
     }
     // reset acceleration
     gcode += m_writer.set_acceleration((unsigned int)floor(m_config.default_acceleration.value + 0.5));
-    return gcode;
 }
 
 std::string GCode::extrude_entity(const ExtrusionEntity &entity, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid, std::string object_color, int layer_id, int layer_cnt)
+{
+    std::string gcode;
+    this->extrude_entity(gcode, entity, std::move(description), speed, lower_layer_edge_grid, std::move(object_color), layer_id, layer_cnt);
+    return gcode;
+}
+
+void GCode::extrude_entity(std::string &gcode, const ExtrusionEntity &entity, std::string description, double speed, std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid, std::string object_color, int layer_id, int layer_cnt)
 {
     if (const ExtrusionPath* path = dynamic_cast<const ExtrusionPath*>(&entity))
-        return this->extrude_path(*path, description, speed, object_color);
+        this->extrude_path(gcode, *path, description, speed, object_color);
     else if (const ExtrusionMultiPath* multipath = dynamic_cast<const ExtrusionMultiPath*>(&entity))
-        return this->extrude_multi_path(*multipath, description, speed, object_color);
+        this->extrude_multi_path(gcode, *multipath, description, speed, object_color);
     else if (const ExtrusionLoop* loop = dynamic_cast<const ExtrusionLoop*>(&entity))
-        return this->extrude_loop(*loop, description, speed, lower_layer_edge_grid, object_color, layer_id, layer_cnt);
+        this->extrude_loop(gcode, *loop, description, speed, lower_layer_edge_grid, object_color, layer_id, layer_cnt);
     else
         throw std::invalid_argument("Invalid argument supplied to extrude()");
-    return "";
 }
 
 std::string GCode::extrude_path(ExtrusionPath path, std::string description, double speed, std::string object_color)
+{
+    std::string gcode;
+    this->extrude_path(gcode, std::move(path), std::move(description), speed, std::move(object_color));
+    return gcode;
+}
+
+void GCode::extrude_path(std::string &gcode, ExtrusionPath path, std::string description, double speed, std::string object_color)
 {
 //    description += ExtrusionEntity::role_to_string(path.role());
     path.object_color = object_color;
     path.simplify(SCALED_RESOLUTION);
-    std::string gcode = this->_extrude(path, description, speed);
+    this->_extrude(gcode, path, description, speed);
     if (m_wipe.enable) {
         m_wipe.path = std::move(path.polyline);
         m_wipe.path.reverse();
     }
     // reset acceleration
     gcode += m_writer.set_acceleration((unsigned int)floor(m_config.default_acceleration.value + 0.5));
-    return gcode;
 }
 
 // Extrude perimeters: Decide where to put seams (hide or align seams).
-std::string GCode::extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid, std::string object_color, int layer_id, int layer_cnt)
+void GCode::extrude_perimeters(std::string &gcode, const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid, std::string object_color, int layer_id, int layer_cnt)
 {
-    std::string gcode;
     for (const ObjectByExtruder::Island::Region &region : by_region) {
         m_config.apply(print.regions()[&region - &by_region.front()]->config());
         for (ExtrusionEntity *ee : region.perimeters.entities)
-            gcode += this->extrude_entity(*ee, "perimeter", -1., &lower_layer_edge_grid, object_color, layer_id, layer_cnt);
+            this->extrude_entity(gcode, *ee, "perimeter", -1., &lower_layer_edge_grid, object_color, layer_id, layer_cnt);
     }
-    return gcode;
 }
 
 // Chain the paths hierarchically by a greedy algorithm to minimize a travel distance.
-std::string GCode::extrude_infill(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::string object_color, int layer_id, int layer_cnt)
+void GCode::extrude_infill(std::string &gcode, const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::string object_color, int layer_id, int layer_cnt)
 {
-    std::string gcode;
     for (const ObjectByExtruder::Island::Region &region : by_region) {
         m_config.apply(print.regions()[&region - &by_region.front()]->config());
         for (ExtrusionEntity *fill : region.infills.chained_path_from(m_last_pos).entities) {
             auto *eec = dynamic_cast<ExtrusionEntityCollection*>(fill);
             if (eec) {
 				for (ExtrusionEntity *ee : eec->chained_path_from(m_last_pos).entities)
-                    gcode += this->extrude_entity(*ee, "infill", -1., nullptr, object_color, layer_id, layer_cnt);
+                    this->extrude_entity(gcode, *ee, "infill", -1., nullptr, object_color, layer_id, layer_cnt);
             } else
-                gcode += this->extrude_entity(*fill, "infill", -1., nullptr, object_color, layer_id, layer_cnt);
+                this->extrude_entity(gcode, *fill, "infill", -1., nullptr, object_color, layer_id, layer_cnt);
         }
     }
-    return gcode;
 }
 
-std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fills)
+void GCode::extrude_support(std::string &gcode, const ExtrusionEntityCollection &support_fills)
 {
-    std::string gcode;
     if (! support_fills.entities.empty()) {
         const char   *support_label            = "support material";
         const char   *support_interface_label  = "support material interface";
@@ -2883,40 +3016,71 @@ std::string GCode::extrude_support(const ExtrusionEntityCollection &support_fill
             const double speed = (role == erSupportMaterial) ? support_speed : support_interface_speed;
             const ExtrusionPath *path = dynamic_cast<const ExtrusionPath*>(ee);
             if (path)
-                gcode += this->extrude_path(*path, label, speed);
+                this->extrude_path(gcode, *path, label, speed);
             else {
                 const ExtrusionMultiPath *multipath = dynamic_cast<const ExtrusionMultiPath*>(ee);
                 assert(multipath != nullptr);
                 if (multipath)
-                    gcode += this->extrude_multi_path(*multipath, label, speed);
+                    this->extrude_multi_path(gcode, *multipath, label, speed);
             }
         }
     }
-    return gcode;
 }
 
-void GCode::_write(FILE* file, const char *what)
+void GCodeOutputStream::write_format(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+
+    int buflen;
+    {
+        va_list args2;
+        va_copy(args2, args);
+        buflen =
+    #ifdef _MSC_VER
+            ::_vscprintf(format, args2)
+    #else
+            ::vsnprintf(nullptr, 0, format, args2)
+    #endif
+            + 1;
+        va_end(args2);
+    }
+
+    char buffer[1024];
+    bool buffer_dynamic = buflen > 1024;
+    char *bufptr = buffer_dynamic ? (char*)malloc(buflen) : buffer;
+    int res = ::vsnprintf(bufptr, buflen, format, args);
+    if (res > 0)
+        this->write(bufptr, size_t(res));
+
+    if (buffer_dynamic)
+        free(bufptr);
+
+    va_end(args);
+}
+
+void GCode::_write(GCodeOutputStream &file, const char *what)
 {
     if (what != nullptr) {
         // apply analyzer, if enabled
         const char* gcode = m_enable_analyzer ? m_analyzer.process_gcode(what).c_str() : what;
 
-        // writes string to file
-        fwrite(gcode, 1, ::strlen(gcode), file);
         // updates time estimator and gcode lines vector
         m_normal_time_estimator.add_gcode_block(gcode);
         if (m_silent_time_estimator_enabled)
             m_silent_time_estimator.add_gcode_block(gcode);
+        // writes string to the output stream, the M73 lines inserted depend on the time estimators updated above
+        file.write(gcode, ::strlen(gcode));
     }
 }
 
-void GCode::_writeln(FILE* file, const std::string &what)
+void GCode::_writeln(GCodeOutputStream &file, const std::string &what)
 {
     if (! what.empty())
         _write(file, (what.back() == '\n') ? what : (what + '\n'));
 }
 
-void GCode::_write_format(FILE* file, const char* format, ...)
+void GCode::_write_format(GCodeOutputStream &file, const char* format, ...)
 {
     va_list args;
     va_start(args, format);
@@ -2948,10 +3112,8 @@ void GCode::_write_format(FILE* file, const char* format, ...)
     va_end(args);
 }
 
-std::string GCode::_extrude(const ExtrusionPath &path, std::string description, double speed)
+void GCode::_extrude(std::string &gcode, const ExtrusionPath &path, std::string description, double speed)
 {
-    std::string gcode;
-    
     if (is_bridge(path.role()))
         description += " (bridge)";
     
@@ -3091,15 +3253,22 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
     }
 
     // F is mm per minute.
-    gcode += m_writer.set_speed(F, "", comment);
+    m_writer.set_speed(gcode, F, "", comment);
     double path_length = 0.;
     {
         std::string comment = m_config.gcode_comments ? description : "";
-        for (const Line &line : path.polyline.lines()) {
-            const double line_length = line.length() * SCALING_FACTOR;
+        // Each extrusion move takes a "C" color line and a G1 line, roughly 80 characters without the comment.
+        // The buffer is shared by the whole layer, grow it geometrically so that reserving per path does not copy it per path.
+        size_t size_needed = gcode.size() + path.polyline.points.size() * (80 + comment.size() + path.object_color.size());
+        if (size_needed > gcode.capacity())
+            gcode.reserve(std::max(size_needed, 2 * gcode.capacity()));
+        const Points &pts = path.polyline.points;
+        for (size_t i = 1; i < pts.size(); ++ i) {
+            const double line_length = (pts[i] - pts[i - 1]).cast<double>().norm() * SCALING_FACTOR;
             path_length += line_length;
-            gcode += m_writer.extrude_to_xy(
-                this->point_to_gcode(line.b),
+            m_writer.extrude_to_xy(
+                gcode,
+                this->point_to_gcode(pts[i]),
                 e_per_mm * line_length,
                 comment,
                 path.object_color);
@@ -3109,7 +3278,6 @@ std::string GCode::_extrude(const ExtrusionPath &path, std::string description,
         gcode += is_bridge(path.role()) ? ";_BRIDGE_FAN_END\n" : ";_EXTRUDE_END\n";
     
     this->set_last_pos(path.last_point());
-    return gcode;
 }
 
 // This method accepts &point in print coordinates.
@@ -3153,7 +3321,7 @@ std::string GCode::travel_to(const Point &point, ExtrusionRole role, std::string
     Lines lines = travel.lines();
     if (! lines.empty()) {
         for (const Line &line : lines)
-    	    gcode += m_writer.travel_to_xy(this->point_to_gcode(line.b), comment);    
+    	    m_writer.travel_to_xy(gcode, this->point_to_gcode(line.b), comment);
         this->set_last_pos(lines.back().b);
     }
     return gcode;
@@ -22,6 +22,7 @@
 #endif // ENABLE_THUMBNAIL_GENERATOR
 
 #include <memory>
+#include <mutex>
 #include <string>
 
 #ifdef HAS_PRESSURE_EQUALIZER
@@ -137,6 +138,26 @@ private:
     double                                                       m_last_wipe_tower_print_z = 0.f;
 };
 
+// G-code exported by GCode::do_export(), written to the output file while it is being generated.
+// The time estimator post processor inserts the M73 remaining time lines on the way, holding back just the lines,
+// which the time estimators did not finalize yet, and it fills in the remaining times at the end of the export.
+class GCodeOutputStream {
+public:
+    GCodeOutputStream(FILE *out, const GCodeTimeEstimator *normal_time_estimator, const GCodeTimeEstimator *silent_time_estimator) :
+        m_post_processor(out, 60.0f, normal_time_estimator, silent_time_estimator) {}
+
+    // The G-code has to be passed to the time estimators first.
+    void write(const char *data, size_t len) { m_post_processor.process(data, len); }
+    void write(const std::string &str) { this->write(str.data(), str.size()); }
+    void write_format(const char *format, ...);
+
+    // Writes the G-code held back and fills in the remaining times, once the time estimators calculated the total time.
+    void finalize() { m_post_processor.finalize(); }
+
+private:
+    GCodeTimeEstimator::PostProcessor m_post_processor;
+};
+
 class GCode {
 public:        
     GCode() : 
@@ -199,9 +220,9 @@ public:
 
 protected:
 #if ENABLE_THUMBNAIL_GENERATOR
-    void            _do_export(Print& print, FILE* file, ThumbnailsGeneratorCallback thumbnail_cb);
+    void            _do_export(Print& print, GCodeOutputStream &file, ThumbnailsGeneratorCallback thumbnail_cb);
 #else
-    void            _do_export(Print &print, FILE *file);
+    void            _do_export(Print &print, GCodeOutputStream &file);
 #endif //ENABLE_THUMBNAIL_GENERATOR
 
     // Object and support extrusions of the same PrintObject at the same print_z.
@@ -216,9 +237,23 @@ protected:
     };
     static std::vector<LayerToPrint>        		                   collect_layers_to_print(const PrintObject &object);
     static std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>> collect_layers_to_print(const Print &print);
-    void            process_layer(
-        // Write into the output file.
-        FILE                            *file,
+    // G-code of a single layer produced by process_layer(), to be post-processed by the cooling buffer
+    // and the pressure equalizer and written into the output file by process_layers().
+    struct LayerResult {
+        std::string gcode;
+        // Set to size_t(-1) if there was nothing to extrude at this layer.
+        size_t      layer_id { size_t(-1) };
+        coordf_t    print_z  { 0. };
+        bool        empty() const { return layer_id == size_t(-1); }
+    };
+    struct ObjectByExtruder;
+    static std::map<unsigned int, std::vector<ObjectByExtruder>> collect_layer_extrusions(
+        const Print                     &print,
+        // Set of object & print layers of the same PrintObject and with the same print_z.
+        const std::vector<LayerToPrint> &layers,
+        const LayerTools                &layer_tools,
+        std::mutex                      &wiping_extrusions_mutex);
+    LayerResult     process_layer(
         const Print                     &print,
         // Set of object & print layers of the same PrintObject and with the same print_z.
         const std::vector<LayerToPrint> &layers,
@@ -227,7 +262,24 @@ protected:
 		const std::vector<std::pair<size_t, size_t>> *ordering,
         // If set to size_t(-1), then print all copies of all objects.
         // Otherwise print a single copy of a single object.
-        const size_t                     single_object_idx = size_t(-1));
+        const size_t                     single_object_idx,
+        // Extrusions of the layers grouped by collect_layer_extrusions().
+        std::map<unsigned int, std::vector<ObjectByExtruder>> &by_extruder,
+        // Distance fields of the layers below the object layers, one per LayerToPrint.
+        // Filled in by process_layers() in advance, missing grids are created on demand.
+        std::vector<std::unique_ptr<EdgeGrid::Grid>> &lower_layer_edge_grids);
+    // Generate, post-process and write the layers into the output file in a pipeline.
+    void            process_layers(
+        // Write into the output stream.
+        GCodeOutputStream                                                  &file,
+        const Print                                                        &print,
+        const ToolOrdering                                                 &tool_ordering,
+        const std::vector<std::pair<coordf_t, std::vector<LayerToPrint>>>  &layers_to_print,
+		// Pairs of PrintObject index and its instance index.
+		const std::vector<std::pair<size_t, size_t>>                       *ordering,
+        // If set to size_t(-1), then print all copies of all objects.
+        // Otherwise print a single copy of a single object.
+        const size_t                                                        single_object_idx = size_t(-1));
 
     void            set_last_pos(const Point &pos) { m_last_pos = pos; m_last_pos_defined = true; }
     bool            last_pos_defined() const { return m_last_pos_defined; }
@@ -238,6 +290,11 @@ protected:
     std::string     extrude_loop(ExtrusionLoop loop, std::string description, double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr, std::string object_color = "#FFFFFF", int layer_id = 0, int layer_cnt = 0);
     std::string     extrude_multi_path(ExtrusionMultiPath multipath, std::string description = "", double speed = -1., std::string object_color = "#FFFFFF");
     std::string     extrude_path(ExtrusionPath path, std::string description = "", double speed = -1., std::string object_color = "#FFFFFF");
+    // Variants appending to a G-code buffer, process_layer() passes its layer buffer down to avoid a string per path.
+    void            extrude_entity(std::string &gcode, const ExtrusionEntity &entity, std::string description = "", double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr, std::string object_color = "#FFFFFF", int layer_id = 0, int layer_cnt = 0);
+    void            extrude_loop(std::string &gcode, ExtrusionLoop loop, std::string description, double speed = -1., std::unique_ptr<EdgeGrid::Grid> *lower_layer_edge_grid = nullptr, std::string object_color = "#FFFFFF", int layer_id = 0, int layer_cnt = 0);
+    void            extrude_multi_path(std::string &gcode, ExtrusionMultiPath multipath, std::string description = "", double speed = -1., std::string object_color = "#FFFFFF");
+    void            extrude_path(std::string &gcode, ExtrusionPath path, std::string description = "", double speed = -1., std::string object_color = "#FFFFFF");
 
     typedef std::vector<int> ExtruderPerCopy;
     // Extruding multiple objects with soluble / non-soluble / combined supports
@@ -292,9 +349,9 @@ protected:
 		// For sequential print, the instance of the object to be printing has to be defined.
 		const size_t                     				 single_object_instance_idx);
 
-    std::string     extrude_perimeters(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid, std::string object_color = "#FFFFFF", int layer_id = 0, int layer_cnt = 0);
-    std::string     extrude_infill(const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::string object_color = "#FFFFFF", int layer_id = 0, int layer_cnt = 0);
-    std::string     extrude_support(const ExtrusionEntityCollection &support_fills);
+    void            extrude_perimeters(std::string &gcode, const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::unique_ptr<EdgeGrid::Grid> &lower_layer_edge_grid, std::string object_color = "#FFFFFF", int layer_id = 0, int layer_cnt = 0);
+    void            extrude_infill(std::string &gcode, const Print &print, const std::vector<ObjectByExtruder::Island::Region> &by_region, std::string object_color = "#FFFFFF", int layer_id = 0, int layer_cnt = 0);
+    void            extrude_support(std::string &gcode, const ExtrusionEntityCollection &support_fills);
 
     std::string     travel_to(const Point &point, ExtrusionRole role, std::string comment);
     bool            needs_retraction(const Polyline &travel, ExtrusionRole role = erNone);
@@ -377,22 +434,22 @@ protected:
     // Analyzer
     GCodeAnalyzer m_analyzer;
 
-    // Write a string into a file.
-    void _write(FILE* file, const std::string& what) { this->_write(file, what.c_str()); }
-    void _write(FILE* file, const char *what);
+    // Write a string into the output stream.
+    void _write(GCodeOutputStream &file, const std::string& what) { this->_write(file, what.c_str()); }
+    void _write(GCodeOutputStream &file, const char *what);
 
-    // Write a string into a file. 
+    // Write a string into the output stream.
     // Add a newline, if the string does not end with a newline already.
     // Used to export a custom G-code section processed by the PlaceholderParser.
-    void _writeln(FILE* file, const std::string& what);
+    void _writeln(GCodeOutputStream &file, const std::string& what);
 
-    // Formats and write into a file the given data. 
-    void _write_format(FILE* file, const char* format, ...);
+    // Formats and write into the output stream the given data. 
+    void _write_format(GCodeOutputStream &file, const char* format, ...);
 
-    std::string _extrude(const ExtrusionPath &path, std::string description = "", double speed = -1);
-    void print_machine_envelope(FILE *file, Print &print);
-    void _print_first_layer_bed_temperature(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
-    void _print_first_layer_extruder_temperatures(FILE *file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
+    void        _extrude(std::string &gcode, const ExtrusionPath &path, std::string description = "", double speed = -1);
+    void print_machine_envelope(GCodeOutputStream &file, Print &print);
+    void _print_first_layer_bed_temperature(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
+    void _print_first_layer_extruder_temperatures(GCodeOutputStream &file, Print &print, const std::string &gcode, unsigned int first_printing_extruder_id, bool wait);
     // this flag triggers first layer speeds
     bool                                on_first_layer() const { return m_layer != nullptr && m_layer->id() == 0; }
 
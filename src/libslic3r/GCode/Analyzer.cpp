@@ -142,6 +142,12 @@ void GCodeAnalyzer::reset()
     _reset_cached_position();
 
     m_moves_map.clear();
+    m_preview_extrude_moves_published = 0;
+    m_preview_ranges_published.height.reset();
+    m_preview_ranges_published.width.reset();
+    m_preview_ranges_published.feedrate.reset();
+    m_preview_ranges_published.fan_speed.reset();
+    m_preview_ranges_published.volumetric_rate.reset();
     m_extruder_offsets.clear();
     m_extruders_count = 1;
     m_extruder_color.clear();
@@ -176,6 +182,25 @@ void GCodeAnalyzer::calc_gcode_preview_data(GCodePreviewData& preview_data, std:
     _calc_gcode_preview_unretractions(preview_data, cancel_callback);
 }
 
+void GCodeAnalyzer::calc_gcode_preview_layers(GCodePreviewData& preview_data)
+{
+    preview_data.extrusion.layers.clear();
+
+    TypeToMovesMap::iterator extrude_moves = m_moves_map.find(GCodeMove::Extrude);
+    if (extrude_moves != m_moves_map.end() && m_preview_extrude_moves_published < extrude_moves->second.size())
+    {
+        _calc_gcode_preview_extrusion_paths(extrude_moves->second, m_preview_extrude_moves_published, preview_data.extrusion.layers, &m_preview_ranges_published, std::function<void()>());
+        m_preview_extrude_moves_published = extrude_moves->second.size();
+    }
+
+    // the colors of the ranges are left to the defaults of preview_data
+    preview_data.ranges.height.set_from(m_preview_ranges_published.height);
+    preview_data.ranges.width.set_from(m_preview_ranges_published.width);
+    preview_data.ranges.feedrate.set_from(m_preview_ranges_published.feedrate);
+    preview_data.ranges.fan_speed.set_from(m_preview_ranges_published.fan_speed);
+    preview_data.ranges.volumetric_rate.set_from(m_preview_ranges_published.volumetric_rate);
+}
+
 bool GCodeAnalyzer::is_valid_extrusion_role(ExtrusionRole role)
 {
     return ((erPerimeter <= role) && (role < erMixed));
@@ -316,7 +341,8 @@ void GCodeAnalyzer::_process_gcode_line(GCodeReader&, const GCodeReader::GCodeLi
     }
 
     // puts the line back into the gcode
-    m_process_output += line.raw() + "\n";
+    m_process_output += line.raw_view();
+    m_process_output += '\n';
 }
 
 void GCodeAnalyzer::_processG1(const GCodeReader::GCodeLine& line)
@@ -955,6 +981,16 @@ bool GCodeAnalyzer::_is_valid_extrusion_role(int value) const
 }
 
 void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
+{
+    TypeToMovesMap::iterator extrude_moves = m_moves_map.find(GCodeMove::Extrude);
+    if (extrude_moves == m_moves_map.end())
+        return;
+
+    _calc_gcode_preview_extrusion_paths(extrude_moves->second, 0, preview_data.extrusion.layers, &preview_data.ranges, cancel_callback);
+}
+
+void GCodeAnalyzer::_calc_gcode_preview_extrusion_paths(const GCodeMovesList& moves, size_t first_move, GCodePreviewData::Extrusion::LayersList& layers,
+    GCodePreviewData::Ranges* ranges, std::function<void()> cancel_callback)
 {
     struct Helper
     {
@@ -973,12 +1009,12 @@ void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& previ
             return layers.back();
         }
 
-        static void store_polyline(const Polyline& polyline, const Metadata& data, float z, GCodePreviewData& preview_data)
+        static void store_polyline(const Polyline& polyline, const Metadata& data, float z, GCodePreviewData::Extrusion::LayersList& layers)
         {
             // if the polyline is valid, create the extrusion path from it and store it
             if (polyline.is_valid())
             {
-				auto& paths = get_layer_at_z(preview_data.extrusion.layers, z).paths;
+				auto& paths = get_layer_at_z(layers, z).paths;
 				paths.emplace_back(GCodePreviewData::Extrusion::Path());
 				GCodePreviewData::Extrusion::Path &path = paths.back();
                 path.polyline = polyline;
@@ -995,10 +1031,6 @@ void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& previ
         }
     };
 
-    TypeToMovesMap::iterator extrude_moves = m_moves_map.find(GCodeMove::Extrude);
-    if (extrude_moves == m_moves_map.end())
-        return;
-
     Metadata data;
     float z = FLT_MAX;
     Polyline polyline;
@@ -1011,22 +1043,24 @@ void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& previ
     GCodePreviewData::Range fan_speed_range;
 
     // to avoid to call the callback too often
-    unsigned int cancel_callback_threshold = (unsigned int)std::max((int)extrude_moves->second.size() / 25, 1);
+    unsigned int cancel_callback_threshold = (unsigned int)std::max((int)(moves.size() - first_move) / 25, 1);
     unsigned int cancel_callback_curr = 0;
 
     // constructs the polylines while traversing the moves
-    for (const GCodeMove& move : extrude_moves->second)
+    for (size_t i = first_move; i < moves.size(); ++i)
     {
+        const GCodeMove& move = moves[i];
+
         // to avoid to call the callback too often
         cancel_callback_curr = (cancel_callback_curr + 1) % cancel_callback_threshold;
-        if (cancel_callback_curr == 0)
+        if (cancel_callback_curr == 0 && cancel_callback)
             cancel_callback();
 
         if ((data != move.data) || (z != move.start_position.z()) || (position != move.start_position) || (volumetric_rate != move.data.feedrate * (float)move.data.mm3_per_mm))
         {
             // store current polyline
             polyline.remove_duplicate_points();
-            Helper::store_polyline(polyline, data, z, preview_data);
+            Helper::store_polyline(polyline, data, z, layers);
 
             // reset current polyline
             polyline = Polyline();
@@ -1055,17 +1089,20 @@ void GCodeAnalyzer::_calc_gcode_preview_extrusion_layers(GCodePreviewData& previ
 
     // store last polyline
     polyline.remove_duplicate_points();
-    Helper::store_polyline(polyline, data, z, preview_data);
+    Helper::store_polyline(polyline, data, z, layers);
 
     // updates preview ranges data
-    preview_data.ranges.height.update_from(height_range);
-    preview_data.ranges.width.update_from(width_range);
-    preview_data.ranges.feedrate.update_from(feedrate_range);
-    preview_data.ranges.volumetric_rate.update_from(volumetric_rate_range);
-    preview_data.ranges.fan_speed.update_from(fan_speed_range);
+    if (ranges != nullptr)
+    {
+        ranges->height.update_from(height_range);
+        ranges->width.update_from(width_range);
+        ranges->feedrate.update_from(feedrate_range);
+        ranges->volumetric_rate.update_from(volumetric_rate_range);
+        ranges->fan_speed.update_from(fan_speed_range);
+    }
 
     // we need to sort the layers by their z as they can be shuffled in case of sequential prints
-    std::sort(preview_data.extrusion.layers.begin(), preview_data.extrusion.layers.end(), [](const GCodePreviewData::Extrusion::Layer& l1, const GCodePreviewData::Extrusion::Layer& l2)->bool { return l1.z < l2.z; });
+    std::sort(layers.begin(), layers.end(), [](const GCodePreviewData::Extrusion::Layer& l1, const GCodePreviewData::Extrusion::Layer& l2)->bool { return l1.z < l2.z; });
 }
 
 void GCodeAnalyzer::_calc_gcode_preview_travel(GCodePreviewData& preview_data, std::function<void()> cancel_callback)
@@ -7,11 +7,10 @@
 
 #include "../Point.hpp"
 #include "../GCodeReader.hpp"
+#include "PreviewData.hpp"
 
 namespace Slic3r {
 
-class GCodePreviewData;
-
 class GCodeAnalyzer
 {
 public:
@@ -114,6 +113,10 @@ private:
     State m_state;
     GCodeReader m_parser;
     TypeToMovesMap m_moves_map;
+    // Number of the Extrude moves already converted by calc_gcode_preview_layers()
+    size_t m_preview_extrude_moves_published;
+    // Value ranges of the Extrude moves already converted by calc_gcode_preview_layers()
+    GCodePreviewData::Ranges m_preview_ranges_published;
     ExtruderOffsetsMap m_extruder_offsets;
     unsigned int m_extruders_count;
     GCodeFlavor m_gcode_flavor;
@@ -143,6 +146,12 @@ public:
     // throws CanceledException through print->throw_if_canceled() (sent by the caller as callback).
     void calc_gcode_preview_data(GCodePreviewData& preview_data, std::function<void()> cancel_callback = std::function<void()>());
 
+    // Calculates the extrusion layers of the moves processed since the previous call, so that the preview
+    // may be shown while the G-code is being exported. The layers are sorted by z.
+    // The ranges cover all the moves processed so far, so that the legend of each batch is valid for the preceding batches.
+    // The paths are split at the call boundaries, calc_gcode_preview_data() still returns the full data.
+    void calc_gcode_preview_layers(GCodePreviewData& preview_data);
+
     // Return an estimate of the memory consumed by the time estimator.
     size_t memory_used() const;
 
@@ -301,6 +310,9 @@ private:
 
     // All the following methods throw CanceledException through print->throw_if_canceled() (sent by the caller as callback).
     void _calc_gcode_preview_extrusion_layers(GCodePreviewData& preview_data, std::function<void()> cancel_callback);
+    // Converts moves[first_move..] into extrusion paths, updates the ranges if not null
+    static void _calc_gcode_preview_extrusion_paths(const GCodeMovesList& moves, size_t first_move, GCodePreviewData::Extrusion::LayersList& layers,
+        GCodePreviewData::Ranges* ranges, std::function<void()> cancel_callback);
     void _calc_gcode_preview_travel(GCodePreviewData& preview_data, std::function<void()> cancel_callback);
     void _calc_gcode_preview_retractions(GCodePreviewData& preview_data, std::function<void()> cancel_callback);
     void _calc_gcode_preview_unretractions(GCodePreviewData& preview_data, std::function<void()> cancel_callback);
@@ -1,8 +1,8 @@
 #include "../GCode.hpp"
 #include "CoolingBuffer.hpp"
-#include <boost/algorithm/string/predicate.hpp>
-#include <boost/algorithm/string/replace.hpp>
 #include <boost/log/trivial.hpp>
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <float.h>
 
@@ -18,6 +18,7 @@ namespace Slic3r {
 
 CoolingBuffer::CoolingBuffer(GCode &gcodegen) : m_gcodegen(gcodegen), m_current_extruder(0)
 {
+    m_config.apply(gcodegen.config(), true);
     this->reset();
 }
 
@@ -28,7 +29,7 @@ void CoolingBuffer::reset()
     m_current_pos[0] = float(pos(0));
     m_current_pos[1] = float(pos(1));
     m_current_pos[2] = float(pos(2));
-    m_current_pos[4] = float(m_gcodegen.config().travel_speed.value);
+    m_current_pos[4] = float(m_config.travel_speed.value);
 }
 
 struct CoolingLine
@@ -290,7 +291,7 @@ std::string CoolingBuffer::process_layer(const std::string &gcode, size_t layer_
 // Return the list of parsed lines, bucketed by an extruder.
 std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::string &gcode, std::vector<float> &current_pos) const
 {
-    const FullPrintConfig       &config        = m_gcodegen.config();
+    const PrintConfig           &config        = m_config;
     const std::vector<Extruder> &extruders     = m_gcodegen.writer().extruders();
     unsigned int                 num_extruders = 0;
     for (const Extruder &ex : extruders)
@@ -318,36 +319,47 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
     // for a sequence of extrusion moves.
     size_t            active_speed_modifier = size_t(-1);
 
+    // The lines are parsed in place, without copying them, as the layer G-code may contain millions of moves.
+    auto starts_with = [](const char *begin, const char *end, const char *prefix, size_t prefix_len) {
+        return size_t(end - begin) >= prefix_len && memcmp(begin, prefix, prefix_len) == 0;
+    };
+    // The cooling markers are stored as G-code comments, search for them past the comment start only.
+    auto contains = [](const char *begin, const char *end, const char *needle) {
+        return std::search(begin, end, needle, needle + strlen(needle)) != end;
+    };
+#define STARTS_WITH(PREFIX) starts_with(line_start, line_body_end, PREFIX, sizeof(PREFIX) - 1)
     for (; *line_start != 0; line_start = line_end) 
     {
         while (*line_end != '\n' && *line_end != 0)
             ++ line_end;
-        // sline will not contain the trailing '\n'.
-        std::string sline(line_start, line_end);
+        // line_body_end does not include the trailing '\n'.
+        const char *line_body_end = line_end;
         // CoolingLine will contain the trailing '\n'.
         if (*line_end == '\n')
             ++ line_end;
         CoolingLine line(0, line_start - gcode.c_str(), line_end - gcode.c_str());
-        if (boost::starts_with(sline, "G0 "))
+        if (STARTS_WITH("G0 "))
             line.type = CoolingLine::TYPE_G0;
-        else if (boost::starts_with(sline, "G1 "))
+        else if (STARTS_WITH("G1 "))
             line.type = CoolingLine::TYPE_G1;
-        else if (boost::starts_with(sline, "G92 "))
+        else if (STARTS_WITH("G92 "))
             line.type = CoolingLine::TYPE_G92;
         if (line.type) {
             // G0, G1 or G92
             // Parse the G-code line.
-            std::vector<float> new_pos(current_pos);
-            const char *c = sline.data() + 3;
+            float new_pos[5];
+            std::copy(current_pos.begin(), current_pos.begin() + 5, new_pos);
+            const char *c = line_start + 3;
             for (;;) {
                 // Skip whitespaces.
-                for (; *c == ' ' || *c == '\t'; ++ c);
-                if (*c == 0 || *c == ';')
+                for (; c != line_body_end && (*c == ' ' || *c == '\t'); ++ c);
+                if (c == line_body_end || *c == ';')
                     break;
                 // Parse the axis.
                 size_t axis = (*c >= 'X' && *c <= 'Z') ? (*c - 'X') :
                               (*c == extrusion_axis) ? 3 : (*c == 'F') ? 4 : size_t(-1);
                 if (axis != size_t(-1)) {
+                    // atof() stops at the trailing '\n' or at the following word.
                     new_pos[axis] = float(atof(++c));
                     if (axis == 4) {
                         // Convert mm/min to mm/sec.
@@ -358,15 +370,18 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     }
                 }
                 // Skip this word.
-                for (; *c != ' ' && *c != '\t' && *c != 0; ++ c);
+                for (; c != line_body_end && *c != ' ' && *c != '\t'; ++ c);
             }
-            bool external_perimeter = boost::contains(sline, ";_EXTERNAL_PERIMETER");
-            bool wipe               = boost::contains(sline, ";_WIPE");
+            // The markers are appended to the G-code words without a space, for example "G1 F1800;_EXTRUDE_SET_SPEED",
+            // thus the word parser above may have skipped them. Search for them from the first comment on the line.
+            const char *comment            = std::find(line_start, line_body_end, ';');
+            bool        external_perimeter = contains(comment, line_body_end, ";_EXTERNAL_PERIMETER");
+            bool        wipe               = contains(comment, line_body_end, ";_WIPE");
             if (external_perimeter)
                 line.type |= CoolingLine::TYPE_EXTERNAL_PERIMETER;
             if (wipe)
                 line.type |= CoolingLine::TYPE_WIPE;
-            if (boost::contains(sline, ";_EXTRUDE_SET_SPEED") && ! wipe) {
+            if (contains(comment, line_body_end, ";_EXTRUDE_SET_SPEED") && ! wipe) {
                 line.type |= CoolingLine::TYPE_ADJUSTABLE;
                 active_speed_modifier = adjustment->lines.size();
             }
@@ -411,12 +426,12 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
                     line.type = 0;
                 }
             }
-            current_pos = std::move(new_pos);
-        } else if (boost::starts_with(sline, ";_EXTRUDE_END")) {
+            std::copy(new_pos, new_pos + 5, current_pos.begin());
+        } else if (STARTS_WITH(";_EXTRUDE_END")) {
             line.type = CoolingLine::TYPE_EXTRUDE_END;
             active_speed_modifier = size_t(-1);
-        } else if (boost::starts_with(sline, toolchange_prefix)) {
-            unsigned int new_extruder = (unsigned int)atoi(sline.c_str() + toolchange_prefix.size());
+        } else if (starts_with(line_start, line_body_end, toolchange_prefix.data(), toolchange_prefix.size())) {
+            unsigned int new_extruder = (unsigned int)atoi(line_start + toolchange_prefix.size());
             // Only change extruder in case the number is meaningful. User could provide an out-of-range index through custom gcodes - those shall be ignored.
             if (new_extruder < map_extruder_to_per_extruder_adjustment.size()) {
                 if (new_extruder != current_extruder) {
@@ -429,25 +444,25 @@ std::vector<PerExtruderAdjustments> CoolingBuffer::parse_layer_gcode(const std::
             else {
                 // Only log the error in case of MM printer. Single extruder printers likely ignore any T anyway.
                 if (map_extruder_to_per_extruder_adjustment.size() > 1)
-                    BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << sline;
+                    BOOST_LOG_TRIVIAL(error) << "CoolingBuffer encountered an invalid toolchange, maybe from a custom gcode: " << std::string(line_start, line_body_end);
             }
 
-        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_START")) {
+        } else if (STARTS_WITH(";_BRIDGE_FAN_START")) {
             line.type = CoolingLine::TYPE_BRIDGE_FAN_START;
-        } else if (boost::starts_with(sline, ";_BRIDGE_FAN_END")) {
+        } else if (STARTS_WITH(";_BRIDGE_FAN_END")) {
             line.type = CoolingLine::TYPE_BRIDGE_FAN_END;
-        } else if (boost::starts_with(sline, "G4 ")) {
+        } else if (STARTS_WITH("G4 ")) {
             // Parse the wait time.
             line.type = CoolingLine::TYPE_G4;
-            size_t pos_S = sline.find('S', 3);
-            size_t pos_P = sline.find('P', 3);
-            line.time = line.time_max = float(
-                (pos_S > 0) ? atof(sline.c_str() + pos_S + 1) :
-                (pos_P > 0) ? atof(sline.c_str() + pos_P + 1) * 0.001 : 0.);
+            // Only the S word is taken into account: the former std::string::find() based parser tested the P position
+            // against zero instead of npos, thus it never reached the P branch and it parsed a missing S word as zero.
+            const char *pos_S = std::find(line_start + 3, line_body_end, 'S');
+            line.time = line.time_max = (pos_S != line_body_end) ? float(atof(pos_S + 1)) : 0.f;
         }
         if (line.type != 0)
             adjustment->lines.emplace_back(std::move(line));
     }
+#undef STARTS_WITH
 
     return per_extruder_adjustments;
 }
@@ -647,6 +662,38 @@ float CoolingBuffer::calculate_layer_slowdown(std::vector<PerExtruderAdjustments
     return elapsed_time_total0;
 }
 
+// Append the G-code comment [begin, end) to out, removing all the occurences of ";_EXTRUDE_SET_SPEED"
+// and optionally of ";_EXTERNAL_PERIMETER" and ";_WIPE", without making a temporary copy of the comment.
+static void append_without_cooling_markers(std::string &out, const char *begin, const char *end, bool external_perimeter, bool wipe)
+{
+    static const std::string set_speed_marker(";_EXTRUDE_SET_SPEED");
+    static const std::string external_perimeter_marker(";_EXTERNAL_PERIMETER");
+    static const std::string wipe_marker(";_WIPE");
+    auto starts_with = [end](const char *c, const std::string &marker) {
+        return size_t(end - c) >= marker.size() && memcmp(c, marker.data(), marker.size()) == 0;
+    };
+    const char *copied = begin;
+    for (const char *c = begin; c < end;) {
+        size_t skip = 0;
+        if (*c == ';') {
+            if (starts_with(c, set_speed_marker))
+                skip = set_speed_marker.size();
+            else if (external_perimeter && starts_with(c, external_perimeter_marker))
+                skip = external_perimeter_marker.size();
+            else if (wipe && starts_with(c, wipe_marker))
+                skip = wipe_marker.size();
+        }
+        if (skip == 0) {
+            ++ c;
+        } else {
+            out.append(copied, c - copied);
+            c += skip;
+            copied = c;
+        }
+    }
+    out.append(copied, end - copied);
+}
+
 // Apply slow down over G-code lines stored in per_extruder_adjustments, enable fan if needed.
 // Returns the adjusted G-code.
 std::string CoolingBuffer::apply_layer_cooldown(
@@ -678,7 +725,7 @@ std::string CoolingBuffer::apply_layer_cooldown(
     bool bridge_fan_control = false;
     int  bridge_fan_speed   = 0;
     auto change_extruder_set_fan = [ this, layer_id, layer_time, &new_gcode, &fan_speed, &bridge_fan_control, &bridge_fan_speed ]() {
-        const FullPrintConfig &config = m_gcodegen.config();
+        const PrintConfig &config = m_config;
 #define EXTRUDER_CONFIG(OPT) config.OPT.get_at(m_current_extruder)
         int min_fan_speed = EXTRUDER_CONFIG(min_fan_speed);
         int fan_speed_new = EXTRUDER_CONFIG(fan_always_on) ? min_fan_speed : 0;
@@ -789,13 +836,8 @@ std::string CoolingBuffer::apply_layer_cooldown(
             if (end < line_end) {
                 if (line->type & (CoolingLine::TYPE_ADJUSTABLE | CoolingLine::TYPE_EXTERNAL_PERIMETER | CoolingLine::TYPE_WIPE)) {
                     // Process comments, remove ";_EXTRUDE_SET_SPEED", ";_EXTERNAL_PERIMETER", ";_WIPE"
-                    std::string comment(end, line_end);
-                    boost::replace_all(comment, ";_EXTRUDE_SET_SPEED", "");
-                    if (line->type & CoolingLine::TYPE_EXTERNAL_PERIMETER)
-                        boost::replace_all(comment, ";_EXTERNAL_PERIMETER", "");
-                    if (line->type & CoolingLine::TYPE_WIPE)
-                        boost::replace_all(comment, ";_WIPE", "");
-                    new_gcode += comment;
+                    append_without_cooling_markers(new_gcode, end, line_end,
+                        (line->type & CoolingLine::TYPE_EXTERNAL_PERIMETER) != 0, (line->type & CoolingLine::TYPE_WIPE) != 0);
                 } else {
                     // Just attach the rest of the source line.
                     new_gcode.append(end, line_end - end);
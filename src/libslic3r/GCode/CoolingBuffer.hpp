@@ -2,6 +2,7 @@
 #define slic3r_CoolingBuffer_hpp_
 
 #include "../libslic3r.h"
+#include "../PrintConfig.hpp"
 #include <map>
 #include <string>
 
@@ -37,6 +38,9 @@ private:
     std::string apply_layer_cooldown(const std::string &gcode, size_t layer_id, float layer_time, std::vector<PerExtruderAdjustments> &per_extruder_adjustments);
 
     GCode&              m_gcodegen;
+    // Snapshot of the print wide configuration taken at construction. GCode::process_layers() runs the cooling buffer
+    // on a layer while the next layer is being generated, which applies the object and region configs to GCode::config().
+    PrintConfig         m_config;
     std::string         m_gcode;
     // Internal data.
     // X,Y,Z,E,F
@@ -1,9 +1,14 @@
 #include "GCodeReader.hpp"
+#include "Utils.hpp"
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <thread>
+
+#include <tbb/pipeline.h>
 
 #include <Shiny/Shiny.h>
 
@@ -24,7 +29,19 @@ void GCodeReader::apply_config(const DynamicPrintConfig &config)
 const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command)
 {
     PROFILE_FUNC();
-    
+    const char *end = this->tokenize_line(ptr, gline, command);
+
+    if (gline.has(E) && m_config.use_relative_e_distances)
+        m_position[E] = 0;
+
+    if (m_verbose)
+        std::cout << gline.m_raw << std::endl;
+
+    return end;
+}
+
+const char* GCodeReader::tokenize_line(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command) const
+{
     // command and args
     const char *c = ptr;
     {
@@ -69,17 +86,11 @@ const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline,
         }
     }
     
-    if (gline.has(E) && m_config.use_relative_e_distances)
-        m_position[E] = 0;
-
     // Skip the rest of the line.
     for (; ! is_end_of_line(*c); ++ c);
 
-    // Copy the raw string including the comment, without the trailing newlines.
-    if (c > ptr) {
-        PROFILE_BLOCK(copy_raw_string);
-        gline.m_raw.assign(ptr, c);
-    }
+    // Reference the raw string including the comment, without the trailing newlines.
+    gline.m_raw = std::string_view(ptr, c - ptr);
 
     // Skip the trailing newlines.
 	if (*c == '\r')
@@ -87,9 +98,6 @@ const char* GCodeReader::parse_line_internal(const char *ptr, GCodeLine &gline,
 	if (*c == '\n')
 		++ c;
 
-    if (m_verbose)
-        std::cout << gline.m_raw << std::endl;
-
     return c;
 }
 
@@ -109,15 +117,102 @@ void GCodeReader::update_coordinates(GCodeLine &gline, std::pair<const char*, co
 
 void GCodeReader::parse_file(const std::string &file, callback_t callback)
 {
-    std::ifstream f(file);
-    std::string line;
-    while (std::getline(f, line))
-        this->parse_line(line, callback);
+    MappedFile mapped(file);
+    if (! mapped.is_open() || mapped.size() == 0)
+        return;
+
+    // The tokenizer reads up to the end of line character, which is not available after the last line
+    // if the file does not end with a new line. Such a last line is parsed from a zero terminated copy.
+    const char *end = mapped.end();
+    for (; end > mapped.begin() && end[-1] != '\n'; -- end) ;
+    const std::string last_line(end, mapped.end());
+
+    // Tokenized line, referencing the mapped file.
+    struct Tokens {
+        const char *raw;
+        uint32_t    raw_length;
+        uint32_t    mask;
+        float       axis[NUM_AXES];
+    };
+    // Chunks of about 256kB are small enough to bound the memory held by the tokens in flight.
+    static constexpr size_t chunk_size = 256 * 1024;
+    const char *chunk_begin = mapped.begin();
+    const auto split = tbb::make_filter<void, std::pair<const char*, const char*>>(tbb::filter::serial_in_order,
+        [&chunk_begin, end](tbb::flow_control &fc) -> std::pair<const char*, const char*> {
+            if (chunk_begin == end) {
+                fc.stop();
+                return { end, end };
+            }
+            // Split after the first new line following chunk_size bytes.
+            const char *chunk_end = end;
+            if (size_t(end - chunk_begin) > chunk_size)
+                chunk_end = static_cast<const char*>(memchr(chunk_begin + chunk_size - 1, '\n', end - chunk_begin - chunk_size + 1)) + 1;
+            std::pair<const char*, const char*> chunk(chunk_begin, chunk_end);
+            chunk_begin = chunk_end;
+            return chunk;
+        });
+    const auto tokenize = tbb::make_filter<std::pair<const char*, const char*>, std::vector<Tokens>>(tbb::filter::parallel,
+        [this](std::pair<const char*, const char*> chunk) -> std::vector<Tokens> {
+            std::vector<Tokens> out;
+            out.reserve((chunk.second - chunk.first) / 24);
+            GCodeLine gline;
+            std::pair<const char*, const char*> cmd;
+            for (const char *ptr = chunk.first; ptr < chunk.second;) {
+                gline.reset();
+                const char *line_begin = ptr;
+                ptr = this->tokenize_line(ptr, gline, cmd);
+                // A zero character or a single '\r' terminates the line, but not the text up to the new line, which is skipped.
+                // This is the same as parse_line() of a line read by std::getline().
+                if (ptr < chunk.second && (ptr == line_begin || ptr[-1] != '\n'))
+                    ptr = static_cast<const char*>(memchr(ptr, '\n', chunk.second - ptr)) + 1;
+                Tokens tokens { gline.m_raw.data(), uint32_t(gline.m_raw.size()), gline.m_mask };
+                memcpy(tokens.axis, gline.m_axis, sizeof(tokens.axis));
+                out.emplace_back(tokens);
+            }
+            return out;
+        });
+    GCodeLine gline;
+    const auto process = tbb::make_filter<std::vector<Tokens>, void>(tbb::filter::serial_in_order,
+        [this, &callback, &gline](const std::vector<Tokens> &lines) {
+            for (const Tokens &tokens : lines) {
+                gline.m_raw  = std::string_view(tokens.raw, tokens.raw_length);
+                gline.m_mask = tokens.mask;
+                memcpy(gline.m_axis, tokens.axis, sizeof(tokens.axis));
+                std::pair<const char*, const char*> cmd;
+                cmd.first  = skip_whitespaces(tokens.raw);
+                cmd.second = skip_word(cmd.first);
+                if (gline.has(E) && m_config.use_relative_e_distances)
+                    m_position[E] = 0;
+                if (m_verbose)
+                    std::cout << gline.m_raw << std::endl;
+                callback(*this, gline);
+                this->update_coordinates(gline, cmd);
+            }
+        });
+    // Limit the number of chunks in flight to bound the memory held by the tokens.
+    const size_t max_tokens = std::max<size_t>(4, 2 * std::thread::hardware_concurrency());
+    tbb::parallel_pipeline(max_tokens, split & tokenize & process);
+
+    if (! last_line.empty()) {
+        gline.reset();
+        this->parse_line(last_line.c_str(), gline, callback);
+    }
+}
+
+GCodeReader::GCodeLine& GCodeReader::GCodeLine::operator=(const GCodeLine &rhs)
+{
+    if (this != &rhs) {
+        m_raw_storage.assign(rhs.m_raw.data(), rhs.m_raw.size());
+        m_raw  = m_raw_storage;
+        m_mask = rhs.m_mask;
+        memcpy(m_axis, rhs.m_axis, sizeof(m_axis));
+    }
+    return *this;
 }
 
 bool GCodeReader::GCodeLine::has(char axis) const
 {
-    const char *c = m_raw.c_str();
+    const char *c = m_raw.data();
     // Skip the whitespaces.
     c = skip_whitespaces(c);
     // Skip the command.
@@ -139,7 +234,7 @@ bool GCodeReader::GCodeLine::has(char axis) const
 
 bool GCodeReader::GCodeLine::has_value(char axis, float &value) const
 {
-    const char *c = m_raw.c_str();
+    const char *c = m_raw.data();
     // Skip the whitespaces.
     c = skip_whitespaces(c);
     // Skip the command.
@@ -182,17 +277,20 @@ void GCodeReader::GCodeLine::set(const GCodeReader &reader, const Axis axis, con
         match[1] = reader.extrusion_axis();
     }
 
+    std::string raw(m_raw);
     if (this->has(axis)) {
-        size_t pos = m_raw.find(match)+2;
-        size_t end = m_raw.find(' ', pos+1);
-        m_raw = m_raw.replace(pos, end-pos, ss.str());
+        size_t pos = raw.find(match)+2;
+        size_t end = raw.find(' ', pos+1);
+        raw.replace(pos, end-pos, ss.str());
     } else {
-        size_t pos = m_raw.find(' ');
+        size_t pos = raw.find(' ');
         if (pos == std::string::npos)
-            m_raw += std::string(match) + ss.str();
+            raw += std::string(match) + ss.str();
         else
-            m_raw = m_raw.replace(pos, 0, std::string(match) + ss.str());
+            raw.replace(pos, 0, std::string(match) + ss.str());
     }
+    m_raw_storage = std::move(raw);
+    m_raw = m_raw_storage;
     m_axis[axis] = new_value;
     m_mask |= 1 << int(axis);
 }
@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <functional>
 #include <string>
+#include <string_view>
 #include "PrintConfig.hpp"
 
 namespace Slic3r {
@@ -15,15 +16,29 @@ public:
     class GCodeLine {
     public:
         GCodeLine() { reset(); }
-        void reset() { m_mask = 0; memset(m_axis, 0, sizeof(m_axis)); m_raw.clear(); }
-
-        const std::string&  raw() const { return m_raw; }
+        // A copy owns its raw text, thus it may outlive the parsed buffer.
+        GCodeLine(const GCodeLine &rhs) { *this = rhs; }
+        GCodeLine& operator=(const GCodeLine &rhs);
+        void reset() { m_mask = 0; memset(m_axis, 0, sizeof(m_axis)); m_raw = std::string_view(""); }
+
+        // Raw line including the comment, without the trailing new line.
+        const std::string&  raw() const {
+            if (m_raw.data() != m_raw_storage.data()) {
+                // The raw text references the parsed buffer, copy it on demand.
+                m_raw_storage.assign(m_raw.data(), m_raw.size());
+                m_raw = m_raw_storage;
+            }
+            return m_raw_storage;
+        }
+        // Raw line without copying it. It points into the parsed buffer
+        // until the line is copied or modified by set(). The character following the raw line is an end of line.
+        std::string_view    raw_view() const { return m_raw; }
         const std::string   cmd() const { 
-            const char *cmd = GCodeReader::skip_whitespaces(m_raw.c_str());
+            const char *cmd = GCodeReader::skip_whitespaces(m_raw.data());
             return std::string(cmd, GCodeReader::skip_word(cmd));
         }
         const std::string   comment() const
-            { size_t pos = m_raw.find(';'); return (pos == std::string::npos) ? "" : m_raw.substr(pos + 1); }
+            { size_t pos = m_raw.find(';'); return (pos == std::string_view::npos) ? "" : std::string(m_raw.substr(pos + 1)); }
 
         bool  has(Axis axis) const { return (m_mask & (1 << int(axis))) != 0; }
         float value(Axis axis) const { return m_axis[axis]; }
@@ -44,7 +59,7 @@ public:
             return sqrt(x*x + y*y);
         }
         bool cmd_is(const char *cmd_test) const {
-            const char *cmd = GCodeReader::skip_whitespaces(m_raw.c_str());
+            const char *cmd = GCodeReader::skip_whitespaces(m_raw.data());
             size_t len = strlen(cmd_test); 
             return strncmp(cmd, cmd_test, len) == 0 && GCodeReader::is_end_of_word(cmd[len]);
         }
@@ -65,7 +80,9 @@ public:
         float f() const { return m_axis[F]; }
 
     private:
-        std::string      m_raw;
+        mutable std::string_view m_raw;
+        // Storage of the raw text of a copied or modified line, or of a line accessed through raw().
+        mutable std::string      m_raw_storage;
         float            m_axis[NUM_AXES];
         uint32_t         m_mask;
         friend class GCodeReader;
@@ -105,6 +122,9 @@ public:
     void parse_line(const std::string &line, Callback callback)
         { GCodeLine gline; this->parse_line(line.c_str(), gline, callback); }
 
+    // Parse a G-code file, which is memory mapped. The file is split into chunks of whole lines, which are tokenized
+    // in parallel, while the callback is called for each line in the file order from a single thread at a time.
+    // The raw text of the lines points into the mapped file, it must not be referenced after the callback returns.
     void parse_file(const std::string &file, callback_t callback);
 
     float& x()       { return m_position[X]; }
@@ -123,6 +143,8 @@ public:
 
 private:
     const char* parse_line_internal(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command);
+    // Parse a single line without touching the reader state, thus it may be called from multiple threads.
+    const char* tokenize_line(const char *ptr, GCodeLine &gline, std::pair<const char*, const char*> &command) const;
     void        update_coordinates(GCodeLine &gline, std::pair<const char*, const char*> &command);
 
     static bool         is_whitespace(char c)           { return c == ' ' || c == '\t'; }
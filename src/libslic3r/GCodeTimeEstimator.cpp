@@ -2,6 +2,7 @@
 #include "Utils.hpp"
 #include <boost/bind.hpp>
 #include <cmath>
+#include <cstring>
 
 #include <Shiny/Shiny.h>
 
@@ -25,6 +26,12 @@ static const float DEFAULT_EXTRUDE_FACTOR_OVERRIDE_PERCENTAGE = 1.0f; // 100 per
 
 static const float PREVIOUS_FEEDRATE_THRESHOLD = 0.0001f;
 
+// Minimum number of blocks kept by the planner before the blocks, which cannot be modified by the planner anymore, are finalized.
+static const size_t PLANNER_CHUNK_SIZE = 4096;
+// Maximum number of blocks kept by the planner. If no block in the buffer is known to be left unmodified by the reverse pass,
+// the blocks are finalized up to the last chunk, with the reverse pass starting at the entry speed of its first block.
+static const size_t PLANNER_MAX_BLOCKS = 16 * PLANNER_CHUNK_SIZE;
+
 #if ENABLE_MOVE_STATS
 static const std::string MOVE_TYPE_STR[Slic3r::GCodeTimeEstimator::Block::Num_Types] =
 {
@@ -46,118 +53,102 @@ namespace Slic3r {
         ::memset(abs_axis_feedrate, 0, Num_Axis * sizeof(float));
     }
 
-    float GCodeTimeEstimator::Block::Trapezoid::acceleration_time(float acceleration) const
+    float GCodeTimeEstimator::Block::trapezoid_time(float distance, float acceleration, float entry, float cruise, float exit)
     {
-        return acceleration_time_from_distance(feedrate.entry, accelerate_until, acceleration);
-    }
+        float accelerate_distance = std::max(0.0f, estimate_acceleration_distance(entry, cruise, acceleration));
+        float decelerate_distance = std::max(0.0f, estimate_acceleration_distance(cruise, exit, -acceleration));
+        float cruise_distance = distance - accelerate_distance - decelerate_distance;
 
-    float GCodeTimeEstimator::Block::Trapezoid::cruise_time() const
-    {
-        return (feedrate.cruise != 0.0f) ? cruise_distance() / feedrate.cruise : 0.0f;
-    }
+        // Not enough space to reach the nominal feedrate.
+        // This means no cruising, and we'll have to use intersection_distance() to calculate when to abort acceleration 
+        // and start braking in order to reach the exit_feedrate exactly at the end of this block.
+        if (cruise_distance < 0.0f)
+        {
+            accelerate_distance = clamp(0.0f, distance, intersection_distance(entry, exit, acceleration, distance));
+            cruise_distance = 0.0f;
+            cruise = speed_from_distance(entry, accelerate_distance, acceleration);
+        }
 
-    float GCodeTimeEstimator::Block::Trapezoid::deceleration_time(float acceleration) const
-    {
-        return acceleration_time_from_distance(feedrate.cruise, (distance - decelerate_after), -acceleration);
-    }
+        float accelerate_until = accelerate_distance;
+        float decelerate_after = accelerate_distance + cruise_distance;
 
-    float GCodeTimeEstimator::Block::Trapezoid::cruise_distance() const
-    {
-        return decelerate_after - accelerate_until;
+        float acceleration_time = acceleration_time_from_distance(entry, accelerate_until, acceleration);
+        float cruise_time = (cruise != 0.0f) ? (decelerate_after - accelerate_until) / cruise : 0.0f;
+        float deceleration_time = acceleration_time_from_distance(cruise, distance - decelerate_after, -acceleration);
+        return acceleration_time + cruise_time + deceleration_time;
     }
 
-    float GCodeTimeEstimator::Block::Trapezoid::acceleration_time_from_distance(float initial_feedrate, float distance, float acceleration)
+    float GCodeTimeEstimator::Block::acceleration_time_from_distance(float initial_feedrate, float distance, float acceleration)
     {
         return (acceleration != 0.0f) ? (speed_from_distance(initial_feedrate, distance, acceleration) - initial_feedrate) / acceleration : 0.0f;
     }
 
-    float GCodeTimeEstimator::Block::Trapezoid::speed_from_distance(float initial_feedrate, float distance, float acceleration)
+    float GCodeTimeEstimator::Block::speed_from_distance(float initial_feedrate, float distance, float acceleration)
     {
         // to avoid invalid negative numbers due to numerical imprecision 
         float value = std::max(0.0f, sqr(initial_feedrate) + 2.0f * acceleration * distance);
         return ::sqrt(value);
     }
 
-    GCodeTimeEstimator::Block::Block()
-    {
-    }
-
-    float GCodeTimeEstimator::Block::move_length() const
-    {
-        float length = ::sqrt(sqr(delta_pos[X]) + sqr(delta_pos[Y]) + sqr(delta_pos[Z]));
-        return (length > 0.0f) ? length : std::abs(delta_pos[E]);
-    }
-
-    float GCodeTimeEstimator::Block::is_extruder_only_move() const
-    {
-        return (delta_pos[X] == 0.0f) && (delta_pos[Y] == 0.0f) && (delta_pos[Z] == 0.0f) && (delta_pos[E] != 0.0f);
-    }
-
-    float GCodeTimeEstimator::Block::is_travel_move() const
-    {
-        return delta_pos[E] == 0.0f;
-    }
-
-    float GCodeTimeEstimator::Block::acceleration_time() const
-    {
-        return trapezoid.acceleration_time(acceleration);
-    }
-
-    float GCodeTimeEstimator::Block::cruise_time() const
-    {
-        return trapezoid.cruise_time();
-    }
-
-    float GCodeTimeEstimator::Block::deceleration_time() const
+    float GCodeTimeEstimator::Block::max_allowable_speed(float acceleration, float target_velocity, float distance)
     {
-        return trapezoid.deceleration_time(acceleration);
+        // to avoid invalid negative numbers due to numerical imprecision 
+        float value = std::max(0.0f, sqr(target_velocity) - 2.0f * acceleration * distance);
+        return ::sqrt(value);
     }
 
-    float GCodeTimeEstimator::Block::cruise_distance() const
+    float GCodeTimeEstimator::Block::estimate_acceleration_distance(float initial_rate, float target_rate, float acceleration)
     {
-        return trapezoid.cruise_distance();
+        return (acceleration == 0.0f) ? 0.0f : (sqr(target_rate) - sqr(initial_rate)) / (2.0f * acceleration);
     }
 
-    void GCodeTimeEstimator::Block::calculate_trapezoid()
+    float GCodeTimeEstimator::Block::intersection_distance(float initial_rate, float final_rate, float acceleration, float distance)
     {
-        float distance = move_length();
-
-        trapezoid.distance = distance;
-        trapezoid.feedrate = feedrate;
-
-        float accelerate_distance = std::max(0.0f, estimate_acceleration_distance(feedrate.entry, feedrate.cruise, acceleration));
-        float decelerate_distance = std::max(0.0f, estimate_acceleration_distance(feedrate.cruise, feedrate.exit, -acceleration));
-        float cruise_distance = distance - accelerate_distance - decelerate_distance;
-
-        // Not enough space to reach the nominal feedrate.
-        // This means no cruising, and we'll have to use intersection_distance() to calculate when to abort acceleration 
-        // and start braking in order to reach the exit_feedrate exactly at the end of this block.
-        if (cruise_distance < 0.0f)
-        {
-            accelerate_distance = clamp(0.0f, distance, intersection_distance(feedrate.entry, feedrate.exit, acceleration, distance));
-            cruise_distance = 0.0f;
-            trapezoid.feedrate.cruise = Trapezoid::speed_from_distance(feedrate.entry, accelerate_distance, acceleration);
-        }
-
-        trapezoid.accelerate_until = accelerate_distance;
-        trapezoid.decelerate_after = accelerate_distance + cruise_distance;
+        return (acceleration == 0.0f) ? 0.0f : (2.0f * acceleration * distance - sqr(initial_rate) + sqr(final_rate)) / (4.0f * acceleration);
     }
 
-    float GCodeTimeEstimator::Block::max_allowable_speed(float acceleration, float target_velocity, float distance)
+    void GCodeTimeEstimator::PlannerBlocks::clear()
     {
-        // to avoid invalid negative numbers due to numerical imprecision 
-        float value = std::max(0.0f, sqr(target_velocity) - 2.0f * acceleration * distance);
-        return ::sqrt(value);
+        distance.clear();
+        acceleration.clear();
+        max_entry_speed.clear();
+        safe_feedrate.clear();
+        entry.clear();
+        cruise.clear();
+        nominal_length.clear();
+#if ENABLE_MOVE_STATS
+        move_type.clear();
+#endif // ENABLE_MOVE_STATS
     }
 
-    float GCodeTimeEstimator::Block::estimate_acceleration_distance(float initial_rate, float target_rate, float acceleration)
+    void GCodeTimeEstimator::PlannerBlocks::erase_front(size_t num_blocks)
     {
-        return (acceleration == 0.0f) ? 0.0f : (sqr(target_rate) - sqr(initial_rate)) / (2.0f * acceleration);
+        distance.erase(distance.begin(), distance.begin() + num_blocks);
+        acceleration.erase(acceleration.begin(), acceleration.begin() + num_blocks);
+        max_entry_speed.erase(max_entry_speed.begin(), max_entry_speed.begin() + num_blocks);
+        safe_feedrate.erase(safe_feedrate.begin(), safe_feedrate.begin() + num_blocks);
+        entry.erase(entry.begin(), entry.begin() + num_blocks);
+        cruise.erase(cruise.begin(), cruise.begin() + num_blocks);
+        nominal_length.erase(nominal_length.begin(), nominal_length.begin() + num_blocks);
+#if ENABLE_MOVE_STATS
+        move_type.erase(move_type.begin(), move_type.begin() + num_blocks);
+#endif // ENABLE_MOVE_STATS
     }
 
-    float GCodeTimeEstimator::Block::intersection_distance(float initial_rate, float final_rate, float acceleration, float distance)
+    size_t GCodeTimeEstimator::PlannerBlocks::memory_used() const
     {
-        return (acceleration == 0.0f) ? 0.0f : (2.0f * acceleration * distance - sqr(initial_rate) + sqr(final_rate)) / (4.0f * acceleration);
+        size_t out = 0;
+        out += SLIC3R_STDVEC_MEMSIZE(this->distance, float);
+        out += SLIC3R_STDVEC_MEMSIZE(this->acceleration, float);
+        out += SLIC3R_STDVEC_MEMSIZE(this->max_entry_speed, float);
+        out += SLIC3R_STDVEC_MEMSIZE(this->safe_feedrate, float);
+        out += SLIC3R_STDVEC_MEMSIZE(this->entry, float);
+        out += SLIC3R_STDVEC_MEMSIZE(this->cruise, float);
+        out += SLIC3R_STDVEC_MEMSIZE(this->nominal_length, unsigned char);
+#if ENABLE_MOVE_STATS
+        out += SLIC3R_STDVEC_MEMSIZE(this->move_type, Block::EMoveType);
+#endif // ENABLE_MOVE_STATS
+        return out;
     }
 
 #if ENABLE_MOVE_STATS
@@ -178,8 +169,9 @@ namespace Slic3r {
     GCodeTimeEstimator::GCodeTimeEstimator(EMode mode)
         : m_mode(mode)
     {
-        reset();
+        // set_default() first, so that reset() sees the default E positioning type.
         set_default();
+        reset();
     }
 
     void GCodeTimeEstimator::add_gcode_line(const std::string& gcode_line)
@@ -202,14 +194,9 @@ namespace Slic3r {
         }
     }
 
-    void GCodeTimeEstimator::calculate_time(bool start_from_beginning)
+    void GCodeTimeEstimator::calculate_time()
     {
         PROFILE_FUNC();
-        if (start_from_beginning)
-        {
-            _reset_time();
-            m_last_st_synchronized_block_id = -1;
-        }
         _calculate_time();
 
         if (m_needs_color_times && (m_color_time_cache != 0.0f))
@@ -271,145 +258,197 @@ namespace Slic3r {
 #endif // ENABLE_MOVE_STATS
     }
 
-    bool GCodeTimeEstimator::post_process(const std::string& filename, float interval_sec, const PostProcessData* const normal_mode, const PostProcessData* const silent_mode)
-    {
-        boost::nowide::ifstream in(filename);
-        if (!in.good())
-            throw std::runtime_error(std::string("Time estimator post process export failed.\nCannot open file for reading.\n"));
-
-        std::string path_tmp = filename + ".postprocess";
+    // Length of the M73 lines written by the post processor including the new line character, long enough for "M73 Q100 S" followed
+    // by the remaining minutes. The lines are padded with spaces, so that the remaining times may be filled in at the end of the export.
+    static const size_t M73_LINE_LENGTH = 24;
 
-        FILE* out = boost::nowide::fopen(path_tmp.c_str(), "wb");
-        if (out == nullptr)
-            throw std::runtime_error(std::string("Time estimator post process export failed.\nCannot open file for writing.\n"));
+    static int64_t ftell_64(FILE *f)
+    {
+#ifdef _WIN32
+        return _ftelli64(f);
+#else
+        return ftello(f);
+#endif
+    }
 
-        std::string normal_time_mask = "M73 P%s R%s\n";
-        std::string silent_time_mask = "M73 Q%s S%s\n";
-        char line_M73[64];
+    static int fseek_64(FILE *f, int64_t offset, int origin)
+    {
+#ifdef _WIN32
+        return _fseeki64(f, offset, origin);
+#else
+        return fseeko(f, off_t(offset), origin);
+#endif
+    }
 
-        std::string gcode_line;
-        // buffer line to export only when greater than 64K to reduce writing calls
-        std::string export_line;
+    GCodeTimeEstimator::PostProcessor::PostProcessor(FILE *out, float interval_sec, const GCodeTimeEstimator* const normal_mode, const GCodeTimeEstimator* const silent_mode) :
+        m_out(out), m_interval_sec(interval_sec)
+    {
+        m_normal.estimator = normal_mode;
+        m_normal.time_mask = "M73 P%d R%s";
+        m_silent.estimator = silent_mode;
+        m_silent.time_mask = "M73 Q%d S%s";
+        m_export_buffer.reserve(65536 + 4096);
+        m_export_buffer_pos = std::max<int64_t>(0, ftell_64(out));
+    }
 
-        // helper function to write to disk
-        auto write_string = [&](const std::string& str) {
-            fwrite((const void*)export_line.c_str(), 1, export_line.length(), out);
-            if (ferror(out))
-            {
-                in.close();
-                fclose(out);
-                boost::nowide::remove(path_tmp.c_str());
-                throw std::runtime_error(std::string("Time estimator post process export failed.\nIs the disk full?\n"));
-            }
-            export_line.clear();
-        };
+    void GCodeTimeEstimator::PostProcessor::process(const char *data, size_t len)
+    {
+        m_pending.append(data, len);
+        const char *begin = m_pending.data() + m_pending_start;
+        const char *end   = m_pending.data() + m_pending.size();
+        for (;;) {
+            const char *eol = static_cast<const char*>(::memchr(begin, '\n', end - begin));
+            // Stop at an unterminated line, it will be completed by the next chunk,
+            // or at a G1 line not finalized by the time estimators yet.
+            if (eol == nullptr || ! this->process_line(begin, eol, false))
+                break;
+            begin = eol + 1;
+        }
+        m_pending_start = begin - m_pending.data();
+        // Release the processed G-code once it makes up for the greater part of the buffer, so that the G-code is moved just a few times.
+        if (m_pending_start > 65536 && m_pending_start * 2 > m_pending.size()) {
+            m_pending.erase(0, m_pending_start);
+            m_pending_start = 0;
+        }
+    }
 
-        GCodeReader parser;
-        unsigned int g1_lines_count = 0;
-        int normal_g1_line_id = 0;
-        float normal_last_recorded_time = 0.0f;
-        int silent_g1_line_id = 0;
-        float silent_last_recorded_time = 0.0f;
-
-        // helper function to process g1 lines
-        auto process_g1_line = [&](const PostProcessData* const data, const GCodeReader::GCodeLine& line, int& g1_line_id, float& last_recorded_time, const std::string& time_mask) {
-            if (data == nullptr)
-                return;
-
-            assert((g1_line_id >= (int)data->g1_line_ids.size()) || (data->g1_line_ids[g1_line_id].first >= g1_lines_count));
-            const Block* block = nullptr;
-            if (g1_line_id < (int)data->g1_line_ids.size())
-            {
-                const G1LineIdToBlockId& map_item = data->g1_line_ids[g1_line_id];
-                if (map_item.first == g1_lines_count)
-                {
-                    if (line.has_e() && (map_item.second < (unsigned int)data->blocks.size()))
-                        block = &data->blocks[map_item.second];
-                    ++g1_line_id;
-                }
+    void GCodeTimeEstimator::PostProcessor::finalize()
+    {
+        // The time estimators calculated the time, all their blocks are finalized.
+        const char *begin = m_pending.data() + m_pending_start;
+        const char *end   = m_pending.data() + m_pending.size();
+        while (begin < end) {
+            const char *eol = static_cast<const char*>(::memchr(begin, '\n', end - begin));
+            if (eol == nullptr)
+                eol = end;
+            this->process_line(begin, eol, true);
+            begin = eol + 1;
+        }
+        m_pending.clear();
+        m_pending_start = 0;
+        this->flush();
+
+        // Fill in the remaining times of the M73 lines.
+        if (! m_M73_lines.empty()) {
+            char line_M73[M73_LINE_LENGTH + 64];
+            for (const M73Line &line : m_M73_lines) {
+                float time = line.mode->estimator->get_time();
+                int   len  = sprintf(line_M73, line.mode->time_mask, (time > 0.0f) ? (int)(100.0f * line.elapsed_time / time) : 0, _get_time_minutes(time - line.elapsed_time).c_str());
+                assert(len > 0 && len < (int)M73_LINE_LENGTH);
+                if (fseek_64(m_out, line.file_pos, SEEK_SET) != 0 || fwrite(line_M73, 1, std::min<size_t>(len, M73_LINE_LENGTH - 1), m_out) == 0)
+                    break;
             }
+            fseek_64(m_out, 0, SEEK_END);
+            m_M73_lines.clear();
+        }
+        if (ferror(m_out))
+            throw std::runtime_error(std::string("Time estimator post process export failed.\nIs the disk full?\n"));
+    }
 
-            if ((block != nullptr) && (block->elapsed_time != -1.0f))
-            {
-                float block_remaining_time = data->time - block->elapsed_time;
-                if (std::abs(last_recorded_time - block_remaining_time) > interval_sec)
-                {
-                    sprintf(line_M73, time_mask.c_str(), std::to_string((int)(100.0f * block->elapsed_time / data->time)).c_str(), _get_time_minutes(block_remaining_time).c_str());
-                    gcode_line += line_M73;
+    bool GCodeTimeEstimator::PostProcessor::g1_line_ready(const ModeData &mode, unsigned int g1_line_id) const
+    {
+        if (mode.estimator == nullptr)
+            return true;
+        const G1LineIdToBlockIdMap &g1_line_ids = mode.estimator->m_g1_line_ids;
+        return mode.g1_line_id >= g1_line_ids.size() || g1_line_ids[mode.g1_line_id].first != g1_line_id ||
+            g1_line_ids[mode.g1_line_id].second < mode.estimator->m_block_times.size();
+    }
 
-                    last_recorded_time = block_remaining_time;
-                }
-            }
-        };
+    void GCodeTimeEstimator::PostProcessor::process_g1_line(ModeData &mode, unsigned int g1_line_id, const GCodeReader::GCodeLine &line)
+    {
+        const GCodeTimeEstimator *estimator = mode.estimator;
+        if (estimator == nullptr)
+            return;
 
-        while (std::getline(in, gcode_line))
+        const G1LineIdToBlockIdMap &g1_line_ids = estimator->m_g1_line_ids;
+        assert((mode.g1_line_id >= g1_line_ids.size()) || (g1_line_ids[mode.g1_line_id].first >= g1_line_id));
+        const float* elapsed_time = nullptr;
+        if (mode.g1_line_id < g1_line_ids.size())
         {
-            if (!in.good())
-            {
-                fclose(out);
-                throw std::runtime_error(std::string("Time estimator post process export failed.\nError while reading from file.\n"));
-            }
-
-            // check tags
-            // remove color change tag
-            if (gcode_line == "; " + Color_Change_Tag)
-                continue;
-
-            // replaces placeholders for initial line M73 with the real lines
-            if ((normal_mode != nullptr) && (gcode_line == Normal_First_M73_Output_Placeholder_Tag))
-            {
-                sprintf(line_M73, normal_time_mask.c_str(), "0", _get_time_minutes(normal_mode->time).c_str());
-                gcode_line = line_M73;
-            }
-            else if ((silent_mode != nullptr) && (gcode_line == Silent_First_M73_Output_Placeholder_Tag))
+            const G1LineIdToBlockId& map_item = g1_line_ids[mode.g1_line_id];
+            if (map_item.first == g1_line_id)
             {
-                sprintf(line_M73, silent_time_mask.c_str(), "0", _get_time_minutes(silent_mode->time).c_str());
-                gcode_line = line_M73;
+                if (line.has_e() && (map_item.second < (unsigned int)estimator->m_block_times.size()))
+                    elapsed_time = &estimator->m_block_times[map_item.second];
+                ++mode.g1_line_id;
             }
-            // replaces placeholders for final line M73 with the real lines
-            else if ((normal_mode != nullptr) && (gcode_line == Normal_Last_M73_Output_Placeholder_Tag))
-            {
-                sprintf(line_M73, normal_time_mask.c_str(), "100", "0");
-                gcode_line = line_M73;
-            }
-            else if ((silent_mode != nullptr) && (gcode_line == Silent_Last_M73_Output_Placeholder_Tag))
-            {
-                sprintf(line_M73, silent_time_mask.c_str(), "100", "0");
-                gcode_line = line_M73;
-            }
-            else
-                gcode_line += "\n";
-
-            // add remaining time lines where needed
-            parser.parse_line(gcode_line,
-                [&](GCodeReader& reader, const GCodeReader::GCodeLine& line)
-                {
-                    if (line.cmd_is("G1"))
-                    {
-                        ++g1_lines_count;
-                        process_g1_line(silent_mode, line, silent_g1_line_id, silent_last_recorded_time, silent_time_mask);
-                        process_g1_line(normal_mode, line, normal_g1_line_id, normal_last_recorded_time, normal_time_mask);
-                    }
-                });
+        }
 
-            export_line += gcode_line;
-            if (export_line.length() > 65535)
-                write_string(export_line);
+        // The first M73 line is placed at the first extrusion, the next ones whenever the print advanced by the interval.
+        if (elapsed_time != nullptr && (mode.last_recorded_time < 0.0f || *elapsed_time - mode.last_recorded_time > m_interval_sec))
+        {
+            this->write_M73_line(mode, *elapsed_time);
+            mode.last_recorded_time = *elapsed_time;
         }
+    }
 
-        if (!export_line.empty())
-            write_string(export_line);
+    void GCodeTimeEstimator::PostProcessor::write_M73_line(const ModeData &mode, float elapsed_time)
+    {
+        m_M73_lines.push_back({ m_export_buffer_pos + (int64_t)m_export_buffer.size(), &mode, elapsed_time });
+        // Placeholder with the mode letters, the values are filled in by finalize().
+        m_export_buffer.append(mode.time_mask, 5);
+        m_export_buffer.append(M73_LINE_LENGTH - 6, ' ');
+        m_export_buffer += '\n';
+    }
+
+    bool GCodeTimeEstimator::PostProcessor::process_line(const char *begin, const char *end, bool finalizing)
+    {
+        m_gcode_line.assign(begin, end);
 
-        fclose(out);
-        in.close();
+        // check tags
+        // remove color change tag
+        if (m_gcode_line.size() == Color_Change_Tag.size() + 2 && boost::starts_with(m_gcode_line, "; ") && boost::ends_with(m_gcode_line, Color_Change_Tag))
+            return true;
 
-        if (rename_file(path_tmp, filename))
-            throw std::runtime_error(std::string("Failed to rename the output G-code file from ") + path_tmp + " to " + filename + '\n' +
-                "Is " + path_tmp + " locked?" + '\n');
+        // replaces placeholders for initial line M73 with the lines to be filled in with the total time
+        if ((m_normal.estimator != nullptr) && (m_gcode_line == Normal_First_M73_Output_Placeholder_Tag))
+            this->write_M73_line(m_normal, 0.0f);
+        else if ((m_silent.estimator != nullptr) && (m_gcode_line == Silent_First_M73_Output_Placeholder_Tag))
+            this->write_M73_line(m_silent, 0.0f);
+        // replaces placeholders for final line M73 with the real lines
+        else if ((m_normal.estimator != nullptr) && (m_gcode_line == Normal_Last_M73_Output_Placeholder_Tag))
+            m_export_buffer += "M73 P100 R0\n";
+        else if ((m_silent.estimator != nullptr) && (m_gcode_line == Silent_Last_M73_Output_Placeholder_Tag))
+            m_export_buffer += "M73 Q100 S0\n";
+        else
+        {
+            // add remaining time lines where needed
+            GCodeReader::GCodeLine gline;
+            bool is_G1 = false;
+            auto action = [&is_G1](GCodeReader&, const GCodeReader::GCodeLine& line) { is_G1 = line.cmd_is("G1"); };
+            m_parser.parse_line(m_gcode_line.c_str(), gline, action);
+            unsigned int g1_line_id = m_g1_lines_count + 1;
+            if (is_G1 && ! finalizing && ! (this->g1_line_ready(m_silent, g1_line_id) && this->g1_line_ready(m_normal, g1_line_id)))
+                // The time estimators did not calculate the elapsed time of this line yet, hold it back.
+                // Parsing the line again later is harmless, the positions tracked by the parser are not used here.
+                return false;
+
+            m_export_buffer.append(m_gcode_line);
+            m_export_buffer += '\n';
+            if (is_G1)
+            {
+                m_g1_lines_count = g1_line_id;
+                this->process_g1_line(m_silent, g1_line_id, gline);
+                this->process_g1_line(m_normal, g1_line_id, gline);
+            }
+        }
 
+        if (m_export_buffer.length() > 65535)
+            this->flush();
         return true;
     }
 
+    void GCodeTimeEstimator::PostProcessor::flush()
+    {
+        if (m_export_buffer.empty())
+            return;
+        fwrite((const void*)m_export_buffer.data(), 1, m_export_buffer.length(), m_out);
+        if (ferror(m_out))
+            throw std::runtime_error(std::string("Time estimator post process export failed.\nIs the disk full?\n"));
+        m_export_buffer_pos += (int64_t)m_export_buffer.length();
+        m_export_buffer.clear();
+    }
+
     void GCodeTimeEstimator::set_axis_position(EAxis axis, float position)
     {
         m_state.axis[axis].position = position;
@@ -758,7 +797,8 @@ namespace Slic3r {
 	size_t GCodeTimeEstimator::memory_used() const
     {
         size_t out = sizeof(*this);
-		out += SLIC3R_STDVEC_MEMSIZE(this->m_blocks, Block);
+		out += m_planner_blocks.memory_used();
+		out += SLIC3R_STDVEC_MEMSIZE(this->m_block_times, float);
 		out += SLIC3R_STDVEC_MEMSIZE(this->m_g1_line_ids, G1LineIdToBlockId);
         return out;
     }
@@ -774,6 +814,7 @@ namespace Slic3r {
         set_axis_origin(X, 0.0f);
         set_axis_origin(Y, 0.0f);
         set_axis_origin(Z, 0.0f);
+        set_axis_origin(E, 0.0f);
 
         if (get_e_local_positioning_type() == Absolute)
             set_axis_position(E, 0.0f);
@@ -784,8 +825,6 @@ namespace Slic3r {
         reset_g1_line_id();
         m_g1_line_ids.clear();
 
-        m_last_st_synchronized_block_id = -1;
-
         m_needs_color_times = false;
         m_color_times.clear();
         m_color_time_cache = 0.0f;
@@ -798,42 +837,19 @@ namespace Slic3r {
 
     void GCodeTimeEstimator::_reset_blocks()
     {
-        m_blocks.clear();
+        m_planner_blocks.clear();
+        m_planner_barrier = 0;
+        m_block_times.clear();
     }
 
     void GCodeTimeEstimator::_calculate_time()
     {
         PROFILE_FUNC();
-        _forward_pass();
-        _reverse_pass();
-        _recalculate_trapezoids();
+        _finalize_blocks(m_planner_blocks.size());
 
+        // The additional time (dwells, tool changes, filament loading and unloading) follows the moves planned so far.
         m_time += get_additional_time();
         m_color_time_cache += get_additional_time();
-
-        for (int i = m_last_st_synchronized_block_id + 1; i < (int)m_blocks.size(); ++i)
-        {
-            Block& block = m_blocks[i];
-            float block_time = 0.0f;
-            block_time += block.acceleration_time();
-            block_time += block.cruise_time();
-            block_time += block.deceleration_time();
-            m_time += block_time;
-            block.elapsed_time = m_time;
-
-#if ENABLE_MOVE_STATS
-            MovesStatsMap::iterator it = _moves_stats.find(block.move_type);
-            if (it == _moves_stats.end())
-                it = _moves_stats.insert(MovesStatsMap::value_type(block.move_type, MoveStats())).first;
-
-            it->second.count += 1;
-            it->second.time += block_time;
-#endif // ENABLE_MOVE_STATS
-
-            m_color_time_cache += block_time;
-        }
-
-        m_last_st_synchronized_block_id = (int)m_blocks.size() - 1;
         // The additional time has been consumed (added to the total time), reset it to zero.
         set_additional_time(0.);
     }
@@ -1006,31 +1022,35 @@ namespace Slic3r {
         if (line.has_f())
             set_feedrate(std::max(line.f() * MMMIN_TO_MMSEC, get_minimum_feedrate()));
 
-        // fills block data
-        Block block;
-
         // calculates block movement deltas
+        float delta_pos[Num_Axis]; // mm
         float max_abs_delta = 0.0f;
         for (unsigned char a = X; a < Num_Axis; ++a)
         {
-            block.delta_pos[a] = new_pos[a] - get_axis_position((EAxis)a);
-            max_abs_delta = std::max(max_abs_delta, std::abs(block.delta_pos[a]));
+            delta_pos[a] = new_pos[a] - get_axis_position((EAxis)a);
+            max_abs_delta = std::max(max_abs_delta, std::abs(delta_pos[a]));
         }
 
         // is it a move ?
         if (max_abs_delta == 0.0f)
             return;
 
+        bool is_travel_move = delta_pos[E] == 0.0f;
+        bool is_extruder_only_move = (delta_pos[X] == 0.0f) && (delta_pos[Y] == 0.0f) && (delta_pos[Z] == 0.0f) && (delta_pos[E] != 0.0f);
+
         // calculates block feedrate
-        m_curr.feedrate = std::max(get_feedrate(), block.is_travel_move() ? get_minimum_travel_feedrate() : get_minimum_feedrate());
+        m_curr.feedrate = std::max(get_feedrate(), is_travel_move ? get_minimum_travel_feedrate() : get_minimum_feedrate());
 
-        float distance = block.move_length();
+        // block move length
+        float distance = ::sqrt(sqr(delta_pos[X]) + sqr(delta_pos[Y]) + sqr(delta_pos[Z]));
+        if (distance <= 0.0f)
+            distance = std::abs(delta_pos[E]);
         float invDistance = 1.0f / distance;
 
         float min_feedrate_factor = 1.0f;
         for (unsigned char a = X; a < Num_Axis; ++a)
         {
-            m_curr.axis_feedrate[a] = m_curr.feedrate * block.delta_pos[a] * invDistance;
+            m_curr.axis_feedrate[a] = m_curr.feedrate * delta_pos[a] * invDistance;
             if (a == E)
                 m_curr.axis_feedrate[a] *= get_extrude_factor_override_percentage();
 
@@ -1039,7 +1059,7 @@ namespace Slic3r {
                 min_feedrate_factor = std::min(min_feedrate_factor, get_axis_max_feedrate((EAxis)a) / m_curr.abs_axis_feedrate[a]);
         }
         
-        block.feedrate.cruise = min_feedrate_factor * m_curr.feedrate;
+        float cruise_feedrate = min_feedrate_factor * m_curr.feedrate;
 
         if (min_feedrate_factor < 1.0f)
         {
@@ -1051,19 +1071,17 @@ namespace Slic3r {
         }
 
         // calculates block acceleration
-        float acceleration = block.is_extruder_only_move() ? get_retract_acceleration() : get_acceleration();
+        float acceleration = is_extruder_only_move ? get_retract_acceleration() : get_acceleration();
 
         for (unsigned char a = X; a < Num_Axis; ++a)
         {
             float axis_max_acceleration = get_axis_max_acceleration((EAxis)a);
-            if (acceleration * std::abs(block.delta_pos[a]) * invDistance > axis_max_acceleration)
+            if (acceleration * std::abs(delta_pos[a]) * invDistance > axis_max_acceleration)
                 acceleration = axis_max_acceleration;
         }
 
-        block.acceleration = acceleration;
-
         // calculates block exit feedrate
-        m_curr.safe_feedrate = block.feedrate.cruise;
+        m_curr.safe_feedrate = cruise_feedrate;
 
         for (unsigned char a = X; a < Num_Axis; ++a)
         {
@@ -1072,16 +1090,14 @@ namespace Slic3r {
                 m_curr.safe_feedrate = std::min(m_curr.safe_feedrate, axis_max_jerk);
         }
 
-        block.feedrate.exit = m_curr.safe_feedrate;
-
         // calculates block entry feedrate
         float vmax_junction = m_curr.safe_feedrate;
-        if (!m_blocks.empty() && (m_prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD))
+        if ((! m_block_times.empty() || ! m_planner_blocks.empty()) && (m_prev.feedrate > PREVIOUS_FEEDRATE_THRESHOLD))
         {
-            bool prev_speed_larger = m_prev.feedrate > block.feedrate.cruise;
-            float smaller_speed_factor = prev_speed_larger ? (block.feedrate.cruise / m_prev.feedrate) : (m_prev.feedrate / block.feedrate.cruise);
+            bool prev_speed_larger = m_prev.feedrate > cruise_feedrate;
+            float smaller_speed_factor = prev_speed_larger ? (cruise_feedrate / m_prev.feedrate) : (m_prev.feedrate / cruise_feedrate);
             // Pick the smaller of the nominal speeds. Higher speed shall not be achieved at the junction during coasting.
-            vmax_junction = prev_speed_larger ? block.feedrate.cruise : m_prev.feedrate;
+            vmax_junction = prev_speed_larger ? cruise_feedrate : m_prev.feedrate;
 
             float v_factor = 1.0f;
             bool limited = false;
@@ -1137,15 +1153,6 @@ namespace Slic3r {
         }
 
         float v_allowable = Block::max_allowable_speed(-acceleration, m_curr.safe_feedrate, distance);
-        block.feedrate.entry = std::min(vmax_junction, v_allowable);
-
-        block.max_entry_speed = vmax_junction;
-        block.flags.nominal_length = (block.feedrate.cruise <= v_allowable);
-        block.flags.recalculate = true;
-        block.safe_feedrate = m_curr.safe_feedrate;
-
-        // calculates block trapezoid
-        block.calculate_trapezoid();
 
         // updates previous
         m_prev = m_curr;
@@ -1156,31 +1163,66 @@ namespace Slic3r {
             set_axis_position((EAxis)a, new_pos[a]);
         }
 
+        // adds block to the planner
+        PlannerBlocks &blocks = m_planner_blocks;
+        blocks.distance.emplace_back(distance);
+        blocks.acceleration.emplace_back(acceleration);
+        blocks.max_entry_speed.emplace_back(vmax_junction);
+        blocks.safe_feedrate.emplace_back(m_curr.safe_feedrate);
+        blocks.entry.emplace_back(std::min(vmax_junction, v_allowable));
+        blocks.cruise.emplace_back(cruise_feedrate);
+        blocks.nominal_length.emplace_back(cruise_feedrate <= v_allowable);
+
 #if ENABLE_MOVE_STATS
         // detects block move type
-        block.move_type = Block::Noop;
+        Block::EMoveType move_type = Block::Noop;
 
-        if (block.delta_pos[E] < 0.0f)
+        if (delta_pos[E] < 0.0f)
         {
-            if ((block.delta_pos[X] != 0.0f) || (block.delta_pos[Y] != 0.0f) || (block.delta_pos[Z] != 0.0f))
-                block.move_type = Block::Move;
+            if ((delta_pos[X] != 0.0f) || (delta_pos[Y] != 0.0f) || (delta_pos[Z] != 0.0f))
+                move_type = Block::Move;
             else
-                block.move_type = Block::Retract;
+                move_type = Block::Retract;
         }
-        else if (block.delta_pos[E] > 0.0f)
+        else if (delta_pos[E] > 0.0f)
         {
-            if ((block.delta_pos[X] == 0.0f) && (block.delta_pos[Y] == 0.0f) && (block.delta_pos[Z] == 0.0f))
-                block.move_type = Block::Unretract;
-            else if ((block.delta_pos[X] != 0.0f) || (block.delta_pos[Y] != 0.0f))
-                block.move_type = Block::Extrude;
+            if ((delta_pos[X] == 0.0f) && (delta_pos[Y] == 0.0f) && (delta_pos[Z] == 0.0f))
+                move_type = Block::Unretract;
+            else if ((delta_pos[X] != 0.0f) || (delta_pos[Y] != 0.0f))
+                move_type = Block::Extrude;
         }
-        else if ((block.delta_pos[X] != 0.0f) || (block.delta_pos[Y] != 0.0f) || (block.delta_pos[Z] != 0.0f))
-            block.move_type = Block::Move;
+        else if ((delta_pos[X] != 0.0f) || (delta_pos[Y] != 0.0f) || (delta_pos[Z] != 0.0f))
+            move_type = Block::Move;
+
+        blocks.move_type.emplace_back(move_type);
 #endif // ENABLE_MOVE_STATS
 
-        // adds block to blocks list
-        m_blocks.emplace_back(block);
-        m_g1_line_ids.emplace_back(G1LineIdToBlockIdMap::value_type(get_g1_line_id(), (unsigned int)m_blocks.size() - 1));
+        m_g1_line_ids.emplace_back(G1LineIdToBlockIdMap::value_type(get_g1_line_id(), (unsigned int)(m_block_times.size() + blocks.size()) - 1));
+
+        // The forward pass of the planner only depends on the preceding blocks, thus it is applied as soon as a block is added.
+        size_t idx = blocks.size() - 1;
+        if (idx > 0)
+        {
+            _planner_forward_pass_kernel(idx - 1, idx);
+            // A block entering at its maximum entry speed will not be modified by the reverse pass,
+            // thus the reverse pass of the blocks preceding it does not depend on the blocks following it.
+            if (blocks.entry[idx] == blocks.max_entry_speed[idx])
+                m_planner_barrier = idx;
+            // The reverse pass sets the entry speed of the previous block to its maximum whatever the blocks following it, if the block
+            // is long enough to decelerate from its maximum entry speed to a full stop. Its forward pass is done, thus its entry speed is set now.
+            else if (idx > 1 && blocks.entry[idx - 1] != blocks.max_entry_speed[idx - 1] &&
+                (blocks.nominal_length[idx - 1] || Block::max_allowable_speed(-blocks.acceleration[idx - 1], 0.0f, blocks.distance[idx - 1]) >= blocks.max_entry_speed[idx - 1]))
+            {
+                blocks.entry[idx - 1] = blocks.max_entry_speed[idx - 1];
+                m_planner_barrier = idx - 1;
+            }
+            // Finalize the blocks in chunks to release the memory early and to amortize the cost of the planner passes.
+            if (m_planner_barrier > 0 && blocks.size() >= PLANNER_CHUNK_SIZE)
+                _finalize_blocks(m_planner_barrier);
+            else if (blocks.size() >= PLANNER_MAX_BLOCKS)
+                // Limit the memory and the G-code held back by the post processor, the estimate of the blocks at the cut deviates slightly.
+                _finalize_blocks(blocks.size() - PLANNER_CHUNK_SIZE);
+        }
     }
 
     void GCodeTimeEstimator::_processG4(const GCodeReader::GCodeLine& line)
@@ -1488,107 +1530,91 @@ namespace Slic3r {
         _calculate_time();
     }
 
-    void GCodeTimeEstimator::_forward_pass()
+    void GCodeTimeEstimator::_finalize_blocks(size_t num_blocks)
     {
         PROFILE_FUNC();
-        if (m_blocks.size() > 1)
+        PlannerBlocks &blocks = m_planner_blocks;
+        size_t         size   = blocks.size();
+        assert(num_blocks <= size);
+        assert(num_blocks == size || blocks.entry[num_blocks] == blocks.max_entry_speed[num_blocks] || size >= PLANNER_MAX_BLOCKS);
+        if (num_blocks == 0)
+            return;
+
+        // Reverse pass. The last block of the planner is never modified, neither the barrier block at num_blocks.
+        for (size_t curr = std::min(num_blocks, size - 1); curr -- > 0;)
+            _planner_reverse_pass_kernel(curr, curr + 1);
+
+        // Trapezoids and times. The exit feedrate of a block is the entry feedrate of the next block,
+        // the last block in buffer stops at its safe feedrate.
+        size_t first_block_id = m_block_times.size();
+        m_block_times.resize(first_block_id + num_blocks);
+        float       *times           = m_block_times.data() + first_block_id;
+        const float *distance        = blocks.distance.data();
+        const float *acceleration    = blocks.acceleration.data();
+        const float *entry           = blocks.entry.data();
+        const float *cruise          = blocks.cruise.data();
+        size_t       num_inner_blocks = std::min(num_blocks, size - 1);
+        for (size_t i = 0; i < num_inner_blocks; ++ i)
+            times[i] = Block::trapezoid_time(distance[i], acceleration[i], entry[i], cruise[i], entry[i + 1]);
+        if (num_inner_blocks < num_blocks)
+            times[num_inner_blocks] = Block::trapezoid_time(distance[num_inner_blocks], acceleration[num_inner_blocks], entry[num_inner_blocks], cruise[num_inner_blocks], blocks.safe_feedrate[num_inner_blocks]);
+
+#if ENABLE_MOVE_STATS
+        for (size_t i = 0; i < num_blocks; ++ i)
         {
-            for (int i = m_last_st_synchronized_block_id + 1; i < (int)m_blocks.size() - 1; ++i)
-            {
-                _planner_forward_pass_kernel(m_blocks[i], m_blocks[i + 1]);
-            }
+            MovesStatsMap::iterator it = _moves_stats.find(blocks.move_type[i]);
+            if (it == _moves_stats.end())
+                it = _moves_stats.insert(MovesStatsMap::value_type(blocks.move_type[i], MoveStats())).first;
+
+            it->second.count += 1;
+            it->second.time += times[i];
         }
-    }
+#endif // ENABLE_MOVE_STATS
 
-    void GCodeTimeEstimator::_reverse_pass()
-    {
-        PROFILE_FUNC();
-        if (m_blocks.size() > 1)
+        // Durations to the elapsed times.
+        for (size_t i = 0; i < num_blocks; ++ i)
         {
-            for (int i = (int)m_blocks.size() - 1; i >= m_last_st_synchronized_block_id + 2; --i)
-            {
-                _planner_reverse_pass_kernel(m_blocks[i - 1], m_blocks[i]);
-            }
+            float block_time = times[i];
+            m_time += block_time;
+            m_color_time_cache += block_time;
+            times[i] = m_time;
         }
+
+        if (num_blocks == size)
+            blocks.clear();
+        else
+            blocks.erase_front(num_blocks);
+        m_planner_barrier = 0;
     }
 
-    void GCodeTimeEstimator::_planner_forward_pass_kernel(Block& prev, Block& curr)
+    void GCodeTimeEstimator::_planner_forward_pass_kernel(size_t prev, size_t curr)
     {
-        PROFILE_FUNC();
+        PlannerBlocks &blocks = m_planner_blocks;
         // If the previous block is an acceleration block, but it is not long enough to complete the
         // full speed change within the block, we need to adjust the entry speed accordingly. Entry
         // speeds have already been reset, maximized, and reverse planned by reverse planner.
         // If nominal length is true, max junction speed is guaranteed to be reached. No need to recheck.
-        if (!prev.flags.nominal_length)
+        if (! blocks.nominal_length[prev])
         {
-            if (prev.feedrate.entry < curr.feedrate.entry)
-            {
-                float entry_speed = std::min(curr.feedrate.entry, Block::max_allowable_speed(-prev.acceleration, prev.feedrate.entry, prev.move_length()));
-
-                // Check for junction speed change
-                if (curr.feedrate.entry != entry_speed)
-                {
-                    curr.feedrate.entry = entry_speed;
-                    curr.flags.recalculate = true;
-                }
-            }
+            if (blocks.entry[prev] < blocks.entry[curr])
+                blocks.entry[curr] = std::min(blocks.entry[curr], Block::max_allowable_speed(-blocks.acceleration[prev], blocks.entry[prev], blocks.distance[prev]));
         }
     }
 
-    void GCodeTimeEstimator::_planner_reverse_pass_kernel(Block& curr, Block& next)
+    void GCodeTimeEstimator::_planner_reverse_pass_kernel(size_t curr, size_t next)
     {
+        PlannerBlocks &blocks = m_planner_blocks;
         // If entry speed is already at the maximum entry speed, no need to recheck. Block is cruising.
         // If not, block in state of acceleration or deceleration. Reset entry speed to maximum and
         // check for maximum allowable speed reductions to ensure maximum possible planned speed.
-        if (curr.feedrate.entry != curr.max_entry_speed)
+        if (blocks.entry[curr] != blocks.max_entry_speed[curr])
         {
             // If nominal length true, max junction speed is guaranteed to be reached. Only compute
             // for max allowable speed if block is decelerating and nominal length is false.
-            if (!curr.flags.nominal_length && (curr.max_entry_speed > next.feedrate.entry))
-                curr.feedrate.entry = std::min(curr.max_entry_speed, Block::max_allowable_speed(-curr.acceleration, next.feedrate.entry, curr.move_length()));
+            if (! blocks.nominal_length[curr] && (blocks.max_entry_speed[curr] > blocks.entry[next]))
+                blocks.entry[curr] = std::min(blocks.max_entry_speed[curr], Block::max_allowable_speed(-blocks.acceleration[curr], blocks.entry[next], blocks.distance[curr]));
             else
-                curr.feedrate.entry = curr.max_entry_speed;
-
-            curr.flags.recalculate = true;
-        }
-    }
-
-    void GCodeTimeEstimator::_recalculate_trapezoids()
-    {
-        PROFILE_FUNC();
-        Block* curr = nullptr;
-        Block* next = nullptr;
-
-        for (int i = m_last_st_synchronized_block_id + 1; i < (int)m_blocks.size(); ++i)
-        {
-            Block& b = m_blocks[i];
-
-            curr = next;
-            next = &b;
-
-            if (curr != nullptr)
-            {
-                // Recalculate if current block entry or exit junction speed has changed.
-                if (curr->flags.recalculate || next->flags.recalculate)
-                {
-                    // NOTE: Entry and exit factors always > 0 by all previous logic operations.
-                    Block block = *curr;
-                    block.feedrate.exit = next->feedrate.entry;
-                    block.calculate_trapezoid();
-                    curr->trapezoid = block.trapezoid;
-                    curr->flags.recalculate = false; // Reset current only to ensure next trapezoid is computed
-                }
-            }
-        }
-
-        // Last/newest block in buffer. Always recalculated.
-        if (next != nullptr)
-        {
-            Block block = *next;
-            block.feedrate.exit = next->safe_feedrate;
-            block.calculate_trapezoid();
-            next->trapezoid = block.trapezoid;
-            next->flags.recalculate = false;
+                blocks.entry[curr] = blocks.max_entry_speed[curr];
         }
     }
 
@@ -5,6 +5,8 @@
 #include "PrintConfig.hpp"
 #include "GCodeReader.hpp"
 
+#include <cstdio>
+
 #define ENABLE_MOVE_STATS 0
 
 namespace Slic3r {
@@ -99,6 +101,8 @@ namespace Slic3r {
         };
 
     public:
+        // Kinematics of a single planner block, following a trapezoidal feedrate profile:
+        // acceleration from the entry feedrate, cruise, deceleration to the exit feedrate.
         struct Block
         {
 #if ENABLE_MOVE_STATS
@@ -114,77 +118,15 @@ namespace Slic3r {
             };
 #endif // ENABLE_MOVE_STATS
 
-            struct FeedrateProfile
-            {
-                float entry;  // mm/s
-                float cruise; // mm/s
-                float exit;   // mm/s
-            };
-
-            struct Trapezoid
-            {
-                float distance;         // mm
-                float accelerate_until; // mm
-                float decelerate_after; // mm
-                FeedrateProfile feedrate;
-
-                float acceleration_time(float acceleration) const;
-                float cruise_time() const;
-                float deceleration_time(float acceleration) const;
-                float cruise_distance() const;
-
-                // This function gives the time needed to accelerate from an initial speed to reach a final distance.
-                static float acceleration_time_from_distance(float initial_feedrate, float distance, float acceleration);
-
-                // This function gives the final speed while accelerating at the given constant acceleration from the given initial speed along the given distance.
-                static float speed_from_distance(float initial_feedrate, float distance, float acceleration);
-            };
-
-            struct Flags
-            {
-                bool recalculate;
-                bool nominal_length;
-            };
-
-#if ENABLE_MOVE_STATS
-            EMoveType move_type;
-#endif // ENABLE_MOVE_STATS
-            Flags flags;
-
-            float delta_pos[Num_Axis]; // mm
-            float acceleration;        // mm/s^2
-            float max_entry_speed;     // mm/s
-            float safe_feedrate;       // mm/s
-
-            FeedrateProfile feedrate;
-            Trapezoid trapezoid;
-            float elapsed_time;
-
-            Block();
-
-            // Returns the length of the move covered by this block, in mm
-            float move_length() const;
-
-            // Returns true if this block is a retract/unretract move only
-            float is_extruder_only_move() const;
-
-            // Returns true if this block is a move with no extrusion
-            float is_travel_move() const;
-
-            // Returns the time spent accelerating toward cruise speed, in seconds
-            float acceleration_time() const;
-
-            // Returns the time spent at cruise speed, in seconds
-            float cruise_time() const;
+            // Returns the time, in seconds, needed to cover the given distance with the given nominal (cruise) feedrate,
+            // accelerating from the entry feedrate and decelerating to the exit feedrate.
+            static float trapezoid_time(float distance, float acceleration, float entry, float cruise, float exit);
 
-            // Returns the time spent decelerating from cruise speed, in seconds
-            float deceleration_time() const;
+            // This function gives the time needed to accelerate from an initial speed to reach a final distance.
+            static float acceleration_time_from_distance(float initial_feedrate, float distance, float acceleration);
 
-            // Returns the distance covered at cruise speed, in mm
-            float cruise_distance() const;
-
-            // Calculates this block's trapezoid
-            void calculate_trapezoid();
+            // This function gives the final speed while accelerating at the given constant acceleration from the given initial speed along the given distance.
+            static float speed_from_distance(float initial_feedrate, float distance, float acceleration);
 
             // Calculates the maximum allowable speed at this point when you must be able to reach target_velocity using the 
             // acceleration within the allotted distance.
@@ -200,7 +142,9 @@ namespace Slic3r {
             static float intersection_distance(float initial_rate, float final_rate, float acceleration, float distance);
         };
 
-        typedef std::vector<Block> BlocksList;
+        // Elapsed time from the start of the print at the end of each block, in seconds, indexed by the block id.
+        // The time of a block is final as soon as the block is finalized by the planner, see _finalize_blocks().
+        typedef std::vector<float> BlockTimesList;
 
 #if ENABLE_MOVE_STATS
         struct MoveStats
@@ -221,23 +165,120 @@ namespace Slic3r {
         struct PostProcessData
         {
             const G1LineIdToBlockIdMap& g1_line_ids;
-            const BlocksList& blocks;
+            const BlockTimesList& elapsed_times;
             float time;
 
-            PostProcessData(const G1LineIdToBlockIdMap& g1_line_ids, const BlocksList& blocks, float time) : g1_line_ids(g1_line_ids), blocks(blocks), time(time) {}
+            PostProcessData(const G1LineIdToBlockIdMap& g1_line_ids, const BlockTimesList& elapsed_times, float time) : g1_line_ids(g1_line_ids), elapsed_times(elapsed_times), time(time) {}
+        };
+
+        // Streaming post processor of the exported G-code:
+        // replaces the placeholders with the correspondent M73 lines,
+        // places new lines M73 (containing the remaining time) where needed (in dependence of the given interval in seconds)
+        // and removes the working tags (as those used for color changes).
+        // The G-code is fed in chunks of arbitrary size while it is being generated and written to the output file
+        // as soon as the time estimators finalized the planner blocks of its G1 lines. The G-code held back is limited
+        // to the moves kept by the planner, see PLANNER_MAX_BLOCKS in GCodeTimeEstimator.cpp.
+        // The remaining times are only known once the total time is calculated, thus the M73 lines are written as placeholders
+        // padded with spaces to a fixed width of 23 characters, into which finalize() writes the values. Compared to post processing
+        // the complete G-code, the M73 lines (except for the last one) end with trailing spaces and the first M73 line
+        // following the initial one is placed at the first extrusion even if the print takes less than the interval.
+        // The G-code has to be passed to the time estimators before it is passed to the post processor.
+        // if normal_mode == nullptr no M73 line will be added for normal mode
+        // if silent_mode == nullptr no M73 line will be added for silent mode
+        class PostProcessor
+        {
+        public:
+            PostProcessor(FILE *out, float interval_sec, const GCodeTimeEstimator* const normal_mode, const GCodeTimeEstimator* const silent_mode);
+
+            // Processes the given chunk of G-code, the chunk does not need to end at a line boundary.
+            void process(const char *data, size_t len);
+            void process(const std::string &str) { this->process(str.data(), str.size()); }
+            // Processes the G-code held back and the last unterminated line, writes all the pending data to the output file
+            // and fills in the remaining times of the M73 lines. To be called after the time estimators calculated the time.
+            // Throws if the output file could not be written.
+            void finalize();
+
+        private:
+            struct ModeData
+            {
+                const GCodeTimeEstimator   *estimator;
+                const char                 *time_mask;
+                size_t                      g1_line_id { 0 };
+                // Elapsed time of the last M73 line inserted, negative if none was inserted yet.
+                float                       last_recorded_time { -1.0f };
+            };
+
+            // M73 line written with a fixed width, to be filled in by finalize().
+            struct M73Line
+            {
+                int64_t                     file_pos;
+                const ModeData             *mode;
+                float                       elapsed_time;
+            };
+
+            // Returns false if the line is a G1 line, which has to wait for the time estimators to finalize its block.
+            bool process_line(const char *begin, const char *end, bool finalizing);
+            bool g1_line_ready(const ModeData &mode, unsigned int g1_line_id) const;
+            void process_g1_line(ModeData &mode, unsigned int g1_line_id, const GCodeReader::GCodeLine &line);
+            void write_M73_line(const ModeData &mode, float elapsed_time);
+            void flush();
+
+            FILE               *m_out;
+            float               m_interval_sec;
+            ModeData            m_normal;
+            ModeData            m_silent;
+            GCodeReader         m_parser;
+            unsigned int        m_g1_lines_count { 0 };
+            // G-code received, but not processed yet. The processed part at its start is erased lazily.
+            std::string         m_pending;
+            size_t              m_pending_start { 0 };
+            // Current line.
+            std::string         m_gcode_line;
+            // Processed G-code, written to disk only when greater than 64K to reduce writing calls.
+            std::string         m_export_buffer;
+            // Position of m_export_buffer in the output file.
+            int64_t             m_export_buffer_pos { 0 };
+            std::vector<M73Line> m_M73_lines;
         };
 
     private:
+        // Blocks, which may still be modified by the planner passes, stored as a structure of arrays.
+        // A block is finalized (its time is calculated and its planner data is released) as soon as the planner
+        // passes cannot modify it anymore, see _finalize_blocks(), thus only a short tail of the G-code
+        // is kept here, while just the times of the finalized blocks are retained.
+        struct PlannerBlocks
+        {
+            std::vector<float>          distance;           // mm
+            std::vector<float>          acceleration;       // mm/s^2
+            std::vector<float>          max_entry_speed;    // mm/s
+            std::vector<float>          safe_feedrate;      // mm/s
+            std::vector<float>          entry;              // mm/s
+            std::vector<float>          cruise;             // mm/s
+            std::vector<unsigned char>  nominal_length;
+#if ENABLE_MOVE_STATS
+            std::vector<Block::EMoveType> move_type;
+#endif // ENABLE_MOVE_STATS
+
+            size_t size() const { return distance.size(); }
+            bool   empty() const { return distance.empty(); }
+            void   clear();
+            // Removes the first num_blocks blocks.
+            void   erase_front(size_t num_blocks);
+            size_t memory_used() const;
+        };
+
         EMode m_mode;
         GCodeReader m_parser;
         State m_state;
         Feedrates m_curr;
         Feedrates m_prev;
-        BlocksList m_blocks;
+        PlannerBlocks m_planner_blocks;
+        // Index of the last block of m_planner_blocks, which will not be modified by the reverse pass of the planner,
+        // zero if there is no such block.
+        size_t m_planner_barrier;
+        BlockTimesList m_block_times;
         // Map between g1 line id and blocks id, used to speed up export of remaining times
         G1LineIdToBlockIdMap m_g1_line_ids;
-        // Index of the last block already st_synchronized
-        int m_last_st_synchronized_block_id;
         float m_time; // s
 
         // data to calculate color print times
@@ -259,10 +300,8 @@ namespace Slic3r {
         void add_gcode_block(const std::string &str) { this->add_gcode_block(str.c_str()); }
 
         // Calculates the time estimate from the gcode lines added using add_gcode_line() or add_gcode_block()
-        // start_from_beginning:
-        // if set to true all blocks will be used to calculate the time estimate,
-        // if set to false only the blocks not yet processed will be used and the calculated time will be added to the current calculated time
-        void calculate_time(bool start_from_beginning);
+        // Only the blocks not yet processed will be used and the calculated time will be added to the current calculated time.
+        void calculate_time();
 
         // Calculates the time estimate from the given gcode in string format
         void calculate_time_from_text(const std::string& gcode);
@@ -273,14 +312,6 @@ namespace Slic3r {
         // Calculates the time estimate from the gcode contained in given list of gcode lines
         void calculate_time_from_lines(const std::vector<std::string>& gcode_lines);
 
-        // Process the gcode contained in the file with the given filename, 
-        // replacing placeholders with correspondent new lines M73
-        // placing new lines M73 (containing the remaining time) where needed (in dependence of the given interval in seconds)
-        // and removing working tags (as those used for color changes)
-        // if normal_mode == nullptr no M73 line will be added for normal mode
-        // if silent_mode == nullptr no M73 line will be added for silent mode
-        static bool post_process(const std::string& filename, float interval_sec, const PostProcessData* const normal_mode, const PostProcessData* const silent_mode);
-
         // Set current position on the given axis with the given value
         void set_axis_position(EAxis axis, float position);
         // Set current origin on the given axis with the given value
@@ -380,7 +411,7 @@ namespace Slic3r {
         // Return an estimate of the memory consumed by the time estimator.
         size_t memory_used() const;
 
-        PostProcessData get_post_process_data() const { return PostProcessData(m_g1_line_ids, m_blocks, m_time); }
+        PostProcessData get_post_process_data() const { return PostProcessData(m_g1_line_ids, m_block_times, m_time); }
 
     private:
         void _reset();
@@ -463,13 +494,14 @@ namespace Slic3r {
         // Simulates firmware st_synchronize() call
         void _simulate_st_synchronize();
 
-        void _forward_pass();
-        void _reverse_pass();
-
-        void _planner_forward_pass_kernel(Block& prev, Block& curr);
-        void _planner_reverse_pass_kernel(Block& curr, Block& next);
+        // Runs the reverse pass of the planner over the first num_blocks planner blocks, calculates their times,
+        // adds them to the total time, appends the elapsed times to m_block_times and releases them from the planner.
+        // If num_blocks is lower than the number of the planner blocks, the block at num_blocks must be a barrier
+        // of the reverse pass (see m_planner_barrier), thus the blocks following it cannot modify the finalized blocks.
+        void _finalize_blocks(size_t num_blocks);
 
-        void _recalculate_trapezoids();
+        void _planner_forward_pass_kernel(size_t prev, size_t curr);
+        void _planner_reverse_pass_kernel(size_t curr, size_t next);
 
         // Returns the given time is seconds in format DDd HHh MMm SSs
         static std::string _get_time_dhms(float time_in_secs);
@@ -1,5 +1,7 @@
 #include "GCodeWriter.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -7,13 +9,57 @@
 
 #define FLAVOR_IS(val) this->config.gcode_flavor == val
 #define FLAVOR_IS_NOT(val) this->config.gcode_flavor != val
-#define COMMENT(comment) if (this->config.gcode_comments && !comment.empty()) gcode << " ; " << comment;
-#define PRECISION(val, precision) std::fixed << std::setprecision(precision) << val
-#define XYZF_NUM(val) PRECISION(val, 3)
-#define E_NUM(val) PRECISION(val, 5)
+#define COMMENT(comment) if (this->config.gcode_comments && !comment.empty()) { gcode += " ; "; gcode += comment; }
+#define XYZF_NUM(val) append_fixed(gcode, val, 3)
+#define E_NUM(val) append_fixed(gcode, val, 5)
 
 namespace Slic3r {
 
+void append_fixed(std::string &out, double value, int precision)
+{
+    static constexpr double pow10[] = { 1., 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+    assert(precision >= 0 && precision <= 9);
+    double scaled = std::abs(value) * pow10[precision];
+    if (scaled < 1e15) {
+        // The multiplication above is off by at most half an ulp of scaled. Unless the fractional part is that close
+        // to a half, rounding the scaled value gives the same digits as the correctly rounded printf("%.*f").
+        double integral = std::floor(scaled);
+        double fraction = scaled - integral;
+        if (std::abs(fraction - 0.5) > scaled * 1e-15) {
+            uint64_t n = uint64_t(integral) + (fraction > 0.5 ? 1 : 0);
+            // Digits are written backwards from the end of the buffer.
+            char  buf[32];
+            char *end = buf + sizeof(buf);
+            char *p   = end;
+            for (int i = 0; i < precision; ++ i, n /= 10)
+                *(-- p) = char('0' + n % 10);
+            if (precision > 0)
+                *(-- p) = '.';
+            do {
+                *(-- p) = char('0' + n % 10);
+                n /= 10;
+            } while (n > 0);
+            // printf() keeps the sign of negative values rounded to zero, so does this.
+            if (std::signbit(value))
+                *(-- p) = '-';
+            out.append(p, end);
+            return;
+        }
+    }
+    // Rounding ties, large values, infinities and NaNs.
+    char buf[512];
+    int  len = snprintf(buf, sizeof(buf), "%.*f", precision, value);
+    out.append(buf, std::min(size_t(len), sizeof(buf) - 1));
+}
+
+// Append value the same way as the default formatting of std::ostream << value does.
+static inline void append_general(std::string &out, double value)
+{
+    char buf[64];
+    int  len = snprintf(buf, sizeof(buf), "%g", value);
+    out.append(buf, std::min(size_t(len), sizeof(buf) - 1));
+}
+
 void GCodeWriter::apply_print_config(const PrintConfig &print_config)
 {
     this->config.apply(print_config, true);
@@ -265,32 +311,53 @@ std::string GCodeWriter::toolchange(unsigned int extruder_id)
 }
 
 std::string GCodeWriter::set_speed(double F, const std::string &comment, const std::string &cooling_marker) const
+{
+    std::string gcode;
+    this->set_speed(gcode, F, comment, cooling_marker);
+    return gcode;
+}
+
+void GCodeWriter::set_speed(std::string &gcode, double F, const std::string &comment, const std::string &cooling_marker) const
 {
     assert(F > 0.);
     assert(F < 100000.);
-    std::ostringstream gcode;
-    gcode << "G1 F" << XYZF_NUM(F);
+    gcode += "G1 F";
+    XYZF_NUM(F);
     COMMENT(comment);
-    gcode << cooling_marker;
-    gcode << "\n";
-    return gcode.str();
+    gcode += cooling_marker;
+    gcode += '\n';
 }
 
 std::string GCodeWriter::travel_to_xy(const Vec2d &point, const std::string &comment)
+{
+    std::string gcode;
+    this->travel_to_xy(gcode, point, comment);
+    return gcode;
+}
+
+void GCodeWriter::travel_to_xy(std::string &gcode, const Vec2d &point, const std::string &comment)
 {
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
+    gcode += "G1 X";
+    XYZF_NUM(point(0));
+    gcode += " Y";
+    XYZF_NUM(point(1));
+    gcode += " F";
+    XYZF_NUM(this->config.travel_speed.value * 60.0);
     COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    gcode += '\n';
 }
 
 std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &comment)
+{
+    std::string gcode;
+    this->travel_to_xyz(gcode, point, comment);
+    return gcode;
+}
+
+void GCodeWriter::travel_to_xyz(std::string &gcode, const Vec3d &point, const std::string &comment)
 {
     /*  If target Z is lower than current Z but higher than nominal Z we
         don't perform the Z move but we only move in the XY plane and
@@ -303,7 +370,8 @@ std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &co
         // and a retract could be skipped (https://github.com/prusa3d/PrusaSlicer/issues/2154
         if (std::abs(m_lifted) < EPSILON)
             m_lifted = 0.;
-        return this->travel_to_xy(to_2d(point));
+        this->travel_to_xy(gcode, to_2d(point));
+        return;
     }
     
     /*  In all the other cases, we perform an actual XYZ move and cancel
@@ -311,14 +379,16 @@ std::string GCodeWriter::travel_to_xyz(const Vec3d &point, const std::string &co
     m_lifted = 0;
     m_pos = point;
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
+    gcode += "G1 X";
+    XYZF_NUM(point(0));
+    gcode += " Y";
+    XYZF_NUM(point(1));
+    gcode += " Z";
+    XYZF_NUM(point(2));
+    gcode += " F";
+    XYZF_NUM(this->config.travel_speed.value * 60.0);
     COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    gcode += '\n';
 }
 
 std::string GCodeWriter::travel_to_z(double z, const std::string &comment)
@@ -344,12 +414,14 @@ std::string GCodeWriter::_travel_to_z(double z, const std::string &comment)
 {
     m_pos(2) = z;
     
-    std::ostringstream gcode;
-    gcode << "G1 Z" << XYZF_NUM(z)
-          <<   " F" << XYZF_NUM(this->config.travel_speed.value * 60.0);
+    std::string gcode;
+    gcode += "G1 Z";
+    XYZF_NUM(z);
+    gcode += " F";
+    XYZF_NUM(this->config.travel_speed.value * 60.0);
     COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    gcode += '\n';
+    return gcode;
 }
 
 bool GCodeWriter::will_move_z(double z) const
@@ -364,38 +436,58 @@ bool GCodeWriter::will_move_z(double z) const
     return true;
 }
 
-std::string GCodeWriter::extrude_to_xy(const Vec2d &point, double dE, const std::string &comment, std::string object_color)
+std::string GCodeWriter::extrude_to_xy(const Vec2d &point, double dE, const std::string &comment, const std::string &object_color)
+{
+    std::string gcode;
+    this->extrude_to_xy(gcode, point, dE, comment, object_color);
+    return gcode;
+}
+
+void GCodeWriter::extrude_to_xy(std::string &gcode, const Vec2d &point, double dE, const std::string &comment, const std::string &object_color)
 {
     m_pos(0) = point(0);
     m_pos(1) = point(1);
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-
-    gcode << "C " << object_color << " ; for custom object color\n";
-
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
+    gcode += "C ";
+    gcode += object_color;
+    gcode += " ; for custom object color\n";
+
+    gcode += "G1 X";
+    XYZF_NUM(point(0));
+    gcode += " Y";
+    XYZF_NUM(point(1));
+    gcode += ' ';
+    gcode += m_extrusion_axis;
+    E_NUM(m_extruder->E());
     COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    gcode += '\n';
 }
 
 std::string GCodeWriter::extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment)
+{
+    std::string gcode;
+    this->extrude_to_xyz(gcode, point, dE, comment);
+    return gcode;
+}
+
+void GCodeWriter::extrude_to_xyz(std::string &gcode, const Vec3d &point, double dE, const std::string &comment)
 {
     m_pos = point;
     m_lifted = 0;
     m_extruder->extrude(dE);
     
-    std::ostringstream gcode;
-    gcode << "G1 X" << XYZF_NUM(point(0))
-          <<   " Y" << XYZF_NUM(point(1))
-          <<   " Z" << XYZF_NUM(point(2))
-          <<    " " << m_extrusion_axis << E_NUM(m_extruder->E());
+    gcode += "G1 X";
+    XYZF_NUM(point(0));
+    gcode += " Y";
+    XYZF_NUM(point(1));
+    gcode += " Z";
+    XYZF_NUM(point(2));
+    gcode += ' ';
+    gcode += m_extrusion_axis;
+    E_NUM(m_extruder->E());
     COMMENT(comment);
-    gcode << "\n";
-    return gcode.str();
+    gcode += '\n';
 }
 
 std::string GCodeWriter::retract(bool before_wipe)
@@ -422,7 +514,7 @@ std::string GCodeWriter::retract_for_toolchange(bool before_wipe)
 
 std::string GCodeWriter::_retract(double length, double restart_extra, const std::string &comment)
 {
-    std::ostringstream gcode;
+    std::string gcode;
     
     /*  If firmware retraction is enabled, we use a fake value of 1
         since we ignore the actual configured retract_length which 
@@ -441,48 +533,54 @@ std::string GCodeWriter::_retract(double length, double restart_extra, const std
     if (dE != 0) {
         if (this->config.use_firmware_retraction) {
             if (FLAVOR_IS(gcfMachinekit))
-                gcode << "G22 ; retract\n";
+                gcode += "G22 ; retract\n";
             else
-                gcode << "G10 ; retract\n";
+                gcode += "G10 ; retract\n";
         } else {
-            gcode << "G1 " << m_extrusion_axis << E_NUM(m_extruder->E())
-                           << " F" << float(m_extruder->retract_speed() * 60.);
+            gcode += "G1 ";
+            gcode += m_extrusion_axis;
+            E_NUM(m_extruder->E());
+            gcode += " F";
+            append_general(gcode, float(m_extruder->retract_speed() * 60.));
             COMMENT(comment);
-            gcode << "\n";
+            gcode += '\n';
         }
     }
     
     if (FLAVOR_IS(gcfMakerWare))
-        gcode << "M103 ; extruder off\n";
+        gcode += "M103 ; extruder off\n";
     
-    return gcode.str();
+    return gcode;
 }
 
 std::string GCodeWriter::unretract()
 {
-    std::ostringstream gcode;
+    std::string gcode;
     
     if (FLAVOR_IS(gcfMakerWare))
-        gcode << "M101 ; extruder on\n";
+        gcode += "M101 ; extruder on\n";
     
     double dE = m_extruder->unretract();
     if (dE != 0) {
         if (this->config.use_firmware_retraction) {
             if (FLAVOR_IS(gcfMachinekit))
-                 gcode << "G23 ; unretract\n";
+                 gcode += "G23 ; unretract\n";
             else
-                 gcode << "G11 ; unretract\n";
-            gcode << this->reset_e();
+                 gcode += "G11 ; unretract\n";
+            gcode += this->reset_e();
         } else {
             // use G1 instead of G0 because G0 will blend the restart with the previous travel move
-            gcode << "G1 " << m_extrusion_axis << E_NUM(m_extruder->E())
-                           << " F" << float(m_extruder->deretract_speed() * 60.);
-            if (this->config.gcode_comments) gcode << " ; unretract";
-            gcode << "\n";
+            gcode += "G1 ";
+            gcode += m_extrusion_axis;
+            E_NUM(m_extruder->E());
+            gcode += " F";
+            append_general(gcode, float(m_extruder->deretract_speed() * 60.));
+            if (this->config.gcode_comments) gcode += " ; unretract";
+            gcode += '\n';
         }
     }
     
-    return gcode.str();
+    return gcode;
 }
 
 /*  If this method is called more than once before calling unlift(),
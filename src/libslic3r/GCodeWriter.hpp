@@ -64,8 +64,15 @@ public:
     std::string travel_to_xyz(const Vec3d &point, const std::string &comment = std::string());
     std::string travel_to_z(double z, const std::string &comment = std::string());
     bool        will_move_z(double z) const;
-    std::string extrude_to_xy(const Vec2d &point, double dE, const std::string &comment = std::string(), std::string object_color = "#FFFFFF");
+    std::string extrude_to_xy(const Vec2d &point, double dE, const std::string &comment = std::string(), const std::string &object_color = "#FFFFFF");
     std::string extrude_to_xyz(const Vec3d &point, double dE, const std::string &comment = std::string());
+    // Variants of the above appending to gcode instead of returning a new string, to be used by the hot loops
+    // emitting the moves of a layer into a single growing buffer.
+    void        set_speed(std::string &gcode, double F, const std::string &comment = std::string(), const std::string &cooling_marker = std::string()) const;
+    void        travel_to_xy(std::string &gcode, const Vec2d &point, const std::string &comment = std::string());
+    void        travel_to_xyz(std::string &gcode, const Vec3d &point, const std::string &comment = std::string());
+    void        extrude_to_xy(std::string &gcode, const Vec2d &point, double dE, const std::string &comment = std::string(), const std::string &object_color = "#FFFFFF");
+    void        extrude_to_xyz(std::string &gcode, const Vec3d &point, double dE, const std::string &comment = std::string());
     std::string retract(bool before_wipe = false);
     std::string retract_for_toolchange(bool before_wipe = false);
     std::string unretract();
@@ -92,6 +99,11 @@ private:
     std::string _retract(double length, double restart_extra, const std::string &comment);
 };
 
+// Append value in the fixed point notation with the given number of decimal digits (at most 9) to out.
+// The output is identical to that of std::ostream << std::fixed << std::setprecision(precision) << value,
+// but the formatting does not go through the iostreams and it does not allocate if out has enough capacity.
+void append_fixed(std::string &out, double value, int precision);
+
 } /* namespace Slic3r */
 
 #endif /* slic3r_GCodeWriter_hpp_ */
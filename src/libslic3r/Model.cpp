@@ -9,6 +9,7 @@
 #include "Format/3mf.hpp"
 
 #include <float.h>
+#include <mutex>
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
@@ -20,6 +21,7 @@
 #include <Eigen/Dense>
 #include "GCodeWriter.hpp"
 #include "GCode/PreviewData.hpp"
+#include "SliceCache.hpp"
 
 namespace Slic3r {
 
@@ -1627,6 +1629,8 @@ void ModelVolume::center_geometry_after_creation(bool update_source_offset)
     {
     	if (m_mesh)
         	const_cast<TriangleMesh*>(m_mesh.get())->translate(-(float)shift(0), -(float)shift(1), -(float)shift(2));
+        m_slicing_mesh_source.reset();
+        m_mesh_digest_source.reset();
         if (m_convex_hull)
 			const_cast<TriangleMesh*>(m_convex_hull.get())->translate(-(float)shift(0), -(float)shift(1), -(float)shift(2));
         translate(shift);
@@ -1654,6 +1658,39 @@ const TriangleMesh& ModelVolume::get_convex_hull() const
     return *m_convex_hull.get();
 }
 
+ModelVolume::SlicingMesh ModelVolume::slicing_mesh() const
+{
+    std::lock_guard<std::mutex> lock(m_slicing_mesh_mutex);
+    if (m_slicing_mesh_source != m_mesh) {
+        std::shared_ptr<const TriangleMesh> mesh = m_mesh;
+        if (mesh->repaired || ! mesh->has_shared_vertices()) {
+            auto mesh_shared = std::make_shared<TriangleMesh>(*m_mesh);
+            if (mesh_shared->repaired) {
+                //FIXME The admesh repair function may break the face connectivity, rather refresh it here as the slicing code relies on it.
+                stl_check_facets_exact(&mesh_shared->stl);
+                // Degenerate facets may have been removed, index the remaining ones.
+                mesh_shared->its.clear();
+            }
+            mesh_shared->require_shared_vertices();
+            mesh = std::move(mesh_shared);
+        }
+        m_slicing_mesh.facets_edges = TriangleMeshSlicer::make_facets_edges(*mesh);
+        m_slicing_mesh.mesh         = std::move(mesh);
+        m_slicing_mesh_source       = m_mesh;
+    }
+    return m_slicing_mesh;
+}
+
+std::string ModelVolume::mesh_digest() const
+{
+    std::lock_guard<std::mutex> lock(m_slicing_mesh_mutex);
+    if (m_mesh_digest_source != m_mesh) {
+        m_mesh_digest        = SliceCache::mesh_digest(*m_mesh);
+        m_mesh_digest_source = m_mesh;
+    }
+    return m_mesh_digest;
+}
+
 ModelVolumeType ModelVolume::type_from_string(const std::string &s)
 {
     // Legacy support
@@ -1790,6 +1827,8 @@ void ModelVolume::scale_geometry_after_creation(const Vec3d& versor)
 {
 	const_cast<TriangleMesh*>(m_mesh.get())->scale(versor);
 	const_cast<TriangleMesh*>(m_convex_hull.get())->scale(versor);
+    m_slicing_mesh_source.reset();
+    m_mesh_digest_source.reset();
 }
 
 void ModelVolume::transform_this_mesh(const Transform3d &mesh_trafo, bool fix_left_handed)
@@ -284,6 +284,8 @@ void PerimeterGenerator::process()
             std::vector<PerimeterGeneratorLoops> contours(loop_number+1);    // depth => loops
             std::vector<PerimeterGeneratorLoops> holes(loop_number+1);       // depth => loops
             ThickPolylines thin_walls;
+            // Successive insets of the island, sharing the Clipper representation of each inset between its neighbor insets.
+            OffsetLadder ladder(last);
             // we loop one time more than needed in order to find gaps after the last perimeter was applied
             for (int i = 0;; ++ i) {  // outer loop is 0
                 // Calculate next onion shell of perimeters.
@@ -300,17 +302,14 @@ void PerimeterGenerator::process()
                         offset_ex(last, 0.0f);
         
                     offsets = offset_ex(offset_ex(offsets, scale_(-this->config->corner_rounding_r.value), ClipperLib::jtRound), scale_(this->config->corner_rounding_r.value), ClipperLib::jtRound);
+                    ladder.push(offsets);
                     // look for thin walls
                     if (this->config->thin_walls) {
                         // the following offset2 ensures almost nothing in @thin_walls is narrower than $min_width
                         // (actually, something larger than that still may exist due to mitering or other causes)
                         coord_t min_width = coord_t(scale_(this->ext_perimeter_flow.nozzle_diameter / 3));
-                        ExPolygons expp = offset2_ex(
-                            // medial axis requires non-overlapping geometry
-                            diff_ex(to_polygons(last),
-                                    offset(offsets, float(ext_perimeter_width / 2.)),
-                                    true),
-                            - float(min_width / 2.), float(min_width / 2.));
+                        // medial axis requires non-overlapping geometry
+                        ExPolygons expp = ladder.thin_walls(float(ext_perimeter_width / 2.), float(min_width / 2.));
                         // the maximum thickness of our thin wall area is equal to the minimum thickness of a single loop
                         for (ExPolygon &ex : expp)
                             ex.medial_axis(ext_perimeter_width + ext_perimeter_spacing2, min_width, &thin_walls);
@@ -326,20 +325,16 @@ void PerimeterGenerator::process()
                         // reliable gap fill algorithm.
                         // Also the offset2(perimeter, -x, x) may sometimes lead to a perimeter, which is larger than
                         // the original.
-                        offset2_ex(last,
-                                - float(distance + min_spacing / 2. - 1.),
-                                float(min_spacing / 2. - 1.)) :
+                        ladder.inset(float(distance), float(min_spacing / 2. - 1.)) :
                         // If "detect thin walls" is not enabled, this paths will be entered, which 
                         // leads to overflows, as in mxlab3d/Slic3r GH #32
-                        offset_ex(last, - float(distance));
+                        ladder.inset(float(distance));
                     // look for gaps
                     if (has_gap_fill)
                         // not using safety offset here would "detect" very narrow gaps
                         // (but still long enough to escape the area threshold) that gap fill
                         // won't be able to fill but we'd still remove from infill area
-                        append(gaps, diff_ex(
-                            offset(last,    - float(0.5 * distance)),
-                            offset(offsets,   float(0.5 * distance + 10))));  // safety offset
+                        append(gaps, ladder.gaps(float(0.5 * distance), float(0.5 * distance + 10)));  // safety offset
                 }
                 if (offsets.empty()) {
                     // Store the number of loops actually generated.
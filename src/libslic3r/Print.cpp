@@ -18,12 +18,15 @@
 #include <float.h>
 
 #include <algorithm>
+#include <exception>
 #include <limits>
 #include <unordered_set>
 #include <boost/filesystem/path.hpp>
 #include <boost/format.hpp>
 #include <boost/log/trivial.hpp>
 
+#include <tbb/task_group.h>
+
 //! macro used to mark string used at localization,
 //! return same string
 #define L(s) Slic3r::I18N::translate(s)
@@ -1577,11 +1580,30 @@ void Print::auto_assign_extruders(ModelObject* model_object) const
 void Print::process()
 {
     BOOST_LOG_TRIVIAL(info) << "Staring the slicing process." << log_memory_info();
-    for (PrintObject *obj : m_objects)
-        obj->make_perimeters();
-    this->set_status(70, L("Infilling layers"));
-    for (PrintObject *obj : m_objects)
-        obj->infill();
+    // The steps of an object depend on the preceding steps of the same object only, each step calls its prerequisites.
+    // Therefore the objects are processed concurrently, each object running its steps in order. On plates with many small objects,
+    // the parallel loops over the layers of a single object are too short to keep all the cores busy,
+    // and the perimeters of a small object may now be generated while a large object is still being sliced.
+    // An exception escaping a task would cancel the context of the task group shared by all the objects: The layer loops
+    // of the other objects would stop early without throwing and their steps would be marked as done with partial layers.
+    // Therefore the exceptions are caught per object, the other objects run to completion and the first exception is rethrown.
+    std::vector<std::exception_ptr> exceptions(m_objects.size());
+    this->set_status_concurrent(true);
+    tbb::task_group task_group;
+    for (size_t i = 0; i < m_objects.size(); ++ i)
+        task_group.run([obj = m_objects[i], &exception = exceptions[i]]() {
+            try {
+                obj->make_perimeters();
+                obj->infill();
+            } catch (...) {
+                exception = std::current_exception();
+            }
+        });
+    task_group.wait();
+    this->set_status_concurrent(false);
+    for (std::exception_ptr &exception : exceptions)
+        if (exception)
+            std::rethrow_exception(exception);
     // for (PrintObject *obj : m_objects)
     //     obj->generate_support_material();
     // if (this->set_started(psWipeTower)) {
@@ -22,6 +22,7 @@ class PrintObject;
 class ModelObject;
 class GCode;
 class GCodePreviewData;
+class SliceCache;
 
 // Print step IDs for keeping track of the print state.
 enum PrintStep {
@@ -185,6 +186,7 @@ private:
     void _simplify_slices(double distance);
     bool has_support_material() const;
     void detect_surfaces_type();
+    Surfaces detect_surfaces_type(size_t idx_region, size_t idx_layer) const;
     void process_external_surfaces();
     void discover_vertical_shells();
     void bridge_over_infill();
@@ -206,16 +208,26 @@ private:
     SlicingParameters                       m_slicing_params;
     LayerPtrs                               m_layers;
     SupportLayerPtrs                        m_support_layers;
+    // Set by make_perimeters() if it classified the region slices while generating the perimeters,
+    // so that prepare_infill() does not have to detect the surface types again.
+    bool                                    m_surfaces_type_detected = false;
 
     std::vector<ExPolygons> slice_region(size_t region_id, const std::vector<float> &z) const;
     std::vector<ExPolygons> slice_modifiers(size_t region_id, const std::vector<float> &z) const;
     std::vector<ExPolygons> slice_volumes(const std::vector<float> &z, const std::vector<const ModelVolume*> &volumes) const;
     std::vector<ExPolygons> slice_volume(const std::vector<float> &z, const ModelVolume &volume) const;
     std::vector<ExPolygons> slice_volume(const std::vector<float> &z, const std::vector<t_layer_height_range> &ranges, const ModelVolume &volume) const;
+    // Transformation of the volume mesh into the coordinate system of the slices.
+    Transform3d             slicing_transformation(const ModelVolume &volume) const;
+    // Key of the slices of the volumes at z in the slice cache of the Print.
+    std::string             slice_cache_key(const std::vector<float> &z, const std::vector<const ModelVolume*> &volumes) const;
 };
 
 struct WipeTowerData
 {
+    // The psWipeTower step, which used to clear the data, is disabled in Print::process().
+    WipeTowerData() { clear(); }
+
     // Following section will be consumed by the GCodeGenerator.
     // Tool ordering of a non-sequential print has to be known to calculate the wipe tower.
     // Cache it here, so it does not need to be recalculated during the G-code generation.
@@ -316,6 +328,18 @@ public:
     std::string         export_gcode(const std::string &path_template, GCodePreviewData *preview_data);
 #endif // ENABLE_THUMBNAIL_GENERATOR
 
+    // Called by export_gcode() from the background thread with the extrusion layers exported since the previous call
+    // and the value ranges of all the layers exported so far, so that the G-code preview may be shown before the export finishes.
+    // Only called if preview_data is not null.
+    typedef std::function<void(GCodePreviewData&&)> gcode_preview_layers_callback_type;
+    void                set_gcode_preview_layers_callback(gcode_preview_layers_callback_type cb) { m_gcode_preview_layers_callback = cb; }
+    const gcode_preview_layers_callback_type& gcode_preview_layers_callback() const { return m_gcode_preview_layers_callback; }
+
+    // Optional persistent cache of the object slices, which may be shared by multiple Print instances.
+    // The cache is keyed by the slicing input, therefore setting it does not invalidate any step.
+    void                set_slice_cache(std::shared_ptr<SliceCache> cache) { m_slice_cache = std::move(cache); }
+    const std::shared_ptr<SliceCache>& slice_cache() const { return m_slice_cache; }
+
     // methods for handling state
     bool                is_step_done(PrintStep step) const { return Inherited::is_step_done(step); }
     // Returns true if an object step is done on all objects and there's at least one object.    
@@ -415,6 +439,9 @@ private:
     // Estimated print time, filament consumed.
     PrintStatistics                         m_print_statistics;
 
+    gcode_preview_layers_callback_type      m_gcode_preview_layers_callback;
+    std::shared_ptr<SliceCache>             m_slice_cache;
+
     // flag used
     bool                                    m_force_update_print_regions = false;
 
@@ -2,6 +2,7 @@
 #define slic3r_PrintBase_hpp_
 
 #include "libslic3r.h"
+#include <algorithm>
 #include <set>
 #include <vector>
 #include <string>
@@ -285,8 +286,15 @@ public:
     void                    set_status_callback(status_callback_type cb) { m_status_callback = cb; }
     // Calls a registered callback to update the status, or print out the default message.
     void                    set_status(int percent, const std::string &message, unsigned int flags = SlicingStatus::DEFAULT) {
-		if (m_status_callback) m_status_callback(SlicingStatus(percent, message, flags));
-        else printf("%d => %s\n", percent, message.c_str());
+        if (m_status_concurrent) {
+            // Updates of the concurrently processed objects are serialized and the progress never goes back.
+            tbb::mutex::scoped_lock lock(m_status_mutex);
+            if (flags == SlicingStatus::DEFAULT && percent < m_status_last_percent)
+                return;
+            m_status_last_percent = std::max(m_status_last_percent, percent);
+            this->call_status_callback(percent, message, flags);
+        } else
+            this->call_status_callback(percent, message, flags);
     }
 
     typedef std::function<void()>  cancel_callback_type;
@@ -343,10 +351,21 @@ protected:
 	DynamicPrintConfig						m_full_print_config;
     PlaceholderParser                       m_placeholder_parser;
 
+    // While set, the status may be updated from multiple threads concurrently. Only the updates advancing the progress are reported.
+    void                   set_status_concurrent(bool concurrent) { m_status_concurrent = concurrent; m_status_last_percent = -1; }
+
 private:
+    void                   call_status_callback(int percent, const std::string &message, unsigned int flags) {
+		if (m_status_callback) m_status_callback(SlicingStatus(percent, message, flags));
+        else printf("%d => %s\n", percent, message.c_str());
+    }
+
     tbb::atomic<CancelStatus>               m_cancel_status;
     // Callback to be evoked regularly to update state of the UI thread.
     status_callback_type                    m_status_callback;
+    bool                                    m_status_concurrent   = false;
+    int                                     m_status_last_percent = -1;
+    tbb::mutex                              m_status_mutex;
 
     // Callback to be evoked to stop the background processing before a state is updated.
     cancel_callback_type                    m_cancel_callback = [](){};
@@ -7,13 +7,16 @@
 #include "SupportMaterial.hpp"
 #include "Surface.hpp"
 #include "Slicing.hpp"
+#include "SliceCache.hpp"
 #include "Utils.hpp"
 
+#include <thread>
 #include <utility>
 #include <boost/log/trivial.hpp>
 #include <float.h>
 
 #include <tbb/parallel_for.h>
+#include <tbb/pipeline.h>
 #include <tbb/atomic.h>
 
 #include <Shiny/Shiny.h>
@@ -150,6 +153,9 @@ void PrintObject::make_perimeters()
     m_print->set_status(20, L("Generating perimeters"));
     BOOST_LOG_TRIVIAL(info) << "Generating perimeters..." << log_memory_info();
     
+    // The surface types of the region slices detected together with the perimeters are only valid until this step is run again.
+    m_surfaces_type_detected = false;
+
     // merge slices if they were split into types
     if (this->typed_slices) {
         for (Layer *layer : m_layers) {
@@ -166,81 +172,157 @@ void PrintObject::make_perimeters()
     // but we don't generate any extra perimeter if fill density is zero, as they would be floating
     // inside the object - infill_only_where_needed should be the method of choice for printing
     // hollow objects
+    std::vector<size_t> extra_perimeters_regions;
     for (size_t region_id = 0; region_id < this->region_volumes.size(); ++ region_id) {
         const PrintRegion &region = *m_print->regions()[region_id];
-        if (! region.config().extra_perimeters || region.config().perimeters == 0 || region.config().fill_density == 0 || this->layer_count() < 2)
-            continue;
-
-        BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters for region " << region_id << " in parallel - start";
+        if (region.config().extra_perimeters && region.config().perimeters > 0 && region.config().fill_density > 0 && this->layer_count() >= 2)
+            extra_perimeters_regions.emplace_back(region_id);
+    }
+    // Reads the region slices of layer_idx + 1, which are modified by the perimeter generator of that layer.
+    auto extra_perimeters = [this, &extra_perimeters_regions](size_t layer_begin, size_t layer_end) {
+        layer_end = std::min(layer_end, m_layers.size() - 1);
+        if (extra_perimeters_regions.empty() || layer_begin >= layer_end)
+            return;
         tbb::parallel_for(
-            tbb::blocked_range<size_t>(0, m_layers.size() - 1),
-            [this, &region, region_id](const tbb::blocked_range<size_t>& range) {
-                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
-                    m_print->throw_if_canceled();
-                    LayerRegion &layerm                     = *m_layers[layer_idx]->m_regions[region_id];
-                    const LayerRegion &upper_layerm         = *m_layers[layer_idx+1]->m_regions[region_id];
-                    const Polygons upper_layerm_polygons    = upper_layerm.slices;
-                    // Filter upper layer polygons in intersection_ppl by their bounding boxes?
-                    // my $upper_layerm_poly_bboxes= [ map $_->bounding_box, @{$upper_layerm_polygons} ];
-                    const double total_loop_length      = total_length(upper_layerm_polygons);
-                    const coord_t perimeter_spacing     = layerm.flow(frPerimeter).scaled_spacing();
-                    const Flow ext_perimeter_flow       = layerm.flow(frExternalPerimeter);
-                    const coord_t ext_perimeter_width   = ext_perimeter_flow.scaled_width();
-                    const coord_t ext_perimeter_spacing = ext_perimeter_flow.scaled_spacing();
-
-                    for (Surface &slice : layerm.slices.surfaces) {
-                        for (;;) {
-                            // compute the total thickness of perimeters
-                            const coord_t perimeters_thickness = ext_perimeter_width/2 + ext_perimeter_spacing/2
-                                + (region.config().perimeters-1 + slice.extra_perimeters) * perimeter_spacing;
-                            // define a critical area where we don't want the upper slice to fall into
-                            // (it should either lay over our perimeters or outside this area)
-                            const coord_t critical_area_depth = coord_t(perimeter_spacing * 1.5);
-                            const Polygons critical_area = diff(
-                                offset(slice.expolygon, float(- perimeters_thickness)),
-                                offset(slice.expolygon, float(- perimeters_thickness - critical_area_depth))
-                            );
-                            // check whether a portion of the upper slices falls inside the critical area
-                            const Polylines intersection = intersection_pl(to_polylines(upper_layerm_polygons), critical_area);
-                            // only add an additional loop if at least 30% of the slice loop would benefit from it
-                            if (total_length(intersection) <=  total_loop_length*0.3)
-                                break;
-                            /*
-                            if (0) {
-                                require "Slic3r/SVG.pm";
-                                Slic3r::SVG::output(
-                                    "extra.svg",
-                                    no_arrows   => 1,
-                                    expolygons  => union_ex($critical_area),
-                                    polylines   => [ map $_->split_at_first_point, map $_->p, @{$upper_layerm->slices} ],
+            tbb::blocked_range<size_t>(layer_begin, layer_end),
+            [this, &extra_perimeters_regions](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx)
+                    for (size_t region_id : extra_perimeters_regions) {
+                        m_print->throw_if_canceled();
+                        const PrintRegion &region = *m_print->regions()[region_id];
+                        LayerRegion &layerm                     = *m_layers[layer_idx]->m_regions[region_id];
+                        const LayerRegion &upper_layerm         = *m_layers[layer_idx+1]->m_regions[region_id];
+                        const Polygons upper_layerm_polygons    = upper_layerm.slices;
+                        // Filter upper layer polygons in intersection_ppl by their bounding boxes?
+                        // my $upper_layerm_poly_bboxes= [ map $_->bounding_box, @{$upper_layerm_polygons} ];
+                        const double total_loop_length      = total_length(upper_layerm_polygons);
+                        const coord_t perimeter_spacing     = layerm.flow(frPerimeter).scaled_spacing();
+                        const Flow ext_perimeter_flow       = layerm.flow(frExternalPerimeter);
+                        const coord_t ext_perimeter_width   = ext_perimeter_flow.scaled_width();
+                        const coord_t ext_perimeter_spacing = ext_perimeter_flow.scaled_spacing();
+
+                        for (Surface &slice : layerm.slices.surfaces) {
+                            for (;;) {
+                                // compute the total thickness of perimeters
+                                const coord_t perimeters_thickness = ext_perimeter_width/2 + ext_perimeter_spacing/2
+                                    + (region.config().perimeters-1 + slice.extra_perimeters) * perimeter_spacing;
+                                // define a critical area where we don't want the upper slice to fall into
+                                // (it should either lay over our perimeters or outside this area)
+                                const coord_t critical_area_depth = coord_t(perimeter_spacing * 1.5);
+                                const Polygons critical_area = diff(
+                                    offset(slice.expolygon, float(- perimeters_thickness)),
+                                    offset(slice.expolygon, float(- perimeters_thickness - critical_area_depth))
                                 );
+                                // check whether a portion of the upper slices falls inside the critical area
+                                const Polylines intersection = intersection_pl(to_polylines(upper_layerm_polygons), critical_area);
+                                // only add an additional loop if at least 30% of the slice loop would benefit from it
+                                if (total_length(intersection) <=  total_loop_length*0.3)
+                                    break;
+                                /*
+                                if (0) {
+                                    require "Slic3r/SVG.pm";
+                                    Slic3r::SVG::output(
+                                        "extra.svg",
+                                        no_arrows   => 1,
+                                        expolygons  => union_ex($critical_area),
+                                        polylines   => [ map $_->split_at_first_point, map $_->p, @{$upper_layerm->slices} ],
+                                    );
+                                }
+                                */
+                                ++ slice.extra_perimeters;
                             }
-                            */
-                            ++ slice.extra_perimeters;
+                            #ifdef DEBUG
+                                if (slice.extra_perimeters > 0)
+                                    printf("  adding %d more perimeter(s) at layer %zu\n", slice.extra_perimeters, layer_idx);
+                            #endif
                         }
-                        #ifdef DEBUG
-                            if (slice.extra_perimeters > 0)
-                                printf("  adding %d more perimeter(s) at layer %zu\n", slice.extra_perimeters, layer_idx);
-                        #endif
                     }
-                }
             });
         m_print->throw_if_canceled();
-        BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters for region " << region_id << " in parallel - end";
-    }
+    };
+    auto perimeters = [this](size_t layer_begin, size_t layer_end) {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(layer_begin, layer_end),
+            [this](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    m_layers[layer_idx]->make_perimeters();
+                }
+            }
+        );
+        m_print->throw_if_canceled();
+    };
 
-    BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - start";
-    tbb::parallel_for(
-        tbb::blocked_range<size_t>(0, m_layers.size()),
-        [this](const tbb::blocked_range<size_t>& range) {
-            for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+    if (m_config.interface_shells.value) {
+        // With interface shells, the surface types of a layer depend on the region slices of its neighbors,
+        // thus they are detected by prepare_infill() once the perimeters of all layers are generated.
+        BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters in parallel - start";
+        extra_perimeters(0, m_layers.size());
+        BOOST_LOG_TRIVIAL(debug) << "Generating extra perimeters in parallel - end";
+        BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - start";
+        perimeters(0, m_layers.size());
+        BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - end";
+    } else {
+        // The perimeters of a layer only need the region slices of that layer, and the surface types of a layer
+        // only need the region slices of that layer and the slices of its neighbors, which are not modified here.
+        // Instead of finishing each of the three passes over all layers before starting the next one, the layers
+        // flow through the passes in bands, so that the perimeters of a band are generated while the extra perimeters
+        // of the band above are being counted and the surfaces of the band below are being classified.
+        // Each pass is serial in order over the bands, which keeps the following invariants:
+        // 1) The extra perimeters of the last layer of a band read the region slices of the first layer of the next band
+        //    before its perimeters are generated.
+        // 2) The surfaces of a layer are classified after its perimeters were generated and after the extra perimeters
+        //    of the layer below were counted.
+        // Slicing is not part of the pipeline: slice() finishes posSlice for all layers before this function is called,
+        // thus there is still a full barrier between slicing and the perimeters. The slicer sweeps the facets of a volume
+        // over all layers at once, slicing it band by band would repeat the sweep over all the facets for each band.
+        BOOST_LOG_TRIVIAL(debug) << "Generating perimeters and detecting solid surfaces in parallel - start";
+        // The region slices will be typed by the last pass. Mark them as typed before the first band is classified,
+        // so that they are merged by the next call of this function even if this one is canceled half way.
+        this->typed_slices = true;
+        const size_t num_layers = m_layers.size();
+        const size_t band_size  = std::max<size_t>(4, std::thread::hardware_concurrency());
+        size_t       next_band  = 0;
+        const auto input = tbb::make_filter<void, size_t>(tbb::filter::serial_in_order,
+            [num_layers, band_size, &next_band](tbb::flow_control &fc) -> size_t {
+                if (next_band >= num_layers) {
+                    fc.stop();
+                    return 0;
+                }
+                size_t band_begin = next_band;
+                next_band = std::min(num_layers, next_band + band_size);
+                return band_begin;
+            });
+        const auto count_extra_perimeters = tbb::make_filter<size_t, size_t>(tbb::filter::serial_in_order,
+            [num_layers, band_size, &extra_perimeters](size_t band_begin) -> size_t {
+                extra_perimeters(band_begin, std::min(num_layers, band_begin + band_size));
+                return band_begin;
+            });
+        const auto generate_perimeters = tbb::make_filter<size_t, size_t>(tbb::filter::serial_in_order,
+            [num_layers, band_size, &perimeters](size_t band_begin) -> size_t {
+                perimeters(band_begin, std::min(num_layers, band_begin + band_size));
+                return band_begin;
+            });
+        const auto detect_surfaces = tbb::make_filter<size_t, void>(tbb::filter::serial_in_order,
+            [this, num_layers, band_size](size_t band_begin) {
+                tbb::parallel_for(
+                    tbb::blocked_range<size_t>(band_begin, std::min(num_layers, band_begin + band_size)),
+                    [this](const tbb::blocked_range<size_t>& range) {
+                        for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer)
+                            for (size_t idx_region = 0; idx_region < this->region_volumes.size(); ++ idx_region) {
+                                m_print->throw_if_canceled();
+                                LayerRegion *layerm = m_layers[idx_layer]->get_region(idx_region);
+                                layerm->slices.surfaces = this->detect_surfaces_type(idx_region, idx_layer);
+                                layerm->slices_to_fill_surfaces_clipped();
+                            }
+                    });
                 m_print->throw_if_canceled();
-                m_layers[layer_idx]->make_perimeters();
-            }
-        }
-    );
-    m_print->throw_if_canceled();
-    BOOST_LOG_TRIVIAL(debug) << "Generating perimeters in parallel - end";
+            });
+        // One band per pass in flight.
+        tbb::parallel_pipeline(3, input & count_extra_perimeters & generate_perimeters & detect_surfaces);
+        m_surfaces_type_detected = true;
+        BOOST_LOG_TRIVIAL(debug) << "Generating perimeters and detecting solid surfaces in parallel - end";
+    }
 
     /*
         simplify slices (both layer and region slices),
@@ -263,7 +345,11 @@ void PrintObject::prepare_infill()
     // Then the classifcation of $layerm->slices is transfered onto 
     // the $layerm->fill_surfaces by clipping $layerm->fill_surfaces
     // by the cummulative area of the previous $layerm->fill_surfaces.
-    this->detect_surfaces_type();
+    // Unless interface shells are enabled, make_perimeters() already did so while generating the perimeters.
+    if (! m_surfaces_type_detected)
+        this->detect_surfaces_type();
+    // Any further run of this step has to classify the surfaces again, as the steps below modify the fill surfaces.
+    m_surfaces_type_detected = false;
     m_print->throw_if_canceled();
     
     // Decide what surfaces are to be filled.
@@ -583,6 +669,8 @@ bool PrintObject::invalidate_state_by_config_options(const std::vector<t_config_
 bool PrintObject::invalidate_step(PrintObjectStep step)
 {
 	bool invalidated = Inherited::invalidate_step(step);
+    if (step == posSlice || step == posPerimeters || step == posPrepareInfill)
+        m_surfaces_type_detected = false;
     
     // propagate to dependent steps
     if (step == posPerimeters) {
@@ -627,6 +715,136 @@ bool PrintObject::has_support_material() const
         || m_config.support_material_enforce_layers > 0;
 }
 
+// Classify the slices of a single region of a single layer against the slices of the layers above and below.
+// Only the region slices of the layer itself and the slices of its neighbors are read (with interface shells also
+// the region slices of its neighbors), therefore the layers may be classified in any order once their inputs are final.
+Surfaces PrintObject::detect_surfaces_type(size_t idx_region, size_t idx_layer) const
+{
+    bool interface_shells = m_config.interface_shells.value;
+    // If we have raft layers, consider bottom layer as a bridge just like any other bottom surface lying on the void.
+    SurfaceType surface_type_bottom_1st =
+        (m_config.raft_layers.value > 0 && m_config.support_material_contact_distance.value > 0) ?
+        stBottomBridge : stBottom;
+    // If we have soluble support material, don't bridge. The overhang will be squished against a soluble layer separating
+    // the support from the print.
+    SurfaceType surface_type_bottom_other =
+        (m_config.support_material.value && m_config.support_material_contact_distance.value == 0) ?
+        stBottom : stBottomBridge;
+
+    Layer       *layer  = m_layers[idx_layer];
+    LayerRegion *layerm = layer->get_region(idx_region);
+    // comparison happens against the *full* slices (considering all regions)
+    // unless internal shells are requested
+    Layer       *upper_layer = (idx_layer + 1 < this->layer_count()) ? m_layers[idx_layer + 1] : nullptr;
+    Layer       *lower_layer = (idx_layer > 0) ? m_layers[idx_layer - 1] : nullptr;
+    // collapse very narrow parts (using the safety offset in the diff is not enough)
+    float        offset = layerm->flow(frExternalPerimeter).scaled_width() / 10.f;
+
+    Polygons     layerm_slices_surfaces = to_polygons(layerm->slices.surfaces);
+
+    // find top surfaces (difference between current surfaces
+    // of current layer and upper one)
+    Surfaces top;
+    if (upper_layer) {
+        Polygons upper_slices = interface_shells ? 
+            to_polygons(upper_layer->get_region(idx_region)->slices.surfaces) : 
+            to_polygons(upper_layer->slices);
+        surfaces_append(top,
+            //FIXME implement offset2_ex working over ExPolygons, that should be a bit more efficient than calling offset_ex twice.
+            offset_ex(offset_ex(diff_ex(layerm_slices_surfaces, upper_slices, true), -offset), offset),
+            stTop);
+    } else {
+        // if no upper layer, all surfaces of this one are solid
+        // we clone surfaces because we're going to clear the slices collection
+        top = layerm->slices.surfaces;
+        for (Surface &surface : top)
+            surface.surface_type = stTop;
+    }
+    
+    // Find bottom surfaces (difference between current surfaces of current layer and lower one).
+    Surfaces bottom;
+    if (lower_layer) {
+#if 0
+        //FIXME Why is this branch failing t\multi.t ?
+        Polygons lower_slices = interface_shells ? 
+            to_polygons(lower_layer->get_region(idx_region)->slices.surfaces) : 
+            to_polygons(lower_layer->slices);
+        surfaces_append(bottom,
+            offset2_ex(diff(layerm_slices_surfaces, lower_slices, true), -offset, offset),
+            surface_type_bottom_other);
+#else
+        // Any surface lying on the void is a true bottom bridge (an overhang)
+        surfaces_append(
+            bottom,
+            offset2_ex(
+                diff(layerm_slices_surfaces, to_polygons(lower_layer->slices), true), 
+                -offset, offset),
+            surface_type_bottom_other);
+        // if user requested internal shells, we need to identify surfaces
+        // lying on other slices not belonging to this region
+        if (interface_shells) {
+            // non-bridging bottom surfaces: any part of this layer lying 
+            // on something else, excluding those lying on our own region
+            surfaces_append(
+                bottom,
+                offset2_ex(
+                    diff(
+                        intersection(layerm_slices_surfaces, to_polygons(lower_layer->slices)), // supported
+                        to_polygons(lower_layer->get_region(idx_region)->slices.surfaces), 
+                        true), 
+                    -offset, offset),
+                stBottom);
+        }
+#endif
+    } else {
+        // if no lower layer, all surfaces of this one are solid
+        // we clone surfaces because we're going to clear the slices collection
+        bottom = layerm->slices.surfaces;
+        for (Surface &surface : bottom)
+            surface.surface_type = surface_type_bottom_1st;
+    }
+    
+    // now, if the object contained a thin membrane, we could have overlapping bottom
+    // and top surfaces; let's do an intersection to discover them and consider them
+    // as bottom surfaces (to allow for bridge detection)
+    if (! top.empty() && ! bottom.empty()) {
+//                Polygons overlapping = intersection(to_polygons(top), to_polygons(bottom));
+//                Slic3r::debugf "  layer %d contains %d membrane(s)\n", $layerm->layer->id, scalar(@$overlapping)
+//                    if $Slic3r::debug;
+        Polygons top_polygons = to_polygons(std::move(top));
+        top.clear();
+        surfaces_append(top,
+            diff_ex(top_polygons, to_polygons(bottom), false),
+            stTop);
+    }
+
+#ifdef SLIC3R_DEBUG_SLICE_PROCESSING
+    {
+        static int iRun = 0;
+        std::vector<std::pair<Slic3r::ExPolygons, SVG::ExPolygonAttributes>> expolygons_with_attributes;
+        expolygons_with_attributes.emplace_back(std::make_pair(union_ex(top),                           SVG::ExPolygonAttributes("green")));
+        expolygons_with_attributes.emplace_back(std::make_pair(union_ex(bottom),                        SVG::ExPolygonAttributes("brown")));
+        expolygons_with_attributes.emplace_back(std::make_pair(to_expolygons(layerm->slices.surfaces),  SVG::ExPolygonAttributes("black")));
+        SVG::export_expolygons(debug_out_path("1_detect_surfaces_type_%d_region%d-layer_%f.svg", iRun ++, idx_region, layer->print_z).c_str(), expolygons_with_attributes);
+    }
+#endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
+    
+    Surfaces surfaces_out;
+
+    // find internal surfaces (difference between top/bottom surfaces and others)
+    {
+        Polygons topbottom = to_polygons(top);
+        polygons_append(topbottom, to_polygons(bottom));
+        surfaces_append(surfaces_out,
+            diff_ex(layerm_slices_surfaces, topbottom, false),
+            stInternal);
+    }
+
+    surfaces_append(surfaces_out, std::move(top));
+    surfaces_append(surfaces_out, std::move(bottom));
+    return surfaces_out;
+}
+
 // This function analyzes slices of a region (SurfaceCollection slices).
 // Each region slice (instance of Surface) is analyzed, whether it is supported or whether it is the top surface.
 // Initially all slices are of type stInternal.
@@ -663,138 +881,19 @@ void PrintObject::detect_surfaces_type()
         tbb::parallel_for(
             tbb::blocked_range<size_t>(0, m_layers.size()),
             [this, idx_region, interface_shells, &surfaces_new](const tbb::blocked_range<size_t>& range) {
-                // If we have raft layers, consider bottom layer as a bridge just like any other bottom surface lying on the void.
-                SurfaceType surface_type_bottom_1st =
-                    (m_config.raft_layers.value > 0 && m_config.support_material_contact_distance.value > 0) ?
-                    stBottomBridge : stBottom;
-                // If we have soluble support material, don't bridge. The overhang will be squished against a soluble layer separating
-                // the support from the print.
-                SurfaceType surface_type_bottom_other =
-                    (m_config.support_material.value && m_config.support_material_contact_distance.value == 0) ?
-                    stBottom : stBottomBridge;
                 for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer) {
                     m_print->throw_if_canceled();
-                    // BOOST_LOG_TRIVIAL(trace) << "Detecting solid surfaces for region " << idx_region << " and layer " << layer->print_z;
-                    Layer       *layer  = m_layers[idx_layer];
-                    LayerRegion *layerm = layer->get_region(idx_region);
-                    // comparison happens against the *full* slices (considering all regions)
-                    // unless internal shells are requested
-                    Layer       *upper_layer = (idx_layer + 1 < this->layer_count()) ? m_layers[idx_layer + 1] : nullptr;
-                    Layer       *lower_layer = (idx_layer > 0) ? m_layers[idx_layer - 1] : nullptr;
-                    // collapse very narrow parts (using the safety offset in the diff is not enough)
-                    float        offset = layerm->flow(frExternalPerimeter).scaled_width() / 10.f;
-
-                    Polygons     layerm_slices_surfaces = to_polygons(layerm->slices.surfaces);
-
-                    // find top surfaces (difference between current surfaces
-                    // of current layer and upper one)
-                    Surfaces top;
-                    if (upper_layer) {
-                        Polygons upper_slices = interface_shells ? 
-                            to_polygons(upper_layer->get_region(idx_region)->slices.surfaces) : 
-                            to_polygons(upper_layer->slices);
-                        surfaces_append(top,
-                            //FIXME implement offset2_ex working over ExPolygons, that should be a bit more efficient than calling offset_ex twice.
-                            offset_ex(offset_ex(diff_ex(layerm_slices_surfaces, upper_slices, true), -offset), offset),
-                            stTop);
-                    } else {
-                        // if no upper layer, all surfaces of this one are solid
-                        // we clone surfaces because we're going to clear the slices collection
-                        top = layerm->slices.surfaces;
-                        for (Surface &surface : top)
-                            surface.surface_type = stTop;
-                    }
-                    
-                    // Find bottom surfaces (difference between current surfaces of current layer and lower one).
-                    Surfaces bottom;
-                    if (lower_layer) {
-#if 0
-                        //FIXME Why is this branch failing t\multi.t ?
-                        Polygons lower_slices = interface_shells ? 
-                            to_polygons(lower_layer->get_region(idx_region)->slices.surfaces) : 
-                            to_polygons(lower_layer->slices);
-                        surfaces_append(bottom,
-                            offset2_ex(diff(layerm_slices_surfaces, lower_slices, true), -offset, offset),
-                            surface_type_bottom_other);
-#else
-                        // Any surface lying on the void is a true bottom bridge (an overhang)
-                        surfaces_append(
-                            bottom,
-                            offset2_ex(
-                                diff(layerm_slices_surfaces, to_polygons(lower_layer->slices), true), 
-                                -offset, offset),
-                            surface_type_bottom_other);
-                        // if user requested internal shells, we need to identify surfaces
-                        // lying on other slices not belonging to this region
-                        if (interface_shells) {
-                            // non-bridging bottom surfaces: any part of this layer lying 
-                            // on something else, excluding those lying on our own region
-                            surfaces_append(
-                                bottom,
-                                offset2_ex(
-                                    diff(
-                                        intersection(layerm_slices_surfaces, to_polygons(lower_layer->slices)), // supported
-                                        to_polygons(lower_layer->get_region(idx_region)->slices.surfaces), 
-                                        true), 
-                                    -offset, offset),
-                                stBottom);
-                        }
-#endif
+                    // BOOST_LOG_TRIVIAL(trace) << "Detecting solid surfaces for region " << idx_region << " and layer " << idx_layer;
+                    Surfaces surfaces = this->detect_surfaces_type(idx_region, idx_layer);
+                    if (interface_shells) {
+                        surfaces_new[idx_layer] = std::move(surfaces);
                     } else {
-                        // if no lower layer, all surfaces of this one are solid
-                        // we clone surfaces because we're going to clear the slices collection
-                        bottom = layerm->slices.surfaces;
-                        for (Surface &surface : bottom)
-                            surface.surface_type = surface_type_bottom_1st;
-                    }
-                    
-                    // now, if the object contained a thin membrane, we could have overlapping bottom
-                    // and top surfaces; let's do an intersection to discover them and consider them
-                    // as bottom surfaces (to allow for bridge detection)
-                    if (! top.empty() && ! bottom.empty()) {
-        //                Polygons overlapping = intersection(to_polygons(top), to_polygons(bottom));
-        //                Slic3r::debugf "  layer %d contains %d membrane(s)\n", $layerm->layer->id, scalar(@$overlapping)
-        //                    if $Slic3r::debug;
-                        Polygons top_polygons = to_polygons(std::move(top));
-                        top.clear();
-                        surfaces_append(top,
-                            diff_ex(top_polygons, to_polygons(bottom), false),
-                            stTop);
-                    }
-
-        #ifdef SLIC3R_DEBUG_SLICE_PROCESSING
-                    {
-                        static int iRun = 0;
-                        std::vector<std::pair<Slic3r::ExPolygons, SVG::ExPolygonAttributes>> expolygons_with_attributes;
-                        expolygons_with_attributes.emplace_back(std::make_pair(union_ex(top),                           SVG::ExPolygonAttributes("green")));
-                        expolygons_with_attributes.emplace_back(std::make_pair(union_ex(bottom),                        SVG::ExPolygonAttributes("brown")));
-                        expolygons_with_attributes.emplace_back(std::make_pair(to_expolygons(layerm->slices.surfaces),  SVG::ExPolygonAttributes("black")));
-                        SVG::export_expolygons(debug_out_path("1_detect_surfaces_type_%d_region%d-layer_%f.svg", iRun ++, idx_region, layer->print_z).c_str(), expolygons_with_attributes);
-                    }
-        #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
-                    
-                    // save surfaces to layer
-                    Surfaces &surfaces_out = interface_shells ? surfaces_new[idx_layer] : layerm->slices.surfaces;
-                    surfaces_out.clear();
-
-                    // find internal surfaces (difference between top/bottom surfaces and others)
-                    {
-                        Polygons topbottom = to_polygons(top);
-                        polygons_append(topbottom, to_polygons(bottom));
-                        surfaces_append(surfaces_out,
-                            diff_ex(layerm_slices_surfaces, topbottom, false),
-                            stInternal);
+                        LayerRegion *layerm = m_layers[idx_layer]->get_region(idx_region);
+                        layerm->slices.surfaces = std::move(surfaces);
+#ifdef SLIC3R_DEBUG_SLICE_PROCESSING
+                        layerm->export_region_slices_to_svg_debug("detect_surfaces_type-final");
+#endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
                     }
-
-                    surfaces_append(surfaces_out, std::move(top));
-                    surfaces_append(surfaces_out, std::move(bottom));
-                    
-        //            Slic3r::debugf "  layer %d has %d bottom, %d top and %d internal surfaces\n",
-        //                $layerm->layer->id, scalar(@bottom), scalar(@top), scalar(@internal) if $Slic3r::debug;
-
-        #ifdef SLIC3R_DEBUG_SLICE_PROCESSING
-                    layerm->export_region_slices_to_svg_debug("detect_surfaces_type-final");
-        #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
                 }
             }
         ); // for each layer of a region
@@ -1310,71 +1409,94 @@ void PrintObject::bridge_over_infill()
             -1,     // custom width, not relevant for bridge flow
             *this
         );
-        
-		for (LayerPtrs::iterator layer_it = m_layers.begin(); layer_it != m_layers.end(); ++ layer_it) {
+
+        // The stInternalSolid surfaces of a layer are split into bridges and solid infill based on the stInternal surfaces
+        // of the layers below, which are not modified here. Therefore the split is calculated for all layers in parallel
+        // and the new surfaces are committed to the layers afterwards, which gives the same result as the serial sweep.
+        struct LayerBridges {
+            bool        modified = false;
+            ExPolygons  to_bridge;
+            ExPolygons  not_to_bridge;
+        };
+        std::vector<LayerBridges> layer_bridges(m_layers.size());
+        BOOST_LOG_TRIVIAL(debug) << "Bridge over infill for region " << region_id << " in parallel - start";
+        tbb::parallel_for(
             // skip first layer
-			if (layer_it == m_layers.begin())
-                continue;
-            
-            Layer* layer        = *layer_it;
-            LayerRegion* layerm = layer->m_regions[region_id];
+            tbb::blocked_range<size_t>(1, std::max<size_t>(1, m_layers.size())),
+            [this, region_id, &bridge_flow, &layer_bridges](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    m_print->throw_if_canceled();
+                    const Layer       *layer  = m_layers[layer_idx];
+                    LayerRegion       *layerm = layer->m_regions[region_id];
             
-            // extract the stInternalSolid surfaces that might be transformed into bridges
-            Polygons internal_solid;
-            layerm->fill_surfaces.filter_by_type(stInternalSolid, &internal_solid);
+                    // extract the stInternalSolid surfaces that might be transformed into bridges
+                    Polygons internal_solid;
+                    layerm->fill_surfaces.filter_by_type(stInternalSolid, &internal_solid);
             
-            // check whether the lower area is deep enough for absorbing the extra flow
-            // (for obvious physical reasons but also for preventing the bridge extrudates
-            // from overflowing in 3D preview)
-            ExPolygons to_bridge;
-            {
-                Polygons to_bridge_pp = internal_solid;
+                    // check whether the lower area is deep enough for absorbing the extra flow
+                    // (for obvious physical reasons but also for preventing the bridge extrudates
+                    // from overflowing in 3D preview)
+                    ExPolygons to_bridge;
+                    {
+                        Polygons to_bridge_pp = internal_solid;
                 
-                // iterate through lower layers spanned by bridge_flow
-                double bottom_z = layer->print_z - bridge_flow.height;
-                for (int i = int(layer_it - m_layers.begin()) - 1; i >= 0; --i) {
-                    const Layer* lower_layer = m_layers[i];
+                        // iterate through lower layers spanned by bridge_flow
+                        double bottom_z = layer->print_z - bridge_flow.height;
+                        for (int i = int(layer_idx) - 1; i >= 0; --i) {
+                            const Layer* lower_layer = m_layers[i];
                     
-                    // stop iterating if layer is lower than bottom_z
-                    if (lower_layer->print_z < bottom_z) break;
+                            // stop iterating if layer is lower than bottom_z
+                            if (lower_layer->print_z < bottom_z) break;
                     
-                    // iterate through regions and collect internal surfaces
-                    Polygons lower_internal;
-                    for (LayerRegion *lower_layerm : lower_layer->m_regions)
-                        lower_layerm->fill_surfaces.filter_by_type(stInternal, &lower_internal);
+                            // iterate through regions and collect internal surfaces
+                            Polygons lower_internal;
+                            for (LayerRegion *lower_layerm : lower_layer->m_regions)
+                                lower_layerm->fill_surfaces.filter_by_type(stInternal, &lower_internal);
                     
-                    // intersect such lower internal surfaces with the candidate solid surfaces
-                    to_bridge_pp = intersection(to_bridge_pp, lower_internal);
-                }
+                            // intersect such lower internal surfaces with the candidate solid surfaces
+                            to_bridge_pp = intersection(to_bridge_pp, lower_internal);
+                        }
                 
-                // there's no point in bridging too thin/short regions
-                //FIXME Vojtech: The offset2 function is not a geometric offset, 
-                // therefore it may create 1) gaps, and 2) sharp corners, which are outside the original contour.
-                // The gaps will be filled by a separate region, which makes the infill less stable and it takes longer.
-                {
-                    float min_width = float(bridge_flow.scaled_width()) * 3.f;
-                    to_bridge_pp = offset2(to_bridge_pp, -min_width, +min_width);
-                }
+                        // there's no point in bridging too thin/short regions
+                        //FIXME Vojtech: The offset2 function is not a geometric offset, 
+                        // therefore it may create 1) gaps, and 2) sharp corners, which are outside the original contour.
+                        // The gaps will be filled by a separate region, which makes the infill less stable and it takes longer.
+                        {
+                            float min_width = float(bridge_flow.scaled_width()) * 3.f;
+                            to_bridge_pp = offset2(to_bridge_pp, -min_width, +min_width);
+                        }
                 
-                if (to_bridge_pp.empty()) continue;
+                        if (to_bridge_pp.empty()) continue;
                 
-                // convert into ExPolygons
-                to_bridge = union_ex(to_bridge_pp);
-            }
+                        // convert into ExPolygons
+                        to_bridge = union_ex(to_bridge_pp);
+                    }
             
-            #ifdef SLIC3R_DEBUG
-            printf("Bridging " PRINTF_ZU " internal areas at layer " PRINTF_ZU "\n", to_bridge.size(), layer->id());
-            #endif
+                    #ifdef SLIC3R_DEBUG
+                    printf("Bridging " PRINTF_ZU " internal areas at layer " PRINTF_ZU "\n", to_bridge.size(), layer->id());
+                    #endif
             
-            // compute the remaning internal solid surfaces as difference
-            ExPolygons not_to_bridge = diff_ex(internal_solid, to_polygons(to_bridge), true);
-            to_bridge = intersection_ex(to_polygons(to_bridge), internal_solid, true);
+                    // compute the remaning internal solid surfaces as difference
+                    LayerBridges &bridges = layer_bridges[layer_idx];
+                    bridges.modified      = true;
+                    bridges.not_to_bridge = diff_ex(internal_solid, to_polygons(to_bridge), true);
+                    bridges.to_bridge     = intersection_ex(to_polygons(to_bridge), internal_solid, true);
+                }
+            });
+        m_print->throw_if_canceled();
+        BOOST_LOG_TRIVIAL(debug) << "Bridge over infill for region " << region_id << " in parallel - end";
+
+        for (size_t layer_idx = 1; layer_idx < m_layers.size(); ++ layer_idx) {
+            LayerBridges &bridges = layer_bridges[layer_idx];
+            if (! bridges.modified)
+                continue;
+            LayerRegion *layerm = m_layers[layer_idx]->m_regions[region_id];
             // build the new collection of fill_surfaces
             layerm->fill_surfaces.remove_type(stInternalSolid);
-            for (ExPolygon &ex : to_bridge)
+            for (ExPolygon &ex : bridges.to_bridge)
                 layerm->fill_surfaces.surfaces.push_back(Surface(stInternalBridge, ex));
-            for (ExPolygon &ex : not_to_bridge)
-                layerm->fill_surfaces.surfaces.push_back(Surface(stInternalSolid, ex));            
+            for (ExPolygon &ex : bridges.not_to_bridge)
+                layerm->fill_surfaces.surfaces.push_back(Surface(stInternalSolid, ex));
             /*
             # exclude infill from the layers below if needed
             # see discussion at https://github.com/alexrj/Slic3r/issues/240
@@ -1413,7 +1535,6 @@ void PrintObject::bridge_over_infill()
             layerm->export_region_slices_to_svg_debug("7_bridge_over_infill");
             layerm->export_region_fill_surfaces_to_svg_debug("7_bridge_over_infill");
 #endif /* SLIC3R_DEBUG_SLICE_PROCESSING */
-            m_print->throw_if_canceled();
         }
     }
 }
@@ -1962,36 +2083,44 @@ std::vector<ExPolygons> PrintObject::slice_support_volumes(const ModelVolumeType
 std::vector<ExPolygons> PrintObject::slice_volumes(const std::vector<float> &z, const std::vector<const ModelVolume*> &volumes) const
 {
     std::vector<ExPolygons> layers;
-    if (! volumes.empty()) {
-        // Compose mesh.
-        //FIXME better to perform slicing over each volume separately and then to use a Boolean operation to merge them.
-		TriangleMesh mesh(volumes.front()->mesh());
-        mesh.transform(volumes.front()->get_matrix(), true);
-		assert(mesh.repaired);
-		if (volumes.size() == 1 && mesh.repaired) {
-			//FIXME The admesh repair function may break the face connectivity, rather refresh it here as the slicing code relies on it.
-			stl_check_facets_exact(&mesh.stl);
-		}
-        for (size_t idx_volume = 1; idx_volume < volumes.size(); ++ idx_volume) {
-            const ModelVolume &model_volume = *volumes[idx_volume];
-            TriangleMesh vol_mesh(model_volume.mesh());
-            vol_mesh.transform(model_volume.get_matrix(), true);
-            mesh.merge(vol_mesh);
+    if (volumes.size() == 1) {
+        layers = this->slice_volume(z, *volumes.front());
+    } else if (! volumes.empty() && ! z.empty()) {
+        SliceCache *cache = m_print->slice_cache().get();
+        std::string cache_key;
+        if (cache != nullptr) {
+            cache_key = this->slice_cache_key(z, volumes);
+            if (cache->load(cache_key, layers))
+                return layers;
         }
-        if (mesh.stl.stats.number_of_facets > 0) {
-            mesh.transform(m_trafo, true);
-            // apply XY shift
-            mesh.translate(- unscale<float>(m_copies_shift(0)), - unscale<float>(m_copies_shift(1)), 0);
-            // perform actual slicing
-            const Print *print = this->print();
-            auto callback = TriangleMeshSlicer::throw_on_cancel_callback_type([print](){print->throw_if_canceled();});
-            // TriangleMeshSlicer needs shared vertices, also this calls the repair() function.
-            mesh.require_shared_vertices();
-            TriangleMeshSlicer mslicer;
-            mslicer.init(&mesh, callback);
-			mslicer.slice(z, float(m_config.slice_closing_radius.value), &layers, callback);
+        // Slice the volumes separately, then merge their loops as if a single mesh composed of all the volumes was sliced.
+        const Print *print = this->print();
+        auto callback = TriangleMeshSlicer::throw_on_cancel_callback_type([print](){print->throw_if_canceled();});
+        std::vector<Polygons> loops(z.size());
+        TriangleMeshSlicer    mslicer;
+        for (const ModelVolume *model_volume : volumes) {
+            ModelVolume::SlicingMesh slicing_mesh = model_volume->slicing_mesh();
+            if (slicing_mesh.mesh->stl.stats.number_of_facets == 0)
+                continue;
+            std::vector<Polygons> volume_loops;
+            mslicer.init(slicing_mesh.mesh.get(), this->slicing_transformation(*model_volume), slicing_mesh.facets_edges, callback);
+            mslicer.slice(z, &volume_loops, callback);
+            for (size_t i = 0; i < z.size(); ++ i)
+                polygons_append(loops[i], std::move(volume_loops[i]));
             m_print->throw_if_canceled();
         }
+        layers.assign(z.size(), ExPolygons());
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, z.size()),
+            [this, &mslicer, &loops, &layers, callback](const tbb::blocked_range<size_t>& range) {
+                for (size_t layer_id = range.begin(); layer_id < range.end(); ++ layer_id) {
+                    callback();
+                    mslicer.make_expolygons(loops[layer_id], float(m_config.slice_closing_radius.value), &layers[layer_id]);
+                }
+            });
+        m_print->throw_if_canceled();
+        if (cache != nullptr)
+            cache->store(cache_key, layers);
     }
     return layers;
 }
@@ -2000,32 +2129,49 @@ std::vector<ExPolygons> PrintObject::slice_volume(const std::vector<float> &z, c
 {
     std::vector<ExPolygons> layers;
     if (! z.empty()) {
-	    // Compose mesh.
-	    //FIXME better to split the mesh into separate shells, perform slicing over each shell separately and then to use a Boolean operation to merge them.
-	    TriangleMesh mesh(volume.mesh());
-	    mesh.transform(volume.get_matrix(), true);
-		if (mesh.repaired) {
-			//FIXME The admesh repair function may break the face connectivity, rather refresh it here as the slicing code relies on it.
-			stl_check_facets_exact(&mesh.stl);
-		}
-	    if (mesh.stl.stats.number_of_facets > 0) {
-	        mesh.transform(m_trafo, true);
-	        // apply XY shift
-	        mesh.translate(- unscale<float>(m_copies_shift(0)), - unscale<float>(m_copies_shift(1)), 0);
+        SliceCache *cache = m_print->slice_cache().get();
+        std::string cache_key;
+        if (cache != nullptr) {
+            cache_key = this->slice_cache_key(z, { &volume });
+            if (cache->load(cache_key, layers))
+                return layers;
+        }
+        // The mesh is transformed on the fly by the slicer, its shared vertices and edge topology are cached by the ModelVolume.
+        ModelVolume::SlicingMesh slicing_mesh = volume.slicing_mesh();
+	    if (slicing_mesh.mesh->stl.stats.number_of_facets > 0) {
 	        // perform actual slicing
 	        TriangleMeshSlicer mslicer;
 	        const Print *print = this->print();
 	        auto callback = TriangleMeshSlicer::throw_on_cancel_callback_type([print](){print->throw_if_canceled();});
-	        // TriangleMeshSlicer needs the shared vertices.
-	        mesh.require_shared_vertices();
-	        mslicer.init(&mesh, callback);
+	        mslicer.init(slicing_mesh.mesh.get(), this->slicing_transformation(volume), slicing_mesh.facets_edges, callback);
 	        mslicer.slice(z, float(m_config.slice_closing_radius.value), &layers, callback);
 	        m_print->throw_if_canceled();
 	    }
+        if (cache != nullptr)
+            cache->store(cache_key, layers);
 	}
     return layers;
 }
 
+Transform3d PrintObject::slicing_transformation(const ModelVolume &volume) const
+{
+    // The volume transformation, the object transformation and the XY shift of the copies.
+    return Geometry::assemble_transform(Vec3d(- unscale<double>(m_copies_shift(0)), - unscale<double>(m_copies_shift(1)), 0.)) * m_trafo * volume.get_matrix();
+}
+
+std::string PrintObject::slice_cache_key(const std::vector<float> &z, const std::vector<const ModelVolume*> &volumes) const
+{
+    SliceCache::Key key;
+    for (const ModelVolume *volume : volumes) {
+        key.add(volume->mesh_digest(), this->slicing_transformation(*volume));
+        // A repaired mesh gets its facet connectivity refreshed before slicing.
+        key.add(volume->mesh().repaired);
+    }
+    key.add(z);
+    key.add(m_config.slice_closing_radius.value);
+    return key.digest();
+}
+
 // Filter the zs not inside the ranges. The ranges are closed at the botton and open at the top, they are sorted lexicographically and non overlapping.
 std::vector<ExPolygons> PrintObject::slice_volume(const std::vector<float> &z, const std::vector<t_layer_height_range> &ranges, const ModelVolume &volume) const
 {
@@ -2486,72 +2632,84 @@ void PrintObject::combine_infill()
             combine[m_layers.size() - 1] = num_layers;
         }
         
-        // loop through layers to which we have assigned layers to combine
-        for (size_t layer_idx = 0; layer_idx < m_layers.size(); ++ layer_idx) {
-            m_print->throw_if_canceled();
-            size_t num_layers = combine[layer_idx];
-			if (num_layers <= 1)
-                continue;
-            // Get all the LayerRegion objects to be combined.
-            std::vector<LayerRegion*> layerms;
-            layerms.reserve(num_layers);
-			for (size_t i = layer_idx + 1 - num_layers; i <= layer_idx; ++ i)
-                layerms.emplace_back(m_layers[i]->regions()[region_id]);
-            // We need to perform a multi-layer intersection, so let's split it in pairs.
-            // Initialize the intersection with the candidates of the lowest layer.
-            ExPolygons intersection = to_expolygons(layerms.front()->fill_surfaces.filter_by_type(stInternal));
-            // Start looping from the second layer and intersect the current intersection with it.
-            for (size_t i = 1; i < layerms.size(); ++ i)
-                intersection = intersection_ex(
-                    to_polygons(intersection),
-                    to_polygons(layerms[i]->fill_surfaces.filter_by_type(stInternal)),
-                    false);
-            double area_threshold = layerms.front()->infill_area_threshold();
-            if (! intersection.empty() && area_threshold > 0.)
-                intersection.erase(std::remove_if(intersection.begin(), intersection.end(), 
-                    [area_threshold](const ExPolygon &expoly) { return expoly.area() <= area_threshold; }), 
-                    intersection.end());
-            if (intersection.empty())
-                continue;
+        // The combined layers form disjoint windows, each of them ending at a layer with a non-zero combine count.
+        // A window only reads and writes the fill surfaces of its own layers, thus the windows are combined in parallel.
+        std::vector<size_t> windows;
+        for (size_t layer_idx = 0; layer_idx < m_layers.size(); ++ layer_idx)
+            if (combine[layer_idx] > 1)
+                windows.emplace_back(layer_idx);
+        
+        BOOST_LOG_TRIVIAL(debug) << "Combining infill for region " << region_id << " in parallel - start";
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, windows.size()),
+            [this, region, region_id, &windows, &combine](const tbb::blocked_range<size_t>& range) {
+                for (size_t window_idx = range.begin(); window_idx < range.end(); ++ window_idx) {
+                    m_print->throw_if_canceled();
+                    size_t layer_idx  = windows[window_idx];
+                    size_t num_layers = combine[layer_idx];
+                    // Get all the LayerRegion objects to be combined.
+                    std::vector<LayerRegion*> layerms;
+                    layerms.reserve(num_layers);
+                    for (size_t i = layer_idx + 1 - num_layers; i <= layer_idx; ++ i)
+                        layerms.emplace_back(m_layers[i]->regions()[region_id]);
+                    // We need to perform a multi-layer intersection, so let's split it in pairs.
+                    // Initialize the intersection with the candidates of the lowest layer.
+                    ExPolygons intersection = to_expolygons(layerms.front()->fill_surfaces.filter_by_type(stInternal));
+                    // Start looping from the second layer and intersect the current intersection with it.
+                    for (size_t i = 1; i < layerms.size(); ++ i)
+                        intersection = intersection_ex(
+                            to_polygons(intersection),
+                            to_polygons(layerms[i]->fill_surfaces.filter_by_type(stInternal)),
+                            false);
+                    double area_threshold = layerms.front()->infill_area_threshold();
+                    if (! intersection.empty() && area_threshold > 0.)
+                        intersection.erase(std::remove_if(intersection.begin(), intersection.end(), 
+                            [area_threshold](const ExPolygon &expoly) { return expoly.area() <= area_threshold; }), 
+                            intersection.end());
+                    if (intersection.empty())
+                        continue;
 //            Slic3r::debugf "  combining %d %s regions from layers %d-%d\n",
 //                scalar(@$intersection),
 //                ($type == stInternal ? 'internal' : 'internal-solid'),
 //                $layer_idx-($every-1), $layer_idx;
-            // intersection now contains the regions that can be combined across the full amount of layers,
-            // so let's remove those areas from all layers.
-            Polygons intersection_with_clearance;
-            intersection_with_clearance.reserve(intersection.size());
-            float clearance_offset = 
-                0.5f * layerms.back()->flow(frPerimeter).scaled_width() +
-             // Because fill areas for rectilinear and honeycomb are grown 
-             // later to overlap perimeters, we need to counteract that too.
-                ((region->config().fill_pattern == ipRectilinear   ||
-                  region->config().fill_pattern == ipGrid          ||
-                  region->config().fill_pattern == ipLine          ||
-                  region->config().fill_pattern == ipHoneycomb) ? 1.5f : 0.5f) * 
-                    layerms.back()->flow(frSolidInfill).scaled_width();
-            for (ExPolygon &expoly : intersection)
-                polygons_append(intersection_with_clearance, offset(expoly, clearance_offset));
-            for (LayerRegion *layerm : layerms) {
-                Polygons internal = to_polygons(layerm->fill_surfaces.filter_by_type(stInternal));
-                layerm->fill_surfaces.remove_type(stInternal);
-                layerm->fill_surfaces.append(diff_ex(internal, intersection_with_clearance, false), stInternal);
-                if (layerm == layerms.back()) {
-                    // Apply surfaces back with adjusted depth to the uppermost layer.
-                    Surface templ(stInternal, ExPolygon());
-                    templ.thickness = 0.;
-                    for (LayerRegion *layerm2 : layerms)
-                        templ.thickness += layerm2->layer()->height;
-                    templ.thickness_layers = (unsigned short)layerms.size();
-                    layerm->fill_surfaces.append(intersection, templ);
-                } else {
-                    // Save void surfaces.
-                    layerm->fill_surfaces.append(
-                        intersection_ex(internal, intersection_with_clearance, false),
-                        stInternalVoid);
+                    // intersection now contains the regions that can be combined across the full amount of layers,
+                    // so let's remove those areas from all layers.
+                    Polygons intersection_with_clearance;
+                    intersection_with_clearance.reserve(intersection.size());
+                    float clearance_offset = 
+                        0.5f * layerms.back()->flow(frPerimeter).scaled_width() +
+                     // Because fill areas for rectilinear and honeycomb are grown 
+                     // later to overlap perimeters, we need to counteract that too.
+                        ((region->config().fill_pattern == ipRectilinear   ||
+                          region->config().fill_pattern == ipGrid          ||
+                          region->config().fill_pattern == ipLine          ||
+                          region->config().fill_pattern == ipHoneycomb) ? 1.5f : 0.5f) * 
+                            layerms.back()->flow(frSolidInfill).scaled_width();
+                    for (ExPolygon &expoly : intersection)
+                        polygons_append(intersection_with_clearance, offset(expoly, clearance_offset));
+                    for (LayerRegion *layerm : layerms) {
+                        Polygons internal = to_polygons(layerm->fill_surfaces.filter_by_type(stInternal));
+                        layerm->fill_surfaces.remove_type(stInternal);
+                        layerm->fill_surfaces.append(diff_ex(internal, intersection_with_clearance, false), stInternal);
+                        if (layerm == layerms.back()) {
+                            // Apply surfaces back with adjusted depth to the uppermost layer.
+                            Surface templ(stInternal, ExPolygon());
+                            templ.thickness = 0.;
+                            for (LayerRegion *layerm2 : layerms)
+                                templ.thickness += layerm2->layer()->height;
+                            templ.thickness_layers = (unsigned short)layerms.size();
+                            layerm->fill_surfaces.append(intersection, templ);
+                        } else {
+                            // Save void surfaces.
+                            layerm->fill_surfaces.append(
+                                intersection_ex(internal, intersection_with_clearance, false),
+                                stInternalVoid);
+                        }
+                    }
                 }
-            }
-        }
+            });
+        m_print->throw_if_canceled();
+        BOOST_LOG_TRIVIAL(debug) << "Combining infill for region " << region_id << " in parallel - end";
     }
 }
 
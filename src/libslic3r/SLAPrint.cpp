@@ -799,7 +799,8 @@ void SLAPrint::process()
         for(auto it = slindex_it; it != po.m_slice_index.end(); ++it)
             po.m_model_height_levels.emplace_back(it->slice_level());
 
-        TriangleMeshSlicer slicer(&mesh);
+        // The slicer keeps its z index between the runs, only the slicing heights change with the layer height.
+        const TriangleMeshSlicer &slicer = po.transformed_mesh_slicer();
 
         po.m_model_slices.clear();
         slicer.slice(po.m_model_height_levels,
@@ -1697,6 +1698,10 @@ SLAPrintObject::SLAPrintObject(SLAPrint *print, ModelObject *model_object)
             obj.require_shared_vertices();
         }
     })
+    , m_transformed_slicer([this](TriangleMeshSlicer &obj) {
+        obj.init(&transformed_mesh(), [](){});
+        obj.build_z_index();
+    })
 {}
 
 SLAPrintObject::~SLAPrintObject() {}
@@ -1938,6 +1943,10 @@ const TriangleMesh &SLAPrintObject::transformed_mesh() const {
     return m_transformed_rmesh.get();
 }
 
+const TriangleMeshSlicer &SLAPrintObject::transformed_mesh_slicer() const {
+    return m_transformed_slicer.get();
+}
+
 std::vector<sla::SupportPoint> SLAPrintObject::transformed_support_points() const
 {
     assert(m_model_object != nullptr);
@@ -78,6 +78,9 @@ public:
 
     // This will return the transformed mesh which is cached
     const TriangleMesh&     transformed_mesh() const;
+    // Slicer of the cached transformed mesh with a prepared z sorted facet index,
+    // reused when only the slicing heights change.
+    const TriangleMeshSlicer& transformed_mesh_slicer() const;
 
     std::vector<sla::SupportPoint>      transformed_support_points() const;
 
@@ -251,6 +254,7 @@ protected:
 
     void                    set_trafo(const Transform3d& trafo, bool left_handed) {
         m_transformed_rmesh.invalidate([this, &trafo, left_handed](){ m_trafo = trafo; m_left_handed = left_handed; });
+        m_transformed_slicer.invalidate([](){});
     }
 
     template<class InstVec> inline void set_instances(InstVec&& instances) { m_instances = std::forward<InstVec>(instances); }
@@ -287,6 +291,8 @@ private:
 
     // Caching the transformed (m_trafo) raw mesh of the object
     mutable CachedObject<TriangleMesh>      m_transformed_rmesh;
+    // Slicer of m_transformed_rmesh, must be invalidated together with m_transformed_rmesh
+    mutable CachedObject<TriangleMeshSlicer> m_transformed_slicer;
 
     class SupportData;
     std::unique_ptr<SupportData> m_supportdata;
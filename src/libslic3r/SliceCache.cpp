@@ -0,0 +1,205 @@
+#include "SliceCache.hpp"
+#include "TriangleMesh.hpp"
+#include "Utils.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+#include <boost/log/trivial.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+namespace Slic3r {
+
+// Bumped whenever the slicing algorithm or the entry format changes, so that the stale entries are not reused.
+static const char SLICE_CACHE_MAGIC[] = "SLC2";
+
+void SliceCache::Key::add(const void *data, size_t size)
+{
+    m_sha1.process_bytes(data, size);
+}
+
+void SliceCache::Key::add(const std::string &mesh_digest, const Transform3d &trafo)
+{
+    this->add(mesh_digest.data(), mesh_digest.size());
+    this->add(trafo.matrix().data(), sizeof(double) * 16);
+}
+
+void SliceCache::Key::add(const std::vector<float> &zs)
+{
+    uint32_t num_zs = uint32_t(zs.size());
+    this->add(&num_zs, sizeof(num_zs));
+    if (! zs.empty())
+        this->add(zs.data(), zs.size() * sizeof(float));
+}
+
+void SliceCache::Key::add(double value)
+{
+    this->add(&value, sizeof(value));
+}
+
+std::string SliceCache::Key::digest()
+{
+    this->add(SLICE_CACHE_MAGIC, 4);
+    unsigned int hash[5];
+    m_sha1.get_digest(hash);
+    char buf[41];
+    for (size_t i = 0; i < 5; ++ i)
+        sprintf(buf + i * 8, "%08x", hash[i]);
+    return std::string(buf, 40);
+}
+
+std::string SliceCache::mesh_digest(const TriangleMesh &mesh)
+{
+    Key      key;
+    uint32_t num_facets = mesh.stl.stats.number_of_facets;
+    key.add(&num_facets, sizeof(num_facets));
+    for (const stl_facet &facet : mesh.stl.facet_start)
+        key.add(facet.vertex, sizeof(facet.vertex));
+    return key.digest();
+}
+
+// The points are delta encoded and stored as zigzag encoded variable length integers,
+// which takes 2 to 3 bytes per point for the usual polygons instead of 8 bytes.
+static void write_varint(std::string &out, uint64_t value)
+{
+    for (; value >= 0x80; value >>= 7)
+        out += char((value & 0x7f) | 0x80);
+    out += char(value);
+}
+
+static bool read_varint(const char *&ptr, const char *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (ptr == end)
+            return false;
+        uint8_t c = uint8_t(*ptr ++);
+        value |= uint64_t(c & 0x7f) << shift;
+        if ((c & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+static inline uint64_t zigzag_encode(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+static inline int64_t  zigzag_decode(uint64_t v) { return int64_t(v >> 1) ^ - int64_t(v & 1); }
+
+static void write_polygon(std::string &out, const Polygon &polygon)
+{
+    write_varint(out, polygon.points.size());
+    Point prev(0, 0);
+    for (const Point &pt : polygon.points) {
+        write_varint(out, zigzag_encode(int64_t(pt(0)) - int64_t(prev(0))));
+        write_varint(out, zigzag_encode(int64_t(pt(1)) - int64_t(prev(1))));
+        prev = pt;
+    }
+}
+
+static bool read_polygon(const char *&ptr, const char *end, Polygon &polygon)
+{
+    uint64_t num_points;
+    // Each point takes at least two bytes, which bounds the allocation for a damaged entry.
+    if (! read_varint(ptr, end, num_points) || num_points > uint64_t(end - ptr) / 2)
+        return false;
+    polygon.points.reserve(size_t(num_points));
+    int64_t x = 0;
+    int64_t y = 0;
+    for (uint64_t i = 0; i < num_points; ++ i) {
+        uint64_t dx, dy;
+        if (! read_varint(ptr, end, dx) || ! read_varint(ptr, end, dy))
+            return false;
+        x += zigzag_decode(dx);
+        y += zigzag_decode(dy);
+        polygon.points.emplace_back(coord_t(x), coord_t(y));
+    }
+    return true;
+}
+
+std::string SliceCache::serialize(const std::vector<ExPolygons> &layers)
+{
+    std::string out(SLICE_CACHE_MAGIC, 4);
+    write_varint(out, layers.size());
+    for (const ExPolygons &expolygons : layers) {
+        write_varint(out, expolygons.size());
+        for (const ExPolygon &expoly : expolygons) {
+            write_varint(out, expoly.holes.size());
+            write_polygon(out, expoly.contour);
+            for (const Polygon &hole : expoly.holes)
+                write_polygon(out, hole);
+        }
+    }
+    return out;
+}
+
+bool SliceCache::deserialize(const char *begin, const char *end, std::vector<ExPolygons> &layers)
+{
+    layers.clear();
+    const char *ptr = begin;
+    uint64_t    num_layers;
+    if (end - ptr < 4 || memcmp(ptr, SLICE_CACHE_MAGIC, 4) != 0)
+        return false;
+    ptr += 4;
+    if (! read_varint(ptr, end, num_layers) || num_layers > uint64_t(end - ptr))
+        return false;
+    layers.assign(size_t(num_layers), ExPolygons());
+    for (ExPolygons &expolygons : layers) {
+        uint64_t num_expolygons;
+        if (! read_varint(ptr, end, num_expolygons) || num_expolygons > uint64_t(end - ptr))
+            return false;
+        expolygons.assign(size_t(num_expolygons), ExPolygon());
+        for (ExPolygon &expoly : expolygons) {
+            uint64_t num_holes;
+            if (! read_varint(ptr, end, num_holes) || num_holes > uint64_t(end - ptr) || ! read_polygon(ptr, end, expoly.contour))
+                return false;
+            expoly.holes.assign(size_t(num_holes), Polygon());
+            for (Polygon &hole : expoly.holes)
+                if (! read_polygon(ptr, end, hole))
+                    return false;
+        }
+    }
+    return ptr == end;
+}
+
+bool SliceCache::load(const std::string &key, std::vector<ExPolygons> &layers) const
+{
+    std::string path = (boost::filesystem::path(m_dir) / (key + ".slices")).string();
+    MappedFile  file;
+    if (! file.open(path)) {
+        ++ m_misses;
+        return false;
+    }
+    if (! deserialize(file.begin(), file.end(), layers)) {
+        BOOST_LOG_TRIVIAL(warning) << "Slice cache: Ignoring a damaged entry " << path;
+        layers.clear();
+        ++ m_misses;
+        return false;
+    }
+    BOOST_LOG_TRIVIAL(debug) << "Slice cache: Loaded " << path;
+    ++ m_hits;
+    return true;
+}
+
+void SliceCache::store(const std::string &key, const std::vector<ExPolygons> &layers) const
+{
+    boost::filesystem::path   path = boost::filesystem::path(m_dir) / (key + ".slices");
+    boost::filesystem::path   path_tmp = path;
+    boost::system::error_code ec;
+    path_tmp += boost::filesystem::unique_path(".%%%%-%%%%.tmp", ec);
+    boost::filesystem::create_directories(path.parent_path(), ec);
+
+    std::string data = serialize(layers);
+    FILE       *fp   = boost::nowide::fopen(path_tmp.string().c_str(), "wb");
+    if (fp == nullptr) {
+        BOOST_LOG_TRIVIAL(error) << "Slice cache: Couldn't open " << path_tmp.string() << " for writing";
+        return;
+    }
+    bool written = fwrite(data.data(), 1, data.size(), fp) == data.size();
+    written = fclose(fp) == 0 && written;
+    if (! written || rename_file(path_tmp.string(), path.string())) {
+        BOOST_LOG_TRIVIAL(error) << "Slice cache: Failed to write " << path.string();
+        boost::filesystem::remove(path_tmp, ec);
+    }
+}
+
+} // namespace Slic3r
@@ -0,0 +1,73 @@
+#ifndef slic3r_SliceCache_hpp_
+#define slic3r_SliceCache_hpp_
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <boost/uuid/detail/sha1.hpp>
+
+#include "libslic3r.h"
+#include "ExPolygon.hpp"
+#include "Point.hpp"
+
+namespace Slic3r {
+
+class TriangleMesh;
+
+// Persistent on-disk cache of the slices of a mesh, shared by the slicing runs of the GUI and of the command line.
+// A cache entry is addressed by a hash of the slicing input: the meshes with their transformations,
+// the slicing Z coordinates and the slicing relevant configuration values.
+// The value stored is the ExPolygons of each layer in a compact binary format.
+// The entries are written to a temporary file first and renamed, so concurrent processes may share the cache directory.
+class SliceCache
+{
+public:
+    // Hash of the slicing input, accumulated from the meshes and parameters by add().
+    class Key
+    {
+    public:
+        // Hash a mesh by its digest, see mesh_digest(), and its transformation.
+        void        add(const std::string &mesh_digest, const Transform3d &trafo);
+        void        add(const std::vector<float> &zs);
+        void        add(double value);
+        void        add(bool value) { this->add(value ? 1. : 0.); }
+        // Hexadecimal digest, used as a file name.
+        std::string digest();
+
+    private:
+        friend class SliceCache;
+        void        add(const void *data, size_t size);
+
+        boost::uuids::detail::sha1 m_sha1;
+    };
+
+    explicit SliceCache(const std::string &dir) : m_dir(dir) {}
+
+    const std::string& dir() const { return m_dir; }
+
+    // Digest of the facets of a mesh (not of the shared vertices, which may not be initialized).
+    // Hashing a large mesh takes time, thus ModelVolume::mesh_digest() calculates it once per mesh.
+    static std::string mesh_digest(const TriangleMesh &mesh);
+
+    // Returns false if the entry is not found or if it is damaged.
+    bool load(const std::string &key, std::vector<ExPolygons> &layers) const;
+    // Number of the entries loaded and of the entries not found or damaged.
+    size_t hits() const { return m_hits; }
+    size_t misses() const { return m_misses; }
+    // Failures to store an entry are logged and otherwise ignored, the cache is only an optimization.
+    void store(const std::string &key, const std::vector<ExPolygons> &layers) const;
+
+    // The binary format of an entry, exposed for the tests.
+    static std::string serialize(const std::vector<ExPolygons> &layers);
+    static bool        deserialize(const char *begin, const char *end, std::vector<ExPolygons> &layers);
+
+private:
+    std::string                 m_dir;
+    mutable std::atomic<size_t> m_hits   { 0 };
+    mutable std::atomic<size_t> m_misses { 0 };
+};
+
+} // namespace Slic3r
+
+#endif /* slic3r_SliceCache_hpp_ */
@@ -1430,33 +1430,69 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
     if (! top_contacts.empty()) 
     {
         // There is some support to be built, if there are non-empty top surfaces detected.
+        // The projection of a layer is trimmed by the object and stretched into the support grid before it is projected
+        // further down, which does not commute with the union of the contact areas, therefore the top-down sweep below
+        // stays serial. Everything the sweep consumes, which does not depend on the projection, is calculated
+        // in parallel beforehand: the contribution of each top contact layer, and the trimming polygons of the object layers
+        // for a window of layers below the sweep.
+        BOOST_LOG_TRIVIAL(debug) << "Support generator - bottom_contact_layers - projections in parallel - start";
+        std::vector<Polygons> contact_projections(top_contacts.size());
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, top_contacts.size()),
+            [&top_contacts, &contact_projections](const tbb::blocked_range<size_t>& range) {
+                for (size_t contact_idx = range.begin(); contact_idx < range.end(); ++ contact_idx) {
+                    Polygons polygons_new;
+                    // Contact surfaces are expanded away from the object, trimmed by the object.
+                    // Use a slight positive offset to overlap the touching regions.
+#if 0
+                    // Merge and collect the contact polygons. The contact polygons are inflated, but not extended into a grid form.
+                    polygons_append(polygons_new, offset(*top_contacts[contact_idx]->contact_polygons, SCALED_EPSILON));
+#else
+                    // Consume the contact_polygons. The contact polygons are already expanded into a grid form, and they are a tiny bit smaller
+                    // than the grid cells.
+                    polygons_append(polygons_new, std::move(*top_contacts[contact_idx]->contact_polygons));
+#endif
+                    // These are the overhang surfaces. They are touching the object and they are not expanded away from the object.
+                    // Use a slight positive offset to overlap the touching regions.
+                    polygons_append(polygons_new, offset(*top_contacts[contact_idx]->overhang_polygons, float(SCALED_EPSILON)));
+                    contact_projections[contact_idx] = union_(polygons_new);
+                }
+            });
+        // The sweep starts accumulating the projection at the highest object layer below the topmost top contact layer.
+        int num_trimmed_layers = std::max(0, int(object.total_layer_count()) - 1);
+        while (num_trimmed_layers > 0 && top_contacts.back()->print_z <= object.get_layer(num_trimmed_layers - 1)->print_z - EPSILON)
+            -- num_trimmed_layers;
+        BOOST_LOG_TRIVIAL(debug) << "Support generator - bottom_contact_layers - projections in parallel - end";
+        // The trimming polygons are calculated for trimming_window layers at a time and released by the sweep once consumed,
+        // so that the offsetted slices of a tall object are not all held in memory at once.
+        const int             trimming_window = 64;
+        std::vector<Polygons> layer_trimming(num_trimmed_layers);
+        // Lowest layer, for which the trimming polygons were calculated.
+        int                   trimmed_begin   = num_trimmed_layers;
+
         // Sum of unsupported contact areas above the current layer.print_z.
         Polygons  projection;
         // Last top contact layer visited when collecting the projection of contact areas.
         int       contact_idx = int(top_contacts.size()) - 1;
-        for (int layer_id = int(object.total_layer_count()) - 2; layer_id >= 0; -- layer_id) {
+        for (int layer_id = num_trimmed_layers - 1; layer_id >= 0; -- layer_id) {
             BOOST_LOG_TRIVIAL(trace) << "Support generator - bottom_contact_layers - layer " << layer_id;
             const Layer &layer = *object.get_layer(layer_id);
             // Collect projections of all contact areas above or at the same level as this top surface.
-            for (; contact_idx >= 0 && top_contacts[contact_idx]->print_z > layer.print_z - EPSILON; -- contact_idx) {
-                Polygons polygons_new;
-                // Contact surfaces are expanded away from the object, trimmed by the object.
-                // Use a slight positive offset to overlap the touching regions.
-#if 0
-                // Merge and collect the contact polygons. The contact polygons are inflated, but not extended into a grid form.
-                polygons_append(polygons_new, offset(*top_contacts[contact_idx]->contact_polygons, SCALED_EPSILON));
-#else
-                // Consume the contact_polygons. The contact polygons are already expanded into a grid form, and they are a tiny bit smaller
-                // than the grid cells.
-                polygons_append(polygons_new, std::move(*top_contacts[contact_idx]->contact_polygons));
-#endif
-                // These are the overhang surfaces. They are touching the object and they are not expanded away from the object.
-                // Use a slight positive offset to overlap the touching regions.
-                polygons_append(polygons_new, offset(*top_contacts[contact_idx]->overhang_polygons, float(SCALED_EPSILON)));
-                polygons_append(projection, union_(polygons_new));
-            }
-            if (projection.empty())
+            for (; contact_idx >= 0 && top_contacts[contact_idx]->print_z > layer.print_z - EPSILON; -- contact_idx)
+                polygons_append(projection, std::move(contact_projections[contact_idx]));
+            if (projection.empty()) {
+                // The projection may vanish inside a window, release the trimming polygons calculated for this layer.
+                Polygons().swap(layer_trimming[layer_id]);
                 continue;
+            }
+            if (layer_id < trimmed_begin) {
+                int trimmed_end = layer_id + 1;
+                trimmed_begin = std::max(0, trimmed_end - trimming_window);
+                tbb::parallel_for(tbb::blocked_range<int>(trimmed_begin, trimmed_end),
+                    [&object, &layer_trimming](const tbb::blocked_range<int>& range) {
+                        for (int layer_id = range.begin(); layer_id < range.end(); ++ layer_id)
+                            layer_trimming[layer_id] = offset(object.get_layer(layer_id)->slices, float(SCALED_EPSILON));
+                    });
+            }
             Polygons projection_raw = union_(projection);
 
             tbb::task_group task_group;
@@ -1570,10 +1606,10 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
                 });
 
             Polygons &layer_support_area = layer_support_areas[layer_id];
-            task_group.run([this, &projection, &projection_raw, &layer, &layer_support_area, layer_id] {
+            Polygons &trimming           = layer_trimming[layer_id];
+            task_group.run([this, &projection, &projection_raw, &layer, &layer_support_area, &trimming, layer_id] {
                 // Remove the areas that touched from the projection that will continue on next, lower, top surfaces.
     //            Polygons trimming = union_(to_polygons(layer.slices), touching, true);
-                Polygons trimming = offset(layer.slices, float(SCALED_EPSILON));
                 projection = diff(projection_raw, trimming, false);
     #ifdef SLIC3R_DEBUG
                 {
@@ -1633,6 +1669,8 @@ PrintObjectSupportMaterial::MyLayersPtr PrintObjectSupportMaterial::bottom_conta
                 projection = std::move(projection_new);
             });
             task_group.wait();
+            // Release the trimming polygons of this layer, they are no more needed.
+            Polygons().swap(trimming);
         }
         std::reverse(bottom_contacts.begin(), bottom_contacts.end());
 //        trim_support_layers_by_object(object, bottom_contacts, 0., 0., m_gap_xy);
@@ -19,6 +19,7 @@
 #include <boost/log/trivial.hpp>
 
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
 
 #include <Eigen/Core>
 #include <Eigen/Dense>
@@ -658,11 +659,37 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
         throw std::invalid_argument("TriangleMeshSlicer was passed a mesh without shared vertices.");
 
     throw_on_cancel();
-    facets_edges.assign(_mesh->stl.stats.number_of_facets * 3, -1);
+    m_z_index.clear();
+    m_use_trafo = false;
+    m_trafo_left_handed = false;
 	v_scaled_shared.assign(_mesh->its.vertices.size(), stl_vertex());
 	for (size_t i = 0; i < v_scaled_shared.size(); ++ i)
         this->v_scaled_shared[i] = _mesh->its.vertices[i] / float(SCALING_FACTOR);
+    this->facets_edges = make_facets_edges(*_mesh, throw_on_cancel);
+}
+
+void TriangleMeshSlicer::init(const TriangleMesh *_mesh, const Transform3d &trafo, std::shared_ptr<const std::vector<int>> _facets_edges, throw_on_cancel_callback_type throw_on_cancel)
+{
+    mesh = _mesh;
+    if (! mesh->has_shared_vertices())
+        throw std::invalid_argument("TriangleMeshSlicer was passed a mesh without shared vertices.");
+
+    throw_on_cancel();
+    m_z_index.clear();
+    m_trafo             = trafo;
+    m_use_trafo         = true;
+    m_trafo_left_handed = trafo.matrix().block(0, 0, 3, 3).determinant() < 0.;
+    v_scaled_shared.clear();
+    v_scaled_shared.shrink_to_fit();
+    assert(! _facets_edges || _facets_edges->size() == _mesh->its.indices.size() * 3);
+    this->facets_edges = _facets_edges ? std::move(_facets_edges) : make_facets_edges(*_mesh, throw_on_cancel);
+}
 
+std::shared_ptr<const std::vector<int>> TriangleMeshSlicer::make_facets_edges(const TriangleMesh &mesh, throw_on_cancel_callback_type throw_on_cancel)
+{
+    const indexed_triangle_set &its = mesh.its;
+    auto facets_edges_ptr = std::make_shared<std::vector<int>>(its.indices.size() * 3, -1);
+    std::vector<int> &facets_edges = *facets_edges_ptr;
     // Create a mapping from triangle edge into face.
     struct EdgeToFace {
         // Index of the 1st vertex of the triangle edge. vertex_low <= vertex_high.
@@ -677,12 +704,12 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
         bool operator<(const EdgeToFace &other) const { return vertex_low < other.vertex_low || (vertex_low == other.vertex_low && vertex_high < other.vertex_high); }
     };
     std::vector<EdgeToFace> edges_map;
-    edges_map.assign(this->mesh->stl.stats.number_of_facets * 3, EdgeToFace());
-    for (uint32_t facet_idx = 0; facet_idx < this->mesh->stl.stats.number_of_facets; ++ facet_idx)
+    edges_map.assign(its.indices.size() * 3, EdgeToFace());
+    for (uint32_t facet_idx = 0; facet_idx < its.indices.size(); ++ facet_idx)
         for (int i = 0; i < 3; ++ i) {
             EdgeToFace &e2f = edges_map[facet_idx*3+i];
-            e2f.vertex_low  = this->mesh->its.indices[facet_idx][i];
-            e2f.vertex_high = this->mesh->its.indices[facet_idx][(i + 1) % 3];
+            e2f.vertex_low  = its.indices[facet_idx][i];
+            e2f.vertex_high = its.indices[facet_idx][(i + 1) % 3];
             e2f.face        = facet_idx;
             // 1 based indexing, to be always strictly positive.
             e2f.face_edge   = i + 1;
@@ -725,10 +752,10 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
                 }
         }
         // Assign an edge index to the 1st face.
-        this->facets_edges[edge_i.face * 3 + std::abs(edge_i.face_edge) - 1] = num_edges;
+        facets_edges[edge_i.face * 3 + std::abs(edge_i.face_edge) - 1] = num_edges;
         if (found) {
             EdgeToFace &edge_j = edges_map[j];
-            this->facets_edges[edge_j.face * 3 + std::abs(edge_j.face_edge) - 1] = num_edges;
+            facets_edges[edge_j.face * 3 + std::abs(edge_j.face_edge) - 1] = num_edges;
             // Mark the edge as connected.
             edge_j.face = -1;
         }
@@ -736,14 +763,70 @@ void TriangleMeshSlicer::init(const TriangleMesh *_mesh, throw_on_cancel_callbac
         if ((i & 0x0ffff) == 0)
             throw_on_cancel();
     }
+    return facets_edges_ptr;
 }
 
+inline stl_triangle_vertex_indices TriangleMeshSlicer::facet_vertices(size_t facet_idx) const
+{
+    const stl_triangle_vertex_indices &vertices = this->mesh->its.indices[facet_idx];
+    return m_trafo_left_handed ? stl_triangle_vertex_indices(vertices(0), vertices(2), vertices(1)) : vertices;
+}
 
+inline int TriangleMeshSlicer::facet_edge(size_t facet_idx, int edge) const
+{
+    // Edges of a reversed facet (v0, v2, v1) are (v0, v2), (v2, v1), (v1, v0), which are the edges 2, 1, 0 of the original facet.
+    return (*this->facets_edges)[facet_idx * 3 + (m_trafo_left_handed ? 2 - edge : edge)];
+}
+
+inline stl_vertex TriangleMeshSlicer::vertex_scaled(int vertex_idx) const
+{
+    stl_vertex v = m_use_trafo ?
+        stl_vertex((m_trafo * this->mesh->its.vertices[vertex_idx].cast<double>()).cast<float>() / float(SCALING_FACTOR)) :
+        this->v_scaled_shared[vertex_idx];
+    return m_use_quaternion ? stl_vertex(m_quaternion * v) : v;
+}
+
+inline stl_facet TriangleMeshSlicer::facet(size_t facet_idx) const
+{
+    if (! m_use_trafo)
+        return m_use_quaternion ? this->mesh->stl.facet_start[facet_idx].rotated(m_quaternion) : this->mesh->stl.facet_start[facet_idx];
+    // Transform the vertices the same way as TriangleMesh::transform() would.
+    stl_triangle_vertex_indices vertices = this->facet_vertices(facet_idx);
+    stl_facet facet;
+    for (int i = 0; i < 3; ++ i)
+        facet.vertex[i] = (m_trafo * this->mesh->its.vertices[vertices(i)].cast<double>()).cast<float>();
+    // Only the orientation of the normal is used for slicing.
+    facet.normal = (facet.vertex[1] - facet.vertex[0]).cross(facet.vertex[2] - facet.vertex[0]);
+    return m_use_quaternion ? facet.rotated(m_quaternion) : facet;
+}
 
 void TriangleMeshSlicer::set_up_direction(const Vec3f& up)
 {
     m_quaternion.setFromTwoVectors(up, Vec3f::UnitZ());
     m_use_quaternion = true;
+    this->clear_z_index();
+}
+
+void TriangleMeshSlicer::build_z_index(throw_on_cancel_callback_type throw_on_cancel)
+{
+    BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::build_z_index - start";
+    m_z_index.assign(this->mesh->stl.stats.number_of_facets, FacetZSpan());
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, m_z_index.size()),
+        [this](const tbb::blocked_range<size_t>& range) {
+            for (size_t facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx) {
+                const stl_facet  facet = this->facet(facet_idx);
+                FacetZSpan      &span  = m_z_index[facet_idx];
+                span.min_z     = fminf(facet.vertex[0](2), fminf(facet.vertex[1](2), facet.vertex[2](2)));
+                span.max_z     = fmaxf(facet.vertex[0](2), fmaxf(facet.vertex[1](2), facet.vertex[2](2)));
+                span.facet_idx = uint32_t(facet_idx);
+            }
+        });
+    throw_on_cancel();
+    // Sort by the facet index as a secondary key, so that the order of the index is unique.
+    tbb::parallel_sort(m_z_index.begin(), m_z_index.end(), [](const FacetZSpan &s1, const FacetZSpan &s2)
+        { return s1.min_z < s2.min_z || (s1.min_z == s2.min_z && s1.facet_idx < s2.facet_idx); });
+    BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::build_z_index - end";
 }
 
 
@@ -779,17 +862,57 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
         type is float.
     */
     
-    BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::_slice_do";
     std::vector<IntersectionLines> lines(z.size());
-    {
-        boost::mutex lines_mutex;
+    if (this->has_z_index()) {
+        BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::_slice_sweep";
+        this->_slice_sweep(z, lines, throw_on_cancel);
+    } else {
+        BOOST_LOG_TRIVIAL(debug) << "TriangleMeshSlicer::_slice_do";
+        // Each chunk of facets collects its intersection lines into a private buffer, therefore the facets
+        // are sliced in parallel without any locking. The buffers are then merged into the layers in the order
+        // of the chunks, so that the order of lines in a layer does not depend on the thread scheduling.
+        const size_t num_facets       = this->mesh->stl.stats.number_of_facets;
+        const size_t facets_per_chunk = 0x04000;
+        std::vector<LayerIntersectionLines> chunks((num_facets + facets_per_chunk - 1) / facets_per_chunk);
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, chunks.size()),
+            [&chunks, &z, num_facets, facets_per_chunk, throw_on_cancel, this](const tbb::blocked_range<size_t>& range) {
+                for (size_t chunk_idx = range.begin(); chunk_idx < range.end(); ++ chunk_idx) {
+                    throw_on_cancel();
+                    LayerIntersectionLines &chunk = chunks[chunk_idx];
+                    size_t facet_end = std::min(num_facets, (chunk_idx + 1) * facets_per_chunk);
+                    for (size_t facet_idx = chunk_idx * facets_per_chunk; facet_idx < facet_end; ++ facet_idx)
+                        this->_slice_do(facet_idx, &chunk, z);
+                    // Group the lines by layers, keep the facet order inside a layer.
+                    std::stable_sort(chunk.begin(), chunk.end(), 
+                        [](const std::pair<size_t, IntersectionLine> &l1, const std::pair<size_t, IntersectionLine> &l2) { return l1.first < l2.first; });
+                }
+            }
+        );
+        throw_on_cancel();
         tbb::parallel_for(
-            tbb::blocked_range<int>(0,this->mesh->stl.stats.number_of_facets),
-            [&lines, &lines_mutex, &z, throw_on_cancel, this](const tbb::blocked_range<int>& range) {
-                for (int facet_idx = range.begin(); facet_idx < range.end(); ++ facet_idx) {
-                    if ((facet_idx & 0x0ffff) == 0)
+            tbb::blocked_range<size_t>(0, z.size()),
+            [&chunks, &lines, throw_on_cancel](const tbb::blocked_range<size_t>& range) {
+                auto lower = [](const std::pair<size_t, IntersectionLine> &l, size_t layer_idx) { return l.first < layer_idx; };
+                for (size_t layer_idx = range.begin(); layer_idx < range.end(); ++ layer_idx) {
+                    if ((layer_idx & 0x0ffff) == 0)
                         throw_on_cancel();
-                    this->_slice_do(facet_idx, &lines, &lines_mutex, z);
+                    std::vector<std::pair<LayerIntersectionLines::const_iterator, LayerIntersectionLines::const_iterator>> spans;
+                    size_t num_lines = 0;
+                    for (const LayerIntersectionLines &chunk : chunks) {
+                        auto begin = std::lower_bound(chunk.begin(), chunk.end(), layer_idx, lower);
+                        auto end   = begin;
+                        for (; end != chunk.end() && end->first == layer_idx; ++ end) ;
+                        if (begin != end) {
+                            spans.emplace_back(begin, end);
+                            num_lines += end - begin;
+                        }
+                    }
+                    IntersectionLines &layer_lines = lines[layer_idx];
+                    layer_lines.reserve(num_lines);
+                    for (const auto &span : spans)
+                        for (auto it = span.first; it != span.second; ++ it)
+                            layer_lines.emplace_back(it->second);
                 }
             }
         );
@@ -847,10 +970,9 @@ void TriangleMeshSlicer::slice(const std::vector<float> &z, std::vector<Polygons
 #endif
 }
 
-void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, 
-    const std::vector<float> &z) const
+void TriangleMeshSlicer::_slice_do(size_t facet_idx, LayerIntersectionLines* lines, const std::vector<float> &z) const
 {
-    const stl_facet &facet = m_use_quaternion ? (this->mesh->stl.facet_start.data() + facet_idx)->rotated(m_quaternion) : *(this->mesh->stl.facet_start.data() + facet_idx);
+    const stl_facet facet = this->facet(facet_idx);
     
     // find facet extents
     const float min_z = fminf(facet.vertex[0](2), fminf(facet.vertex[1](2), facet.vertex[2](2)));
@@ -876,13 +998,71 @@ void TriangleMeshSlicer::_slice_do(size_t facet_idx, std::vector<IntersectionLin
         std::vector<float>::size_type layer_idx = it - z.begin();
         IntersectionLine il;
         if (this->slice_facet(*it / SCALING_FACTOR, facet, facet_idx, min_z, max_z, &il) == TriangleMeshSlicer::Slicing) {
-            boost::lock_guard<boost::mutex> l(*lines_mutex);
             if (il.edge_type == feHorizontal) {
                 // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
             } else
-                (*lines)[layer_idx].emplace_back(il);
+                lines->emplace_back(layer_idx, il);
+        }
+    }
+}
+
+// Sweep the slicing planes upwards over the facets sorted by their minimum z, maintaining a set of facets crossing the current plane.
+// The slicing planes are split into blocks swept in parallel. The order of lines in a layer follows the order of the z index,
+// therefore it does not depend on the thread scheduling.
+void TriangleMeshSlicer::_slice_sweep(const std::vector<float> &z, std::vector<IntersectionLines> &lines, throw_on_cancel_callback_type throw_on_cancel) const
+{
+    if (z.empty())
+        return;
+    const size_t num_blocks = std::min<size_t>(z.size(), 64);
+    std::vector<size_t> block_begin(num_blocks + 1);
+    for (size_t block = 0; block <= num_blocks; ++ block)
+        block_begin[block] = block * z.size() / num_blocks;
+
+    // Sequential sweep over the first slicing planes of the blocks to collect the facets active at the start of each block.
+    // Both the active facets and the start of the not yet active facets are stored as indices into m_z_index.
+    std::vector<std::vector<uint32_t>> block_active(num_blocks);
+    std::vector<size_t>                block_next(num_blocks);
+    {
+        std::vector<uint32_t> active;
+        size_t                next = 0;
+        for (size_t block = 0; block < num_blocks; ++ block) {
+            float slice_z = z[block_begin[block]];
+            for (; next < m_z_index.size() && m_z_index[next].min_z <= slice_z; ++ next)
+                active.emplace_back(uint32_t(next));
+            active.erase(std::remove_if(active.begin(), active.end(), [this, slice_z](uint32_t i){ return m_z_index[i].max_z < slice_z; }), active.end());
+            block_active[block] = active;
+            block_next[block]   = next;
         }
     }
+    throw_on_cancel();
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, num_blocks, 1),
+        [this, &z, &lines, &block_begin, &block_active, &block_next, throw_on_cancel](const tbb::blocked_range<size_t>& range) {
+            for (size_t block = range.begin(); block < range.end(); ++ block) {
+                std::vector<uint32_t> &active = block_active[block];
+                size_t                 next   = block_next[block];
+                for (size_t layer_idx = block_begin[block]; layer_idx < block_begin[block + 1]; ++ layer_idx) {
+                    throw_on_cancel();
+                    float slice_z = z[layer_idx];
+                    for (; next < m_z_index.size() && m_z_index[next].min_z <= slice_z; ++ next)
+                        active.emplace_back(uint32_t(next));
+                    active.erase(std::remove_if(active.begin(), active.end(), [this, slice_z](uint32_t i){ return m_z_index[i].max_z < slice_z; }), active.end());
+                    IntersectionLines &layer_lines = lines[layer_idx];
+                    for (uint32_t i : active) {
+                        const FacetZSpan &span  = m_z_index[i];
+                        const stl_facet   facet = this->facet(span.facet_idx);
+                        IntersectionLine  il;
+                        // Ignore horizontal triangles. Any valid horizontal triangle must have a vertical triangle connected, otherwise the part has zero volume.
+                        if (this->slice_facet(slice_z / SCALING_FACTOR, facet, span.facet_idx, span.min_z, span.max_z, &il) == TriangleMeshSlicer::Slicing &&
+                            il.edge_type != feHorizontal)
+                            layer_lines.emplace_back(il);
+                    }
+                }
+                // Release the active set early.
+                active = std::vector<uint32_t>();
+            }
+        });
 }
 
 void TriangleMeshSlicer::slice(const std::vector<float> &z, const float closing_radius, std::vector<ExPolygons>* layers, throw_on_cancel_callback_type throw_on_cancel) const
@@ -919,38 +1099,26 @@ TriangleMeshSlicer::FacetSliceType TriangleMeshSlicer::slice_facet(
     // Reorder vertices so that the first one is the one with lowest Z.
     // This is needed to get all intersection lines in a consistent order
     // (external on the right of the line)
-    const stl_triangle_vertex_indices &vertices = this->mesh->its.indices[facet_idx];
+    const stl_triangle_vertex_indices vertices = this->facet_vertices(facet_idx);
     int i = (facet.vertex[1].z() == min_z) ? 1 : ((facet.vertex[2].z() == min_z) ? 2 : 0);
 
-    // These are used only if the cut plane is tilted:
-    stl_vertex rotated_a;
-    stl_vertex rotated_b;
+    // Scaled vertices of the facet, transformed and rotated if the mesh is sliced with a transformation or a tilted cut plane.
+    const stl_vertex v_scaled[3] = { this->vertex_scaled(vertices[0]), this->vertex_scaled(vertices[1]), this->vertex_scaled(vertices[2]) };
 
     for (int j = i; j - i < 3; ++j) {  // loop through facet edges
-        int        edge_id  = this->facets_edges[facet_idx * 3 + (j % 3)];
+        int        edge_id  = this->facet_edge(facet_idx, j % 3);
         int        a_id     = vertices[j % 3];
         int        b_id     = vertices[(j+1) % 3];
 
-        const stl_vertex *a;
-        const stl_vertex *b;
-        if (m_use_quaternion) {
-            rotated_a = m_quaternion * this->v_scaled_shared[a_id];
-            rotated_b = m_quaternion * this->v_scaled_shared[b_id];
-            a = &rotated_a;
-            b = &rotated_b;
-        }
-        else {
-            a = &this->v_scaled_shared[a_id];
-            b = &this->v_scaled_shared[b_id];
-        }
+        const stl_vertex *a = &v_scaled[j % 3];
+        const stl_vertex *b = &v_scaled[(j+1) % 3];
         
         // Is edge or face aligned with the cutting plane?
         if (a->z() == slice_z && b->z() == slice_z) {
             // Edge is horizontal and belongs to the current layer.
-            // The following rotation of the three vertices may not be efficient, but this branch happens rarely.
-            const stl_vertex &v0 = m_use_quaternion ? stl_vertex(m_quaternion * this->v_scaled_shared[vertices[0]]) : this->v_scaled_shared[vertices[0]];
-            const stl_vertex &v1 = m_use_quaternion ? stl_vertex(m_quaternion * this->v_scaled_shared[vertices[1]]) : this->v_scaled_shared[vertices[1]];
-            const stl_vertex &v2 = m_use_quaternion ? stl_vertex(m_quaternion * this->v_scaled_shared[vertices[2]]) : this->v_scaled_shared[vertices[2]];
+            const stl_vertex &v0 = v_scaled[0];
+            const stl_vertex &v1 = v_scaled[1];
+            const stl_vertex &v2 = v_scaled[2];
             const stl_normal &normal = facet.normal;
             // We may ignore this edge for slicing purposes, but we may still use it for object cutting.
             FacetSliceType    result = Slicing;
@@ -1067,9 +1235,7 @@ TriangleMeshSlicer::FacetSliceType TriangleMeshSlicer::slice_facet(
             if (i == line_out->a_id || i == line_out->b_id)
                 i = vertices[2];
             assert(i != line_out->a_id && i != line_out->b_id);
-            line_out->edge_type = ((m_use_quaternion ?
-                                    (m_quaternion * this->v_scaled_shared[i]).z()
-                                    : this->v_scaled_shared[i].z()) < slice_z) ? feTop : feBottom;
+            line_out->edge_type = (this->vertex_scaled(i).z() < slice_z) ? feTop : feBottom;
         }
 #endif
         return Slicing;
@@ -1741,6 +1907,8 @@ void TriangleMeshSlicer::make_expolygons(std::vector<IntersectionLine> &lines, c
 
 void TriangleMeshSlicer::cut(float z, TriangleMesh* upper, TriangleMesh* lower) const
 {
+    // Cutting works on the facets of the mesh, not on the transformed facets.
+    assert(! m_use_trafo);
     IntersectionLines upper_lines, lower_lines;
     
     BOOST_LOG_TRIVIAL(trace) << "TriangleMeshSlicer::cut - slicing object";
@@ -4,6 +4,7 @@
 #include "libslic3r.h"
 #include <admesh/stl.h>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <boost/thread.hpp>
 #include "BoundingBox.hpp"
@@ -168,8 +169,17 @@ public:
     TriangleMeshSlicer() : mesh(nullptr) {}
 	TriangleMeshSlicer(const TriangleMesh* mesh) { this->init(mesh, [](){}); }
     void init(const TriangleMesh *mesh, throw_on_cancel_callback_type throw_on_cancel);
+    // Slice the mesh transformed by trafo. The vertices are transformed on the fly, so that neither the mesh is copied
+    // nor its shared vertices are duplicated. A left handed transformation flips the facets.
+    // The map from the facets to the edges depends on the mesh only, it may be reused from make_facets_edges().
+    void init(const TriangleMesh *mesh, const Transform3d &trafo, std::shared_ptr<const std::vector<int>> facets_edges, throw_on_cancel_callback_type throw_on_cancel);
     void slice(const std::vector<float> &z, std::vector<Polygons>* layers, throw_on_cancel_callback_type throw_on_cancel) const;
     void slice(const std::vector<float> &z, const float closing_radius, std::vector<ExPolygons>* layers, throw_on_cancel_callback_type throw_on_cancel) const;
+    // Merge the loops produced by slice() into ExPolygons, closing the gaps up to closing_radius.
+    // Used to merge the loops of multiple meshes sliced separately.
+    void make_expolygons(const Polygons &loops, const float closing_radius, ExPolygons* slices) const;
+    // Map from a facet to an edge index of a mesh with shared vertices.
+    static std::shared_ptr<const std::vector<int>> make_facets_edges(const TriangleMesh &mesh, throw_on_cancel_callback_type throw_on_cancel = [](){});
     enum FacetSliceType {
         NoSlice = 0,
         Slicing = 1,
@@ -178,22 +188,51 @@ public:
     FacetSliceType slice_facet(float slice_z, const stl_facet &facet, const int facet_idx,
         const float min_z, const float max_z, IntersectionLine *line_out) const;
     void cut(float z, TriangleMesh* upper, TriangleMesh* lower) const;
+    // Clears the z sorted facet index, call build_z_index() again after changing the up direction.
     void set_up_direction(const Vec3f& up);
+    // Sort the facets by their minimum z. If the index is available, slice() sweeps the slicing planes upwards
+    // over a set of active facets instead of searching the slicing planes for each facet.
+    // The index is retained by the slicer, so that it is reused by repeated calls to slice() with different z lists.
+    void build_z_index(throw_on_cancel_callback_type throw_on_cancel = [](){});
+    void clear_z_index() { m_z_index.clear(); m_z_index.shrink_to_fit(); }
+    bool has_z_index() const { return ! m_z_index.empty(); }
     
 private:
     const TriangleMesh      *mesh;
     // Map from a facet to an edge index.
-    std::vector<int>         facets_edges;
-    // Scaled copy of this->mesh->stl.v_shared
+    std::shared_ptr<const std::vector<int>> facets_edges;
+    // Scaled copy of this->mesh->stl.v_shared, not used if m_use_trafo.
     std::vector<stl_vertex>  v_scaled_shared;
+    // Transformation applied to the vertices on the fly.
+    Transform3d              m_trafo;
+    // Whether or not the above transformation should be used
+    bool                     m_use_trafo = false;
+    // The transformation is left handed, the order of the facet vertices is reversed to keep the facets oriented outwards.
+    bool                     m_trafo_left_handed = false;
     // Quaternion that will be used to rotate every facet before the slicing
     Eigen::Quaternion<float, Eigen::DontAlign> m_quaternion;
     // Whether or not the above quaterion should be used
     bool                     m_use_quaternion = false;
+    // Z extent of a facet, the index is sorted by min_z.
+    struct FacetZSpan {
+        float    min_z;
+        float    max_z;
+        uint32_t facet_idx;
+    };
+    std::vector<FacetZSpan>  m_z_index;
+
+    // Intersection lines of a chunk of facets, each tagged with the index of the layer it belongs to.
+    typedef std::vector<std::pair<size_t, IntersectionLine>> LayerIntersectionLines;
 
-    void _slice_do(size_t facet_idx, std::vector<IntersectionLines>* lines, boost::mutex* lines_mutex, const std::vector<float> &z) const;
+    // Facet, its vertex indices, edge indices and scaled vertices after the transformation and rotation are applied.
+    stl_facet                   facet(size_t facet_idx) const;
+    stl_triangle_vertex_indices facet_vertices(size_t facet_idx) const;
+    int                         facet_edge(size_t facet_idx, int edge) const;
+    stl_vertex                  vertex_scaled(int vertex_idx) const;
+
+    void _slice_do(size_t facet_idx, LayerIntersectionLines* lines, const std::vector<float> &z) const;
+    void _slice_sweep(const std::vector<float> &z, std::vector<IntersectionLines> &lines, throw_on_cancel_callback_type throw_on_cancel) const;
     void make_loops(std::vector<IntersectionLine> &lines, Polygons* loops) const;
-    void make_expolygons(const Polygons &loops, const float closing_radius, ExPolygons* slices) const;
     void make_expolygons_simple(std::vector<IntersectionLine> &lines, ExPolygons* slices) const;
     void make_expolygons(std::vector<IntersectionLine> &lines, const float closing_radius, ExPolygons* slices) const;
 };
@@ -268,6 +268,33 @@ public:
     void reset() { closure = Closure(); }
 };
 
+// Read only memory mapping of a whole file, the path is UTF-8 encoded.
+// The mapped data is not zero terminated. An empty file is mapped to an empty range.
+class MappedFile
+{
+public:
+    MappedFile() {}
+    explicit MappedFile(const std::string &path) { this->open(path); }
+    MappedFile(const MappedFile&) = delete;
+    ~MappedFile() { this->close(); }
+
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false if the file could not be opened or mapped.
+    bool        open(const std::string &path);
+    void        close();
+
+    bool        is_open() const { return m_data != nullptr; }
+    const char* data()    const { return m_data; }
+    size_t      size()    const { return m_size; }
+    const char* begin()   const { return m_data; }
+    const char* end()     const { return m_data + m_size; }
+
+private:
+    const char *m_data = nullptr;
+    size_t      m_size = 0;
+};
+
 // Shorten the dhms time by removing the seconds, rounding the dhm to full minutes
 // and removing spaces.
 inline std::string short_time(const std::string &time)
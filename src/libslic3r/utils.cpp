@@ -16,6 +16,9 @@
 	#include <sys/types.h>
 	#include <sys/param.h>
     #include <sys/resource.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
 	#ifdef BSD
 		#include <sys/sysctl.h>
 	#endif
@@ -722,6 +725,59 @@ unsigned get_current_pid()
 #endif
 }
 
+bool MappedFile::open(const std::string &path)
+{
+    this->close();
+#ifdef WIN32
+    HANDLE file = ::CreateFileW(boost::nowide::widen(path).c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (::GetFileSizeEx(file, &size)) {
+        if (size.QuadPart == 0)
+            m_data = "";
+        else if (HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr); mapping != nullptr) {
+            // The view keeps the file mapping object alive.
+            m_data = (const char*)::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (m_data != nullptr)
+                m_size = size_t(size.QuadPart);
+            ::CloseHandle(mapping);
+        }
+    }
+    ::CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    struct stat st;
+    if (::fstat(fd, &st) == 0) {
+        if (st.st_size == 0)
+            m_data = "";
+        else if (void *ptr = ::mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0); ptr != MAP_FAILED) {
+            ::madvise(ptr, size_t(st.st_size), MADV_SEQUENTIAL);
+            m_data = (const char*)ptr;
+            m_size = size_t(st.st_size);
+        }
+    }
+    // The mapping stays valid after the file descriptor is closed.
+    ::close(fd);
+#endif
+    return this->is_open();
+}
+
+void MappedFile::close()
+{
+    if (m_size > 0) {
+#ifdef WIN32
+        ::UnmapViewOfFile(m_data);
+#else
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
 std::string xml_escape(std::string text)
 {
     std::string::size_type pos = 0;
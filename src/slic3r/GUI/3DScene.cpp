@@ -14,6 +14,7 @@
 #include "libslic3r/Format/STL.hpp"
 #include "libslic3r/Utils.hpp"
 
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -83,35 +84,191 @@ void GLIndexedVertexArray::finalize_geometry(bool opengl_initialized)
     assert(this->triangle_indices_VBO_id == 0);
     assert(this->quad_indices_VBO_id == 0);
 
+    if (this->compact_on_finalize)
+        this->compact_geometry();
+
 	if (! opengl_initialized) {
 		// Shrink the data vectors to conserve memory in case the data cannot be transfered to the OpenGL driver yet.
 		this->shrink_to_fit();
 		return;
 	}
 
+    auto upload = [](GLenum target, unsigned int &VBO_id, const void *data, size_t size) {
+        glsafe(::glGenBuffers(1, &VBO_id));
+        glsafe(::glBindBuffer(target, VBO_id));
+        glsafe(::glBufferData(target, size, data, GL_STATIC_DRAW));
+        glsafe(::glBindBuffer(target, 0));
+    };
+    if (m_compacted) {
+        if (! m_compact_vertices.empty()) {
+            upload(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id, m_compact_vertices.data(), m_compact_vertices.size() * sizeof(CompactVertex));
+            m_compact_vertices = std::vector<CompactVertex>();
+        }
+        if (! m_triangle_indices_16bit.empty()) {
+            upload(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices_VBO_id, m_triangle_indices_16bit.data(), m_triangle_indices_16bit.size() * sizeof(uint16_t));
+            m_triangle_indices_16bit = std::vector<uint16_t>();
+        }
+        if (! m_quad_indices_16bit.empty()) {
+            upload(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices_VBO_id, m_quad_indices_16bit.data(), m_quad_indices_16bit.size() * sizeof(uint16_t));
+            m_quad_indices_16bit = std::vector<uint16_t>();
+        }
+    }
     if (! this->vertices_and_normals_interleaved.empty()) {
-        glsafe(::glGenBuffers(1, &this->vertices_and_normals_interleaved_VBO_id));
-        glsafe(::glBindBuffer(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id));
-        glsafe(::glBufferData(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved.size() * 4, this->vertices_and_normals_interleaved.data(), GL_STATIC_DRAW));
-        glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
+        upload(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id, this->vertices_and_normals_interleaved.data(), this->vertices_and_normals_interleaved.size() * 4);
         this->vertices_and_normals_interleaved.clear();
     }
     if (! this->triangle_indices.empty()) {
-        glsafe(::glGenBuffers(1, &this->triangle_indices_VBO_id));
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices_VBO_id));
-        glsafe(::glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices.size() * 4, this->triangle_indices.data(), GL_STATIC_DRAW));
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+        upload(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices_VBO_id, this->triangle_indices.data(), this->triangle_indices.size() * 4);
         this->triangle_indices.clear();
     }
     if (! this->quad_indices.empty()) {
-        glsafe(::glGenBuffers(1, &this->quad_indices_VBO_id));
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices_VBO_id));
-        glsafe(::glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices.size() * 4, this->quad_indices.data(), GL_STATIC_DRAW));
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+        upload(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices_VBO_id, this->quad_indices.data(), this->quad_indices.size() * 4);
         this->quad_indices.clear();
     }
 }
 
+void GLIndexedVertexArray::compact_geometry()
+{
+    assert(this->vertices_and_normals_interleaved_VBO_id == 0);
+    if (m_compacted || this->vertices_and_normals_interleaved.empty())
+        return;
+
+    // Quantize relative to the center of the bounding box with the same scale along all the axes,
+    // so that the compact_matrix() does not distort the normals. The shaders normalize the transformed normals.
+    Vec3d  size   = m_bounding_box.size();
+    double extent = 0.5 * std::max(size.x(), std::max(size.y(), size.z()));
+    m_compact_origin = m_bounding_box.center();
+    m_compact_scale  = (extent > 0.) ? extent / 32767. : 1.;
+    double inv_scale = 1. / m_compact_scale;
+
+    size_t num_vertices = this->vertices_and_normals_interleaved.size() / 6;
+    m_compact_vertices.assign(num_vertices, CompactVertex());
+    for (size_t i = 0; i < num_vertices; ++ i) {
+        const float   *src = this->vertices_and_normals_interleaved.data() + i * 6;
+        CompactVertex &dst = m_compact_vertices[i];
+        for (int j = 0; j < 3; ++ j) {
+            dst.normal[j]   = int8_t(std::lround(std::max(-1.f, std::min(1.f, src[j])) * 127.f));
+            dst.position[j] = int16_t(std::lround(std::max(-32767., std::min(32767., (double(src[j + 3]) - m_compact_origin(j)) * inv_scale))));
+        }
+        dst.padding_position = 0;
+        dst.padding_normal   = 0;
+    }
+    this->vertices_and_normals_interleaved = std::vector<float>();
+
+    m_indices_16bit = num_vertices <= 65536;
+    if (m_indices_16bit) {
+        m_triangle_indices_16bit.assign(this->triangle_indices.begin(), this->triangle_indices.end());
+        m_quad_indices_16bit.assign(this->quad_indices.begin(), this->quad_indices.end());
+        this->triangle_indices = std::vector<int>();
+        this->quad_indices     = std::vector<int>();
+    }
+    m_compacted = true;
+}
+
+Transform3d GLIndexedVertexArray::compact_matrix() const
+{
+    Transform3d m = Transform3d::Identity();
+    if (m_compacted) {
+        m.translate(m_compact_origin);
+        m.scale(m_compact_scale);
+    }
+    return m;
+}
+
+void GLIndexedVertexArray::copy_compact(const GLIndexedVertexArray &rhs)
+{
+    this->compact_on_finalize      = rhs.compact_on_finalize;
+    this->m_compact_vertices       = rhs.m_compact_vertices;
+    this->m_triangle_indices_16bit = rhs.m_triangle_indices_16bit;
+    this->m_quad_indices_16bit     = rhs.m_quad_indices_16bit;
+    this->m_compacted              = rhs.m_compacted;
+    this->m_indices_16bit          = rhs.m_indices_16bit;
+    this->m_compact_origin         = rhs.m_compact_origin;
+    this->m_compact_scale          = rhs.m_compact_scale;
+}
+
+void GLIndexedVertexArray::move_compact(GLIndexedVertexArray &rhs)
+{
+    this->compact_on_finalize      = rhs.compact_on_finalize;
+    this->m_compact_vertices       = std::move(rhs.m_compact_vertices);
+    this->m_triangle_indices_16bit = std::move(rhs.m_triangle_indices_16bit);
+    this->m_quad_indices_16bit     = std::move(rhs.m_quad_indices_16bit);
+    this->m_compacted              = rhs.m_compacted;
+    this->m_indices_16bit          = rhs.m_indices_16bit;
+    this->m_compact_origin         = rhs.m_compact_origin;
+    this->m_compact_scale          = rhs.m_compact_scale;
+}
+
+std::vector<float> GLIndexedVertexArray::get_vertices_and_normals_interleaved() const
+{
+    std::vector<float>         out;
+    std::vector<CompactVertex> compact_vertices;
+    if (! this->vertices_and_normals_interleaved.empty())
+        // data are in CPU memory
+        out = this->vertices_and_normals_interleaved;
+    else if (! m_compact_vertices.empty())
+        compact_vertices = m_compact_vertices;
+    else if (this->vertices_and_normals_interleaved_VBO_id != 0 && this->vertices_and_normals_interleaved_size != 0) {
+        // data are in GPU memory
+        glsafe(::glBindBuffer(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id));
+        if (m_compacted) {
+            compact_vertices.assign(this->vertices_and_normals_interleaved_size / 6, CompactVertex());
+            glsafe(::glGetBufferSubData(GL_ARRAY_BUFFER, 0, compact_vertices.size() * sizeof(CompactVertex), compact_vertices.data()));
+        } else {
+            out.assign(this->vertices_and_normals_interleaved_size, 0.0f);
+            glsafe(::glGetBufferSubData(GL_ARRAY_BUFFER, 0, out.size() * sizeof(float), out.data()));
+        }
+        glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
+    }
+    if (! compact_vertices.empty()) {
+        out.reserve(compact_vertices.size() * 6);
+        for (const CompactVertex &v : compact_vertices) {
+            for (int j = 0; j < 3; ++ j)
+                out.emplace_back(float(v.normal[j]) / 127.f);
+            for (int j = 0; j < 3; ++ j)
+                out.emplace_back(float(m_compact_origin(j) + m_compact_scale * v.position[j]));
+        }
+    }
+    return out;
+}
+
+std::vector<int> GLIndexedVertexArray::get_indices(const std::vector<int> &indices, const std::vector<uint16_t> &indices_16bit, unsigned int VBO_id, size_t size, size_t first, size_t count) const
+{
+    std::vector<int> out;
+    if (! indices.empty()) {
+        // data are in CPU memory
+        count = std::min(indices.size() - std::min(indices.size(), first), count);
+        out.assign(indices.begin() + first, indices.begin() + first + count);
+    } else if (! indices_16bit.empty()) {
+        count = std::min(indices_16bit.size() - std::min(indices_16bit.size(), first), count);
+        out.assign(indices_16bit.begin() + first, indices_16bit.begin() + first + count);
+    } else if (VBO_id != 0 && first < size) {
+        // data are in GPU memory
+        count = std::min(size - first, count);
+        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, VBO_id));
+        if (m_indices_16bit) {
+            std::vector<uint16_t> data(count, 0);
+            glsafe(::glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, first * sizeof(uint16_t), count * sizeof(uint16_t), data.data()));
+            out.assign(data.begin(), data.end());
+        } else {
+            out.assign(count, 0);
+            glsafe(::glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, first * sizeof(int), count * sizeof(int), out.data()));
+        }
+        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    }
+    return out;
+}
+
+std::vector<int> GLIndexedVertexArray::get_triangle_indices(size_t first, size_t count) const
+{
+    return this->get_indices(this->triangle_indices, m_triangle_indices_16bit, this->triangle_indices_VBO_id, this->triangle_indices_size, first, count);
+}
+
+std::vector<int> GLIndexedVertexArray::get_quad_indices(size_t first, size_t count) const
+{
+    return this->get_indices(this->quad_indices, m_quad_indices_16bit, this->quad_indices_VBO_id, this->quad_indices_size, first, count);
+}
+
 void GLIndexedVertexArray::release_geometry()
 {
     if (this->vertices_and_normals_interleaved_VBO_id) {
@@ -129,34 +286,22 @@ void GLIndexedVertexArray::release_geometry()
     this->clear();
 }
 
-void GLIndexedVertexArray::render() const
+void GLIndexedVertexArray::set_vertex_pointers() const
 {
-    assert(this->vertices_and_normals_interleaved_VBO_id != 0);
-    assert(this->triangle_indices_VBO_id != 0 || this->quad_indices_VBO_id != 0);
-
     glsafe(::glBindBuffer(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id));
-    glsafe(::glVertexPointer(3, GL_FLOAT, 6 * sizeof(float), (const void*)(3 * sizeof(float))));
-    glsafe(::glNormalPointer(GL_FLOAT, 6 * sizeof(float), nullptr));
-
-    glsafe(::glEnableClientState(GL_VERTEX_ARRAY));
-    glsafe(::glEnableClientState(GL_NORMAL_ARRAY));
-
-    // Render using the Vertex Buffer Objects.
-    if (this->triangle_indices_size > 0) {
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices_VBO_id));
-        glsafe(::glDrawElements(GL_TRIANGLES, GLsizei(this->triangle_indices_size), GL_UNSIGNED_INT, nullptr));
-        glsafe(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-    }
-    if (this->quad_indices_size > 0) {
-        glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices_VBO_id));
-        glsafe(::glDrawElements(GL_QUADS, GLsizei(this->quad_indices_size), GL_UNSIGNED_INT, nullptr));
-        glsafe(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    if (m_compacted) {
+        // The positions are converted to floats as they are, the normals are normalized to <-1, 1>.
+        glsafe(::glVertexPointer(3, GL_SHORT, sizeof(CompactVertex), (const void*)offsetof(CompactVertex, position)));
+        glsafe(::glNormalPointer(GL_BYTE, sizeof(CompactVertex), (const void*)offsetof(CompactVertex, normal)));
+    } else {
+        glsafe(::glVertexPointer(3, GL_FLOAT, 6 * sizeof(float), (const void*)(3 * sizeof(float))));
+        glsafe(::glNormalPointer(GL_FLOAT, 6 * sizeof(float), nullptr));
     }
+}
 
-    glsafe(::glDisableClientState(GL_VERTEX_ARRAY));
-    glsafe(::glDisableClientState(GL_NORMAL_ARRAY));
-
-    glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
+void GLIndexedVertexArray::render() const
+{
+    this->render(std::pair<size_t, size_t>(0, this->triangle_indices_size), std::pair<size_t, size_t>(0, this->quad_indices_size));
 }
 
 void GLIndexedVertexArray::render(
@@ -166,22 +311,26 @@ void GLIndexedVertexArray::render(
     assert(this->vertices_and_normals_interleaved_VBO_id != 0);
     assert(this->triangle_indices_VBO_id != 0 || this->quad_indices_VBO_id != 0);
 
+    if (m_compacted) {
+        glsafe(::glPushMatrix());
+        glsafe(::glMultMatrixd(this->compact_matrix().data()));
+    }
+
     // Render using the Vertex Buffer Objects.
-    glsafe(::glBindBuffer(GL_ARRAY_BUFFER, this->vertices_and_normals_interleaved_VBO_id));
-    glsafe(::glVertexPointer(3, GL_FLOAT, 6 * sizeof(float), (const void*)(3 * sizeof(float))));
-    glsafe(::glNormalPointer(GL_FLOAT, 6 * sizeof(float), nullptr));
+    this->set_vertex_pointers();
 
     glsafe(::glEnableClientState(GL_VERTEX_ARRAY));
     glsafe(::glEnableClientState(GL_NORMAL_ARRAY));
 
+    GLenum index_type = m_indices_16bit ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
     if (this->triangle_indices_size > 0) {
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->triangle_indices_VBO_id));
-        glsafe(::glDrawElements(GL_TRIANGLES, GLsizei(std::min(this->triangle_indices_size, tverts_range.second - tverts_range.first)), GL_UNSIGNED_INT, (const void*)(tverts_range.first * 4)));
+        glsafe(::glDrawElements(GL_TRIANGLES, GLsizei(std::min(this->triangle_indices_size, tverts_range.second - tverts_range.first)), index_type, (const void*)(tverts_range.first * this->index_size())));
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
     }
     if (this->quad_indices_size > 0) {
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->quad_indices_VBO_id));
-        glsafe(::glDrawElements(GL_QUADS, GLsizei(std::min(this->quad_indices_size, qverts_range.second - qverts_range.first)), GL_UNSIGNED_INT, (const void*)(qverts_range.first * 4)));
+        glsafe(::glDrawElements(GL_QUADS, GLsizei(std::min(this->quad_indices_size, qverts_range.second - qverts_range.first)), index_type, (const void*)(qverts_range.first * this->index_size())));
         glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
     }
 
@@ -189,6 +338,9 @@ void GLIndexedVertexArray::render(
     glsafe(::glDisableClientState(GL_NORMAL_ARRAY));
     
     glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    if (m_compacted)
+        glsafe(::glPopMatrix());
 }
 
 const float GLVolume::BASE_DMT_COLOR[4] = { 0.1f, 0.1f, 0.1f, 1.0f };
@@ -423,7 +575,8 @@ void GLVolume::render(int color_id, int detection_id, int worldmatrix_id) const
         glsafe(::glUniform1i(detection_id, shader_outside_printer_detection_enabled ? 1 : 0));
 
     if (worldmatrix_id != -1)
-        glsafe(::glUniformMatrix4fv(worldmatrix_id, 1, GL_FALSE, (const GLfloat*)world_matrix().cast<float>().data()));
+        // The shader transforms the vertices as they are stored, including the compact ones.
+        glsafe(::glUniformMatrix4fv(worldmatrix_id, 1, GL_FALSE, (const GLfloat*)(world_matrix() * this->indexed_vertex_array.compact_matrix()).cast<float>().data()));
 
     render();
 }
@@ -602,6 +755,8 @@ GLVolume* GLVolumeCollection::new_toolpath_volume(const float *rgba, size_t rese
 	GLVolume *out = new_nontoolpath_volume(rgba, reserve_vbo_floats);
   out->base_dmt = false;
 	out->is_extrusion_path = true;
+	// The toolpaths are not edited once loaded, store them in the compact format.
+	out->indexed_vertex_array.compact_on_finalize = true;
 	return out;
 }
 
@@ -918,74 +1073,12 @@ void GLVolumeCollection::export_toolpaths_to_obj(const char* filename) const
         if (!can_export_to_obj(*volume))
             continue;
 
-        std::vector<float> src_vertices_and_normals_interleaved;
-        std::vector<int>   src_triangle_indices;
-        std::vector<int>   src_quad_indices;
-
-        if (!volume->indexed_vertex_array.vertices_and_normals_interleaved.empty())
-            // data are in CPU memory
-            src_vertices_and_normals_interleaved = volume->indexed_vertex_array.vertices_and_normals_interleaved;
-        else if ((volume->indexed_vertex_array.vertices_and_normals_interleaved_VBO_id != 0) && (volume->indexed_vertex_array.vertices_and_normals_interleaved_size != 0))
-        {
-            // data are in GPU memory
-            src_vertices_and_normals_interleaved = std::vector<float>(volume->indexed_vertex_array.vertices_and_normals_interleaved_size, 0.0f);
-
-            glsafe(::glBindBuffer(GL_ARRAY_BUFFER, volume->indexed_vertex_array.vertices_and_normals_interleaved_VBO_id));
-            glsafe(::glGetBufferSubData(GL_ARRAY_BUFFER, 0, src_vertices_and_normals_interleaved.size() * sizeof(float), src_vertices_and_normals_interleaved.data()));
-            glsafe(::glBindBuffer(GL_ARRAY_BUFFER, 0));
-        }
-        else
+        std::vector<float> src_vertices_and_normals_interleaved = volume->indexed_vertex_array.get_vertices_and_normals_interleaved();
+        if (src_vertices_and_normals_interleaved.empty())
             continue;
 
-        if (!volume->indexed_vertex_array.triangle_indices.empty())
-        {
-            // data are in CPU memory
-            size_t size = std::min(volume->indexed_vertex_array.triangle_indices.size(), volume->tverts_range.second - volume->tverts_range.first);
-            if (size != 0)
-            {
-                std::vector<int>::const_iterator it_begin = volume->indexed_vertex_array.triangle_indices.begin() + volume->tverts_range.first;
-                std::vector<int>::const_iterator it_end = volume->indexed_vertex_array.triangle_indices.begin() + volume->tverts_range.first + size;
-                std::copy(it_begin, it_end, std::back_inserter(src_triangle_indices));
-            }
-        }
-        else if ((volume->indexed_vertex_array.triangle_indices_VBO_id != 0) && (volume->indexed_vertex_array.triangle_indices_size != 0))
-        {
-            // data are in GPU memory
-            size_t size = std::min(volume->indexed_vertex_array.triangle_indices_size, volume->tverts_range.second - volume->tverts_range.first);
-            if (size != 0)
-            {
-                src_triangle_indices = std::vector<int>(size, 0);
-
-                glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, volume->indexed_vertex_array.triangle_indices_VBO_id));
-                glsafe(::glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, volume->tverts_range.first * sizeof(int), size * sizeof(int), src_triangle_indices.data()));
-                glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-            }
-        }
-
-        if (!volume->indexed_vertex_array.quad_indices.empty())
-        {
-            // data are in CPU memory
-            size_t size = std::min(volume->indexed_vertex_array.quad_indices.size(), volume->qverts_range.second - volume->qverts_range.first);
-            if (size != 0)
-            {
-                std::vector<int>::const_iterator it_begin = volume->indexed_vertex_array.quad_indices.begin() + volume->qverts_range.first;
-                std::vector<int>::const_iterator it_end = volume->indexed_vertex_array.quad_indices.begin() + volume->qverts_range.first + size;
-                std::copy(it_begin, it_end, std::back_inserter(src_quad_indices));
-            }
-        }
-        else if ((volume->indexed_vertex_array.quad_indices_VBO_id != 0) && (volume->indexed_vertex_array.quad_indices_size != 0))
-        {
-            // data are in GPU memory
-            size_t size = std::min(volume->indexed_vertex_array.quad_indices_size, volume->qverts_range.second - volume->qverts_range.first);
-            if (size != 0)
-            {
-                src_quad_indices = std::vector<int>(size, 0);
-
-                glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, volume->indexed_vertex_array.quad_indices_VBO_id));
-                glsafe(::glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, volume->qverts_range.first * sizeof(int), size * sizeof(int), src_quad_indices.data()));
-                glsafe(::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-            }
-        }
+        std::vector<int> src_triangle_indices = volume->indexed_vertex_array.get_triangle_indices(volume->tverts_range.first, volume->tverts_range.second - volume->tverts_range.first);
+        std::vector<int> src_quad_indices     = volume->indexed_vertex_array.get_quad_indices(volume->qverts_range.first, volume->qverts_range.second - volume->qverts_range.first);
 
         if (src_triangle_indices.empty() && src_quad_indices.empty())
             continue;
@@ -1769,6 +1862,72 @@ void _3DScene::extrusionentity_to_verts(const ExtrusionEntity *extrusion_entity,
     }
 }
 
+// Upper bound of the geometry emitted by thick_lines_to_indexed_vertex_array() for num_lines line segments
+// with num_height_changes changes of the layer height between successive segments, including the closing transition of a loop.
+// The bound is tight for the straight segments, it only overestimates the vertices shared at the smooth turns.
+static void thick_lines_size(size_t num_lines, size_t num_height_changes, bool closed, GLIndexedVertexArray::Size &size)
+{
+    if (num_lines == 0)
+        return;
+    // 8 vertices for the 1st segment, up to 6 for the following ones plus one for a change of the layer height,
+    // up to 2 more for the closing transition of a loop.
+    size.vertices  += 8 + 6 * (num_lines - 1) + num_height_changes + (closed ? 2 : 0);
+    // 4 sides of each segment, 2 caps at the ends of an open path or 1 cap at the start of a loop,
+    // 2 caps at each change of the layer height.
+    size.quads     += 4 * num_lines + (closed ? 1 : 2) + 2 * num_height_changes;
+    // 2 triangles filling a wedge at each sharp turn.
+    size.triangles += 2 * (num_lines - 1) + (closed ? 2 : 0);
+}
+
+// Number of lines of the polyline after polyline.remove_duplicate_points(), without modifying the polyline.
+static size_t num_lines_without_duplicates(const Polyline &polyline)
+{
+    size_t num_lines = 0;
+    for (size_t i = 1; i < polyline.points.size(); ++ i)
+        if (polyline.points[i] != polyline.points[i - 1])
+            ++ num_lines;
+    return num_lines;
+}
+
+static void extrusion_paths_size(const ExtrusionPaths &paths, bool closed, GLIndexedVertexArray::Size &size)
+{
+    size_t num_lines          = 0;
+    size_t num_height_changes = 0;
+    double height_first       = 0.;
+    double height_prev        = 0.;
+    for (const ExtrusionPath &path : paths) {
+        size_t num_lines_this = num_lines_without_duplicates(path.polyline);
+        if (num_lines_this == 0)
+            continue;
+        if (num_lines == 0)
+            height_first = path.height;
+        else if (path.height != height_prev)
+            ++ num_height_changes;
+        height_prev = path.height;
+        num_lines  += num_lines_this;
+    }
+    if (closed && num_lines > 0 && height_prev != height_first)
+        ++ num_height_changes;
+    thick_lines_size(num_lines, num_height_changes, closed, size);
+}
+
+void _3DScene::extrusionentity_to_verts_size(const ExtrusionEntity *extrusion_entity, GLIndexedVertexArray::Size &size)
+{
+    if (extrusion_entity != nullptr) {
+        if (auto *extrusion_path = dynamic_cast<const ExtrusionPath*>(extrusion_entity))
+            thick_lines_size(num_lines_without_duplicates(extrusion_path->polyline), 0, false, size);
+        else if (auto *extrusion_loop = dynamic_cast<const ExtrusionLoop*>(extrusion_entity))
+            extrusion_paths_size(extrusion_loop->paths, true, size);
+        else if (auto *extrusion_multi_path = dynamic_cast<const ExtrusionMultiPath*>(extrusion_entity))
+            extrusion_paths_size(extrusion_multi_path->paths, false, size);
+        else if (auto *extrusion_entity_collection = dynamic_cast<const ExtrusionEntityCollection*>(extrusion_entity)) {
+            for (const ExtrusionEntity *ee : extrusion_entity_collection->entities)
+                extrusionentity_to_verts_size(ee, size);
+        } else
+            throw std::runtime_error("Unexpected extrusion_entity type in to_verts_size()");
+    }
+}
+
 void _3DScene::polyline3_to_verts(const Polyline3& polyline, double width, double height, GLVolume& volume)
 {
     Lines3 lines = polyline.lines();
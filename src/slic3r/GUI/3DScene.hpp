@@ -64,7 +64,7 @@ public:
         vertices_and_normals_interleaved_VBO_id(0),
         triangle_indices_VBO_id(0),
         quad_indices_VBO_id(0)
-        { assert(! rhs.has_VBOs()); }
+        { assert(! rhs.has_VBOs()); this->copy_compact(rhs); }
     GLIndexedVertexArray(GLIndexedVertexArray &&rhs) :
         vertices_and_normals_interleaved(std::move(rhs.vertices_and_normals_interleaved)),
         triangle_indices(std::move(rhs.triangle_indices)),
@@ -72,7 +72,7 @@ public:
         vertices_and_normals_interleaved_VBO_id(0),
         triangle_indices_VBO_id(0),
         quad_indices_VBO_id(0)
-        { assert(! rhs.has_VBOs()); }
+        { assert(! rhs.has_VBOs()); this->move_compact(rhs); }
 
     ~GLIndexedVertexArray() { release_geometry(); }
 
@@ -91,6 +91,7 @@ public:
         this->vertices_and_normals_interleaved_size  = rhs.vertices_and_normals_interleaved_size;
         this->triangle_indices_size                  = rhs.triangle_indices_size;
         this->quad_indices_size                      = rhs.quad_indices_size;
+        this->copy_compact(rhs);
         return *this;
     }
 
@@ -109,9 +110,30 @@ public:
         this->vertices_and_normals_interleaved_size  = rhs.vertices_and_normals_interleaved_size;
         this->triangle_indices_size                  = rhs.triangle_indices_size;
         this->quad_indices_size                      = rhs.quad_indices_size;
+        this->move_compact(rhs);
         return *this;
     }
 
+    // Vertex of the compact format, into which the toolpaths are converted to save host and GPU memory.
+    // The position is quantized to 16 bits relative to the center of the bounding box, the normal to signed bytes.
+    // Both are padded to 4 bytes, a vertex takes 12 bytes instead of 24 bytes of the GL_N3F_V3F format.
+    struct CompactVertex {
+        int16_t position[3];
+        int16_t padding_position;
+        int8_t  normal[3];
+        int8_t  padding_normal;
+    };
+
+    // Number of vertices, triangles and quads to be pushed into the vertex array, used to preallocate the buffers.
+    struct Size {
+        size_t vertices{ 0 };
+        size_t triangles{ 0 };
+        size_t quads{ 0 };
+
+        bool  empty() const { return vertices == 0; }
+        Size& operator+=(const Size &rhs) { vertices += rhs.vertices; triangles += rhs.triangles; quads += rhs.quads; return *this; }
+    };
+
     // Vertices and their normals, interleaved to be used by void glInterleavedArrays(GL_N3F_V3F, 0, x)
     std::vector<float> vertices_and_normals_interleaved;
     std::vector<int>   triangle_indices;
@@ -129,6 +151,14 @@ public:
     unsigned int       triangle_indices_VBO_id{ 0 };
     unsigned int       quad_indices_VBO_id{ 0 };
 
+    // Convert the geometry to the compact format by finalize_geometry(). Set by GLVolumeCollection::new_toolpath_volume()
+    // for the toolpaths, which are large and which are not modified after being loaded.
+    // An extrusion takes about 4 indices per vertex, thus a 24 + 16 bytes per vertex shrinks to 12 + 8 bytes with 16 bit indices,
+    // to about a half. Volumes of more than 64k vertices keep 32 bit indices and shrink to 12 + 16 bytes only. Of the toolpath
+    // volumes, only the print object volumes are limited to 64k vertices, the skirt, wipe tower and G-code preview volumes
+    // are split at 128k vertices.
+    bool               compact_on_finalize{ false };
+
     void load_mesh_full_shading(const TriangleMesh &mesh);
     void load_mesh(const TriangleMesh& mesh) { this->load_mesh_full_shading(mesh); }
 
@@ -140,9 +170,16 @@ public:
         this->quad_indices.reserve(sz * 4);
     }
 
+    // Reserve the buffers for the geometry described by size on top of the geometry already stored.
+    inline void reserve_more(const Size &size) {
+        this->vertices_and_normals_interleaved.reserve(this->vertices_and_normals_interleaved.size() + size.vertices * 6);
+        this->triangle_indices.reserve(this->triangle_indices.size() + size.triangles * 3);
+        this->quad_indices.reserve(this->quad_indices.size() + size.quads * 4);
+    }
+
     inline void push_geometry(float x, float y, float z, float nx, float ny, float nz) {
-        assert(this->vertices_and_normals_interleaved_VBO_id == 0);
-        if (this->vertices_and_normals_interleaved_VBO_id != 0)
+        assert(this->vertices_and_normals_interleaved_VBO_id == 0 && ! m_compacted);
+        if (this->vertices_and_normals_interleaved_VBO_id != 0 || m_compacted)
             return;
 
         if (this->vertices_and_normals_interleaved.size() + 6 > this->vertices_and_normals_interleaved.capacity())
@@ -167,11 +204,11 @@ public:
     }
 
     inline void push_triangle(int idx1, int idx2, int idx3) {
-        assert(this->vertices_and_normals_interleaved_VBO_id == 0);
-        if (this->vertices_and_normals_interleaved_VBO_id != 0)
+        assert(this->vertices_and_normals_interleaved_VBO_id == 0 && ! m_compacted);
+        if (this->vertices_and_normals_interleaved_VBO_id != 0 || m_compacted)
             return;
 
-        if (this->triangle_indices.size() + 3 > this->vertices_and_normals_interleaved.capacity())
+        if (this->triangle_indices.size() + 3 > this->triangle_indices.capacity())
             this->triangle_indices.reserve(next_highest_power_of_2(this->triangle_indices.size() + 3));
         this->triangle_indices.emplace_back(idx1);
         this->triangle_indices.emplace_back(idx2);
@@ -180,11 +217,11 @@ public:
     };
 
     inline void push_quad(int idx1, int idx2, int idx3, int idx4) {
-        assert(this->vertices_and_normals_interleaved_VBO_id == 0);
-        if (this->vertices_and_normals_interleaved_VBO_id != 0)
+        assert(this->vertices_and_normals_interleaved_VBO_id == 0 && ! m_compacted);
+        if (this->vertices_and_normals_interleaved_VBO_id != 0 || m_compacted)
             return;
 
-        if (this->quad_indices.size() + 4 > this->vertices_and_normals_interleaved.capacity())
+        if (this->quad_indices.size() + 4 > this->quad_indices.capacity())
             this->quad_indices.reserve(next_highest_power_of_2(this->quad_indices.size() + 4));
         this->quad_indices.emplace_back(idx1);
         this->quad_indices.emplace_back(idx2);
@@ -196,7 +233,15 @@ public:
     // Finalize the initialization of the geometry & indices,
     // upload the geometry and indices to OpenGL VBO objects
     // and shrink the allocated data, possibly relasing it if it has been loaded into the VBOs.
+    // Converts the geometry to the compact format first if compact_on_finalize is set.
+    // May be called repeatedly with opengl_initialized == false.
     void finalize_geometry(bool opengl_initialized);
+    // Quantize the vertices and normals into the compact format, use 16 bit indices if there are at most 64k vertices.
+    // No geometry may be pushed afterwards.
+    void compact_geometry();
+    bool is_compacted() const { return m_compacted; }
+    // Transformation of the compact vertices to the original coordinates, identity if not compacted.
+    Transform3d compact_matrix() const;
     // Release the geometry data, release OpenGL VBOs.
     void release_geometry();
 
@@ -210,6 +255,11 @@ public:
         this->vertices_and_normals_interleaved.clear();
         this->triangle_indices.clear();
         this->quad_indices.clear();
+        this->m_compact_vertices.clear();
+        this->m_triangle_indices_16bit.clear();
+        this->m_quad_indices_16bit.clear();
+        this->m_compacted = false;
+        this->m_indices_16bit = false;
         this->m_bounding_box.reset();
         vertices_and_normals_interleaved_size = 0;
         triangle_indices_size = 0;
@@ -221,28 +271,58 @@ public:
         this->vertices_and_normals_interleaved.shrink_to_fit();
         this->triangle_indices.shrink_to_fit();
         this->quad_indices.shrink_to_fit();
+        this->m_compact_vertices.shrink_to_fit();
+        this->m_triangle_indices_16bit.shrink_to_fit();
+        this->m_quad_indices_16bit.shrink_to_fit();
     }
 
     const BoundingBoxf3& bounding_box() const { return m_bounding_box; }
 
+    // Vertices and their normals in the GL_N3F_V3F format, decoded from the compact format
+    // and possibly downloaded from the VBO. Used for exporting the geometry.
+    std::vector<float> get_vertices_and_normals_interleaved() const;
+    // Up to count triangle / quad indices starting with first, possibly downloaded from the VBO.
+    std::vector<int>   get_triangle_indices(size_t first, size_t count) const;
+    std::vector<int>   get_quad_indices(size_t first, size_t count) const;
+
     // Return an estimate of the memory consumed by this class.
-    size_t cpu_memory_used() const { return sizeof(*this) + vertices_and_normals_interleaved.capacity() * sizeof(float) + triangle_indices.capacity() * sizeof(int) + quad_indices.capacity() * sizeof(int); }
+    size_t cpu_memory_used() const { 
+        return sizeof(*this) + vertices_and_normals_interleaved.capacity() * sizeof(float) + triangle_indices.capacity() * sizeof(int) + quad_indices.capacity() * sizeof(int) +
+            m_compact_vertices.capacity() * sizeof(CompactVertex) + m_triangle_indices_16bit.capacity() * sizeof(uint16_t) + m_quad_indices_16bit.capacity() * sizeof(uint16_t);
+    }
     // Return an estimate of the memory held by GPU vertex buffers.
     size_t gpu_memory_used() const
     {
     	size_t memsize = 0;
     	if (this->vertices_and_normals_interleaved_VBO_id != 0)
-    		memsize += this->vertices_and_normals_interleaved_size * 4;
+    		memsize += m_compacted ? this->vertices_and_normals_interleaved_size / 6 * sizeof(CompactVertex) : this->vertices_and_normals_interleaved_size * 4;
     	if (this->triangle_indices_VBO_id != 0)
-    		memsize += this->triangle_indices_size * 4;
+    		memsize += this->triangle_indices_size * this->index_size();
     	if (this->quad_indices_VBO_id != 0)
-    		memsize += this->quad_indices_size * 4;
+    		memsize += this->quad_indices_size * this->index_size();
     	return memsize;
     }
     size_t total_memory_used() const { return this->cpu_memory_used() + this->gpu_memory_used(); }
 
 private:
+    size_t index_size() const { return m_indices_16bit ? sizeof(uint16_t) : sizeof(int); }
+    void   copy_compact(const GLIndexedVertexArray &rhs);
+    void   move_compact(GLIndexedVertexArray &rhs);
+    std::vector<int> get_indices(const std::vector<int> &indices, const std::vector<uint16_t> &indices_16bit, unsigned int VBO_id, size_t size, size_t first, size_t count) const;
+    void   set_vertex_pointers() const;
+
     BoundingBoxf3 m_bounding_box;
+
+    // Geometry in the compact format, filled in by compact_geometry() and released once loaded into the VBOs.
+    // The vertices_and_normals_interleaved_size keeps counting the floats of the GL_N3F_V3F format.
+    std::vector<CompactVertex> m_compact_vertices;
+    std::vector<uint16_t>      m_triangle_indices_16bit;
+    std::vector<uint16_t>      m_quad_indices_16bit;
+    bool                       m_compacted{ false };
+    bool                       m_indices_16bit{ false };
+    // Position of a compact vertex: m_compact_origin + m_compact_scale * CompactVertex::position
+    Vec3d                      m_compact_origin{ Vec3d::Zero() };
+    double                     m_compact_scale{ 1. };
 };
 
 class GLVolume {
@@ -673,6 +753,9 @@ public:
     static void extrusionentity_to_verts(const ExtrusionMultiPath& extrusion_multi_path, float print_z, const Point& copy, GLVolume& volume);
     static void extrusionentity_to_verts(const ExtrusionEntityCollection& extrusion_entity_collection, float print_z, const Point& copy, GLVolume& volume);
     static void extrusionentity_to_verts(const ExtrusionEntity* extrusion_entity, float print_z, const Point& copy, GLVolume& volume);
+    // Upper bound of the geometry generated by extrusionentity_to_verts(extrusion_entity, print_z, copy, volume), accumulated into size.
+    // Used to preallocate the vertex arrays before tessellating, so that the tessellation does not reallocate.
+    static void extrusionentity_to_verts_size(const ExtrusionEntity* extrusion_entity, GLIndexedVertexArray::Size& size);
     static void polyline3_to_verts(const Polyline3& polyline, double width, double height, GLVolume& volume);
     static void point3_to_verts(const Vec3crd& point, double width, double height, GLVolume& volume);
 };
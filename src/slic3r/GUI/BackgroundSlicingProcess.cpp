@@ -89,6 +89,12 @@ void BackgroundSlicingProcess::process_fff()
 	assert(m_print == m_fff_print);
     m_print->process();
 	wxQueueEvent(GUI::wxGetApp().mainframe->m_plater, new wxCommandEvent(m_event_slicing_completed_id));
+	// Tag the layers streamed to the preview with the generation of this export, so that the UI thread drops them
+	// if this export is canceled before their events are processed.
+	unsigned int generation = ++ m_gcode_preview_generation;
+	m_fff_print->set_gcode_preview_layers_callback([this, generation](GCodePreviewData &&preview_data) {
+		wxQueueEvent(GUI::wxGetApp().mainframe->m_plater, new GCodePreviewLayersEvent(m_event_gcode_preview_layers_id, 0, generation, std::move(preview_data)));
+	});
 #if ENABLE_THUMBNAIL_GENERATOR
     m_fff_print->export_gcode(m_temp_output_path, m_gcode_preview_data, m_thumbnail_cb);
 #else
@@ -299,6 +305,7 @@ bool BackgroundSlicingProcess::stop()
 	}
 //	assert(this->running());
 	if (m_state == STATE_STARTED || m_state == STATE_RUNNING) {
+		++ m_gcode_preview_generation;
 		m_print->cancel();
 		// Wait until the background processing stops by being canceled.
 		m_condition.wait(lck, [this](){ return m_state == STATE_CANCELED; });
@@ -335,6 +342,7 @@ void BackgroundSlicingProcess::stop_internal()
 	std::unique_lock<std::mutex> lck(m_mutex);
 	assert(m_state == STATE_STARTED || m_state == STATE_RUNNING || m_state == STATE_FINISHED || m_state == STATE_CANCELED);
 	if (m_state == STATE_STARTED || m_state == STATE_RUNNING) {
+		++ m_gcode_preview_generation;
 		// At this point of time the worker thread may be blocking on m_print->state_mutex().
 		// Set the print state to canceled before unlocking the state_mutex(), so when the worker thread wakes up,
 		// it throws the CanceledException().
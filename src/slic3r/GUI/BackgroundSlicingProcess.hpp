@@ -1,6 +1,7 @@
 #ifndef slic3r_GUI_BackgroundSlicingProcess_hpp_
 #define slic3r_GUI_BackgroundSlicingProcess_hpp_
 
+#include <atomic>
 #include <string>
 #include <condition_variable>
 #include <mutex>
@@ -10,13 +11,13 @@
 #include <wx/event.h>
 
 #include "libslic3r/Print.hpp"
+#include "libslic3r/GCode/PreviewData.hpp"
 #include "slic3r/Utils/PrintHost.hpp"
 #include "slic3r/Utils/Thread.hpp"
 
 namespace Slic3r {
 
 class DynamicPrintConfig;
-class GCodePreviewData;
 class Model;
 class SLAPrint;
 
@@ -32,6 +33,20 @@ public:
 
 wxDEFINE_EVENT(EVT_SLICING_UPDATE, SlicingStatusEvent);
 
+// Carries the extrusion layers exported since the previous event and the value ranges of all the layers exported so far
+// from the background thread to the preview.
+class GCodePreviewLayersEvent : public wxEvent
+{
+public:
+	GCodePreviewLayersEvent(wxEventType eventType, int winid, unsigned int generation, GCodePreviewData &&preview_data) :
+		wxEvent(winid, eventType), generation(generation), preview_data(std::move(preview_data)) {}
+	virtual wxEvent *Clone() const { return new GCodePreviewLayersEvent(*this); }
+
+	// BackgroundSlicingProcess::gcode_preview_generation() of the export, which produced the layers.
+	unsigned int 		generation;
+	GCodePreviewData 	preview_data;
+};
+
 // Print step IDs for keeping track of the print state.
 enum BackgroundSlicingProcessStep {
     bspsGCodeFinalize, bspsCount,
@@ -60,6 +75,12 @@ public:
 	// The following wxCommandEvent will be sent to the UI thread / Platter window, when the G-code export is finished.
 	// The wxCommandEvent is sent to the UI thread asynchronously without waiting for the event to be processed.
 	void set_finished_event(int event_id) { m_event_finished_id = event_id; }
+	// The following GCodePreviewLayersEvent will be sent to the UI thread / Platter window with the layers exported so far,
+	// while the G-code export is running. The event is sent asynchronously, it may be processed after the export was canceled.
+	void set_gcode_preview_layers_event(int event_id) { m_event_gcode_preview_layers_id = event_id; }
+	// Incremented when a G-code export is started and when the background processing is canceled.
+	// The GCodePreviewLayersEvents of a different generation are stale and shall be dropped.
+	unsigned int gcode_preview_generation() const { return m_gcode_preview_generation; }
 
 	// Activate either m_fff_print or m_sla_print.
 	// Return true if changed.
@@ -195,6 +216,10 @@ private:
 	int 						m_event_slicing_completed_id 	= 0;
 	// wxWidgets command ID to be sent to the platter to inform that the task finished.
 	int 						m_event_finished_id  			= 0;
+	// wxWidgets event ID to be sent to the platter with the layers of the G-code exported so far.
+	int 						m_event_gcode_preview_layers_id = 0;
+	// Written by the UI thread when canceling and by the worker thread when starting the export.
+	std::atomic<unsigned int>	m_gcode_preview_generation { 0 };
 };
 
 }; // namespace Slic3r
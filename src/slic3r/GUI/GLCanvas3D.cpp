@@ -74,6 +74,9 @@ static const float ERROR_BG_LIGHT_COLOR[3] = { 0.753f, 0.192f, 0.039f };
 
 // Number of floats
 static const size_t MAX_VERTEX_BUFFER_SIZE     = 131072 * 6; // 3.15MB
+// Number of floats of the toolpath volumes of the print objects. Limited to 64k vertices, so that their compact format
+// is indexed with 16 bits, which halves the index buffers holding about 4 indices per vertex of the extrusions.
+static const size_t MAX_COMPACT_VERTEX_BUFFER_SIZE = 65536 * 6; // 1.5MB, 768kB once compacted
 // Reserve size in number of floats.
 static const size_t VERTEX_BUFFER_RESERVE_SIZE = 131072 * 2; // 1.05MB
 // Reserve size in number of floats, maximum sum of all preallocated buffers.
@@ -1412,6 +1415,7 @@ GLCanvas3D::GLCanvas3D(wxGLCanvas* canvas, Bed3D& bed, Camera& camera, GLToolbar
     , m_cursor_type(Standard)
     , m_color_by("volume")
     , m_reload_delayed(false)
+    , m_gcode_preview_streaming(false)
 #if ENABLE_RENDER_PICKING_PASS
     , m_show_picking_texture(false)
 #endif // ENABLE_RENDER_PICKING_PASS
@@ -1548,6 +1552,7 @@ void GLCanvas3D::reset_volumes()
         m_volumes.clear();
         m_dirty = true;
     }
+    m_gcode_preview_streaming = false;
 
     _set_warning_texture(WarningTexture::ObjectOutside, false);
 }
@@ -2489,6 +2494,32 @@ void GLCanvas3D::load_gcode_preview(const GCodePreviewData& preview_data, const
     }
 }
 
+void GLCanvas3D::append_gcode_preview_layers(const GCodePreviewData& layers_data, const GCodePreviewData& preview_data, const std::vector<std::string>& str_object_colors, const std::vector<std::string>& str_object_names)
+{
+    const Print *print = this->fff_print();
+    if ((m_canvas == nullptr) || (print == nullptr) || layers_data.extrusion.layers.empty())
+        return;
+
+    _set_current();
+
+    if (!m_gcode_preview_streaming)
+    {
+        // Replace the preview of the slices with the extrusions exported so far.
+        reset_volumes();
+        m_gcode_preview_volume_index.reset();
+        m_gcode_preview_streaming = true;
+    }
+
+    // Each batch gets its own volumes, the volumes loaded by the previous batches have already been sent to the gpu.
+    std::vector<float> object_colors = _parse_colors(str_object_colors);
+    _load_gcode_extrusion_paths(layers_data, object_colors);
+
+    _update_gcode_volumes_visibility(preview_data);
+    // The ranges of the batch cover the layers of the previous batches as well.
+    _generate_legend_texture(layers_data, object_colors, str_object_names);
+    m_dirty = true;
+}
+
 void GLCanvas3D::load_sla_preview()
 {
     const SLAPrint* print = this->sla_print();
@@ -5508,67 +5539,44 @@ void GLCanvas3D::_load_print_object_toolpaths(const PrintObject& print_object, c
     size_t          grain_size = std::max(ctxt.layers.size() / 16, size_t(1));
     tbb::spin_mutex new_volume_mutex;
     auto            new_volume = [this, &new_volume_mutex](const float *color) -> GLVolume* {
-    	// Allocate the volume before locking.
-		GLVolume *volume = new GLVolume(color);
-		volume->is_extrusion_path = true;
-    	tbb::spin_mutex::scoped_lock lock;
-    	// Lock by ROII, so if the emplace_back() fails, the lock will be released.
-        lock.acquire(new_volume_mutex);
-        m_volumes.volumes.emplace_back(volume);
-        lock.release();
-        return volume;
+    	// Lock by ROII, so if new_toolpath_volume() fails, the lock will be released.
+    	tbb::spin_mutex::scoped_lock lock(new_volume_mutex);
+        return m_volumes.new_toolpath_volume(color);
     };
     const size_t    volumes_cnt_initial = m_volumes.volumes.size();
     tbb::parallel_for(
         tbb::blocked_range<size_t>(0, ctxt.layers.size(), grain_size),
         [&ctxt, &new_volume, is_selected_separate_extruder, this](const tbb::blocked_range<size_t>& range) {
-        GLVolumePtrs 		vols;
-        std::vector<size_t>	color_print_layer_to_glvolume;
-        auto                volume = [&ctxt, &vols, &color_print_layer_to_glvolume, &range](size_t layer_idx, int extruder, int feature) -> GLVolume& {            
-            return *vols[ctxt.color_by_color_print()?
+        const size_t num_volumes = (ctxt.color_by_color_print() || ctxt.color_by_tool()) ? ctxt.number_tools() : 3;
+        auto volume_color = [&ctxt](size_t idx_volume) -> const float* {
+            return (ctxt.color_by_color_print() || ctxt.color_by_tool()) ? ctxt.color_tool(idx_volume) :
+                (idx_volume == 0) ? ctxt.color_perimeters() : (idx_volume == 1) ? ctxt.color_infill() : ctxt.color_support();
+        };
+        auto volume_idx = [&ctxt](size_t layer_idx, int extruder, int feature) -> size_t {
+            return ctxt.color_by_color_print() ?
                 ctxt.color_print_color_idx_by_layer_idx_and_extruder(layer_idx, extruder) :
 				ctxt.color_by_tool() ? 
 					std::min<int>(ctxt.number_tools() - 1, std::max<int>(extruder - 1, 0)) : 
-					feature
-				];
+					feature;
         };
-        if (ctxt.color_by_color_print() || ctxt.color_by_tool()) {
-            for (size_t i = 0; i < ctxt.number_tools(); ++i)
-                vols.emplace_back(new_volume(ctxt.color_tool(i)));
-        }
-        else
-            vols = { new_volume(ctxt.color_perimeters()), new_volume(ctxt.color_infill()), new_volume(ctxt.color_support()) };
-        for (GLVolume *vol : vols)
-			// Reserving number of vertices (3x position + 3x color)
-        	vol->indexed_vertex_array.reserve(VERTEX_BUFFER_RESERVE_SIZE / 6);
-        for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer) {
-            const Layer *layer = ctxt.layers[idx_layer];
-
-            if (is_selected_separate_extruder)
+        auto skip_layer = [&ctxt, is_selected_separate_extruder, this](size_t idx_layer) {
+            if (! is_selected_separate_extruder)
+                return false;
+            for (const LayerRegion* layerm : ctxt.layers[idx_layer]->regions())
             {
-                bool at_least_one_has_correct_extruder = false;
-                for (const LayerRegion* layerm : layer->regions())
-                {
-                    if (layerm->slices.surfaces.empty())
-                        continue;
-                    const PrintRegionConfig& cfg = layerm->region()->config();
-                    if (cfg.perimeter_extruder.value    == m_selected_extruder ||
-                        cfg.infill_extruder.value       == m_selected_extruder ||
-                        cfg.solid_infill_extruder.value == m_selected_extruder ) {
-                        at_least_one_has_correct_extruder = true;
-                        break;
-                    }
-                }
-                if (!at_least_one_has_correct_extruder)
+                if (layerm->slices.surfaces.empty())
                     continue;
+                const PrintRegionConfig& cfg = layerm->region()->config();
+                if (cfg.perimeter_extruder.value    == m_selected_extruder ||
+                    cfg.infill_extruder.value       == m_selected_extruder ||
+                    cfg.solid_infill_extruder.value == m_selected_extruder )
+                    return false;
             }
-
-            for (GLVolume *vol : vols)
-                if (vol->print_zs.empty() || vol->print_zs.back() != layer->print_z) {
-                    vol->print_zs.push_back(layer->print_z);
-                    vol->offsets.push_back(vol->indexed_vertex_array.quad_indices.size());
-                    vol->offsets.push_back(vol->indexed_vertex_array.triangle_indices.size());
-                }
+            return true;
+        };
+        // Call visitor(extrusion_entity, copy, idx_volume) for all the extrusions of a layer, shared by the sizing and the tessellation passes.
+        auto for_each_extrusion = [&ctxt, &volume_idx, is_selected_separate_extruder, this](size_t idx_layer, auto &&visitor) {
+            const Layer *layer = ctxt.layers[idx_layer];
             for (const Point &copy : *ctxt.shifted_copies) {
                 for (const LayerRegion *layerm : layer->regions()) {
                     if (is_selected_separate_extruder)
@@ -5580,15 +5588,14 @@ void GLCanvas3D::_load_print_object_toolpaths(const PrintObject& print_object, c
                             continue;
                     }
                     if (ctxt.has_perimeters)
-                        _3DScene::extrusionentity_to_verts(layerm->perimeters, float(layer->print_z), copy,
-                        	volume(idx_layer, layerm->region()->config().perimeter_extruder.value, 0));
+                        visitor(&layerm->perimeters, copy, volume_idx(idx_layer, layerm->region()->config().perimeter_extruder.value, 0));
                     if (ctxt.has_infill) {
                         for (const ExtrusionEntity *ee : layerm->fills.entities) {
                             // fill represents infill extrusions of a single island.
                             const auto *fill = dynamic_cast<const ExtrusionEntityCollection*>(ee);
                             if (! fill->entities.empty())
-                                _3DScene::extrusionentity_to_verts(*fill, float(layer->print_z), copy,
-	                                volume(idx_layer, 
+                                visitor(fill, copy,
+	                                volume_idx(idx_layer, 
 		                                is_solid_infill(fill->entities.front()->role()) ?
 			                                layerm->region()->config().solid_infill_extruder :
 			                                layerm->region()->config().infill_extruder,
@@ -5600,8 +5607,8 @@ void GLCanvas3D::_load_print_object_toolpaths(const PrintObject& print_object, c
                     const SupportLayer *support_layer = dynamic_cast<const SupportLayer*>(layer);
                     if (support_layer) {
                         for (const ExtrusionEntity *extrusion_entity : support_layer->support_fills.entities)
-                            _3DScene::extrusionentity_to_verts(extrusion_entity, float(layer->print_z), copy,
-	                            volume(idx_layer, 
+                            visitor(extrusion_entity, copy,
+	                            volume_idx(idx_layer, 
 		                            (extrusion_entity->role() == erSupportMaterial) ?
 			                            support_layer->object()->config().support_material_extruder :
 			                            support_layer->object()->config().support_material_interface_extruder,
@@ -5609,19 +5616,63 @@ void GLCanvas3D::_load_print_object_toolpaths(const PrintObject& print_object, c
                     }
                 }
             }
-            // Ensure that no volume grows over the limits. If the volume is too large, allocate a new one.
-	        for (size_t i = 0; i < vols.size(); ++i) {
-	            GLVolume &vol = *vols[i];
-	            if (vol.indexed_vertex_array.vertices_and_normals_interleaved.size() > MAX_VERTEX_BUFFER_SIZE) {
-	                vols[i] = new_volume(vol.color);
-	                reserve_new_volume_finalize_old_volume(*vols[i], vol, false);
-	            }
-	        }
+        };
+
+        // Sizing pass: bound the geometry of each layer of this range and of each volume, so that the volumes
+        // may be allocated to their final size upfront and the tessellation does not reallocate.
+        std::vector<GLIndexedVertexArray::Size> layer_sizes(range.size() * num_volumes);
+        std::vector<char>                       layer_skipped(range.size(), false);
+        for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer) {
+            layer_skipped[idx_layer - range.begin()] = skip_layer(idx_layer);
+            if (! layer_skipped[idx_layer - range.begin()])
+                for_each_extrusion(idx_layer, [&layer_sizes, &range, num_volumes, idx_layer](const ExtrusionEntity *ee, const Point &, size_t idx_volume) {
+                    _3DScene::extrusionentity_to_verts_size(ee, layer_sizes[(idx_layer - range.begin()) * num_volumes + idx_volume]);
+                });
+        }
+
+        // Tessellation pass. A volume is started with the layers fitting into MAX_COMPACT_VERTEX_BUFFER_SIZE preallocated,
+        // the next volume of the same color is started once the layers are exhausted.
+        GLVolumePtrs        vols(num_volumes, nullptr);
+        std::vector<size_t> vols_end(num_volumes, range.begin());
+        for (size_t idx_layer = range.begin(); idx_layer < range.end(); ++ idx_layer) {
+            if (layer_skipped[idx_layer - range.begin()])
+                continue;
+            const Layer *layer = ctxt.layers[idx_layer];
+            for (size_t i = 0; i < num_volumes; ++ i) {
+                if (idx_layer < vols_end[i])
+                    continue;
+                GLIndexedVertexArray::Size size;
+                size_t                     end = idx_layer;
+                for (; end < range.end(); ++ end) {
+                    const GLIndexedVertexArray::Size &size_layer = layer_sizes[(end - range.begin()) * num_volumes + i];
+                    if (! size.empty() && (size.vertices + size_layer.vertices) * 6 > MAX_COMPACT_VERTEX_BUFFER_SIZE)
+                        break;
+                    size += size_layer;
+                }
+                vols_end[i] = end;
+                if (vols[i] != nullptr)
+                    // This code runs in parallel and the OpenGL driver is not thread safe,
+                    // only convert the buffers to the compact format in parallel and shrink them.
+                    vols[i]->indexed_vertex_array.finalize_geometry(false);
+                vols[i] = size.empty() ? nullptr : new_volume(volume_color(i));
+                if (vols[i] != nullptr)
+                    vols[i]->indexed_vertex_array.reserve_more(size);
+            }
+            for (GLVolume *vol : vols)
+                if (vol != nullptr && (vol->print_zs.empty() || vol->print_zs.back() != layer->print_z)) {
+                    vol->print_zs.push_back(layer->print_z);
+                    vol->offsets.push_back(vol->indexed_vertex_array.quad_indices.size());
+                    vol->offsets.push_back(vol->indexed_vertex_array.triangle_indices.size());
+                }
+            for_each_extrusion(idx_layer, [&vols, layer](const ExtrusionEntity *ee, const Point &copy, size_t idx_volume) {
+                // The volume is only missing if the extrusion produces no geometry.
+                if (vols[idx_volume] != nullptr)
+                    _3DScene::extrusionentity_to_verts(ee, float(layer->print_z), copy, *vols[idx_volume]);
+            });
         }
         for (GLVolume *vol : vols)
-        	// Ideally one would call vol->indexed_vertex_array.finalize() here to move the buffers to the OpenGL driver,
-        	// but this code runs in parallel and the OpenGL driver is not thread safe.
-            vol->indexed_vertex_array.shrink_to_fit();
+            if (vol != nullptr)
+                vol->indexed_vertex_array.finalize_geometry(false);
     });
 
     BOOST_LOG_TRIVIAL(debug) << "Loading print object toolpaths in parallel - finalizing results" << m_volumes.log_memory_info() << log_memory_info();
@@ -5693,13 +5744,8 @@ void GLCanvas3D::_load_wipe_tower_toolpaths(const std::vector<std::string>& str_
     size_t          grain_size = std::max(n_items / 128, size_t(1));
     tbb::spin_mutex new_volume_mutex;
     auto            new_volume = [this, &new_volume_mutex](const float *color) -> GLVolume* {
-        auto *volume = new GLVolume(color);
-		volume->is_extrusion_path = true;
-        tbb::spin_mutex::scoped_lock lock;
-        lock.acquire(new_volume_mutex);
-        m_volumes.volumes.emplace_back(volume);
-        lock.release();
-        return volume;
+        tbb::spin_mutex::scoped_lock lock(new_volume_mutex);
+        return m_volumes.new_toolpath_volume(color);
     };
     const size_t   volumes_cnt_initial = m_volumes.volumes.size();
     std::vector<GLVolumeCollection> volumes_per_thread(n_items);
@@ -5779,7 +5825,7 @@ void GLCanvas3D::_load_wipe_tower_toolpaths(const std::vector<std::string>& str_
             }
         }
         for (GLVolume *vol : vols)
-            vol->indexed_vertex_array.shrink_to_fit();
+            vol->indexed_vertex_array.finalize_geometry(false);
     });
 
     BOOST_LOG_TRIVIAL(debug) << "Loading wipe tower toolpaths in parallel - finalizing results" << m_volumes.log_memory_info() << log_memory_info();
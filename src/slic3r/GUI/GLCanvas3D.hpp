@@ -13,6 +13,7 @@
 #include "Gizmos/GLGizmosManager.hpp"
 #include "GUI_ObjectLayers.hpp"
 #include "MeshUtils.hpp"
+#include "libslic3r/GCode/PreviewData.hpp"
 
 #include <float.h>
 
@@ -35,7 +36,6 @@ namespace Slic3r {
 class GLShader;
 class ExPolygon;
 class BackgroundSlicingProcess;
-class GCodePreviewData;
 #if ENABLE_THUMBNAIL_GENERATOR
 struct ThumbnailData;
 #endif // ENABLE_THUMBNAIL_GENERATOR
@@ -470,6 +470,8 @@ private:
     bool m_reload_delayed;
 
     GCodePreviewVolumeIndex m_gcode_preview_volume_index;
+    // Set by append_gcode_preview_layers(), cleared by reset_volumes().
+    bool m_gcode_preview_streaming;
 
 #if ENABLE_RENDER_PICKING_PASS
     bool m_show_picking_texture;
@@ -596,6 +598,10 @@ public:
     void reload_scene(bool refresh_immediately, bool force_full_scene_refresh = false);
 
     void load_gcode_preview(const GCodePreviewData& preview_data, const std::vector<std::string>& str_object_colors, const std::vector<std::string>& str_object_names);
+    // Adds the extrusions of the layers exported so far to the scene, while the G-code export is still running.
+    // The first call replaces the preview of the slices, load_gcode_preview() replaces the appended layers once the export finishes.
+    // The legend is generated from the ranges of layers_data, the visibility of the paths follows preview_data.
+    void append_gcode_preview_layers(const GCodePreviewData& layers_data, const GCodePreviewData& preview_data, const std::vector<std::string>& str_object_colors, const std::vector<std::string>& str_object_names);
     void load_sla_preview();
     void load_preview(const std::vector<std::string>& str_tool_colors, const std::vector<Model::CustomGCode>& color_print_values);
     void bind_event_handlers();
@@ -184,6 +184,7 @@ Preview::Preview(
     , m_preferred_color_mode("feature")
     , m_loaded(false)
     , m_enabled(false)
+    , m_gcode_preview_batches_generation(0)
     , m_schedule_background_process(schedule_background_process_func)
 #ifdef __linux__
     , m_volumes_cleanup_required(false)
@@ -825,6 +826,11 @@ void Preview::load_print_as_fff(bool keep_z_range)
             // Load the real G-code preview.
             m_canvas->load_gcode_preview(*m_gcode_preview_data, colors, names);
             m_loaded = true;
+            m_gcode_preview_batches.clear();
+        } else if (! m_gcode_preview_batches.empty() && m_gcode_preview_batches_generation == m_process->gcode_preview_generation()) {
+            // The G-code is being exported. Show the layers exported so far, the following ones will be appended as they arrive.
+            m_canvas->reset_volumes();
+            load_gcode_preview_batches(0);
         } else {
             // Load the initial preview based on slices, not the final G-code.
             m_canvas->load_preview(colors, color_print_values);
@@ -841,6 +847,43 @@ void Preview::load_print_as_fff(bool keep_z_range)
     }
 }
 
+void Preview::append_gcode_preview_layers(unsigned int generation, GCodePreviewData &&preview_data)
+{
+    if (m_loaded || m_process->current_printer_technology() != ptFFF)
+        return;
+
+    if (generation != m_gcode_preview_batches_generation)
+    {
+        // First layers of a new export.
+        m_gcode_preview_batches.clear();
+        m_gcode_preview_batches_generation = generation;
+    }
+    preview_data.extrusion.view_type = m_gcode_preview_data->extrusion.view_type;
+    m_gcode_preview_batches.emplace_back(std::move(preview_data));
+
+    // If hidden, the layers are loaded by load_print_as_fff() once the preview is shown.
+    if (IsShown())
+        load_gcode_preview_batches(m_gcode_preview_batches.size() - 1);
+}
+
+void Preview::load_gcode_preview_batches(size_t first_batch)
+{
+    std::vector<std::string> colors;
+    std::vector<std::string> names;
+    for (const ModelObject *object : wxGetApp().model().objects)
+        if (object->instances[0]->is_printable()) {
+            colors.push_back(object->instances[0]->object_color);
+            names.push_back(object->name);
+        }
+
+    for (size_t i = first_batch; i < m_gcode_preview_batches.size(); ++ i)
+        m_canvas->append_gcode_preview_layers(m_gcode_preview_batches[i], *m_gcode_preview_data, colors, names);
+    std::vector<double> zs = m_canvas->get_current_print_zs(true);
+    if (! zs.empty())
+        update_sliders(zs, true);
+    m_canvas_widget->Refresh();
+}
+
 void Preview::load_print_as_sla()
 {
     if (m_loaded || (m_process->current_printer_technology() != ptSLA))
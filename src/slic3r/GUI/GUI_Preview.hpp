@@ -6,6 +6,7 @@
 
 #include <string>
 #include "libslic3r/Model.hpp"
+#include "libslic3r/GCode/PreviewData.hpp"
 
 class wxNotebook;
 class wxGLCanvas;
@@ -22,7 +23,6 @@ namespace Slic3r {
 class DynamicPrintConfig;
 class Print;
 class BackgroundSlicingProcess;
-class GCodePreviewData;
 class Model;
 
 namespace GUI {
@@ -103,6 +103,12 @@ class Preview : public wxPanel
     bool m_loaded;
     bool m_enabled;
 
+    // Layers of the G-code being exported, received by append_gcode_preview_layers(). They are kept until the full
+    // G-code preview is loaded, so that they may be shown if the preview becomes visible while the export is running.
+    std::vector<GCodePreviewData> m_gcode_preview_batches;
+    // BackgroundSlicingProcess::gcode_preview_generation() of the export, which produced m_gcode_preview_batches.
+    unsigned int m_gcode_preview_batches_generation;
+
     DoubleSlider*       m_slider {nullptr};
 
 public:
@@ -125,6 +131,8 @@ public:
     void load_print(bool keep_z_range = false);
     void reload_print(bool keep_volumes = false);
     void refresh_print();
+    // Shows the layers of the G-code exported so far, until the export finishes and the full G-code preview is loaded.
+    void append_gcode_preview_layers(unsigned int generation, GCodePreviewData &&preview_data);
 
     void msw_rescale();
     void move_double_slider(wxKeyEvent& evt);
@@ -165,6 +173,8 @@ private:
 
     void load_print_as_fff(bool keep_z_range = false);
     void load_print_as_sla();
+    // Sends m_gcode_preview_batches starting with first_batch to the canvas.
+    void load_gcode_preview_batches(size_t first_batch);
 
     void on_sliders_scroll_changed(wxCommandEvent& event);
 
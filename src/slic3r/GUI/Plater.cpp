@@ -99,6 +99,7 @@ wxDEFINE_EVENT(EVT_SCHEDULE_BACKGROUND_PROCESS,     SimpleEvent);
 wxDEFINE_EVENT(EVT_SLICING_UPDATE,                  SlicingStatusEvent);
 wxDEFINE_EVENT(EVT_SLICING_COMPLETED,               wxCommandEvent);
 wxDEFINE_EVENT(EVT_PROCESS_COMPLETED,               wxCommandEvent);
+wxDEFINE_EVENT(EVT_GCODE_PREVIEW_LAYERS,            GCodePreviewLayersEvent);
 
 // Sidebar widgets
 
@@ -2072,6 +2073,7 @@ Plater::priv::priv(Plater *q, MainFrame *main_frame)
 #endif // ENABLE_THUMBNAIL_GENERATOR
     background_process.set_slicing_completed_event(EVT_SLICING_COMPLETED);
     background_process.set_finished_event(EVT_PROCESS_COMPLETED);
+    background_process.set_gcode_preview_layers_event(EVT_GCODE_PREVIEW_LAYERS);
     // Default printer technology for default config.
     background_process.select_technology(this->printer_technology);
     // Register progress callback from the Print class to the Platter.
@@ -2082,6 +2084,12 @@ Plater::priv::priv(Plater *q, MainFrame *main_frame)
     fff_print.set_status_callback(statuscb);
     sla_print.set_status_callback(statuscb);
     this->q->Bind(EVT_SLICING_UPDATE, &priv::on_slicing_update, this);
+    // Show the G-code preview while the G-code is being exported. The layers of an export canceled or restarted
+    // since the event was sent would overwrite the preview of the current state, they are dropped.
+    this->q->Bind(EVT_GCODE_PREVIEW_LAYERS, [this](GCodePreviewLayersEvent &evt) {
+        if (evt.generation == this->background_process.gcode_preview_generation())
+            this->preview->append_gcode_preview_layers(evt.generation, std::move(evt.preview_data));
+    });
 
     view3D = new View3D(q, bed, camera, view_toolbar, &model, config, &background_process);
     preview = new Preview(q, bed, camera, view_toolbar, &model, config, &background_process, &gcode_preview_data, [this](){ schedule_background_process(); });
@@ -0,0 +1,75 @@
+#include <catch2/catch.hpp>
+
+#include <memory>
+
+#include "libslic3r/GCode.hpp"
+#include "libslic3r/GCode/CoolingBuffer.hpp"
+
+using namespace Slic3r;
+
+static std::unique_ptr<CoolingBuffer> make_cooling_buffer(GCode &gcodegen, const DynamicPrintConfig &config)
+{
+    PrintConfig print_config;
+    print_config.apply(config, true);
+    gcodegen.apply_print_config(print_config);
+    gcodegen.set_layer_count(10);
+    gcodegen.writer().set_extruders({ 0 });
+    gcodegen.writer().set_extruder(0);
+    return std::make_unique<CoolingBuffer>(gcodegen);
+}
+
+// Feedrate of the first G1 line setting the feedrate after the position pos, in mm/min.
+static double feedrate_after(const std::string &gcode, size_t pos)
+{
+    size_t pos_F = gcode.find("G1 F", pos);
+    return pos_F == std::string::npos ? 0. : atof(gcode.c_str() + pos_F + 4);
+}
+
+SCENARIO("Cooling markers emitted by GCodeWriter::set_speed()", "[CoolingBuffer]") {
+    GIVEN("A layer of an infill, an external perimeter and a wipe, each 10mm long at 60mm/s") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({
+            { "cooling",                    "1" },
+            { "min_print_speed",            "1" },
+            // The layer takes 0.5s, the infill alone has to slow down to stretch it to 0.75s.
+            { "slowdown_below_layer_time",  "1" },
+            { "fan_below_layer_time",       "0" },
+            { "use_relative_e_distances",   "0" }
+        });
+        GCode gcodegen;
+        std::unique_ptr<CoolingBuffer> buffer = make_cooling_buffer(gcodegen, config);
+        GCodeWriter &writer = gcodegen.writer();
+        // The markers are appended to the F word without a space, the same way GCode::_extrude() and Wipe::wipe() do.
+        std::string gcode;
+        gcode += writer.set_speed(3600, "", ";_EXTRUDE_SET_SPEED");
+        gcode += writer.extrude_to_xy(Vec2d(10., 0.), 1.);
+        gcode += ";_EXTRUDE_END\n";
+        gcode += writer.set_speed(3600, "", ";_EXTRUDE_SET_SPEED;_EXTERNAL_PERIMETER");
+        gcode += writer.extrude_to_xy(Vec2d(10., 10.), 1.);
+        gcode += ";_EXTRUDE_END\n";
+        gcode += writer.set_speed(3600, "", ";_WIPE");
+        gcode += writer.extrude_to_xy(Vec2d(0., 10.), -1.);
+        REQUIRE(gcode.find("F3600.000;_EXTRUDE_SET_SPEED\n") != std::string::npos);
+        REQUIRE(gcode.find("F3600.000;_WIPE\n") != std::string::npos);
+        WHEN("The layer is processed") {
+            std::string out = buffer->process_layer(gcode, 1);
+            THEN("The markers are removed from the output") {
+                REQUIRE(out.find(";_EXTRUDE_SET_SPEED") == std::string::npos);
+                REQUIRE(out.find(";_EXTERNAL_PERIMETER") == std::string::npos);
+                REQUIRE(out.find(";_WIPE") == std::string::npos);
+                REQUIRE(out.find(";_EXTRUDE_END") == std::string::npos);
+            }
+            THEN("The infill is adjustable and it is slowed down") {
+                double F = feedrate_after(out, 0);
+                REQUIRE(F > 0.);
+                REQUIRE(F < 3600. - EPSILON);
+            }
+            THEN("The external perimeter is recognized and it is not slowed down, as slowing down the infill is sufficient") {
+                REQUIRE(feedrate_after(out, out.find("X10.000 Y0.000")) == Approx(3600.));
+            }
+            THEN("The wipe is recognized and it is not slowed down") {
+                REQUIRE(feedrate_after(out, out.find("X10.000 Y10.000")) == Approx(3600.));
+            }
+        }
+    }
+}
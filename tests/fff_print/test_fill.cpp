@@ -5,6 +5,7 @@
 
 #include "libslic3r/ClipperUtils.hpp"
 #include "libslic3r/Fill/Fill.hpp"
+#include "libslic3r/Fill/FillGyroid.hpp"
 #include "libslic3r/Flow.hpp"
 #include "libslic3r/Geometry.hpp"
 #include "libslic3r/Print.hpp"
@@ -190,6 +191,249 @@ TEST_CASE("Fill: Pattern Path Length", "[Fill]") {
     }
 }
 
+TEST_CASE("Fill: Shared pattern cache", "[Fill]") {
+    // The squares have different sizes and positions, so they share the cached wave periods / hexagon dimensions,
+    // but not the final polylines.
+    ExPolygon square1(Polygon::new_scale({ Vec2d(0, 0), Vec2d(50, 0), Vec2d(50, 50), Vec2d(0, 50) }));
+    ExPolygon square2(Polygon::new_scale({ Vec2d(70, 10), Vec2d(100, 10), Vec2d(100, 60), Vec2d(70, 60) }));
+    auto same = [](const Polylines &pls1, const Polylines &pls2) {
+        return pls1.size() == pls2.size() &&
+            std::equal(pls1.begin(), pls1.end(), pls2.begin(), [](const Polyline &pl1, const Polyline &pl2) { return pl1.points == pl2.points; });
+    };
+    for (const char *pattern : { "gyroid", "honeycomb" }) {
+        auto fill = [pattern](const ExPolygon &expolygon, coordf_t z) {
+            std::unique_ptr<Slic3r::Fill> filler(Slic3r::Fill::new_from_type(pattern));
+            filler->angle   = 0.f;
+            filler->spacing = 0.5;
+            filler->z       = z;
+            FillParams fill_params;
+            fill_params.density = 0.2f;
+            Surface surface(stInternal, expolygon);
+            return filler->fill_surface(&surface, fill_params);
+        };
+        SECTION(std::string("Repeated fills of the same layer produce the same ") + pattern + " infill") {
+            Polylines first  = fill(square1, 1.2);
+            // Fill another surface at the same height, the cached pattern is reused.
+            REQUIRE(! fill(square2, 1.2).empty());
+            Polylines second = fill(square1, 1.2);
+            REQUIRE(! first.empty());
+            REQUIRE(same(first, second));
+        }
+        SECTION(std::string("Fills at another height do not reuse the ") + pattern + " infill of the first height") {
+            Polylines first  = fill(square1, 1.2);
+            Polylines second = fill(square1, 1.4);
+            if (std::string(pattern) == "gyroid")
+                REQUIRE(! same(first, second));
+            REQUIRE(same(fill(square1, 1.2), first));
+        }
+    }
+}
+
+// Reference evaluation of the gyroid wave by libm.
+static double gyroid_reference(double x, double z_sin, double z_cos, bool vertical, bool flip)
+{
+    if (vertical) {
+        double phase_offset = (z_cos < 0 ? M_PI : 0) + M_PI;
+        double a   = sin(x + phase_offset);
+        double b   = - z_cos;
+        double res = z_sin * cos(x + phase_offset + (flip ? M_PI : 0.));
+        double r   = sqrt(sqr(a) + sqr(b));
+        return asin(a/r) + asin(res/r) + M_PI;
+    } else {
+        double phase_offset = z_sin < 0 ? M_PI : 0.;
+        double a   = cos(x + phase_offset);
+        double b   = - z_sin;
+        double res = z_cos * sin(x + phase_offset + (flip ? 0 : M_PI));
+        double r   = sqrt(sqr(a) + sqr(b));
+        return asin(a/r) + asin(res/r) + 0.5 * M_PI;
+    }
+}
+
+// Reference gyroid waves covering width x height periods, sampled and replicated by the scalar algorithm FillGyroid used
+// before the batch evaluation and the row cache.
+static Polylines gyroid_reference_waves(double gridZ, double density_adjusted, double line_spacing, double width, double height)
+{
+    const double scaleFactor = scale_(line_spacing) / density_adjusted;
+    const double tolerance   = std::min(line_spacing / 2, FillGyroid::PatternTolerance) / unscale<double>(scaleFactor);
+    const double z           = gridZ / scaleFactor;
+    const double z_sin       = sin(z);
+    const double z_cos       = cos(z);
+    bool   vertical    = (std::abs(z_sin) <= std::abs(z_cos));
+    double lower_bound = 0.;
+    double upper_bound = height;
+    bool   flip        = true;
+    if (vertical) {
+        flip        = false;
+        lower_bound = -M_PI;
+        upper_bound = width - M_PI_2;
+        std::swap(width, height);
+    }
+    auto one_period = [width, tolerance, z_sin, z_cos, vertical](bool flip) {
+        std::vector<Vec2d> points;
+        double limit = std::min(2*M_PI, width);
+        for (double x = 0.; x < limit - EPSILON; x += M_PI_2)
+            points.emplace_back(x, gyroid_reference(x, z_sin, z_cos, vertical, flip));
+        points.emplace_back(limit, gyroid_reference(limit, z_sin, z_cos, vertical, flip));
+        for (;;) {
+            size_t size = points.size();
+            for (size_t i = 1; i < size; ++ i) {
+                Vec2d lp = points[i - 1];
+                Vec2d rp = points[i];
+                double x = lp(0) + (rp(0) - lp(0)) / 2;
+                Vec2d ip(x, gyroid_reference(x, z_sin, z_cos, vertical, flip));
+                if (std::abs(cross2(Vec2d(ip - lp), Vec2d(ip - rp))) > sqr(tolerance))
+                    points.emplace_back(ip);
+            }
+            if (size == points.size())
+                break;
+            std::sort(points.begin(), points.end(), [](const Vec2d &lhs, const Vec2d &rhs) { return lhs(0) < rhs(0); });
+        }
+        return points;
+    };
+    auto wave = [width, height, scaleFactor, z_sin, z_cos, vertical](std::vector<Vec2d> points, double offset, bool flip) {
+        double period = points.back()(0);
+        if (width != period) {
+            points.pop_back();
+            size_t n = points.size();
+            do {
+                points.emplace_back(points[points.size() - n](0) + period, points[points.size() - n](1));
+            } while (points.back()(0) < width - EPSILON);
+            points.emplace_back(width, gyroid_reference(width, z_sin, z_cos, vertical, flip));
+        }
+        Polyline polyline;
+        for (Vec2d &point : points) {
+            point(1) = clamp(0., height, point(1) + offset);
+            if (vertical)
+                std::swap(point(0), point(1));
+            polyline.points.emplace_back((point * scaleFactor).cast<coord_t>());
+        }
+        return polyline;
+    };
+    std::vector<Vec2d> one_period_odd  = one_period(flip);
+    flip = ! flip;
+    std::vector<Vec2d> one_period_even = one_period(flip);
+    Polylines result;
+    for (double y0 = lower_bound; y0 < upper_bound + EPSILON; y0 += M_PI) {
+        result.emplace_back(wave(one_period_odd, y0, flip));
+        y0 += M_PI;
+        if (y0 < upper_bound + EPSILON)
+            result.emplace_back(wave(one_period_even, y0, flip));
+    }
+    return result;
+}
+
+TEST_CASE("Fill: Gyroid wave evaluation", "[Fill]") {
+    // Odd number of samples to exercise the scalar tail of the SIMD batches, the x range covers the wave end points of wide infills.
+    std::vector<double> xs;
+    for (double x = 0.; x < 4. * M_PI; x += 0.0009765625)
+        xs.emplace_back(x);
+    for (double x = 0.; x < 2000.; x += 0.37)
+        xs.emplace_back(x);
+    if ((xs.size() & 1) == 0)
+        xs.emplace_back(M_PI);
+    std::vector<double> ys(xs.size());
+    double max_error = 0.;
+    for (double z = -7.; z < 7.; z += 0.0137) {
+        double z_sin    = sin(z);
+        double z_cos    = cos(z);
+        bool   vertical = std::abs(z_sin) <= std::abs(z_cos);
+        for (bool flip : { false, true }) {
+            FillGyroid::wave(z_sin, z_cos, vertical, flip, xs.data(), ys.data(), xs.size());
+            for (size_t i = 0; i < xs.size(); ++ i)
+                max_error = std::max(max_error, std::abs(ys[i] - gyroid_reference(xs[i], z_sin, z_cos, vertical, flip)));
+        }
+    }
+    // The tolerance of the wave refinement is FillGyroid::PatternTolerance, the evaluation error is negligible against it.
+    REQUIRE(max_error < 1e-12);
+    REQUIRE(max_error < 1e-6 * FillGyroid::PatternTolerance);
+}
+
+TEST_CASE("Fill: Gyroid infill stays within the tolerance of the reference waves", "[Fill]") {
+    // A square filled without rotation and without connecting the lines, so that the infill is made of the clipped waves.
+    ExPolygon square(Polygon::new_scale({ Vec2d(0, 0), Vec2d(40, 0), Vec2d(40, 40), Vec2d(0, 40) }));
+    Surface   surface(stInternal, square);
+    for (double spacing : { 0.3, 0.5 })
+        for (double z : { 0.2, 1.2, 1.5, 2.9, 4.1 }) {
+            std::unique_ptr<Slic3r::Fill> filler(Slic3r::Fill::new_from_type("gyroid"));
+            filler->angle   = float(- FillGyroid::CorrectionAngle * M_PI / 180.);
+            filler->spacing = spacing;
+            filler->z       = z;
+            FillParams fill_params;
+            fill_params.density      = 0.2f;
+            fill_params.dont_connect = true;
+            Polylines polylines = filler->fill_surface(&surface, fill_params);
+            REQUIRE(! polylines.empty());
+
+            // The reference waves placed the same way FillGyroid::_fill_surface_single() places them.
+            ExPolygons expolygons       = offset_ex(square, float(scale_(- 0.5 * spacing)));
+            REQUIRE(expolygons.size() == 1);
+            BoundingBox bb               = expolygons.front().contour.bounding_box();
+            double      density_adjusted = fill_params.density * FillGyroid::DensityAdjust;
+            coord_t     distance         = coord_t(scale_(spacing) / density_adjusted);
+            coord_t     grid             = coord_t(2*M_PI*distance);
+            bb.merge(Point((bb.min(0) / grid) * grid, (bb.min(1) / grid) * grid));
+            Polylines reference = gyroid_reference_waves(scale_(z), density_adjusted, spacing,
+                ceil(bb.size()(0) / distance) + 1., ceil(bb.size()(1) / distance) + 1.);
+            Lines reference_lines;
+            for (Polyline &pl : reference) {
+                pl.translate(bb.min);
+                append(reference_lines, pl.lines());
+            }
+            Lines infill_lines;
+            for (const Polyline &pl : polylines)
+                append(infill_lines, pl.lines());
+            auto distance_to = [](const Point &pt, const Lines &lines) {
+                double d2 = std::numeric_limits<double>::max();
+                for (const Line &line : lines)
+                    d2 = std::min(d2, line.distance_to_squared(pt));
+                return sqrt(d2);
+            };
+            const double tolerance = scale_(std::min(spacing / 2, FillGyroid::PatternTolerance));
+            // All the infill lies on the reference waves.
+            double max_distance = 0.;
+            for (const Polyline &pl : polylines)
+                for (const Point &pt : pl.points)
+                    max_distance = std::max(max_distance, distance_to(pt, reference_lines));
+            REQUIRE(max_distance < tolerance);
+            // The reference waves are covered by the infill, except for the short pieces along the boundary removed by the filler.
+            ExPolygons inner = offset_ex(expolygons.front(), float(scale_(- 3. * spacing)));
+            max_distance = 0.;
+            for (const Polyline &pl : reference)
+                for (const Point &pt : pl.points)
+                    if (std::any_of(inner.begin(), inner.end(), [&pt](const ExPolygon &expoly) { return expoly.contains(pt); }))
+                        max_distance = std::max(max_distance, distance_to(pt, infill_lines));
+            REQUIRE(max_distance < tolerance);
+        }
+}
+
+TEST_CASE("Fill: Gyroid fill of multiple islands", "[Fill]") {
+    // A row of squares connected by bars thinner than the infill spacing, which fall apart into separate islands
+    // when offsetted by half the spacing.
+    Polygon contour;
+    for (int i = 0; i < 8; ++ i)
+        for (const Vec2d &pt : { Vec2d(30 * i, 0), Vec2d(30 * i + 20, 0), Vec2d(30 * i + 20, 10), Vec2d(30 * i + 30, 10) })
+            contour.points.emplace_back(Point::new_scale(pt(0), pt(1)));
+    contour.points.pop_back();
+    for (int i = 7; i >= 0; -- i)
+        for (const Vec2d &pt : { Vec2d(30 * i + 30, 10.2), Vec2d(30 * i + 20, 10.2), Vec2d(30 * i + 20, 20 + i), Vec2d(30 * i, 20 + i) })
+            contour.points.emplace_back(Point::new_scale(pt(0), pt(1)));
+    contour.points.erase(contour.points.begin() + 31);
+    Surface surface(stInternal, ExPolygon(contour));
+    std::unique_ptr<Slic3r::Fill> filler(Slic3r::Fill::new_from_type("gyroid"));
+    filler->angle   = 0.f;
+    filler->spacing = 0.5;
+    filler->z       = 1.2;
+    FillParams fill_params;
+    fill_params.density = 0.2f;
+    REQUIRE(offset_ex(surface.expolygon, float(scale_(- 0.5 * filler->spacing))).size() == 8);
+    // The islands filled in parallel produce the same infill as the islands filled one by one.
+    Polylines parallel   = filler->fill_surface(&surface, fill_params);
+    Polylines one_by_one = filler->Fill::fill_surface(&surface, fill_params);
+    REQUIRE(! parallel.empty());
+    REQUIRE(parallel.size() == one_by_one.size());
+    REQUIRE(std::equal(parallel.begin(), parallel.end(), one_by_one.begin(), [](const Polyline &pl1, const Polyline &pl2) { return pl1.points == pl2.points; }));
+}
+
 /*
 {
     my $collection = Slic3r::Polyline::Collection->new(
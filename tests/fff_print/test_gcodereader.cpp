@@ -0,0 +1,174 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/cstdio.hpp>
+
+#include "libslic3r/GCodeReader.hpp"
+
+using namespace Slic3r;
+
+struct ParsedLine {
+    std::string raw;
+    bool        has[NUM_AXES];
+    float       axis[NUM_AXES];
+    float       position[NUM_AXES];
+
+    bool operator==(const ParsedLine &rhs) const {
+        if (raw != rhs.raw)
+            return false;
+        for (size_t i = 0; i < NUM_AXES; ++ i)
+            if (has[i] != rhs.has[i] || (has[i] && axis[i] != rhs.axis[i]) || position[i] != rhs.position[i])
+                return false;
+        return true;
+    }
+};
+
+static void collect_line(std::vector<ParsedLine> &out, const GCodeReader &reader, const GCodeReader::GCodeLine &line)
+{
+    ParsedLine parsed;
+    parsed.raw = line.raw();
+    for (size_t i = 0; i < NUM_AXES; ++ i) {
+        parsed.has[i]  = line.has(Axis(i));
+        parsed.axis[i] = line.value(Axis(i));
+    }
+    parsed.position[X] = reader.x();
+    parsed.position[Y] = reader.y();
+    parsed.position[Z] = reader.z();
+    parsed.position[E] = reader.e();
+    parsed.position[F] = reader.f();
+    out.emplace_back(parsed);
+}
+
+static std::vector<ParsedLine> parse_buffer(const std::string &gcode, bool relative_e)
+{
+    std::vector<ParsedLine> out;
+    GCodeReader reader;
+    DynamicPrintConfig config;
+    config.set_key_value("use_relative_e_distances", new ConfigOptionBool(relative_e));
+    reader.apply_config(config);
+    reader.parse_buffer(gcode, [&out](GCodeReader &reader, const GCodeReader::GCodeLine &line) { collect_line(out, reader, line); });
+    return out;
+}
+
+static std::vector<ParsedLine> parse_file(const std::string &gcode, bool relative_e)
+{
+    boost::filesystem::path temp = boost::filesystem::unique_path();
+    {
+        std::ofstream f(temp.string(), std::ios::binary);
+        f << gcode;
+    }
+    std::vector<ParsedLine> out;
+    GCodeReader reader;
+    DynamicPrintConfig config;
+    config.set_key_value("use_relative_e_distances", new ConfigOptionBool(relative_e));
+    reader.apply_config(config);
+    reader.parse_file(temp.string(), [&out](GCodeReader &reader, const GCodeReader::GCodeLine &line) { collect_line(out, reader, line); });
+    boost::nowide::remove(temp.string().c_str());
+    return out;
+}
+
+// The former parse_file(): Each line read by std::getline() is parsed up to its first end of line character.
+static std::vector<ParsedLine> parse_lines(const std::string &gcode, bool relative_e)
+{
+    std::vector<ParsedLine> out;
+    GCodeReader reader;
+    DynamicPrintConfig config;
+    config.set_key_value("use_relative_e_distances", new ConfigOptionBool(relative_e));
+    reader.apply_config(config);
+    std::istringstream f(gcode);
+    std::string line;
+    while (std::getline(f, line))
+        reader.parse_line(line, [&out](GCodeReader &reader, const GCodeReader::GCodeLine &line) { collect_line(out, reader, line); });
+    return out;
+}
+
+static std::string synthetic_gcode(size_t num_layers, size_t moves_per_layer)
+{
+    std::ostringstream out;
+    out << "; synthetic G-code\nG21\nG90\nM83\n";
+    char buf[128];
+    for (size_t layer = 0; layer < num_layers; ++ layer) {
+        sprintf(buf, "G1 Z%.3f F7800 ; layer %d\n", 0.2 + 0.2 * layer, int(layer));
+        out << buf;
+        for (size_t i = 0; i < moves_per_layer; ++ i) {
+            sprintf(buf, "G1 X%.3f Y%.3f E%.5f\n", 100. + (i % 37), 100. + (i % 91) * 0.5, 0.01 + (i % 7) * 0.001);
+            out << buf;
+        }
+        out << "G92 E0\n\n";
+    }
+    return out.str();
+}
+
+SCENARIO("Parsing a memory mapped G-code file", "[GCodeReader]") {
+    GIVEN("A G-code spanning many chunks") {
+        std::string gcode = synthetic_gcode(200, 1000);
+        THEN("parse_file() produces the same lines and positions as parse_buffer()") {
+            for (bool relative_e : { false, true }) {
+                INFO("relative E " << relative_e);
+                std::vector<ParsedLine> lines = parse_buffer(gcode, relative_e);
+                REQUIRE(lines.size() > 200000);
+                REQUIRE(parse_file(gcode, relative_e) == lines);
+            }
+        }
+    }
+    GIVEN("Small G-codes with unusual line endings") {
+        THEN("parse_file() produces the same lines as parse_buffer()") {
+            for (const char *gcode : {
+                "G1 X10 Y20\nG1 X30 E1.5",
+                "G1 X10 Y20\r\nG92 E0\r\n\r\nG1 X30 E1.5 ; comment\r\n",
+                "\n\n;comment only\n",
+                "G1 X1",
+                "" }) {
+                INFO(gcode);
+                REQUIRE(parse_file(gcode, false) == parse_buffer(gcode, false));
+            }
+        }
+    }
+    GIVEN("Lines with a zero character or a single carriage return inside") {
+        THEN("parse_file() ignores the rest of the line as parsing the lines read by std::getline() did") {
+            for (const std::string &gcode : {
+                std::string("G1 X10\0 Y20\nG1 X30 E1\n", 22),
+                std::string("\n\0G1 X5\nG1 Y5\n", 14),
+                std::string("G1 X10\rG1 X20\nG1 X30\n"),
+                std::string("G1 X10\nG1 X20\0 E1", 17) }) {
+                INFO(gcode);
+                REQUIRE(parse_file(gcode, false) == parse_lines(gcode, false));
+            }
+        }
+    }
+    GIVEN("A missing file") {
+        THEN("no line is parsed") {
+            GCodeReader reader;
+            size_t num_lines = 0;
+            reader.parse_file((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string(),
+                [&num_lines](GCodeReader&, const GCodeReader::GCodeLine&) { ++ num_lines; });
+            REQUIRE(num_lines == 0);
+        }
+    }
+}
+
+SCENARIO("Modifying a parsed G-code line", "[GCodeReader]") {
+    GIVEN("A line copied out of the parsed buffer") {
+        GCodeReader reader;
+        GCodeReader::GCodeLine copy;
+        {
+            std::string gcode = "G1 X10 Z0.3 E1\n";
+            reader.parse_buffer(gcode, [&copy](GCodeReader&, const GCodeReader::GCodeLine &line) { copy = line; });
+        }
+        THEN("the copy owns its text") {
+            REQUIRE(copy.raw() == "G1 X10 Z0.3 E1");
+            REQUIRE(copy.cmd_is("G1"));
+        }
+        WHEN("an axis value is replaced") {
+            copy.set(reader, Z, 0.5f);
+            THEN("the raw text is updated") {
+                REQUIRE(copy.raw() == "G1 X10 Z0.500 E1");
+                REQUIRE(copy.z() == 0.5f);
+            }
+        }
+    }
+}
@@ -0,0 +1,170 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <vector>
+
+#include "libslic3r/GCodeTimeEstimator.hpp"
+
+using namespace Slic3r;
+
+// Back and forth moves along X. Each reversal brings the junction speed down to the X jerk,
+// so every move takes the same time as a single isolated move.
+static std::string back_and_forth_gcode(size_t num_moves)
+{
+    std::ostringstream gcode;
+    gcode << "G1 F6000\n";
+    for (size_t i = 0; i < num_moves; ++ i)
+        gcode << ((i & 1) ? "G1 X0\n" : "G1 X100\n");
+    return gcode.str();
+}
+
+// Feeds the G-code to the estimator in line aligned blocks, the way GCode::_write() does.
+static void add_gcode_in_blocks(GCodeTimeEstimator &estimator, const std::string &gcode, size_t block_size)
+{
+    for (size_t pos = 0; pos < gcode.size();) {
+        size_t end = gcode.find('\n', std::min(gcode.size() - 1, pos + block_size));
+        if (end == std::string::npos)
+            end = gcode.size() - 1;
+        estimator.add_gcode_block(gcode.substr(pos, end + 1 - pos));
+        pos = end + 1;
+    }
+}
+
+SCENARIO("Time estimate of trapezoidal moves", "[GCodeTimeEstimator]") {
+    // 100mm at 100mm/s, accelerating at 1500mm/s^2 from and decelerating to the 10mm/s X jerk:
+    // 2 * 3.3mm in 2 * 0.06s and 93.4mm cruising in 0.934s.
+    const float single_move_time = 1.054f;
+    GIVEN("A single move with the default machine limits") {
+        GCodeTimeEstimator estimator(GCodeTimeEstimator::Normal);
+        estimator.calculate_time_from_text("G1 X100 F6000\n");
+        THEN("the time matches the trapezoidal profile") {
+            REQUIRE(estimator.get_time() == Approx(single_move_time));
+        }
+    }
+    GIVEN("Many more moves than fit into a single planner chunk") {
+        const size_t num_moves = 100000;
+        GCodeTimeEstimator estimator(GCodeTimeEstimator::Normal);
+        add_gcode_in_blocks(estimator, back_and_forth_gcode(num_moves), 4096);
+        THEN("the planner keeps only a few bytes per already planned move") {
+            REQUIRE(estimator.memory_used() < num_moves * 32);
+        }
+        WHEN("the time is calculated") {
+            estimator.calculate_time();
+            THEN("the total time is the sum of the move times") {
+                // The elapsed time is accumulated in single precision.
+                REQUIRE(estimator.get_time() == Approx(num_moves * single_move_time).epsilon(1e-3));
+            }
+            THEN("the elapsed time is exported for every move") {
+                GCodeTimeEstimator::PostProcessData data = estimator.get_post_process_data();
+                REQUIRE(data.g1_line_ids.size() == num_moves);
+                float last = 0.f;
+                bool  monotonic = true;
+                for (const GCodeTimeEstimator::G1LineIdToBlockId &id : data.g1_line_ids) {
+                    float elapsed = data.elapsed_times[id.second];
+                    monotonic &= elapsed > last;
+                    last = elapsed;
+                }
+                REQUIRE(monotonic);
+                REQUIRE(last == Approx(estimator.get_time()));
+            }
+        }
+    }
+}
+
+SCENARIO("M73 lines inserted by the streaming post processor", "[GCodeTimeEstimator]") {
+    GIVEN("Extrusions taking about three hours, fed to the time estimator and to the post processor as they are generated") {
+        std::string gcode = "M83\nG1 F6000\n" + GCodeTimeEstimator::Normal_First_M73_Output_Placeholder_Tag + "\n";
+        for (size_t i = 0; i < 10000; ++ i)
+            gcode += (i & 1) ? "G1 X0 E1\n" : "G1 X100 E1\n";
+        gcode += GCodeTimeEstimator::Normal_Last_M73_Output_Placeholder_Tag + "\n";
+        FILE *file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        GCodeTimeEstimator estimator(GCodeTimeEstimator::Normal);
+        GCodeTimeEstimator::PostProcessor post_processor(file, 60.0f, &estimator, nullptr);
+        for (size_t pos = 0; pos < gcode.size();) {
+            size_t end = gcode.find('\n', pos) + 1;
+            estimator.add_gcode_block(gcode.substr(pos, end - pos));
+            post_processor.process(gcode.data() + pos, end - pos);
+            pos = end;
+        }
+        WHEN("the G-code is exported") {
+            fflush(file);
+            long written_before_finalize = ftell(file);
+            estimator.calculate_time();
+            post_processor.finalize();
+            std::string out(gcode.size() * 2, '\0');
+            rewind(file);
+            out.resize(fread(&out.front(), 1, out.size(), file));
+            fclose(file);
+            THEN("most of the G-code is written before the total time is known") {
+                // The time estimator finalizes its blocks in chunks of 4096 blocks.
+                REQUIRE(written_before_finalize > long(gcode.size() / 2));
+            }
+            THEN("the M73 lines are filled in with the remaining times") {
+                std::vector<std::pair<int, int>> M73;
+                for (size_t pos = out.find("M73 P"); pos != std::string::npos; pos = out.find("M73 P", pos + 1)) {
+                    int P = -1, R = -1;
+                    REQUIRE(sscanf(out.c_str() + pos, "M73 P%d R%d", &P, &R) == 2);
+                    M73.emplace_back(P, R);
+                }
+                // The initial line, a line at the first extrusion, then a line a minute and the final line.
+                REQUIRE(M73.size() >= 170);
+                REQUIRE(M73.front() == std::make_pair(0, (int)std::round(estimator.get_time() / 60.f)));
+                REQUIRE(M73.back() == std::make_pair(100, 0));
+                for (size_t i = 1; i < M73.size(); ++ i) {
+                    REQUIRE(M73[i].first >= M73[i - 1].first);
+                    REQUIRE(M73[i].second <= M73[i - 1].second);
+                }
+                REQUIRE(out.find("_TE_") == std::string::npos);
+            }
+            THEN("the M73 lines are padded with spaces to a fixed width, except for the final line") {
+                size_t num_padded = 0;
+                for (size_t pos = out.find("M73 P"); pos != std::string::npos; pos = out.find("M73 P", pos + 1)) {
+                    std::string line = out.substr(pos, out.find('\n', pos) - pos);
+                    if (line == "M73 P100 R0")
+                        continue;
+                    REQUIRE(line.size() == 23);
+                    size_t end = line.find_last_not_of(' ') + 1;
+                    REQUIRE(end > 8);
+                    REQUIRE(line.find(' ', line.find('R')) == end);
+                    ++ num_padded;
+                }
+                REQUIRE(num_padded >= 169);
+            }
+        }
+    }
+}
+
+SCENARIO("G-code held back by the streaming post processor", "[GCodeTimeEstimator]") {
+    GIVEN("Extrusions along a circle, too short to reach the junction speeds") {
+        // Without any move entering at its maximum speed, the planner cannot tell which moves are final before it reaches its limit.
+        std::string gcode = "M83\nG1 F6000\n";
+        char line[64];
+        for (size_t i = 0; i < 200000; ++ i) {
+            double angle = 0.002 * double(i);
+            sprintf(line, "G1 X%.4f Y%.4f E0.001\n", 100. + 10. * cos(angle), 100. + 10. * sin(angle));
+            gcode += line;
+        }
+        FILE *file = std::tmpfile();
+        REQUIRE(file != nullptr);
+        GCodeTimeEstimator estimator(GCodeTimeEstimator::Normal);
+        GCodeTimeEstimator::PostProcessor post_processor(file, 60.0f, &estimator, nullptr);
+        add_gcode_in_blocks(estimator, gcode, 65536);
+        post_processor.process(gcode);
+        WHEN("the G-code is fed to the time estimator and to the post processor") {
+            fflush(file);
+            long written_before_finalize = ftell(file);
+            estimator.calculate_time();
+            post_processor.finalize();
+            long written = ftell(file);
+            fclose(file);
+            THEN("the G-code held back is bounded by the planner") {
+                REQUIRE(written_before_finalize > long(gcode.size() / 2));
+                REQUIRE(written >= long(gcode.size()));
+            }
+        }
+    }
+}
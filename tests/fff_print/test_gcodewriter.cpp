@@ -1,6 +1,9 @@
 #include <catch2/catch.hpp>
 
+#include <iomanip>
 #include <memory>
+#include <random>
+#include <sstream>
 
 #include "libslic3r/GCodeWriter.hpp"
 
@@ -94,3 +97,51 @@ SCENARIO("set_speed emits values with fixed-point output.", "[GCodeWriter]") {
         }
     }
 }
+
+TEST_CASE("append_fixed matches the iostream fixed point formatting", "[GCodeWriter]") {
+    auto check = [](double value, int precision) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(precision) << value;
+        std::string out;
+        append_fixed(out, value, precision);
+        return out == ss.str();
+    };
+    for (double value : { 0., -0., 1., -1., 0.0005, -0.0005, 0.0015, 2.5, 203.200522, 99999.123, 1e20, -1e300 })
+        for (int precision : { 0, 3, 5 })
+            REQUIRE(check(value, precision));
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<double> coord(-500., 500.);
+    std::uniform_int_distribution<int>     milli(-500000, 500000);
+    bool all_equal = true;
+    for (size_t i = 0; i < 100000 && all_equal; ++ i)
+        // Random values and values lying on the rounding ties of the 3 and 5 digit formatting.
+        all_equal = check(coord(rng), 3) && check(coord(rng), 5) && check(milli(rng) * 0.001 + 0.0005, 3) && check(milli(rng) * 0.00001 + 0.000005, 5);
+    REQUIRE(all_equal);
+}
+
+SCENARIO("The appending and the string returning move variants emit the same G-code.", "[GCodeWriter]") {
+    GIVEN("Two writers with a single extruder") {
+        GCodeWriter writer1, writer2;
+        for (GCodeWriter *writer : { &writer1, &writer2 }) {
+            writer->set_extruders({ 0 });
+            writer->set_extruder(0);
+        }
+        std::string returned, appended;
+        for (int i = 0; i < 100; ++ i) {
+            Vec2d pt(i * 0.1234567, 200. - i * 1.0000005);
+            returned += writer1.set_speed(1800. + i);
+            writer2.set_speed(appended, 1800. + i);
+            returned += writer1.travel_to_xy(pt, "travel");
+            writer2.travel_to_xy(appended, pt, "travel");
+            returned += writer1.extrude_to_xy(pt + Vec2d(1., 1.), 0.0333333, "extrude");
+            writer2.extrude_to_xy(appended, pt + Vec2d(1., 1.), 0.0333333, "extrude");
+            returned += writer1.travel_to_xyz(Vec3d(pt.x(), pt.y(), 0.2 * i));
+            writer2.travel_to_xyz(appended, Vec3d(pt.x(), pt.y(), 0.2 * i));
+            returned += writer1.extrude_to_xyz(Vec3d(pt.x(), pt.y(), 0.2 * i + 0.1), 0.01);
+            writer2.extrude_to_xyz(appended, Vec3d(pt.x(), pt.y(), 0.2 * i + 0.1), 0.01);
+        }
+        THEN("The outputs are identical") {
+            REQUIRE(returned == appended);
+        }
+    }
+}
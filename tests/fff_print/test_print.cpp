@@ -8,6 +8,17 @@
 using namespace Slic3r;
 using namespace Slic3r::Test;
 
+// The instances added by init_print() are not checked in the object list, thus they would not be printed.
+// Check all the instances of the model and apply the model to the print again.
+static void check_instances(Print &print, Model &model)
+{
+    for (ModelObject *mo : model.objects)
+        for (ModelInstance *mi : mo->instances)
+            mi->checked = true;
+    print.apply(model, print.full_print_config());
+    print.validate();
+}
+
 SCENARIO("PrintObject: Perimeter generation", "[PrintObject]") {
     GIVEN("20mm cube and default config") {
         WHEN("make_perimeters() is called")  {
@@ -29,6 +40,71 @@ SCENARIO("PrintObject: Perimeter generation", "[PrintObject]") {
     }
 }
 
+SCENARIO("Print: Objects processed concurrently", "[Print]") {
+    GIVEN("A plate with a cube, an L and a V shaped object") {
+        const std::initializer_list<TestMesh> meshes { TestMesh::cube_20x20x20, TestMesh::L, TestMesh::V };
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print(meshes, print, model, { { "fill_density", 0.2 } });
+        check_instances(print, model);
+        print.process();
+        THEN("Each object has the same perimeters as if it was printed alone, and it is infilled") {
+            REQUIRE(print.objects().size() == meshes.size());
+            size_t idx = 0;
+            for (TestMesh mesh : meshes) {
+                Slic3r::Print print_alone;
+                Slic3r::Model model_alone;
+                Slic3r::Test::init_print({ mesh }, print_alone, model_alone, { { "fill_density", 0.2 } });
+                check_instances(print_alone, model_alone);
+                print_alone.process();
+                const PrintObject &object       = *print.objects()[idx ++];
+                const PrintObject &object_alone = *print_alone.objects().front();
+                REQUIRE(object.layers().size() == object_alone.layers().size());
+                for (size_t i = 0; i < object.layers().size(); ++ i) {
+                    const LayerRegion &layerm       = *object.layers()[i]->regions().front();
+                    const LayerRegion &layerm_alone = *object_alone.layers()[i]->regions().front();
+                    REQUIRE(layerm.perimeters.items_count() == layerm_alone.perimeters.items_count());
+                    // The infill is aligned to a global grid, it depends on the object position.
+                    REQUIRE(layerm.fills.empty() == layerm_alone.fills.empty());
+                }
+            }
+        }
+    }
+}
+
+SCENARIO("Print: Failure of one of the objects processed concurrently", "[Print]") {
+    GIVEN("A plate with a cube and an object too thin to produce any layer") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        TriangleMesh cube = Slic3r::Test::mesh(TestMesh::cube_20x20x20);
+        TriangleMesh thin = make_cube(10., 10., 0.05);
+        thin.translate(30.f, 0.f, 0.f);
+        Slic3r::Test::init_print({ cube, thin }, print, model, { { "fill_density", 0.2 }, { "first_layer_height", 0.3 } });
+        check_instances(print, model);
+        WHEN("The print is processed") {
+            THEN("The failure of the thin object is reported") {
+                REQUIRE_THROWS(print.process());
+            }
+            THEN("The cube is processed completely, it is not stopped half way by the failure of the thin object") {
+                REQUIRE_THROWS(print.process());
+                const PrintObject &object = *print.objects().front();
+                REQUIRE(object.is_step_done(posPerimeters));
+                REQUIRE(object.is_step_done(posInfill));
+                Slic3r::Print print_alone;
+                Slic3r::Model model_alone;
+                Slic3r::Test::init_print({ TestMesh::cube_20x20x20 }, print_alone, model_alone, { { "fill_density", 0.2 }, { "first_layer_height", 0.3 } });
+                check_instances(print_alone, model_alone);
+                print_alone.process();
+                REQUIRE(object.layers().size() == print_alone.objects().front()->layers().size());
+                for (const Layer *layer : object.layers()) {
+                    REQUIRE(! layer->regions().front()->perimeters.empty());
+                    REQUIRE(! layer->regions().front()->fills.empty());
+                }
+            }
+        }
+    }
+}
+
 SCENARIO("Print: Skirt generation", "[Print]") {
     GIVEN("20mm cube and default config") {
         WHEN("Skirts is set to 2 loops")  {
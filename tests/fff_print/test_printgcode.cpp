@@ -1,12 +1,20 @@
 #include <catch2/catch.hpp>
 
 #include "libslic3r/libslic3r.h"
+#include "libslic3r/GCode.hpp"
 #include "libslic3r/GCodeReader.hpp"
+#include "libslic3r/GCode/PreviewData.hpp"
 
 #include "test_data.hpp"
 
 #include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <boost/filesystem.hpp>
+#include <boost/nowide/cstdio.hpp>
 #include <boost/regex.hpp>
+#include <tbb/task_arena.h>
 
 using namespace Slic3r;
 using namespace Slic3r::Test;
@@ -15,6 +23,17 @@ boost::regex perimeters_regex("G1 X[-0-9.]* Y[-0-9.]* E[-0-9.]* ; perimeter");
 boost::regex infill_regex("G1 X[-0-9.]* Y[-0-9.]* E[-0-9.]* ; infill");
 boost::regex skirt_regex("G1 X[-0-9.]* Y[-0-9.]* E[-0-9.]* ; skirt");
 
+// The instances added by init_print() are not checked in the object list, thus they would not be printed.
+// Check all the instances of the model and apply the model to the print again.
+static void check_instances(Print &print, Model &model)
+{
+    for (ModelObject *mo : model.objects)
+        for (ModelInstance *mi : mo->instances)
+            mi->checked = true;
+    print.apply(model, print.full_print_config());
+    print.validate();
+}
+
 SCENARIO( "PrintGCode basic functionality", "[PrintGCode]") {
     GIVEN("A default configuration and a print test object") {
         WHEN("the output is executed with no support material") {
@@ -201,6 +220,43 @@ SCENARIO( "PrintGCode basic functionality", "[PrintGCode]") {
                 REQUIRE(gcode.find("M107") != std::string::npos);
             }
         }
+        WHEN("remaining times are enabled for a Marlin printer with silent mode") {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            ::Test::init_print({ TestMesh::cube_20x20x20 }, print, model, {
+				{ "gcode_flavor",               "marlin" },
+                { "remaining_times",            true },
+                { "silent_mode",                true }
+                });
+            check_instances(print, model);
+            std::string gcode = ::Test::gcode(print);
+            THEN("the placeholders are replaced by the first and the last M73 lines") {
+                REQUIRE(gcode.find("_TE_") == std::string::npos);
+                REQUIRE(gcode.find("M73 P0 R") != std::string::npos);
+                REQUIRE(gcode.find("M73 Q0 S") != std::string::npos);
+                REQUIRE(gcode.find("M73 P100 R0\n") != std::string::npos);
+                REQUIRE(gcode.find("M73 Q100 S0\n") != std::string::npos);
+            }
+            THEN("remaining times are inserted during the print and filled in") {
+                size_t num_normal  = 0;
+                bool   filled_in   = true;
+                bool   monotonic   = true;
+                int    last_P      = 0;
+                int    last_R      = std::numeric_limits<int>::max();
+                for (size_t pos = gcode.find("M73 P"); pos != std::string::npos; pos = gcode.find("M73 P", pos + 1)) {
+                    int P = -1, R = -1;
+                    filled_in &= sscanf(gcode.c_str() + pos, "M73 P%d R%d", &P, &R) == 2;
+                    monotonic &= P >= last_P && R <= last_R;
+                    last_P = P;
+                    last_R = R;
+                    ++ num_normal;
+                }
+                REQUIRE(num_normal > 2);
+                REQUIRE(filled_in);
+                REQUIRE(monotonic);
+                REQUIRE(last_P == 100);
+            }
+        }
         WHEN("end_gcode exists with layer_num and layer_z") {
 			std::string gcode = ::Test::slice({ TestMesh::cube_20x20x20 }, {
 				{ "end_gcode",              "; Layer_num [layer_num]\n; Layer_z [layer_z]" },
@@ -268,3 +324,138 @@ SCENARIO( "PrintGCode basic functionality", "[PrintGCode]") {
         }
     }
 }
+
+SCENARIO( "PrintGCode layer pipeline", "[PrintGCode]") {
+    // Strip the "generated by ... on <timestamp>" header.
+    auto strip_header = [](const std::string &gcode) { return gcode.substr(gcode.find('\n')); };
+    auto gcode_with_threads = [](int num_threads, std::initializer_list<TestMesh> meshes, std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> config_items) {
+        std::string gcode;
+        tbb::task_arena arena(num_threads);
+        arena.execute([&gcode, &meshes, &config_items]() {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            ::Test::init_print(meshes, print, model, config_items);
+            check_instances(print, model);
+            gcode = ::Test::gcode(print);
+        });
+        return gcode;
+    };
+    GIVEN("Three objects with supports and cooling") {
+        std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> config_items {
+            { "gcode_comments",                 true },
+            { "support_material",               true },
+            { "cooling",                        "1" },
+            { "slowdown_below_layer_time",      "30" },
+            { "layer_height",                   0.3 },
+            { "first_layer_height",             0.3 }
+        };
+        WHEN("the G-code is exported with a single thread and with multiple threads") {
+            std::string gcode_serial   = gcode_with_threads(1, { TestMesh::cube_20x20x20, TestMesh::overhang, TestMesh::sphere_50mm }, config_items);
+            std::string gcode_parallel = gcode_with_threads(8, { TestMesh::cube_20x20x20, TestMesh::overhang, TestMesh::sphere_50mm }, config_items);
+            THEN("the outputs are identical") {
+                REQUIRE(! gcode_serial.empty());
+                REQUIRE(strip_header(gcode_serial) == strip_header(gcode_parallel));
+            }
+        }
+    }
+    GIVEN("Two objects printed sequentially") {
+        std::initializer_list<Slic3r::ConfigBase::SetDeserializeItem> config_items {
+            { "complete_objects",               true },
+            { "gcode_comments",                 true },
+            { "layer_height",                   0.5 },
+            { "first_layer_height",             0.5 }
+        };
+        WHEN("the G-code is exported with a single thread and with multiple threads") {
+            std::string gcode_serial   = gcode_with_threads(1, { TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, config_items);
+            std::string gcode_parallel = gcode_with_threads(8, { TestMesh::cube_20x20x20, TestMesh::cube_20x20x20 }, config_items);
+            THEN("the outputs are identical") {
+                REQUIRE(! gcode_serial.empty());
+                REQUIRE(strip_header(gcode_serial) == strip_header(gcode_parallel));
+            }
+        }
+    }
+}
+
+SCENARIO( "PrintGCode preview of the layers exported so far", "[PrintGCode]") {
+    // Length of the extrusions per print_z.
+    auto extrusion_lengths = [](const GCodePreviewData::Extrusion::LayersList &layers) {
+        std::map<float, double> lengths;
+        for (const GCodePreviewData::Extrusion::Layer &layer : layers)
+            for (const GCodePreviewData::Extrusion::Path &path : layer.paths)
+                lengths[layer.z] += unscale<double>(path.polyline.length());
+        return lengths;
+    };
+    GIVEN("A sphere exported with the G-code preview enabled") {
+        Slic3r::Print print;
+        Slic3r::Model model;
+        Slic3r::Test::init_print({TestMesh::sphere_50mm}, print, model, {
+            { "layer_height",       0.3 },
+            { "first_layer_height", 0.3 }
+            });
+        check_instances(print, model);
+        GCodePreviewData::Extrusion::LayersList streamed;
+        GCodePreviewData::Ranges                streamed_ranges;
+        size_t num_batches = 0;
+        print.set_gcode_preview_layers_callback([&streamed, &streamed_ranges, &num_batches](GCodePreviewData &&batch) {
+            streamed.insert(streamed.end(), std::make_move_iterator(batch.extrusion.layers.begin()), std::make_move_iterator(batch.extrusion.layers.end()));
+            // Each batch carries the ranges of the layers streamed so far, they may only grow.
+            if (num_batches > 0) {
+                REQUIRE(batch.ranges.height.min <= streamed_ranges.height.min);
+                REQUIRE(batch.ranges.feedrate.max >= streamed_ranges.feedrate.max);
+            }
+            streamed_ranges = batch.ranges;
+            ++ num_batches;
+        });
+        GCodePreviewData preview_data;
+        boost::filesystem::path temp = boost::filesystem::unique_path();
+        print.set_status_silent();
+        print.process();
+        print.export_gcode(temp.string(), &preview_data);
+        boost::nowide::remove(temp.string().c_str());
+        THEN("the streamed layers contain the extrusions of the final preview") {
+            REQUIRE(num_batches > 0);
+            std::map<float, double> lengths          = extrusion_lengths(preview_data.extrusion.layers);
+            std::map<float, double> lengths_streamed = extrusion_lengths(streamed);
+            REQUIRE(lengths.size() > 100);
+            REQUIRE(lengths_streamed.size() == lengths.size());
+            for (const std::pair<const float, double> &length : lengths) {
+                INFO("print_z " << length.first);
+                REQUIRE(lengths_streamed[length.first] == Approx(length.second));
+            }
+        }
+        THEN("the ranges of the last streamed batch cover all the streamed layers, so the legend shown while streaming is valid") {
+            REQUIRE(! streamed_ranges.height.empty());
+            for (const GCodePreviewData::Extrusion::Layer &layer : streamed)
+                for (const GCodePreviewData::Extrusion::Path &path : layer.paths) {
+                    REQUIRE(streamed_ranges.height.min   <= path.height);
+                    REQUIRE(streamed_ranges.height.max   >= path.height);
+                    REQUIRE(streamed_ranges.width.min    <= path.width);
+                    REQUIRE(streamed_ranges.width.max    >= path.width);
+                    REQUIRE(streamed_ranges.feedrate.min <= path.feedrate);
+                    REQUIRE(streamed_ranges.feedrate.max >= path.feedrate);
+                }
+            // The final preview also contains the moves exported after the last layer, which are not streamed.
+            REQUIRE(streamed_ranges.height.min   >= preview_data.ranges.height.min);
+            REQUIRE(streamed_ranges.height.max   <= preview_data.ranges.height.max);
+            REQUIRE(streamed_ranges.feedrate.min >= preview_data.ranges.feedrate.min);
+            REQUIRE(streamed_ranges.feedrate.max <= preview_data.ranges.feedrate.max);
+        }
+    }
+}
+
+TEST_CASE("GCodeOutputStream writes long formatted lines completely", "[PrintGCode]") {
+    FILE *file = std::tmpfile();
+    REQUIRE(file != nullptr);
+    std::string comment(3000, 'x');
+    {
+        GCodeOutputStream stream(file, nullptr, nullptr);
+        stream.write_format("; %s\n", comment.c_str());
+        stream.write("G1 X10\n");
+        stream.finalize();
+    }
+    std::string out(4096, '\0');
+    rewind(file);
+    out.resize(fread(&out.front(), 1, out.size(), file));
+    fclose(file);
+    REQUIRE(out == "; " + comment + "\nG1 X10\n");
+}
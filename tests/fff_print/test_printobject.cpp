@@ -2,12 +2,28 @@
 
 #include "libslic3r/libslic3r.h"
 #include "libslic3r/Print.hpp"
+#include "libslic3r/SliceCache.hpp"
+
+#include <map>
+#include <tuple>
+#include <boost/filesystem.hpp>
 
 #include "test_data.hpp"
 
 using namespace Slic3r;
 using namespace Slic3r::Test;
 
+// The instances added by init_print() are not checked in the object list, thus they would not be printed.
+// Check all the instances of the model and apply the model to the print again.
+static void check_instances(Print &print, Model &model)
+{
+    for (ModelObject *mo : model.objects)
+        for (ModelInstance *mi : mo->instances)
+            mi->checked = true;
+    print.apply(model, print.full_print_config());
+    print.validate();
+}
+
 SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
     GIVEN("20mm cube and default initial config, initial layer height of 2mm") {
         WHEN("generate_object_layers() is called for 2mm layer heights and nozzle diameter of 3mm") {
@@ -86,3 +102,147 @@ SCENARIO("PrintObject: object layer heights", "[PrintObject]") {
 #endif
     }
 }
+
+SCENARIO("PrintObject: slice cache", "[PrintObject]") {
+    GIVEN("50mm sphere sliced with an empty slice cache") {
+        boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("slice_cache_%%%%-%%%%");
+        auto cache = std::make_shared<SliceCache>(dir.string());
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({ { "layer_height", 0.3 } });
+        auto slice_with_cache = [&config](std::shared_ptr<SliceCache> cache) {
+            auto print = std::make_unique<Print>();
+            Model model;
+            Slic3r::Test::init_print({TestMesh::sphere_50mm}, *print, model, config);
+            check_instances(*print, model);
+            print->set_slice_cache(cache);
+            print->process();
+            return print;
+        };
+        std::unique_ptr<Print> print_reference = slice_with_cache(nullptr);
+        std::unique_ptr<Print> print_first     = slice_with_cache(cache);
+        THEN("The cache entries are written") {
+            REQUIRE(cache->hits() == 0);
+            REQUIRE(cache->misses() > 0);
+            REQUIRE(! boost::filesystem::is_empty(dir));
+        }
+        WHEN("The same object is sliced again") {
+            size_t misses = cache->misses();
+            std::unique_ptr<Print> print_second = slice_with_cache(cache);
+            THEN("The slices are loaded from the cache") {
+                REQUIRE(cache->hits() > 0);
+                REQUIRE(cache->misses() == misses);
+            }
+            THEN("The slices are the same as the slices computed without the cache") {
+                const LayerPtrs &layers_reference = print_reference->objects().front()->layers();
+                const LayerPtrs &layers_second    = print_second->objects().front()->layers();
+                REQUIRE(layers_second.size() == layers_reference.size());
+                for (size_t i = 0; i < layers_reference.size(); ++ i)
+                    REQUIRE(SliceCache::serialize({ layers_second[i]->slices }) == SliceCache::serialize({ layers_reference[i]->slices }));
+            }
+        }
+        WHEN("An entry is truncated") {
+            std::vector<ExPolygons> layers { print_reference->objects().front()->layers()[10]->slices };
+            const std::string key = "truncated";
+            cache->store(key, layers);
+            boost::filesystem::path path = dir / (key + ".slices");
+            REQUIRE(boost::filesystem::exists(path));
+            std::vector<ExPolygons> loaded;
+            REQUIRE(cache->load(key, loaded));
+            REQUIRE(loaded.front().size() == layers.front().size());
+            boost::filesystem::resize_file(path, boost::filesystem::file_size(path) - 1);
+            size_t misses = cache->misses();
+            THEN("It is rejected") {
+                REQUIRE(! cache->load(key, loaded));
+                REQUIRE(loaded.empty());
+                REQUIRE(cache->misses() == misses + 1);
+            }
+        }
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(dir, ec);
+    }
+}
+
+SCENARIO("PrintObject: surface types detected with the perimeters", "[PrintObject]") {
+    GIVEN("50mm sphere") {
+        auto surface_areas = [](bool interface_shells) {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            Slic3r::Test::init_print({TestMesh::sphere_50mm}, print, model, {
+                { "layer_height",       0.3 },
+                { "interface_shells",   interface_shells }
+            });
+            check_instances(print, model);
+            print.process();
+            std::vector<double> areas(size_t(stCount), 0.);
+            for (const Layer *layer : print.objects().front()->layers())
+                for (const LayerRegion *layerm : layer->regions())
+                    for (const Surface &surface : layerm->fill_surfaces.surfaces)
+                        areas[size_t(surface.surface_type)] += surface.area();
+            return areas;
+        };
+        WHEN("The surface types are classified while generating the perimeters") {
+            // With a single region, interface shells classify the surfaces the same way, but only after all perimeters are generated.
+            std::vector<double> areas_wavefront = surface_areas(false);
+            std::vector<double> areas_barrier   = surface_areas(true);
+            THEN("The fill surfaces are the same as if the surfaces were classified after the perimeters") {
+                REQUIRE(areas_wavefront[stTop] > 0.);
+                REQUIRE(areas_wavefront[stBottomBridge] + areas_wavefront[stBottom] > 0.);
+                for (size_t surface_type = 0; surface_type < size_t(stCount); ++ surface_type)
+                    REQUIRE(areas_wavefront[surface_type] == Approx(areas_barrier[surface_type]).epsilon(0.02));
+            }
+        }
+    }
+}
+
+SCENARIO("PrintObject: bridge over infill and combined infill", "[PrintObject]") {
+    GIVEN("20mm cube with sparse infill combined every 2 layers") {
+        DynamicPrintConfig config = DynamicPrintConfig::full_print_config();
+        config.set_deserialize({
+            { "layer_height",           0.2 },
+            { "fill_density",           "20%" },
+            { "infill_every_layers",    2 }
+        });
+        WHEN("The print is processed") {
+            Slic3r::Print print;
+            Slic3r::Model model;
+            Slic3r::Test::init_print({TestMesh::cube_20x20x20}, print, model, config);
+            check_instances(print, model);
+            print.process();
+            const PrintObject &object = *print.objects().front();
+            // Number and area (mm^2) of the fill surfaces by the surface type and the number of combined layers.
+            std::map<std::pair<SurfaceType, unsigned short>, std::pair<size_t, double>> fill_surfaces;
+            std::vector<size_t> bridged_layers;
+            for (const Layer *layer : object.layers())
+                for (const LayerRegion *layerm : layer->regions())
+                    for (const Surface &surface : layerm->fill_surfaces.surfaces) {
+                        std::pair<size_t, double> &stat = fill_surfaces[std::make_pair(surface.surface_type, surface.thickness_layers)];
+                        ++ stat.first;
+                        stat.second += surface.expolygon.area() * SCALING_FACTOR * SCALING_FACTOR;
+                        if (surface.surface_type == stInternalBridge)
+                            bridged_layers.emplace_back(layer->id());
+                    }
+            THEN("The fill surfaces match the ones produced by the layer by layer sweeps") {
+                // Sparse infill is combined in pairs of layers, leaving a void in the lower layer of each pair.
+                // The internal solid layers are bridged over the sparse infill below the top solid layers.
+                const std::vector<std::tuple<SurfaceType, unsigned short, size_t, double>> expected {
+                    { stTop,            1, 1,    307.126326 },
+                    { stBottom,         1, 1,    260.823308 },
+                    { stInternal,       1, 1,    307.125625 },
+                    { stInternal,       2, 46, 14127.778750 },
+                    { stInternalSolid,  1, 3,    921.378978 },
+                    { stInternalBridge, 1, 1,    307.125625 },
+                    { stInternalVoid,   1, 46, 14127.778750 }
+                };
+                REQUIRE(object.layers().size() == 99);
+                REQUIRE(fill_surfaces.size() == expected.size());
+                for (const std::tuple<SurfaceType, unsigned short, size_t, double> &e : expected) {
+                    auto it = fill_surfaces.find(std::make_pair(std::get<0>(e), std::get<1>(e)));
+                    REQUIRE(it != fill_surfaces.end());
+                    REQUIRE(it->second.first == std::get<2>(e));
+                    REQUIRE(it->second.second == Approx(std::get<3>(e)).epsilon(1e-6));
+                }
+                REQUIRE(bridged_layers == std::vector<size_t>{ 96 });
+            }
+        }
+    }
+}
@@ -212,3 +212,69 @@ SCENARIO("Constant offset", "[ClipperUtils]") {
 		}
 	}
 }
+
+static double area_mm2(const ExPolygons &expolygons)
+{
+	double area = 0.;
+	for (const Polygon &polygon : to_polygons(expolygons))
+		area += polygon.area();
+	return area * SCALING_FACTOR * SCALING_FACTOR;
+}
+
+// Comb with 1mm wide teeth next to a box with a square hole.
+static ExPolygons comb_and_box_with_hole()
+{
+	coord_t s = 1000000;
+	ExPolygon comb;
+	comb.contour.points = { { 0, 0 }, { 30 * s, 0 }, { 30 * s, 15 * s } };
+	for (coord_t x = 29 * s; x > 0; x -= 3 * s) {
+		comb.contour.points.emplace_back(x, 15 * s);
+		comb.contour.points.emplace_back(x, 5 * s);
+		comb.contour.points.emplace_back(x - 2 * s, 5 * s);
+		comb.contour.points.emplace_back(x - 2 * s, 15 * s);
+	}
+	comb.contour.points.emplace_back(0, 15 * s);
+	ExPolygon box;
+	box.contour.points = { { 40 * s, 0 }, { 60 * s, 0 }, { 60 * s, 20 * s }, { 40 * s, 20 * s } };
+	box.holes.emplace_back(Points{ { 47 * s, 7 * s }, { 47 * s, 13 * s }, { 53 * s, 13 * s }, { 53 * s, 7 * s } });
+	return { comb, box };
+}
+
+SCENARIO("Offset ladder", "[ClipperUtils]") {
+	coord_t s = 1000000;
+	GIVEN("Comb and box with a hole") {
+		ExPolygons island = comb_and_box_with_hole();
+		for (float collapse : { 0.f, 0.2f * s }) {
+			DYNAMIC_SECTION("Insets of 0.45mm, collapse " << collapse / s << "mm") {
+				float      delta = 0.45f * s;
+				OffsetLadder ladder(island);
+				ExPolygons last = island;
+				for (int i = 0; i < 12 && ! last.empty(); ++ i) {
+					ExPolygons level = ladder.inset(delta, collapse);
+					ExPolygons level_ref = collapse > 0.f ? offset2_ex(last, - delta - collapse, collapse) : offset_ex(last, - delta);
+					ExPolygons gaps      = ladder.gaps(0.5f * delta, 0.5f * delta + 10.f);
+					ExPolygons gaps_ref  = diff_ex(offset(last, - 0.5f * delta), offset(level_ref, 0.5f * delta + 10.f));
+					INFO("Level " << i);
+					REQUIRE(level.size() == level_ref.size());
+					REQUIRE(area_mm2(level) == Approx(area_mm2(level_ref)).margin(0.001));
+					REQUIRE(area_mm2(gaps) == Approx(area_mm2(gaps_ref)).margin(0.001));
+					last = std::move(level_ref);
+				}
+			}
+		}
+		WHEN("Thin walls are detected") {
+			float      width    = 0.5f * s;
+			float      collapse = 0.6f * s;
+			ExPolygons level = offset2_ex(island, - width - collapse, collapse);
+			OffsetLadder ladder(island);
+			ladder.push(level);
+			ExPolygons thin_walls     = ladder.thin_walls(width, 0.1f * s);
+			ExPolygons thin_walls_ref = offset2_ex(diff_ex(to_polygons(island), offset(level, width), true), - 0.1f * s, 0.1f * s);
+			THEN("Thin walls match the offsets calculated one by one") {
+				REQUIRE(! thin_walls.empty());
+				REQUIRE(thin_walls.size() == thin_walls_ref.size());
+				REQUIRE(area_mm2(thin_walls) == Approx(area_mm2(thin_walls_ref)).margin(0.001));
+			}
+		}
+	}
+}
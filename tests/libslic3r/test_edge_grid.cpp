@@ -0,0 +1,80 @@
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <random>
+
+#include "libslic3r/EdgeGrid.hpp"
+
+using namespace Slic3r;
+
+// Gear like contour with a circular hole, sampled finely enough to place many edges into each grid cell.
+static ExPolygon gear(double radius, int num_teeth, int segments_per_tooth)
+{
+	ExPolygon out;
+	int n = num_teeth * segments_per_tooth;
+	for (int i = 0; i < n; ++ i) {
+		double a = 2. * PI * double(i) / double(n);
+		double r = radius * (1. + 0.1 * std::sin(a * num_teeth));
+		out.contour.points.emplace_back(Point::new_scale(r * std::cos(a), r * std::sin(a)));
+	}
+	Polygon hole;
+	for (int i = n - 1; i >= 0; -- i) {
+		double a = 2. * PI * double(i) / double(n);
+		hole.points.emplace_back(Point::new_scale(0.3 * radius * std::cos(a), 0.3 * radius * std::sin(a)));
+	}
+	out.holes.emplace_back(std::move(hole));
+	return out;
+}
+
+static Points random_points(const BoundingBox &bbox, size_t num_points)
+{
+	std::mt19937 rng(0);
+	std::uniform_int_distribution<coord_t> dx(bbox.min.x(), bbox.max.x());
+	std::uniform_int_distribution<coord_t> dy(bbox.min.y(), bbox.max.y());
+	Points out;
+	out.reserve(num_points);
+	for (size_t i = 0; i < num_points; ++ i)
+		out.emplace_back(dx(rng), dy(rng));
+	return out;
+}
+
+SCENARIO("EdgeGrid batch signed distance", "[EdgeGrid]") {
+	GIVEN("Gear with a hole") {
+		ExPolygon 	   shape = gear(20., 30, 24);
+		EdgeGrid::Grid grid;
+		grid.create(shape, coord_t(scale_(1.)));
+		BoundingBox bbox = grid.bbox();
+		bbox.offset(scale_(3.));
+		Points 	pts 		  = random_points(bbox, 20000);
+		coord_t search_radius = coord_t(scale_(0.6));
+		WHEN("The signed distance field is not calculated") {
+			std::vector<coordf_t> dist = grid.signed_distance(pts, search_radius);
+			THEN("The batch query matches the queries one by one") {
+				REQUIRE(dist.size() == pts.size());
+				size_t num_found = 0;
+				for (size_t i = 0; i < pts.size(); ++ i) {
+					coordf_t d;
+					bool found = grid.signed_distance(pts[i], search_radius, d);
+					REQUIRE(found == ! std::isnan(dist[i]));
+					if (found) {
+						REQUIRE(dist[i] == Approx(d).margin(1e-3));
+						++ num_found;
+					}
+				}
+				REQUIRE(num_found > 0);
+				REQUIRE(num_found < pts.size());
+			}
+		}
+		WHEN("The signed distance field is calculated") {
+			grid.calculate_sdf();
+			std::vector<coordf_t> dist = grid.signed_distance(pts, search_radius);
+			THEN("The batch query matches the queries one by one") {
+				for (size_t i = 0; i < pts.size(); ++ i) {
+					coordf_t d;
+					REQUIRE(grid.signed_distance(pts[i], search_radius, d));
+					REQUIRE(dist[i] == Approx(d).margin(1e-3));
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,123 @@
+#include <catch2/catch.hpp>
+
+#include <thread>
+
+#include <tbb/task_arena.h>
+
+#include "libslic3r/Geometry.hpp"
+#include "libslic3r/TriangleMesh.hpp"
+#include "libslic3r/Format/OBJ.hpp"
+
+using namespace Slic3r;
+
+static std::vector<float> slicing_heights(const TriangleMesh &mesh, float layer_height)
+{
+    std::vector<float> z;
+    BoundingBoxf3 bbox = mesh.bounding_box();
+    for (double h = bbox.min.z() + 0.5 * layer_height; h < bbox.max.z(); h += layer_height)
+        z.emplace_back(float(h));
+    return z;
+}
+
+static TriangleMesh load_test_mesh(const char *obj_filename)
+{
+    TriangleMesh mesh;
+    load_obj((std::string(TEST_DATA_DIR) + "/" + obj_filename).c_str(), &mesh);
+    mesh.repair();
+    return mesh;
+}
+
+static std::vector<Polygons> slice_with_slicer(const TriangleMeshSlicer &slicer, const std::vector<float> &z)
+{
+    std::vector<Polygons> layers;
+    slicer.slice(z, &layers, [](){});
+    return layers;
+}
+
+static double total_area(const Polygons &polygons)
+{
+    double area = 0.;
+    for (const Polygon &polygon : polygons)
+        area += polygon.area();
+    return area;
+}
+
+// Slice the mesh with the TBB scheduler limited to num_threads.
+static std::vector<Polygons> slice_with_threads(const TriangleMesh &mesh, const std::vector<float> &z, int num_threads)
+{
+    std::vector<Polygons> layers;
+    tbb::task_arena arena(num_threads);
+    arena.execute([&mesh, &z, &layers]() {
+        TriangleMeshSlicer slicer(&mesh);
+        slicer.slice(z, &layers, [](){});
+    });
+    return layers;
+}
+
+TEST_CASE("Slicing result does not depend on the number of threads", "[TriangleMeshSlicer]") {
+    TriangleMesh mesh = make_sphere(20., 2. * PI / 360.);
+    std::vector<float> z = slicing_heights(mesh, 0.1f);
+    std::vector<Polygons> serial   = slice_with_threads(mesh, z, 1);
+    std::vector<Polygons> parallel = slice_with_threads(mesh, z, std::max(2, int(std::thread::hardware_concurrency())));
+    REQUIRE(serial.size() == z.size());
+    REQUIRE(parallel.size() == z.size());
+    for (size_t i = 0; i < z.size(); ++ i) {
+        REQUIRE(serial[i].size() == parallel[i].size());
+        for (size_t j = 0; j < serial[i].size(); ++ j)
+            REQUIRE(serial[i][j].points == parallel[i][j].points);
+    }
+}
+
+TEST_CASE("Sweep plane slicing produces the same slices as slicing per facet", "[TriangleMeshSlicer]") {
+    for (const char *obj_filename : { "20mm_cube.obj", "pyramid.obj", "frog_legs.obj", "extruder_idler.obj", "ipadstand.obj" }) {
+        TriangleMesh mesh = load_test_mesh(obj_filename);
+        TriangleMeshSlicer slicer(&mesh);
+        TriangleMeshSlicer slicer_sweep(&mesh);
+        slicer_sweep.build_z_index();
+        REQUIRE(slicer_sweep.has_z_index());
+        // The index is reused by slicing with different layer heights.
+        for (float layer_height : { 0.3f, 0.1f, 0.05f }) {
+            std::vector<float> z = slicing_heights(mesh, layer_height);
+            std::vector<Polygons> layers       = slice_with_slicer(slicer, z);
+            std::vector<Polygons> layers_sweep = slice_with_slicer(slicer_sweep, z);
+            REQUIRE(layers.size() == layers_sweep.size());
+            for (size_t i = 0; i < layers.size(); ++ i) {
+                INFO(obj_filename << " layer height " << layer_height << " layer " << i);
+                REQUIRE(layers[i].size() == layers_sweep[i].size());
+                REQUIRE(total_area(layers[i]) == Approx(total_area(layers_sweep[i])));
+            }
+        }
+    }
+}
+
+TEST_CASE("Slicing with a transformation produces the same slices as slicing a transformed copy", "[TriangleMeshSlicer]") {
+    const Transform3d trafos[] = {
+        Geometry::assemble_transform(Vec3d(10., -5., 2.), Vec3d(0.3, -0.2, 1.1), Vec3d(1.5, 0.8, 1.2)),
+        // Left handed, the facets are flipped.
+        Geometry::assemble_transform(Vec3d(-3., 7., 0.), Vec3d(0., 0.4, 0.), Vec3d::Ones(), Vec3d(-1., 1., 1.))
+    };
+    for (const char *obj_filename : { "20mm_cube.obj", "pyramid.obj", "frog_legs.obj", "extruder_idler.obj" }) {
+        TriangleMesh mesh = load_test_mesh(obj_filename);
+        std::shared_ptr<const std::vector<int>> facets_edges = TriangleMeshSlicer::make_facets_edges(mesh);
+        for (const Transform3d &trafo : trafos) {
+            TriangleMesh mesh_transformed = mesh;
+            mesh_transformed.transform(trafo, true);
+            std::vector<float> z = slicing_heights(mesh_transformed, 0.2f);
+            TriangleMeshSlicer slicer(&mesh_transformed);
+            TriangleMeshSlicer slicer_trafo;
+            slicer_trafo.init(&mesh, trafo, facets_edges, [](){});
+            std::vector<Polygons> layers       = slice_with_slicer(slicer, z);
+            std::vector<Polygons> layers_trafo = slice_with_slicer(slicer_trafo, z);
+            slicer_trafo.build_z_index();
+            std::vector<Polygons> layers_sweep = slice_with_slicer(slicer_trafo, z);
+            REQUIRE(layers.size() == layers_trafo.size());
+            REQUIRE(layers.size() == layers_sweep.size());
+            for (size_t i = 0; i < layers.size(); ++ i) {
+                INFO(obj_filename << " layer " << i);
+                REQUIRE(layers[i].size() == layers_trafo[i].size());
+                REQUIRE(total_area(layers_trafo[i]) == Approx(total_area(layers[i])));
+                REQUIRE(total_area(layers_sweep[i]) == Approx(total_area(layers_trafo[i])));
+            }
+        }
+    }
+}
@@ -1,5 +1,10 @@
 #include <catch2/catch.hpp>
 
+#include <random>
+
+#include <boost/filesystem.hpp>
+#include <boost/nowide/fstream.hpp>
+
 #include "libslic3r/Model.hpp"
 #include "libslic3r/Format/STL.hpp"
 
@@ -55,3 +60,76 @@ SCENARIO("Reading an STL file", "[stl]") {
 		}
 	}
 }
+
+// Random facets, which survive a round trip through an ASCII STL exactly, as stl_write_ascii() prints 9 significant digits.
+static stl_file random_stl(size_t num_facets)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> coordinate(-100.f, 100.f);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	stl_file stl;
+	stl.stats.type = inmemory;
+	stl.stats.number_of_facets = uint32_t(num_facets);
+	stl.stats.original_num_facets = int(num_facets);
+	stl_allocate(&stl);
+	for (stl_facet &facet : stl.facet_start) {
+		facet.normal = stl_normal(unit(rng), unit(rng), unit(rng));
+		for (stl_vertex &v : facet.vertex)
+			v = stl_vertex(coordinate(rng), coordinate(rng), coordinate(rng));
+	}
+	return stl;
+}
+
+static bool same_facets(const stl_file &stl1, const stl_file &stl2)
+{
+	return stl1.facet_start.size() == stl2.facet_start.size() &&
+		std::equal(stl1.facet_start.begin(), stl1.facet_start.end(), stl2.facet_start.begin(),
+			[](const stl_facet &f1, const stl_facet &f2) { return memcmp(&f1, &f2, 48) == 0; });
+}
+
+SCENARIO("Loading large STL files", "[stl]") {
+	GIVEN("a random mesh, whose ASCII STL spans several blocks parsed in parallel") {
+		stl_file stl = random_stl(40000);
+		boost::filesystem::path dir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("stl_load_%%%%-%%%%");
+		boost::filesystem::create_directories(dir);
+		std::string path_ascii  = (dir / "random-ascii.stl").string();
+		std::string path_binary = (dir / "random-binary.stl").string();
+		REQUIRE(stl_write_ascii(&stl, path_ascii.c_str(), "random"));
+		REQUIRE(stl_write_binary(&stl, path_binary.c_str(), "random"));
+		WHEN("the ASCII and binary STL files are loaded") {
+			stl_file stl_ascii, stl_binary;
+			bool ascii_loaded  = stl_open(&stl_ascii,  path_ascii.c_str());
+			bool binary_loaded = stl_open(&stl_binary, path_binary.c_str());
+			THEN("both load the original facets exactly") {
+				REQUIRE(ascii_loaded);
+				REQUIRE(binary_loaded);
+				REQUIRE(stl_ascii.stats.type == ascii);
+				REQUIRE(stl_binary.stats.type == binary);
+				REQUIRE(stl_ascii.stats.number_of_facets == 40000);
+				REQUIRE(stl_binary.stats.number_of_facets == 40000);
+				REQUIRE(std::string(stl_ascii.stats.header) == "solid  random");
+				REQUIRE(std::string(stl_binary.stats.header) == "random");
+				REQUIRE(same_facets(stl_ascii, stl));
+				REQUIRE(same_facets(stl_binary, stl));
+				REQUIRE(stl_ascii.stats.min == stl_binary.stats.min);
+				REQUIRE(stl_ascii.stats.max == stl_binary.stats.max);
+			}
+		}
+		WHEN("the ASCII STL file is truncated after the endloop of the 20000th facet") {
+			size_t size = 0;
+			{
+				boost::nowide::ifstream file(path_ascii, std::ios::binary);
+				std::string line;
+				for (size_t num_endloops = 0; num_endloops < 20000 && std::getline(file, line); size += line.size() + 1)
+					if (line == "    endloop")
+						++ num_endloops;
+			}
+			boost::filesystem::resize_file(path_ascii, size);
+			stl_file stl_ascii;
+			THEN("load fails, as the facet count estimated from the number of lines includes the incomplete facet") {
+				REQUIRE(! stl_open(&stl_ascii, path_ascii.c_str()));
+			}
+		}
+		boost::filesystem::remove_all(dir);
+	}
+}